@@ -0,0 +1,156 @@
+#include "BenchmarkCommandlet.h"
+#include "BenchmarkScenarios.h"
+#include "ControlLinkServer.h"
+#include "HAL/PlatformTime.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+#include "Serialization/JsonSerializer.h"
+#include "Serialization/JsonWriter.h"
+
+#if PLATFORM_UNIX || PLATFORM_MAC || PLATFORM_ANDROID
+#include <time.h>
+#endif
+
+namespace {
+using FScenarioFunc = bool (*)(const FString &, TSharedRef<FJsonObject>);
+
+struct FScenarioEntry {
+  const TCHAR *Name;
+  FScenarioFunc Func;
+};
+
+const FScenarioEntry Scenarios[] = {
+    {TEXT("CodecDecode"), &BenchmarkScenarios::RunCodecDecode},
+    {TEXT("ControlSampling"), &BenchmarkScenarios::RunControlSampling},
+    {TEXT("Discovery"), &BenchmarkScenarios::RunDiscovery},
+    {TEXT("FecRecovery"), &BenchmarkScenarios::RunFecRecovery},
+    {TEXT("ImpairmentProxy"), &BenchmarkScenarios::RunImpairmentProxy},
+    {TEXT("Kernels"), &BenchmarkScenarios::RunKernels},
+    {TEXT("MotionToPhoton"), &BenchmarkScenarios::RunMotionToPhoton},
+    {TEXT("Pipeline"), &BenchmarkScenarios::RunPipeline},
+    {TEXT("PosePrediction"), &BenchmarkScenarios::RunPosePrediction},
+    {TEXT("RedundancyLoss"), &BenchmarkScenarios::RunRedundancyLoss},
+    {TEXT("RobotStandIn"), &BenchmarkScenarios::RunRobotStandIn},
+    {TEXT("VideoReprojection"), &BenchmarkScenarios::RunVideoReprojection},
+    {TEXT("WireCodec"), &BenchmarkScenarios::RunWireCodec},
+};
+} // namespace
+
+double FBenchmarkSamples::Mean() const {
+  if (Values.Num() == 0) {
+    return 0.0;
+  }
+  double Sum = 0.0;
+  for (double Value : Values) {
+    Sum += Value;
+  }
+  return Sum / Values.Num();
+}
+
+double FBenchmarkSamples::Percentile(double P) const {
+  if (Values.Num() == 0) {
+    return 0.0;
+  }
+  TArray<double> Sorted = Values;
+  Sorted.Sort();
+  const double Rank = FMath::Clamp(P, 0.0, 100.0) / 100.0 * (Sorted.Num() - 1);
+  const int32 Lower = FMath::FloorToInt32(Rank);
+  const int32 Upper = FMath::Min(Lower + 1, Sorted.Num() - 1);
+  return FMath::Lerp(Sorted[Lower], Sorted[Upper], Rank - Lower);
+}
+
+double FBenchmarkSamples::MedianAbsoluteDeviation() const {
+  const double Median = Percentile(50.0);
+  FBenchmarkSamples Deviations;
+  for (double Value : Values) {
+    Deviations.Add(FMath::Abs(Value - Median));
+  }
+  return Deviations.Percentile(50.0);
+}
+
+TSharedRef<FJsonObject> FBenchmarkSamples::ToJson() const {
+  TSharedRef<FJsonObject> Json = MakeShared<FJsonObject>();
+  Json->SetNumberField(TEXT("count"), Values.Num());
+  Json->SetNumberField(TEXT("mean"), Mean());
+  Json->SetNumberField(TEXT("p50"), Percentile(50.0));
+  Json->SetNumberField(TEXT("p95"), Percentile(95.0));
+  Json->SetNumberField(TEXT("p99"), Percentile(99.0));
+  Json->SetNumberField(TEXT("max"), Percentile(100.0));
+  return Json;
+}
+
+double GetThreadCpuSeconds() {
+#if PLATFORM_UNIX || PLATFORM_MAC || PLATFORM_ANDROID
+  struct timespec Ts;
+  if (clock_gettime(CLOCK_THREAD_CPUTIME_ID, &Ts) == 0) {
+    return Ts.tv_sec + Ts.tv_nsec * 1e-9;
+  }
+#endif
+  // No per-thread clock. Wall time would pass for CPU time in the reports.
+  return -1.0;
+}
+
+UBenchmarkCommandlet::UBenchmarkCommandlet() {
+  IsClient = false;
+  IsServer = false;
+  IsEditor = false;
+  LogToConsole = true;
+}
+
+int32 UBenchmarkCommandlet::Main(const FString &Params) {
+  FString Scenario;
+  if (!FParse::Value(*Params, TEXT("Scenario="), Scenario)) {
+    UE_LOG(LogTemp, Error, TEXT("Usage: -run=Benchmark -Scenario=<name>"));
+    for (const FScenarioEntry &Entry : Scenarios) {
+      UE_LOG(LogTemp, Display, TEXT("  %s"), Entry.Name);
+    }
+    return 1;
+  }
+
+  const FScenarioEntry *Found = nullptr;
+  for (const FScenarioEntry &Entry : Scenarios) {
+    if (Scenario.Equals(Entry.Name, ESearchCase::IgnoreCase)) {
+      Found = &Entry;
+      break;
+    }
+  }
+  if (!Found) {
+    UE_LOG(LogTemp, Error, TEXT("Unknown benchmark scenario: %s"), *Scenario);
+    return 1;
+  }
+
+  TSharedRef<FJsonObject> Report = MakeShared<FJsonObject>();
+  Report->SetStringField(TEXT("scenario"), Found->Name);
+  Report->SetStringField(TEXT("platform"),
+                         FPlatformProperties::IniPlatformName());
+  Report->SetStringField(TEXT("timestamp"), FDateTime::UtcNow().ToIso8601());
+  Report->SetStringField(TEXT("params"), Params);
+
+  // Stand-in robots on loopback must not be beaconed by later real sessions
+  FControlLinkServer::DisablePeerCache();
+
+  UE_LOG(LogTemp, Display, TEXT("Running benchmark scenario %s"), Found->Name);
+  const bool bSucceeded = Found->Func(Params, Report);
+  Report->SetBoolField(TEXT("succeeded"), bSucceeded);
+
+  FString Json;
+  TSharedRef<TJsonWriter<>> Writer = TJsonWriterFactory<>::Create(&Json);
+  FJsonSerializer::Serialize(Report, Writer);
+
+  FString OutputPath;
+  if (!FParse::Value(*Params, TEXT("Output="), OutputPath)) {
+    OutputPath = FPaths::ProjectSavedDir() / TEXT("Benchmarks") /
+                 FString::Printf(TEXT("%s-%s.json"), Found->Name,
+                                 *FDateTime::Now().ToString());
+  }
+  if (FFileHelper::SaveStringToFile(Json, *OutputPath)) {
+    UE_LOG(LogTemp, Display, TEXT("Benchmark report written to %s"),
+           *OutputPath);
+  } else {
+    UE_LOG(LogTemp, Error, TEXT("Failed to write benchmark report to %s"),
+           *OutputPath);
+  }
+  UE_LOG(LogTemp, Display, TEXT("%s"), *Json);
+
+  return bSucceeded ? 0 : 1;
+}
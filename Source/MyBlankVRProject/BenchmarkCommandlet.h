@@ -0,0 +1,19 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Commandlets/Commandlet.h"
+#include "BenchmarkCommandlet.generated.h"
+
+// Headless benchmark runner, e.g.
+//   UnrealEditor-Cmd MyBlankVRProject.uproject -run=Benchmark
+//       -Scenario=CodecDecode -nullrhi
+// Every scenario writes a JSON report to Saved/Benchmarks (or -Output=).
+UCLASS()
+class UBenchmarkCommandlet : public UCommandlet {
+  GENERATED_BODY()
+
+public:
+  UBenchmarkCommandlet();
+
+  virtual int32 Main(const FString &Params) override;
+};
@@ -0,0 +1,114 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Dom/JsonObject.h"
+
+// Timing samples collected by a scenario, summarized for the report.
+struct FBenchmarkSamples {
+  TArray<double> Values;
+
+  void Add(double Value) { Values.Add(Value); }
+  int32 Num() const { return Values.Num(); }
+
+  double Mean() const;
+  // Linearly interpolated percentile, P in [0, 100]
+  double Percentile(double P) const;
+  // Median distance from the median; a spread outliers barely move
+  double MedianAbsoluteDeviation() const;
+
+  // count, mean, p50, p95, p99 and max
+  TSharedRef<FJsonObject> ToJson() const;
+};
+
+// CPU time consumed so far by the calling thread, in seconds; negative where
+// the platform has no per-thread clock
+double GetThreadCpuSeconds();
+
+namespace BenchmarkScenarios {
+// Encodes a synthetic test pattern with H.264, H.265 and AV1 at the same
+// resolution and bitrate, then times decoding of each frame.
+bool RunCodecDecode(const FString &Params, TSharedRef<FJsonObject> Report);
+
+// Replays a known head motion through game ticks that hitch every
+// -HitchEvery seconds for -HitchMs, and once for -StallMs during a fast
+// turn, sampling control the old tick-gated way, every tick, and every tick
+// extrapolated to send time. Reports the sent pose's error against the true
+// one at each send, the largest jump between sends and any whole turns lost
+// to a wrong unwrap.
+bool RunControlSampling(const FString &Params, TSharedRef<FJsonObject> Report);
+
+// Starts the control link server against a loopback robot that answers
+// discovery beacons, -Trials times from a cold start, and reports the time
+// to find the robot, send it the first control packet and sync its clock.
+bool RunDiscovery(const FString &Params, TSharedRef<FJsonObject> Report);
+
+// Runs synthetic RTP through the FEC encoder, an impairment loss model and
+// the decoder, reporting residual loss and overhead per group size and loss
+// rate. -LossModel=GilbertElliott -BurstLength=N switches to bursty loss.
+bool RunFecRecovery(const FString &Params, TSharedRef<FJsonObject> Report);
+
+// Runs the UDP impairment proxy for -Duration seconds between -ListenPort
+// and -Upstream, configured from the FImpairmentConfig keys (Reverse.* for
+// the return path). Lets shell scripts put any local sender and receiver
+// behind a lossy link.
+bool RunImpairmentProxy(const FString &Params, TSharedRef<FJsonObject> Report);
+
+// Times the project's hot kernels in isolation at the sizes they run at:
+// YUV to BGRA conversion and scaling, the frame copies to the texture,
+// control packet encode, decode and CRC, clock sync fitting and mapping,
+// and the SPSC channel handoff, same-thread and across threads. Each is
+// reported as the median and MAD of -Batches batches of about -BatchMs, so
+// runs compare; -Filter= runs only the kernels whose name contains it.
+bool RunKernels(const FString &Params, TSharedRef<FJsonObject> Report);
+
+// Drives the control link against a loopback robot stand-in with set
+// uplink, actuation, frame rate and encode delays (-UplinkMs, -ActuationMs,
+// -FrameHz, -EncodeMs) whose frames are shown -DisplayMs after arrival, and
+// reports motion-to-photon latency split by stage. Fails if a stage's
+// median strays from what the stand-in was set to.
+bool RunMotionToPhoton(const FString &Params, TSharedRef<FJsonObject> Report);
+
+// Runs the real pipelines headless (-nullrhi) in a bare game world: a
+// player pawn carrying the control streamer and the video actor decoding
+// into its texture, ticked at -TickHz against a local robot stand-in sending
+// x264 video (the FRobotStandInConfig keys set it). After the first frame
+// is shown, measures -Seconds and reports fps, game tick and latency
+// percentiles, motion-to-photon by stage, CPU per thread, memory growth and
+// packet counts. Fails unless frames were shown and control was acked.
+bool RunPipeline(const FString &Params, TSharedRef<FJsonObject> Report);
+
+// Runs every head pose prediction model over a recorded head motion trace
+// (-Trace=, as written by the streamer's bRecordHeadMotion) or a synthetic
+// one, and reports the angular error against the actual pose at several
+// look-ahead horizons.
+bool RunPosePrediction(const FString &Params, TSharedRef<FJsonObject> Report);
+
+// Sends control at -RateHz through bursty and random loss models with each
+// redundancy mode (multi-sample bundles, spaced duplicates) and decodes it
+// as the robot would, reporting effective loss, bandwidth and the gaps
+// between fresh samples at the robot.
+bool RunRedundancyLoss(const FString &Params, TSharedRef<FJsonObject> Report);
+
+// Runs -Robots= local robot stand-ins (RobotStandIn.h) for -Seconds, each
+// on its own loopback address, the first -VideoStreams= of them streaming
+// video to consecutive port pairs ten apart; the FRobotStandInConfig keys
+// set the rest. Stands in for the robot when testing the headset on a
+// machine without one. -Link also runs a control link per stand-in
+// in-process and fails unless each synced, streamed control and heard
+// acks and telemetry.
+bool RunRobotStandIn(const FString &Params, TSharedRef<FJsonObject> Report);
+
+// Round-trips capture poses through the video SEI codec, then shows random
+// image points captured at one head pose at another, with each reprojection
+// mode, and reports how far from their captured direction they appear.
+// Fails if the SEI does not round-trip or the plane correction is not exact
+// within -MaxDegrees.
+bool RunVideoReprojection(const FString &Params,
+                          TSharedRef<FJsonObject> Report);
+
+// Round-trips random control, telemetry and clock-sync messages through the
+// wire codec, fuzzes the decoder with corrupted and random datagrams, and
+// times encode/decode of control packets. Fails on any mismatch or on a
+// corrupted packet being accepted.
+bool RunWireCodec(const FString &Params, TSharedRef<FJsonObject> Report);
+} // namespace BenchmarkScenarios
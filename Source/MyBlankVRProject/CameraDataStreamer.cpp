@@ -1,23 +1,67 @@
 #include "CameraDataStreamer.h"
-#include "CameraDataStreamerRunnable.h"
+#include "ClockSync.h"
+#include "ControlLinkServer.h"
+#include "MetricsEndpoint.h"
+#include "Misc/DateTime.h"
+#include "Misc/Paths.h"
+#include "RendezvousFallback.h"
 #include "MyVRPawn.h"
+#include "PipelineStats.h"
 #include "Engine/World.h"
 #include "GameFramework/PlayerController.h"
 #include "Engine/GameViewportClient.h"
 
 UCameraDataStreamer::UCameraDataStreamer()
-    : StreamerRunnable(nullptr), StreamerThread(nullptr)
 {
     PrimaryComponentTick.bCanEverTick = true;
+    // Sample after the camera has been updated for this frame
+    PrimaryComponentTick.TickGroup = TG_PostUpdateWork;
 }
 
 void UCameraDataStreamer::BeginPlay()
 {
     Super::BeginPlay();
 
-    // Start the worker thread
-    StreamerRunnable = new FCameraDataStreamerRunnable(&DataQueue, this);
-    StreamerThread = FRunnableThread::Create(StreamerRunnable, TEXT("CameraDataStreamerThread"));
+    TelemetryHistory.SetWindow(TelemetryWindowSeconds);
+
+    FControlLinkConfig Config;
+    Config.SendRateHz = ControlSendRateHz;
+    Config.bSendOnChange = bSendControlOnChange;
+    Config.HeartbeatSeconds = ControlHeartbeatInterval;
+    Config.RobotAddress = RobotAddress;
+    Config.PeerTimeoutSeconds = RobotTimeoutSeconds;
+    Config.RedundancySamples = ControlRedundancySamples;
+    Config.DuplicateCount = ControlDuplicates;
+    Config.DuplicateSpacingSeconds = ControlDuplicateSpacingMs / 1000.0;
+    Config.MaxExtrapolationSeconds = ControlMaxExtrapolationMs / 1000.0;
+    Config.MaxSampleAgeSeconds = ControlMaxSampleAgeMs / 1000.0;
+
+    FHeadPosePredictorConfig PredictorConfig;
+    PredictorConfig.Model = HeadPosePrediction;
+    PredictorConfig.MaxHorizonSeconds = MaxPredictionHorizonMs / 1000.0;
+    PredictorConfig.MaxLeadDegrees = MaxPredictionLeadDegrees;
+    PosePredictor.SetConfig(PredictorConfig);
+    RecordedHeadMotion.Reset();
+    CommandHistory.Reset();
+
+    Link = MakeShared<FControlLink, ESPMode::ThreadSafe>(Config);
+
+    // Starts the I/O thread if no other streamer has
+    LinkServer = FControlLinkServer::Acquire();
+    if (LinkServer)
+    {
+        if (bUseRemoteRendezvous)
+        {
+            LinkServer->SetRendezvousFallback(MakeShared<FHttpRendezvousFallback, ESPMode::ThreadSafe>());
+        }
+        LinkServer->AddLink(Link);
+    }
+
+    // Scrapes are optional; without the endpoint the metrics just go unread
+    if (MetricsPort > 0)
+    {
+        MetricsEndpoint = FMetricsEndpoint::Acquire(MetricsPort);
+    }
     
     // Get camera rotation
     APlayerController* PlayerController = GetWorld()->GetFirstPlayerController();
@@ -26,26 +70,30 @@ void UCameraDataStreamer::BeginPlay()
     if (PlayerController && PlayerController->PlayerCameraManager)
     {
         FRotator CameraRotation = PlayerController->PlayerCameraManager->GetCameraRotation();
-        PreviousYaw = CameraRotation.Yaw;
-        PreviousPitch = CameraRotation.Pitch;
-        AccumulatedYaw = 0.0f;
-        AccumulatedPitch = 0.0f;
+        PoseAccumulator.Reset(CameraRotation.Pitch, CameraRotation.Yaw, ClockSync::NowMicros());
     }
 }
 
 void UCameraDataStreamer::EndPlay(const EEndPlayReason::Type EndPlayReason)
 {
-    // Stop the worker thread
-    if (StreamerRunnable)
+    // The I/O thread stops with the last streamer's reference
+    if (LinkServer)
     {
-        StreamerRunnable->Stop();
-        StreamerThread->WaitForCompletion();
-
-        delete StreamerRunnable;
-        StreamerRunnable = nullptr;
+        LinkServer->RemoveLink(Link);
+        LinkServer.Reset();
+    }
+    Link.Reset();
+    MetricsEndpoint.Reset();
 
-        delete StreamerThread;
-        StreamerThread = nullptr;
+    if (bRecordHeadMotion && RecordedHeadMotion.Num() > 0)
+    {
+        const FString Path = FPaths::ProjectSavedDir() / TEXT("HeadMotion") /
+            FString::Printf(TEXT("HeadMotion-%s.csv"), *FDateTime::Now().ToString());
+        if (HeadMotionTrace::Save(Path, RecordedHeadMotion))
+        {
+            UE_LOG(LogTemp, Log, TEXT("Recorded %d head motion samples to %s"), RecordedHeadMotion.Num(), *Path);
+        }
+        RecordedHeadMotion.Empty();
     }
 
     Super::EndPlay(EndPlayReason);
@@ -54,104 +102,330 @@ void UCameraDataStreamer::EndPlay(const EEndPlayReason::Type EndPlayReason)
 void UCameraDataStreamer::TickComponent(float DeltaTime, ELevelTick TickType, FActorComponentTickFunction* ThisTickFunction)
 {
     Super::TickComponent(DeltaTime, TickType, ThisTickFunction);
-    
-    TimeSinceLastSend += DeltaTime;
-    
-    if (TimeSinceLastSend >= SendInterval) {
-        TimeSinceLastSend = 0;
-        
-        if (StreamerRunnable)
-        {
-            // Get camera rotation
-            APlayerController* PlayerController = GetWorld()->GetFirstPlayerController();
-
-            if (PlayerController && PlayerController->PlayerCameraManager)
-            {
-                FRotator CameraRotation = PlayerController->PlayerCameraManager->GetCameraRotation();
-                
-                float DeltaYaw = CameraRotation.Yaw - PreviousYaw;
-                float DeltaPitch = CameraRotation.Pitch - PreviousPitch;
-                
-                if (DeltaYaw > 180.0f) {
-                    DeltaYaw -= 360.0f;
-                } else if (DeltaYaw < -180.f) {
-                    DeltaYaw += 360.0f;
-                }
-
-                PreviousYaw = CameraRotation.Yaw;
-                PreviousPitch = CameraRotation.Pitch;
-
-                UEnhancedInputLocalPlayerSubsystem* Subsystem = ULocalPlayer::GetSubsystem<UEnhancedInputLocalPlayerSubsystem>(PlayerController->GetLocalPlayer());
-                if (Subsystem)
-                {
-
-                    // Do not accumulate the yaw and pitch if the left X button is pressed
-                    // This allows the user to manually recalibrate the camera
-                    if (!Subsystem->GetPlayerInput()->GetActionValue(IA_Pause_Camera_Motors).Get<bool>())
-                    {
-                        AccumulatedYaw += DeltaYaw;
-                        AccumulatedPitch += DeltaPitch;
-                    }
-
-                    // Get right trigger value
-                    FInputActionValue CurrentRightTriggerPositionValue = Subsystem->GetPlayerInput()->GetActionValue(IA_Hand_IndexCurl_Right);
-                    CachedRightIndexCurlValue = CurrentRightTriggerPositionValue.Get<float>();
-
-                    // Get left trigger value
-                    FInputActionValue CurrentLeftTriggerPositionValue = Subsystem->GetPlayerInput()->GetActionValue(IA_Hand_IndexCurl_Left);
-                    float CachedLeftIndexCurlValue = CurrentLeftTriggerPositionValue.Get<float>();
-
-                    // Left and right trigger values cancel each other out
-                    CachedRightIndexCurlValue -= CachedLeftIndexCurlValue;
-
-                    // IA_Turbo_Throttle
-                    FInputActionValue AButtonPressed = Subsystem->GetPlayerInput()->GetActionValue(IA_Turbo_Throttle);
-                    CachedRightThumbUpValue = AButtonPressed.Get<bool>();
-
-                    // If A button is not pressed, then depress throttle
-                    if (!CachedRightThumbUpValue) {
-                       CachedRightIndexCurlValue *= .45f;
-                    }
-
-                    FInputActionValue CurrentThumbstickValue = Subsystem->GetPlayerInput()->GetActionValue(IA_Hand_Thumbstick_Right);
-                    CachedRightThumbstickValue = CurrentThumbstickValue.Get<float>();
-
-                    // UE_LOG(LogTemp, Log, TEXT("Streamer Speed: %f, Distance: %f"), SpeedMph, DistanceFeet);
-                }
-
-                // Enqueue the data
-                DataQueue.Enqueue(new FRobotControlData(AccumulatedPitch, AccumulatedYaw, CachedRightIndexCurlValue, CachedRightThumbstickValue));
-            }
+
+    UpdateTelemetryHistory();
+
+    // Every tick: the I/O thread paces sends itself and takes the newest
+    // sample, carrying it forward if the next one is late
+    if (Link)
+    {
+        SampleControl();
+    }
+
+    if (bLogMotionToPhoton && Link && GetWorld()->GetTimeSeconds() >= NextMotionToPhotonLog)
+    {
+        NextMotionToPhotonLog = GetWorld()->GetTimeSeconds() + 5.0;
+        const FMotionToPhotonStats Stats = Link->MotionToPhoton.GetStats();
+        UE_LOG(LogTemp, Log, TEXT("Motion to photon: p50 %.1f p95 %.1f ms = uplink %.1f + actuation/capture %.1f + encode/network %.1f + decode/display %.1f (%lld loops, %lld unmatched)"),
+            Stats.TotalP50Ms, Stats.TotalP95Ms, Stats.UplinkMs, Stats.ActuationCaptureMs, Stats.EncodeNetworkMs,
+            Stats.DecodeDisplayMs, (long long)Stats.Loops, (long long)Stats.Unmatched);
+    }
+}
+
+void UCameraDataStreamer::SampleControl()
+{
+    // Get camera rotation
+    APlayerController* PlayerController = GetWorld()->GetFirstPlayerController();
+    if (!PlayerController || !PlayerController->PlayerCameraManager)
+    {
+        return;
+    }
+
+    const int64 NowUs = ClockSync::NowMicros();
+    FRotator CameraRotation = PlayerController->PlayerCameraManager->GetCameraRotation();
+
+    // Without input the pose is held. A controller with no local player
+    // (the headless Pipeline benchmark) has no input to hold it with and
+    // follows the camera.
+    bool bAccumulate = PlayerController->GetLocalPlayer() == nullptr;
+
+    UEnhancedInputLocalPlayerSubsystem* Subsystem = ULocalPlayer::GetSubsystem<UEnhancedInputLocalPlayerSubsystem>(PlayerController->GetLocalPlayer());
+    if (Subsystem)
+    {
+        // Do not accumulate the yaw and pitch if the left X button is pressed
+        // This allows the user to manually recalibrate the camera
+        bAccumulate = !Subsystem->GetPlayerInput()->GetActionValue(IA_Pause_Camera_Motors).Get<bool>();
+
+        // Get right trigger value
+        FInputActionValue CurrentRightTriggerPositionValue = Subsystem->GetPlayerInput()->GetActionValue(IA_Hand_IndexCurl_Right);
+        CachedRightIndexCurlValue = CurrentRightTriggerPositionValue.Get<float>();
+
+        // Get left trigger value
+        FInputActionValue CurrentLeftTriggerPositionValue = Subsystem->GetPlayerInput()->GetActionValue(IA_Hand_IndexCurl_Left);
+        float CachedLeftIndexCurlValue = CurrentLeftTriggerPositionValue.Get<float>();
+
+        // Left and right trigger values cancel each other out
+        CachedRightIndexCurlValue -= CachedLeftIndexCurlValue;
+
+        // IA_Turbo_Throttle
+        FInputActionValue AButtonPressed = Subsystem->GetPlayerInput()->GetActionValue(IA_Turbo_Throttle);
+        CachedRightThumbUpValue = AButtonPressed.Get<bool>();
+
+        // If A button is not pressed, then depress throttle
+        if (!CachedRightThumbUpValue) {
+           CachedRightIndexCurlValue *= .45f;
         }
+
+        FInputActionValue CurrentThumbstickValue = Subsystem->GetPlayerInput()->GetActionValue(IA_Hand_Thumbstick_Right);
+        CachedRightThumbstickValue = CurrentThumbstickValue.Get<float>();
     }
+
+    PoseAccumulator.Update(CameraRotation.Pitch, CameraRotation.Yaw, NowUs, bAccumulate);
+
+    FHeadPoseSample Pose;
+    Pose.TimeUs = NowUs;
+    Pose.Pitch = PoseAccumulator.GetPitch();
+    Pose.Yaw = PoseAccumulator.GetYaw();
+    PosePredictor.AddSample(Pose);
+    if (bRecordHeadMotion)
+    {
+        RecordedHeadMotion.Add(Pose);
+    }
+    RefreshPredictionHorizon(NowUs);
+
+    FRobotControlData Sample(Pose.Pitch, Pose.Yaw, CachedRightIndexCurlValue, CachedRightThumbstickValue);
+    Sample.PitchRate = PoseAccumulator.GetPitchRate();
+    Sample.YawRate = PoseAccumulator.GetYawRate();
+    Sample.SampledLocalUs = NowUs;
+
+    // Aim where the head will be when the command reaches the gimbal. A held
+    // pose is sent as is, so releasing the pause does not fling it.
+    if (bAccumulate && HeadPosePrediction != EHeadPosePredictionModel::None)
+    {
+        const FHeadPoseSample Predicted = PosePredictor.Predict(PredictionHorizonSeconds);
+        Sample.Pitch = Predicted.Pitch;
+        Sample.Yaw = Predicted.Yaw;
+        Sample.PitchRate = PosePredictor.GetPitchRate(PredictionHorizonSeconds);
+        Sample.YawRate = PosePredictor.GetYawRate(PredictionHorizonSeconds);
+    }
+
+    FHeadPoseSample Commanded;
+    Commanded.TimeUs = NowUs;
+    Commanded.Pitch = Sample.Pitch;
+    Commanded.Yaw = Sample.Yaw;
+    CommandHistory.Add(Commanded);
+
+    // Publish the sample; an unread older one is simply replaced
+    Link->ControlChannel.Push(Sample);
+}
+
+void UCameraDataStreamer::RefreshPredictionHorizon(int64 NowUs)
+{
+    if (NowUs < NextHorizonRefreshUs)
+    {
+        return;
+    }
+    NextHorizonRefreshUs = NowUs + 250000;
+
+    // One-way delay once the clock is synced, half the round trip before
+    const FControlLinkQuality Quality = Link->GetQuality().GetStats();
+    double NetworkMs = 0.0;
+    if (Quality.bDelayValid)
+    {
+        NetworkMs = FMath::Max(Quality.ForwardDelayMs, 0.0f);
+    }
+    else if (Quality.RttP50Ms > 0.0f)
+    {
+        NetworkMs = Quality.RttP50Ms / 2.0;
+    }
+    PredictionHorizonSeconds = (NetworkMs + GimbalLatencyMs) / 1000.0;
+}
+
+float UCameraDataStreamer::GetPredictionHorizonMs() const
+{
+    if (HeadPosePrediction == EHeadPosePredictionModel::None)
+    {
+        return 0.0f;
+    }
+    return FMath::Min(PredictionHorizonSeconds * 1000.0, (double)MaxPredictionHorizonMs);
+}
+
+bool UCameraDataStreamer::GetGimbalPoseAt(int64 LocalUs, float& OutPitch, float& OutYaw) const
+{
+    // A command takes network delay plus gimbal latency to be realised
+    return CommandHistory.Sample(LocalUs - (int64)(PredictionHorizonSeconds * 1e6), OutPitch, OutYaw);
 }
 
 float UCameraDataStreamer::GetAccumulatedYaw() const
 {
-    return AccumulatedYaw;
+    return PoseAccumulator.GetYaw();
 }
 
 float UCameraDataStreamer::GetAccumulatedPitch() const
 {
-    return AccumulatedPitch;
+    return PoseAccumulator.GetPitch();
+}
+
+bool UCameraDataStreamer::GetTelemetrySnapshot(FTelemetrySnapshot& OutSnapshot) const
+{
+    return Link && Link->TelemetryChannel.PeekLatest(OutSnapshot);
+}
+
+bool UCameraDataStreamer::GetFreshTelemetry(FTelemetrySnapshot& OutSnapshot) const
+{
+    return GetTelemetrySnapshot(OutSnapshot) &&
+        ClockSync::NowMicros() - OutSnapshot.ReceivedLocalUs <= TelemetryStaleSeconds * 1e6;
 }
 
 float UCameraDataStreamer::GetSpeedMph() const
 {
-    return SpeedMph;
+    // A silent robot is assumed stopped rather than frozen at its last speed
+    FTelemetrySnapshot Snapshot;
+    return GetFreshTelemetry(Snapshot) ? Snapshot.SpeedMph : 0.0f;
 }
 
 float UCameraDataStreamer::GetDistanceFeet() const
 {
-    return DistanceFeet;
+    FTelemetrySnapshot Snapshot;
+    return GetFreshTelemetry(Snapshot) ? Snapshot.DistanceFeet : 0.0f;
 }
 
 int UCameraDataStreamer::GetControlBatteryPercentage() const
 {
-    return ControlBatteryPercentage;
+    // Battery levels stay valid while the link is down
+    FTelemetrySnapshot Snapshot;
+    return GetTelemetrySnapshot(Snapshot) ? Snapshot.ControlBatteryPercentage : 0;
 }
 
 int UCameraDataStreamer::GetDriveBatteryPercentage() const
 {
-    return DriveBatteryPercentage;
+    FTelemetrySnapshot Snapshot;
+    return GetTelemetrySnapshot(Snapshot) ? Snapshot.DriveBatteryPercentage : 0;
+}
+
+void UCameraDataStreamer::UpdateTelemetryHistory()
+{
+    if (Link)
+    {
+        FPV_LINK_COUNTER_SET(TelemetryQueueDepth, Link->GetMetricsLink(), Link->TelemetryChannel.GetProducedCount() -
+            Link->TelemetryChannel.GetConsumedCount() - Link->TelemetryChannel.GetOverwrittenCount());
+    }
+
+    FTelemetrySnapshot Snapshot;
+    while (Link && Link->TelemetryChannel.PopNext(Snapshot))
+    {
+        const float ChannelValues[FTelemetryHistory::NumChannels] = {
+            Snapshot.SpeedMph,
+            Snapshot.DistanceFeet,
+            (float)Snapshot.ControlBatteryPercentage,
+            (float)Snapshot.DriveBatteryPercentage,
+        };
+        TelemetryHistory.Add(Snapshot.ReceivedLocalUs / 1e6, ChannelValues);
+    }
+    TelemetryHistory.Expire(ClockSync::NowMicros() / 1e6);
+}
+
+FTelemetryWindowStats UCameraDataStreamer::GetTelemetryStats(ETelemetryChannel Channel) const
+{
+    return TelemetryHistory.Get(Channel).GetStats();
+}
+
+void UCameraDataStreamer::GetTelemetryHistory(ETelemetryChannel Channel, float SpanSeconds, TArray<FTelemetryHistoryPoint>& OutPoints) const
+{
+    TelemetryHistory.Get(Channel).GetHistory(ClockSync::NowMicros() / 1e6, SpanSeconds, OutPoints);
+}
+
+float UCameraDataStreamer::GetTelemetryAgeSeconds() const
+{
+    FTelemetrySnapshot Snapshot;
+    if (!GetTelemetrySnapshot(Snapshot))
+    {
+        return -1.0f;
+    }
+    return (ClockSync::NowMicros() - Snapshot.ReceivedLocalUs) / 1e6;
+}
+
+int64 UCameraDataStreamer::GetControlSamplesConsumed() const
+{
+    return Link ? Link->ControlChannel.GetConsumedCount() : 0;
+}
+
+int64 UCameraDataStreamer::GetControlSamplesOverwritten() const
+{
+    return Link ? Link->ControlChannel.GetOverwrittenCount() : 0;
+}
+
+FControlSendStats UCameraDataStreamer::GetControlSendStats() const
+{
+    return Link ? Link->GetSendStats() : FControlSendStats();
+}
+
+FControlLinkQuality UCameraDataStreamer::GetControlLinkQuality() const
+{
+    return Link ? Link->GetQuality().GetStats() : FControlLinkQuality();
+}
+
+FMotionToPhotonStats UCameraDataStreamer::GetMotionToPhotonStats() const
+{
+    return Link ? Link->MotionToPhoton.GetStats() : FMotionToPhotonStats();
+}
+
+void UCameraDataStreamer::RecordVideoFrameShown(const FVideoFramePose& Pose, int64 ShownLocalUs)
+{
+    FClockEstimate Clock;
+    if (Link && Link->GetClockEstimate(Clock))
+    {
+        Link->MotionToPhoton.RecordFrame(Pose, ShownLocalUs, Clock);
+    }
+}
+
+void UCameraDataStreamer::GetControlRttHistogram(TArray<float>& OutUpperMs, TArray<int64>& OutCounts) const
+{
+    if (Link)
+    {
+        Link->GetQuality().GetRttHistogram(OutUpperMs, OutCounts);
+    }
+    else
+    {
+        OutUpperMs.Reset();
+        OutCounts.Reset();
+    }
+}
+
+int64 UCameraDataStreamer::GetControlBackpressureDrops() const
+{
+    return Link ? Link->GetBackpressureDrops() : 0;
+}
+
+bool UCameraDataStreamer::IsRobotConnected() const
+{
+    return Link && Link->HasPeer();
+}
+
+ERobotLinkState UCameraDataStreamer::GetRobotLinkState() const
+{
+    return Link ? Link->GetState() : ERobotLinkState::Searching;
+}
+
+float UCameraDataStreamer::GetLinkAcquisitionMs() const
+{
+    return Link ? Link->GetAcquisitionSeconds() * 1000.0 : -1.0f;
+}
+
+float UCameraDataStreamer::GetRobotDiscoveryMs() const
+{
+    return Link ? Link->GetDiscoverySeconds() * 1000.0 : -1.0f;
+}
+
+bool UCameraDataStreamer::GetClockEstimate(FClockEstimate& OutEstimate) const
+{
+    return Link && Link->GetClockEstimate(OutEstimate);
+}
+
+bool UCameraDataStreamer::IsClockSynced() const
+{
+    FClockEstimate Estimate;
+    return GetClockEstimate(Estimate);
+}
+
+float UCameraDataStreamer::GetClockUncertaintyMs() const
+{
+    FClockEstimate Estimate;
+    return GetClockEstimate(Estimate) ? Estimate.UncertaintyUs / 1000.0 : 0.0f;
+}
+
+float UCameraDataStreamer::GetClockDriftPpm() const
+{
+    FClockEstimate Estimate;
+    return GetClockEstimate(Estimate) ? Estimate.Drift * 1e6 : 0.0f;
 }
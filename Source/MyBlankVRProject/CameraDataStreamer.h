@@ -5,7 +5,14 @@
 #include "EnhancedInputSubsystems.h"
 #include "InputAction.h"
 #include "Components/ActorComponent.h"
-#include "Containers/Queue.h"
+#include "ControlLinkQuality.h"
+#include "ControlPoseAccumulator.h"
+#include "ControlSendScheduler.h"
+#include "HeadPosePredictor.h"
+#include "MotionToPhoton.h"
+#include "VideoReprojection.h"
+#include "SpscValueChannel.h"
+#include "TelemetryHistory.h"
 #include "CameraDataStreamer.generated.h"
 
 
@@ -17,11 +24,69 @@ struct FRobotControlData
     float TriggerPosition;
     float ThumbstickX;
 
+    // Degrees per second when sampled
+    float PitchRate = 0.0f;
+    float YawRate = 0.0f;
+    // ClockSync::NowMicros() when sampled; 0 if unknown, which disables
+    // extrapolation
+    int64 SampledLocalUs = 0;
+
     // Constructor for convenience
     FRobotControlData(float InPitch = 0.0f, float InYaw = 0.0f, float InTriggerPosition = 0.0f, float InThumbstickX = 0.0f)
         : Pitch(InPitch), Yaw(InYaw), TriggerPosition(InTriggerPosition), ThumbstickX(InThumbstickX) {}
+
+    // The sample carried forward along its rates to LocalUs, by at most
+    // MaxSeconds, so a send between game ticks or during a hitch does not
+    // repeat a stale pose
+    FRobotControlData ExtrapolatedTo(int64 LocalUs, double MaxSeconds) const
+    {
+        FRobotControlData Result = *this;
+        if (SampledLocalUs != 0 && LocalUs > SampledLocalUs)
+        {
+            const float Seconds = (float)FMath::Min((LocalUs - SampledLocalUs) / 1e6, MaxSeconds);
+            Result.Pitch += PitchRate * Seconds;
+            Result.Yaw += YawRate * Seconds;
+        }
+        return Result;
+    }
+};
+
+// Game thread -> I/O thread handoff of control samples
+using FControlSampleChannel = TSpscValueChannel<FRobotControlData, 64>;
+
+// Latest robot telemetry, published whole by the I/O thread
+struct FTelemetrySnapshot
+{
+    float SpeedMph = 0.0f;
+    float DistanceFeet = 0.0f;
+    int32 ControlBatteryPercentage = 0;
+    int32 DriveBatteryPercentage = 0;
+
+    // ClockSync::NowMicros() when the packet arrived
+    int64 ReceivedLocalUs = 0;
+    // Robot send time, on the robot's clock
+    uint64 RobotTimestampUs = 0;
+    uint32 Sequence = 0;
 };
 
+// I/O thread -> game thread. The game thread drains every snapshot into
+// the telemetry history; other readers only peek the newest one.
+using FTelemetryChannel = TSpscValueChannel<FTelemetrySnapshot, 64>;
+
+class FControlLink;
+class FControlLinkServer;
+class FMetricsEndpoint;
+
+UENUM(BlueprintType)
+enum class ERobotLinkState : uint8
+{
+    // No robot has announced itself for this link yet, or it went silent
+    Searching,
+    // Control is streaming; packet timestamps are zero until the clock syncs
+    Connected,
+    // Control is streaming with timestamps on the robot's clock
+    Synced,
+};
 
 UCLASS(ClassGroup = (Custom), meta = (BlueprintSpawnableComponent))
 class MYBLANKVRPROJECT_API UCameraDataStreamer : public UActorComponent
@@ -38,11 +103,6 @@ protected:
 public:
     virtual void TickComponent(float DeltaTime, ELevelTick TickType, FActorComponentTickFunction* ThisTickFunction) override;
 
-    float SpeedMph = 0;
-    float DistanceFeet = 0;
-    int ControlBatteryPercentage = 0;
-    int DriveBatteryPercentage = 0;
-
     UFUNCTION(BlueprintCallable, Category = "Camera Data Streamer")
     float GetAccumulatedYaw() const;
 
@@ -61,6 +121,184 @@ public:
     UFUNCTION(BlueprintCallable, Category = "Camera Data Streamer")
     int GetDriveBatteryPercentage() const;
 
+    // Seconds since the last telemetry packet, negative if none arrived yet
+    UFUNCTION(BlueprintCallable, Category = "Camera Data Streamer")
+    float GetTelemetryAgeSeconds() const;
+
+    // Speed and distance read as zero once telemetry is older than this
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Camera Data Streamer")
+    float TelemetryStaleSeconds = 1.0f;
+
+    // Newest telemetry; false if none has arrived yet
+    bool GetTelemetrySnapshot(FTelemetrySnapshot& OutSnapshot) const;
+
+    // Min/max/mean of a telemetry channel over the last TelemetryWindowSeconds
+    UFUNCTION(BlueprintCallable, Category = "Camera Data Streamer")
+    FTelemetryWindowStats GetTelemetryStats(ETelemetryChannel Channel) const;
+
+    // Downsampled min/max/mean buckets covering the last SpanSeconds, oldest
+    // first. Bucket width grows with the span: 1 s up to 5 minutes, 10 s up to
+    // an hour, 1 minute beyond.
+    UFUNCTION(BlueprintCallable, Category = "Camera Data Streamer")
+    void GetTelemetryHistory(ETelemetryChannel Channel, float SpanSeconds, TArray<FTelemetryHistoryPoint>& OutPoints) const;
+
+    // Rolling window for GetTelemetryStats; read when play begins
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Camera Data Streamer", meta = (ClampMin = "0.1"))
+    float TelemetryWindowSeconds = 5.0f;
+
+    // Control samples taken by the I/O thread
+    UFUNCTION(BlueprintCallable, Category = "Camera Data Streamer")
+    int64 GetControlSamplesConsumed() const;
+
+    // Control samples superseded before the I/O thread took them
+    UFUNCTION(BlueprintCallable, Category = "Camera Data Streamer")
+    int64 GetControlSamplesOverwritten() const;
+
+    UFUNCTION(BlueprintCallable, Category = "Camera Data Streamer")
+    FControlSendStats GetControlSendStats() const;
+
+    // RTT, one-way delay, loss and reordering from the robot's acks
+    UFUNCTION(BlueprintCallable, Category = "Camera Data Streamer")
+    FControlLinkQuality GetControlLinkQuality() const;
+
+    // Session-wide control RTT histogram; the last bucket's bound is -1
+    UFUNCTION(BlueprintCallable, Category = "Camera Data Streamer")
+    void GetControlRttHistogram(TArray<float>& OutUpperMs, TArray<int64>& OutCounts) const;
+
+    // Head motion to photon: latency from a head pose being sampled to the
+    // video frame it moved the camera for being shown, split by stage.
+    // Needs a robot that tags frames with the control packet they reflect.
+    UFUNCTION(BlueprintCallable, Category = "Camera Data Streamer")
+    FMotionToPhotonStats GetMotionToPhotonStats() const;
+
+    // The video actor reports every frame it puts on screen
+    void RecordVideoFrameShown(const FVideoFramePose& Pose, int64 ShownLocalUs);
+
+    // Log the motion-to-photon breakdown every few seconds
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Latency")
+    bool bLogMotionToPhoton = false;
+
+    // TCP port serving pipeline metrics at /metrics in the Prometheus text
+    // format; 0 turns the endpoint off. Read when play begins.
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Latency", meta = (ClampMin = "0", ClampMax = "65535"))
+    int32 MetricsPort = 9464;
+
+    // Control packets dropped because the socket buffer was full
+    UFUNCTION(BlueprintCallable, Category = "Camera Data Streamer")
+    int64 GetControlBackpressureDrops() const;
+
+    // True while a robot is attached to this component's link
+    UFUNCTION(BlueprintCallable, Category = "Camera Data Streamer")
+    bool IsRobotConnected() const;
+
+    UFUNCTION(BlueprintCallable, Category = "Camera Data Streamer")
+    ERobotLinkState GetRobotLinkState() const;
+
+    // Milliseconds from the robot's first datagram to the first control
+    // packet sent to it, for the latest (re)connect; negative if none yet
+    UFUNCTION(BlueprintCallable, Category = "Camera Data Streamer")
+    float GetLinkAcquisitionMs() const;
+
+    // Milliseconds the link searched before a robot answered, for the latest
+    // (re)connect; negative if none yet
+    UFUNCTION(BlueprintCallable, Category = "Camera Data Streamer")
+    float GetRobotDiscoveryMs() const;
+
+    // Register with the remote rendezvous server if LAN discovery finds no
+    // robot within a few seconds; read when play begins
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Control")
+    bool bUseRemoteRendezvous = true;
+
+    // A robot silent for this long is dropped and searched for again; read
+    // when play begins
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Control", meta = (ClampMin = "0.1"))
+    float RobotTimeoutSeconds = 3.0f;
+
+    // True once the robot's clock has been sampled
+    UFUNCTION(BlueprintCallable, Category = "Camera Data Streamer")
+    bool IsClockSynced() const;
+
+    UFUNCTION(BlueprintCallable, Category = "Camera Data Streamer")
+    float GetClockUncertaintyMs() const;
+
+    UFUNCTION(BlueprintCallable, Category = "Camera Data Streamer")
+    float GetClockDriftPpm() const;
+
+    // Mapping from ClockSync::NowMicros() to the robot's clock
+    bool GetClockEstimate(struct FClockEstimate& OutEstimate) const;
+
+    // IPv4 address of the robot to drive; empty takes the first robot that
+    // announces itself and is not driven by another component. Read when play
+    // begins.
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Control")
+    FString RobotAddress;
+
+    // Control packets per second; read when play begins
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Control", meta = (ClampMin = "1", ClampMax = "1000"))
+    float ControlSendRateHz = 250.0f;
+
+    // Skip ticks whose sample matches the last one sent, down to the heartbeat
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Control")
+    bool bSendControlOnChange = false;
+
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Control", meta = (ClampMin = "0.001", EditCondition = "bSendControlOnChange"))
+    float ControlHeartbeatInterval = 0.1f;
+
+    // Samples carried per control datagram, newest plus those sent before
+    // it; 1 disables redundancy. Read when play begins.
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Control", meta = (ClampMin = "1", ClampMax = "6"))
+    int32 ControlRedundancySamples = 1;
+
+    // Extra copies of every control datagram; read when play begins
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Control", meta = (ClampMin = "0", ClampMax = "3"))
+    int32 ControlDuplicates = 0;
+
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Control", meta = (ClampMin = "0.1", EditCondition = "ControlDuplicates > 0"))
+    float ControlDuplicateSpacingMs = 2.0f;
+
+    // How far the I/O thread may carry the newest pose forward along its
+    // rate when game ticks are late; beyond it the pose holds. 0 sends
+    // samples as taken. Read when play begins.
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Control", meta = (ClampMin = "0", ClampMax = "200"))
+    float ControlMaxExtrapolationMs = 50.0f;
+
+    // Past this age the newest sample is sent with the throttle and
+    // thumbstick released, so a stalled game thread does not keep the robot
+    // driving. 0 disables. Read when play begins.
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Control", meta = (ClampMin = "0", ClampMax = "5000"))
+    float ControlMaxSampleAgeMs = 250.0f;
+
+    // Leads the gimbal by the command's measured latency so it tracks the
+    // head instead of trailing it; read when play begins
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Prediction")
+    EHeadPosePredictionModel HeadPosePrediction = EHeadPosePredictionModel::Kalman;
+
+    // The gimbal's own response time, added to the measured network delay
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Prediction", meta = (ClampMin = "0"))
+    float GimbalLatencyMs = 30.0f;
+
+    // Look-ahead cap whatever latency is measured; read when play begins
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Prediction", meta = (ClampMin = "0", ClampMax = "500"))
+    float MaxPredictionHorizonMs = 150.0f;
+
+    // Largest lead over the actual head pose, per axis; read when play begins
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Prediction", meta = (ClampMin = "0"))
+    float MaxPredictionLeadDegrees = 15.0f;
+
+    // Current look-ahead: network delay plus gimbal latency, capped
+    UFUNCTION(BlueprintCallable, Category = "Camera Data Streamer")
+    float GetPredictionHorizonMs() const;
+
+    // Where the gimbal pointed at LocalUs (ClockSync::NowMicros() time
+    // base), from the command sent one control latency earlier; false
+    // outside the last few seconds
+    bool GetGimbalPoseAt(int64 LocalUs, float& OutPitch, float& OutYaw) const;
+
+    // Record head orientation to Saved/HeadMotion when play ends, for
+    // evaluating prediction offline with the PosePrediction benchmark
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Prediction")
+    bool bRecordHeadMotion = false;
+
     UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Input")
     UInputAction* IA_Hand_IndexCurl_Right;
 
@@ -77,20 +315,39 @@ public:
     UInputAction* IA_Pause_Camera_Motors;
 
 private:
-    class FCameraDataStreamerRunnable* StreamerRunnable;
-    FRunnableThread* StreamerThread;
+    // Shared with every other streamer in the process
+    TSharedPtr<FControlLinkServer, ESPMode::ThreadSafe> LinkServer;
+    // This component's robot; carries the control and telemetry channels
+    TSharedPtr<FControlLink, ESPMode::ThreadSafe> Link;
+    // Shared like the link server
+    TSharedPtr<FMetricsEndpoint, ESPMode::ThreadSafe> MetricsEndpoint;
+    FTelemetryHistory TelemetryHistory;
 
-    TQueue<FRobotControlData*, EQueueMode::Spsc> DataQueue;
-    
-    float TimeSinceLastSend = 0.0f;
-    float SendInterval = 0.02f;
+    // Moves newly arrived telemetry into TelemetryHistory
+    void UpdateTelemetryHistory();
+
+    // Snapshot if it is fresh enough for motion values to be trusted
+    bool GetFreshTelemetry(FTelemetrySnapshot& OutSnapshot) const;
     
-    // Used to get rid of discontinuity at 0 - 360 degrees.
-    float PreviousYaw = 0.0f; // initialized in beginPlay
-    float AccumulatedYaw = 0.0f;
+    // Samples the camera and input into a timestamped control sample
+    void SampleControl();
+
+    // Camera rotation unwrapped into gimbal angles; reset in BeginPlay
+    FControlPoseAccumulator PoseAccumulator;
+
+    FHeadPosePredictor PosePredictor;
+    double PredictionHorizonSeconds = 0.0;
+    int64 NextHorizonRefreshUs = 0;
+    TArray<FHeadPoseSample> RecordedHeadMotion;
+
+    // Poses sent to the gimbal, for placing video frames that carry only a
+    // capture time
+    FPoseHistory CommandHistory;
+
+    // Re-reads the link's delay every so often; the stats are not free
+    void RefreshPredictionHorizon(int64 NowUs);
 
-    float PreviousPitch = 0.0f; // initialized in beginPlay
-    float AccumulatedPitch = 0.0f;
+    double NextMotionToPhotonLog = 0.0;
 
     float CachedRightIndexCurlValue = 0.0f;
     float CachedRightThumbstickValue = 0.0f;
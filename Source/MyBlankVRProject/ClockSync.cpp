@@ -0,0 +1,129 @@
+#include "ClockSync.h"
+#include "HAL/PlatformTime.h"
+
+namespace {
+// Buckets whose best round trip is above twice the window's best plus this
+// were congested throughout and are left out of the fit
+constexpr int64 MinFilterSlackUs = 200;
+// A fit over less time than this says nothing useful about drift
+constexpr int64 MinDriftSpanUs = 5 * 1000 * 1000;
+// Crystal oscillators stay well inside this; anything larger is noise
+constexpr double MaxDrift = 500e-6;
+constexpr int64 MaxRttUs = 1000 * 1000;
+// A good sample this far off the prediction means the robot's clock stepped
+constexpr int64 StepThresholdUs = 20 * 1000;
+} // namespace
+
+int64 ClockSync::NowMicros() {
+  static const double MicrosPerCycle =
+      FPlatformTime::GetSecondsPerCycle64() * 1e6;
+  return (int64)(FPlatformTime::Cycles64() * MicrosPerCycle);
+}
+
+FClockSyncEstimator::FClockSyncEstimator() { Reset(); }
+
+void FClockSyncEstimator::Reset() {
+  NumSamples = 0;
+  NextSample = 0;
+  Estimate = FClockEstimate();
+}
+
+bool FClockSyncEstimator::AddSample(int64 T1, int64 T2, int64 T3, int64 T4) {
+  const int64 Rtt = (T4 - T1) - (T3 - T2);
+  if (T4 < T1 || T3 < T2 || Rtt < 0 || Rtt > MaxRttUs) {
+    return false;
+  }
+
+  FSample Sample;
+  Sample.LocalUs = T1 + (T4 - T1) / 2;
+  Sample.OffsetUs = ((T2 - T1) + (T3 - T4)) / 2;
+  Sample.RttUs = Rtt;
+
+  if (Estimate.bValid && Rtt <= Estimate.MinRttUs + MinFilterSlackUs) {
+    const int64 Predicted = Estimate.ToRemoteUs(Sample.LocalUs) - Sample.LocalUs;
+    if (FMath::Abs(Sample.OffsetUs - Predicted) > StepThresholdUs) {
+      UE_LOG(LogTemp, Warning,
+             TEXT("Clock sync: remote clock stepped by %lld us, resetting"),
+             Sample.OffsetUs - Predicted);
+      Reset();
+    }
+  }
+
+  Samples[NextSample] = Sample;
+  NextSample = (NextSample + 1) % WindowSize;
+  NumSamples = FMath::Min(NumSamples + 1, WindowSize);
+  Estimate.UpdatedLocalUs = Sample.LocalUs;
+  Update();
+  return true;
+}
+
+void FClockSyncEstimator::Update() {
+  int64 MinRtt = MAX_int64;
+  for (int32 i = 0; i < NumSamples; i++) {
+    MinRtt = FMath::Min(MinRtt, Samples[i].RttUs);
+  }
+  const int64 Threshold = MinRtt * 2 + MinFilterSlackUs;
+
+  // Minimum filter per bucket of consecutive samples: one low-delay point
+  // from every stretch of the window keeps the fit spread over time, which
+  // is what makes the drift estimate stable
+  int32 Selected[WindowSize / BucketSize + 1] = {};
+  int32 N = 0;
+  const int32 Oldest = (NextSample - NumSamples + WindowSize) % WindowSize;
+  for (int32 Start = 0; Start < NumSamples; Start += BucketSize) {
+    int32 Best = -1;
+    for (int32 k = Start; k < FMath::Min(Start + BucketSize, NumSamples); k++) {
+      const int32 i = (Oldest + k) % WindowSize;
+      if (Best < 0 || Samples[i].RttUs < Samples[Best].RttUs) {
+        Best = i;
+      }
+    }
+    if (Samples[Best].RttUs <= Threshold) {
+      Selected[N++] = Best;
+    }
+  }
+
+  // Fit relative to the newest sample and the first selected offset to keep
+  // the sums well conditioned
+  const int64 Newest = Samples[(NextSample - 1 + WindowSize) % WindowSize].LocalUs;
+  const int64 BaseOffset = Samples[Selected[0]].OffsetUs;
+  double SumX = 0.0, SumY = 0.0, SumXX = 0.0, SumXY = 0.0;
+  for (int32 j = 0; j < N; j++) {
+    const FSample &Sample = Samples[Selected[j]];
+    const double X = (double)(Sample.LocalUs - Newest);
+    const double Y = (double)(Sample.OffsetUs - BaseOffset);
+    SumX += X;
+    SumY += Y;
+    SumXX += X * X;
+    SumXY += X * Y;
+  }
+  const int64 Span =
+      Samples[Selected[N - 1]].LocalUs - Samples[Selected[0]].LocalUs;
+
+  // Without enough spread for a fresh fit, carry the last drift forward
+  // rather than assume none, or the offset would lag by drift * window
+  double Slope = Estimate.Drift;
+  const double Variance = SumXX - SumX * SumX / N;
+  if (N >= 3 && Span >= MinDriftSpanUs && Variance > 0.0) {
+    Slope = FMath::Clamp((SumXY - SumX * SumY / N) / Variance, -MaxDrift,
+                         MaxDrift);
+  }
+  const double Intercept = (SumY - Slope * SumX) / N;
+
+  double SumResidual2 = 0.0;
+  for (int32 j = 0; j < N; j++) {
+    const FSample &Sample = Samples[Selected[j]];
+    const double Residual = (double)(Sample.OffsetUs - BaseOffset) -
+                            (Intercept + Slope * (Sample.LocalUs - Newest));
+    SumResidual2 += Residual * Residual;
+  }
+
+  Estimate.bValid = true;
+  Estimate.ReferenceLocalUs = Newest;
+  Estimate.OffsetUs = BaseOffset + (int64)FMath::RoundToDouble(Intercept);
+  Estimate.Drift = Slope;
+  Estimate.MinRttUs = (double)MinRtt;
+  Estimate.UncertaintyUs =
+      MinRtt * 0.5 + FMath::Sqrt(SumResidual2 / FMath::Max(1, N - 1));
+  Estimate.SampleCount = NumSamples;
+}
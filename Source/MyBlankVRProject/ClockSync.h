@@ -0,0 +1,74 @@
+#pragma once
+
+#include "CoreMinimal.h"
+
+namespace ClockSync {
+// Local monotonic clock in microseconds. All sync math runs on this clock so
+// wall-clock steps on the headset cannot disturb it.
+MYBLANKVRPROJECT_API int64 NowMicros();
+} // namespace ClockSync
+
+// Published mapping from the local monotonic clock to the robot's clock:
+//
+//   Remote = Local + OffsetUs + Drift * (Local - ReferenceLocalUs)
+struct FClockEstimate {
+  bool bValid = false;
+  int64 ReferenceLocalUs = 0;
+  int64 OffsetUs = 0;
+  // Rate difference, robot relative to local (1e-6 = 1 ppm)
+  double Drift = 0.0;
+  // Half the best round trip plus the spread of the fit, in microseconds
+  double UncertaintyUs = 0.0;
+  double MinRttUs = 0.0;
+  // Samples in the window, including the ones filtered out
+  int32 SampleCount = 0;
+  // Local time of the last accepted sample
+  int64 UpdatedLocalUs = 0;
+
+  int64 ToRemoteUs(int64 LocalUs) const {
+    return LocalUs + OffsetUs +
+           (int64)(Drift * (double)(LocalUs - ReferenceLocalUs));
+  }
+
+  int64 ToLocalUs(int64 RemoteUs) const {
+    // Drift is tiny, so evaluating it at the remote time is close enough
+    return RemoteUs - OffsetUs -
+           (int64)(Drift * (double)(RemoteUs - OffsetUs - ReferenceLocalUs));
+  }
+};
+
+// NTP-style offset estimation from request/response timestamp quadruples.
+//
+// Queueing delay is what skews an offset sample, so only the lowest-delay
+// sample of each stretch of the window is trusted. A line fitted through
+// those gives the current offset and the drift between the clocks.
+class MYBLANKVRPROJECT_API FClockSyncEstimator {
+public:
+  static constexpr int32 WindowSize = 64;
+  static constexpr int32 BucketSize = 8;
+
+  FClockSyncEstimator();
+
+  void Reset();
+
+  // T1/T4: local send/receive, T2/T3: remote receive/send. Returns false if
+  // the sample was rejected as implausible.
+  bool AddSample(int64 T1, int64 T2, int64 T3, int64 T4);
+
+  const FClockEstimate &GetEstimate() const { return Estimate; }
+
+private:
+  struct FSample {
+    int64 LocalUs;
+    int64 OffsetUs;
+    int64 RttUs;
+  };
+
+  void Update();
+
+  FSample Samples[WindowSize];
+  int32 NumSamples;
+  int32 NextSample;
+
+  FClockEstimate Estimate;
+};
@@ -0,0 +1,258 @@
+#include "BenchmarkScenarios.h"
+#include "HAL/PlatformTime.h"
+#include "VideoStreamConfig.h"
+
+extern "C" {
+#include <libavcodec/avcodec.h>
+#include <libavutil/imgutils.h>
+#include <libavutil/opt.h>
+}
+
+namespace {
+struct FEncoderChoice {
+  const char *Name;
+  // Low-latency private options matching what the robot sends, as name and
+  // value pairs. Each encoder spells its speed preset differently.
+  const char *Options[2][2];
+};
+
+struct FCodecCandidate {
+  EVideoCodec Codec;
+  AVCodecID CodecId;
+  // Software encoders in order of preference
+  FEncoderChoice Encoders[3];
+};
+
+const FCodecCandidate Candidates[] = {
+    {EVideoCodec::H264,
+     AV_CODEC_ID_H264,
+     {{"libx264", {{"preset", "veryfast"}, {"tune", "zerolatency"}}}}},
+    {EVideoCodec::H265,
+     AV_CODEC_ID_HEVC,
+     {{"libx265", {{"preset", "veryfast"}, {"tune", "zerolatency"}}}}},
+    {EVideoCodec::AV1,
+     AV_CODEC_ID_AV1,
+     {{"libsvtav1", {{"preset", "10"}}},
+      {"libaom-av1", {{"usage", "realtime"}, {"cpu-used", "8"}}},
+      {"librav1e", {{"speed", "10"}}}}},
+};
+
+const AVCodec *FindEncoder(const FCodecCandidate &Candidate,
+                           const FEncoderChoice *&OutChoice) {
+  for (const FEncoderChoice &Choice : Candidate.Encoders) {
+    if (Choice.Name) {
+      if (const AVCodec *Encoder = avcodec_find_encoder_by_name(Choice.Name)) {
+        OutChoice = &Choice;
+        return Encoder;
+      }
+    }
+  }
+  return nullptr;
+}
+
+// Moving diagonal luma gradient with drifting chroma, so every frame carries
+// real motion for the encoder to work on.
+void FillTestPattern(AVFrame *Frame, int32 Index) {
+  for (int32 Y = 0; Y < Frame->height; Y++) {
+    uint8 *Row = Frame->data[0] + Y * Frame->linesize[0];
+    for (int32 X = 0; X < Frame->width; X++) {
+      Row[X] = (uint8)(X + Y + Index * 3);
+    }
+  }
+  for (int32 Y = 0; Y < Frame->height / 2; Y++) {
+    uint8 *RowU = Frame->data[1] + Y * Frame->linesize[1];
+    uint8 *RowV = Frame->data[2] + Y * Frame->linesize[2];
+    for (int32 X = 0; X < Frame->width / 2; X++) {
+      RowU[X] = (uint8)(128 + Y - Index);
+      RowV[X] = (uint8)(64 + X + Index * 2);
+    }
+  }
+}
+
+// Encodes NumFrames of the test pattern. Returns false if the encoder could
+// not be opened or rejected one of Choice's options.
+bool EncodeTestSequence(const AVCodec *Encoder, const FEncoderChoice &Choice,
+                        int32 Width, int32 Height, int32 Fps, int64 Bitrate,
+                        int32 NumFrames, TArray<AVPacket *> &OutPackets) {
+  AVCodecContext *EncoderContext = avcodec_alloc_context3(Encoder);
+  if (!EncoderContext) {
+    return false;
+  }
+  EncoderContext->width = Width;
+  EncoderContext->height = Height;
+  EncoderContext->pix_fmt = AV_PIX_FMT_YUV420P;
+  EncoderContext->time_base = AVRational{1, Fps};
+  EncoderContext->framerate = AVRational{Fps, 1};
+  EncoderContext->bit_rate = Bitrate;
+  EncoderContext->gop_size = Fps;
+  EncoderContext->max_b_frames = 0;
+
+  // A preset silently left at its default would skew the comparison
+  for (const auto &Option : Choice.Options) {
+    if (Option[0] &&
+        av_opt_set(EncoderContext->priv_data, Option[0], Option[1], 0) < 0) {
+      UE_LOG(LogTemp, Error, TEXT("CodecDecode: %s rejected %s=%s"),
+             UTF8_TO_TCHAR(Choice.Name), UTF8_TO_TCHAR(Option[0]),
+             UTF8_TO_TCHAR(Option[1]));
+      avcodec_free_context(&EncoderContext);
+      return false;
+    }
+  }
+
+  if (avcodec_open2(EncoderContext, Encoder, nullptr) < 0) {
+    avcodec_free_context(&EncoderContext);
+    return false;
+  }
+
+  AVFrame *Frame = av_frame_alloc();
+  Frame->format = EncoderContext->pix_fmt;
+  Frame->width = Width;
+  Frame->height = Height;
+  av_frame_get_buffer(Frame, 0);
+
+  AVPacket *Packet = av_packet_alloc();
+  for (int32 Index = 0; Index <= NumFrames; Index++) {
+    if (Index < NumFrames) {
+      av_frame_make_writable(Frame);
+      FillTestPattern(Frame, Index);
+      Frame->pts = Index;
+      avcodec_send_frame(EncoderContext, Frame);
+    } else {
+      // Flush
+      avcodec_send_frame(EncoderContext, nullptr);
+    }
+    while (avcodec_receive_packet(EncoderContext, Packet) == 0) {
+      AVPacket *Encoded = av_packet_alloc();
+      av_packet_move_ref(Encoded, Packet);
+      OutPackets.Add(Encoded);
+    }
+  }
+
+  av_packet_free(&Packet);
+  av_frame_free(&Frame);
+  avcodec_free_context(&EncoderContext);
+  return true;
+}
+} // namespace
+
+bool BenchmarkScenarios::RunCodecDecode(const FString &Params,
+                                        TSharedRef<FJsonObject> Report) {
+  int32 Width = 854;
+  int32 Height = 480;
+  int32 Fps = 30;
+  int32 NumFrames = 300;
+  int32 DecodeThreads = 1;
+  int64 Bitrate = 2000000;
+  FParse::Value(*Params, TEXT("Width="), Width);
+  FParse::Value(*Params, TEXT("Height="), Height);
+  FParse::Value(*Params, TEXT("Fps="), Fps);
+  FParse::Value(*Params, TEXT("Frames="), NumFrames);
+  FParse::Value(*Params, TEXT("DecodeThreads="), DecodeThreads);
+  FParse::Value(*Params, TEXT("Bitrate="), Bitrate);
+
+  Report->SetNumberField(TEXT("width"), Width);
+  Report->SetNumberField(TEXT("height"), Height);
+  Report->SetNumberField(TEXT("fps"), Fps);
+  Report->SetNumberField(TEXT("target_bitrate"), Bitrate);
+  Report->SetNumberField(TEXT("decode_threads"), DecodeThreads);
+
+  TArray<TSharedPtr<FJsonValue>> Results;
+  bool bAnyDecoded = false;
+
+  for (const FCodecCandidate &Candidate : Candidates) {
+    TSharedRef<FJsonObject> Result = MakeShared<FJsonObject>();
+    Result->SetStringField(TEXT("codec"), GetRtpEncodingName(Candidate.Codec));
+    Results.Add(MakeShared<FJsonValueObject>(Result));
+
+    const FEncoderChoice *Choice = nullptr;
+    const AVCodec *Encoder = FindEncoder(Candidate, Choice);
+    const AVCodec *Decoder = avcodec_find_decoder(Candidate.CodecId);
+    if (!Encoder || !Decoder) {
+      Result->SetStringField(TEXT("skipped"), !Encoder ? TEXT("no encoder")
+                                                       : TEXT("no decoder"));
+      UE_LOG(LogTemp, Warning, TEXT("CodecDecode: skipping %s (%s)"),
+             GetRtpEncodingName(Candidate.Codec),
+             !Encoder ? TEXT("no encoder") : TEXT("no decoder"));
+      continue;
+    }
+    Result->SetStringField(TEXT("encoder"), UTF8_TO_TCHAR(Encoder->name));
+    Result->SetStringField(TEXT("decoder"), UTF8_TO_TCHAR(Decoder->name));
+
+    TArray<AVPacket *> Packets;
+    if (!EncodeTestSequence(Encoder, *Choice, Width, Height, Fps, Bitrate,
+                            NumFrames, Packets)) {
+      Result->SetStringField(TEXT("skipped"), TEXT("encoder failed to open"));
+      continue;
+    }
+
+    int64 EncodedBytes = 0;
+    for (const AVPacket *Packet : Packets) {
+      EncodedBytes += Packet->size;
+    }
+
+    AVCodecContext *DecoderContext = avcodec_alloc_context3(Decoder);
+    DecoderContext->thread_count = DecodeThreads;
+    if (avcodec_open2(DecoderContext, Decoder, nullptr) < 0) {
+      Result->SetStringField(TEXT("skipped"), TEXT("decoder failed to open"));
+      avcodec_free_context(&DecoderContext);
+      for (AVPacket *Packet : Packets) {
+        av_packet_free(&Packet);
+      }
+      continue;
+    }
+
+    // One packet per frame with B-frames off, so per-packet time is the
+    // per-frame decode cost.
+    FBenchmarkSamples WallMs;
+    FBenchmarkSamples CpuMs;
+    const bool bCpuClock = GetThreadCpuSeconds() >= 0.0;
+    AVFrame *Frame = av_frame_alloc();
+    int32 DecodedFrames = 0;
+    for (AVPacket *Packet : Packets) {
+      const double WallStart = FPlatformTime::Seconds();
+      const double CpuStart = GetThreadCpuSeconds();
+      if (avcodec_send_packet(DecoderContext, Packet) == 0) {
+        while (avcodec_receive_frame(DecoderContext, Frame) == 0) {
+          DecodedFrames++;
+        }
+      }
+      WallMs.Add((FPlatformTime::Seconds() - WallStart) * 1000.0);
+      if (bCpuClock) {
+        CpuMs.Add((GetThreadCpuSeconds() - CpuStart) * 1000.0);
+      }
+    }
+    avcodec_send_packet(DecoderContext, nullptr);
+    while (avcodec_receive_frame(DecoderContext, Frame) == 0) {
+      DecodedFrames++;
+    }
+
+    av_frame_free(&Frame);
+    avcodec_free_context(&DecoderContext);
+    for (AVPacket *Packet : Packets) {
+      av_packet_free(&Packet);
+    }
+
+    const double Seconds = FMath::Max(1, NumFrames) / (double)Fps;
+    Result->SetNumberField(TEXT("frames_decoded"), DecodedFrames);
+    Result->SetNumberField(TEXT("encoded_bytes"), (double)EncodedBytes);
+    Result->SetNumberField(TEXT("actual_kbps"),
+                           EncodedBytes * 8.0 / Seconds / 1000.0);
+    Result->SetObjectField(TEXT("decode_wall_ms"), WallMs.ToJson());
+    if (bCpuClock) {
+      Result->SetObjectField(TEXT("decode_cpu_ms"), CpuMs.ToJson());
+    }
+    bAnyDecoded |= DecodedFrames > 0;
+
+    const FBenchmarkSamples &LoggedMs = bCpuClock ? CpuMs : WallMs;
+    UE_LOG(LogTemp, Display,
+           TEXT("CodecDecode: %s (%s) %d frames, %s mean %.3f ms, p95 %.3f "
+                "ms, %.0f kbps"),
+           GetRtpEncodingName(Candidate.Codec), UTF8_TO_TCHAR(Decoder->name),
+           DecodedFrames, bCpuClock ? TEXT("cpu") : TEXT("wall"),
+           LoggedMs.Mean(), LoggedMs.Percentile(95.0),
+           EncodedBytes * 8.0 / Seconds / 1000.0);
+  }
+
+  Report->SetArrayField(TEXT("codecs"), Results);
+  return bAnyDecoded;
+}
@@ -0,0 +1,222 @@
+#include "ControlLinkQuality.h"
+#include "ClockSync.h"
+#include "Misc/ScopeLock.h"
+#include "PipelineStats.h"
+
+namespace {
+constexpr double HistogramFirstUpperMs = 0.1;
+
+// Half-octave buckets: 0.1 ms, 0.14 ms, 0.2 ms ... about 290 ms, then open
+int32 HistogramBucket(double RttMs) {
+  if (RttMs <= HistogramFirstUpperMs) {
+    return 0;
+  }
+  const int32 Bucket = FMath::CeilToInt(
+      2.0 * FMath::Loge(RttMs / HistogramFirstUpperMs) / FMath::Loge(2.0));
+  return FMath::Clamp(Bucket, 0,
+                      FControlLinkQualityTracker::HistogramBuckets - 1);
+}
+} // namespace
+
+FControlLinkQualityTracker::FControlLinkQualityTracker()
+    : OldestUnresolved(0), NextSequence(0), bStarted(false), HighestAcked(0),
+      MetricsLink(INDEX_NONE), bAnyAck(false), LastAckLocalUs(0),
+      PacketsSent(0), PacketsAcked(0), PacketsLost(0), PacketsReordered(0),
+      RecentLostCount(0), RecentResolved(0), AckSamples(0) {
+  FMemory::Memzero(Slots, sizeof(Slots));
+  FMemory::Memzero(RecentLost, sizeof(RecentLost));
+  FMemory::Memzero(RecentAcks, sizeof(RecentAcks));
+  FMemory::Memzero(Histogram, sizeof(Histogram));
+}
+
+void FControlLinkQualityTracker::RecordSend(uint32 Sequence,
+                                            int64 SentLocalUs) {
+  FScopeLock ScopeLock(&Lock);
+  if (!bStarted) {
+    bStarted = true;
+    OldestUnresolved = Sequence;
+  }
+  // A full ring resolves its oldest packets early, as lost if unacked
+  while ((uint32)(Sequence - OldestUnresolved) >= (uint32)SlotCount) {
+    Resolve(Slots[OldestUnresolved % SlotCount]);
+    OldestUnresolved++;
+  }
+
+  FSlot &Slot = Slots[Sequence % SlotCount];
+  Slot.Sequence = Sequence;
+  Slot.SentLocalUs = SentLocalUs;
+  Slot.bInFlight = true;
+  Slot.bAcked = false;
+  NextSequence = Sequence + 1;
+  PacketsSent++;
+}
+
+void FControlLinkQualityTracker::MarkAcked(uint32 Sequence) {
+  if ((uint32)(Sequence - OldestUnresolved) >=
+      (uint32)(NextSequence - OldestUnresolved)) {
+    // Already resolved, or never sent
+    return;
+  }
+  FSlot &Slot = Slots[Sequence % SlotCount];
+  if (Slot.bInFlight && !Slot.bAcked && Slot.Sequence == Sequence) {
+    Slot.bAcked = true;
+    PacketsAcked++;
+  }
+}
+
+void FControlLinkQualityTracker::RecordAck(uint32 AckedSequence,
+                                           uint32 ReceivedMask,
+                                           uint64 RobotReceiveUs,
+                                           uint64 RobotTransmitUs,
+                                           int64 ReceivedLocalUs,
+                                           const FClockEstimate *Clock) {
+  FScopeLock ScopeLock(&Lock);
+  if (!bStarted) {
+    return;
+  }
+  LastAckLocalUs = ReceivedLocalUs;
+
+  const FSlot &Slot = Slots[AckedSequence % SlotCount];
+  const bool bFirstAck =
+      (uint32)(AckedSequence - OldestUnresolved) <
+          (uint32)(NextSequence - OldestUnresolved) &&
+      Slot.Sequence == AckedSequence && Slot.bInFlight && !Slot.bAcked;
+
+  // A duplicated or re-sent ack for an older sequence is not a reorder;
+  // only a sequence acked for the first time after a newer one is
+  if (bAnyAck && (int32)(AckedSequence - HighestAcked) < 0) {
+    if (bFirstAck) {
+      PacketsReordered++;
+    }
+  } else {
+    HighestAcked = AckedSequence;
+    bAnyAck = true;
+  }
+  if (bFirstAck) {
+    // Take out the time the robot held the packet before acking
+    const int64 HoldUs = RobotTransmitUs >= RobotReceiveUs
+                             ? (int64)(RobotTransmitUs - RobotReceiveUs)
+                             : 0;
+    const int64 RoundTripUs = ReceivedLocalUs - Slot.SentLocalUs;
+    const int64 RttUs =
+        RoundTripUs > HoldUs ? RoundTripUs - HoldUs : RoundTripUs;
+
+    FAckSample &Sample = RecentAcks[AckSamples % RecentCount];
+    Sample.RttMs = RttUs / 1000.0f;
+    Sample.bDelayValid = Clock && Clock->bValid && RobotReceiveUs != 0;
+    if (Sample.bDelayValid) {
+      Sample.ForwardDelayMs =
+          ((int64)RobotReceiveUs - Clock->ToRemoteUs(Slot.SentLocalUs)) /
+          1000.0f;
+      Sample.ReverseDelayMs =
+          (Clock->ToRemoteUs(ReceivedLocalUs) - (int64)RobotTransmitUs) /
+          1000.0f;
+    }
+    AckSamples++;
+    Histogram[HistogramBucket(Sample.RttMs)]++;
+    PipelineMetrics::ControlRtt.Observe(MetricsLink, RttUs);
+  }
+
+  MarkAcked(AckedSequence);
+  for (uint32 Bit = 0; Bit < 32; Bit++) {
+    if (ReceivedMask & (1u << Bit)) {
+      MarkAcked(AckedSequence - 1 - Bit);
+    }
+  }
+}
+
+void FControlLinkQualityTracker::Resolve(FSlot &Slot) {
+  const uint8 bLost = Slot.bInFlight && !Slot.bAcked ? 1 : 0;
+  PacketsLost += bLost;
+  if (bLost) {
+    FPV_LINK_COUNTER_ADD(ControlPacketsLost, MetricsLink, 1);
+  }
+
+  uint8 &Recent = RecentLost[RecentResolved % RecentCount];
+  RecentLostCount += bLost - Recent;
+  Recent = bLost;
+  RecentResolved++;
+  Slot.bInFlight = false;
+}
+
+void FControlLinkQualityTracker::Expire(int64 NowLocalUs) {
+  FScopeLock ScopeLock(&Lock);
+  while (OldestUnresolved != NextSequence) {
+    FSlot &Slot = Slots[OldestUnresolved % SlotCount];
+    if (!Slot.bAcked && NowLocalUs - Slot.SentLocalUs < LossTimeoutUs) {
+      break;
+    }
+    Resolve(Slot);
+    OldestUnresolved++;
+  }
+}
+
+void FControlLinkQualityTracker::SetMetricsLink(int32 Link) {
+  FScopeLock ScopeLock(&Lock);
+  MetricsLink = Link;
+}
+
+FControlLinkQuality FControlLinkQualityTracker::GetStats() const {
+  FScopeLock ScopeLock(&Lock);
+  FControlLinkQuality Stats;
+  Stats.PacketsSent = PacketsSent;
+  Stats.PacketsAcked = PacketsAcked;
+  Stats.PacketsLost = PacketsLost;
+  Stats.PacketsReordered = PacketsReordered;
+  const int64 Resolved = FMath::Min<int64>(RecentResolved, RecentCount);
+  Stats.RecentLossRate = Resolved > 0 ? (float)RecentLostCount / Resolved : 0.0f;
+  Stats.ReorderRate =
+      PacketsAcked > 0 ? (float)PacketsReordered / PacketsAcked : 0.0f;
+  if (bAnyAck) {
+    Stats.LastAckAgeMs = (ClockSync::NowMicros() - LastAckLocalUs) / 1000.0f;
+  }
+
+  const int32 Count = (int32)FMath::Min<int64>(AckSamples, RecentCount);
+  if (Count == 0) {
+    return Stats;
+  }
+  TArray<float> Rtts;
+  Rtts.Reserve(Count);
+  double RttSum = 0.0;
+  double ForwardSum = 0.0;
+  double ReverseSum = 0.0;
+  int32 DelayCount = 0;
+  for (int32 i = 0; i < Count; i++) {
+    const FAckSample &Sample = RecentAcks[i];
+    Rtts.Add(Sample.RttMs);
+    RttSum += Sample.RttMs;
+    if (Sample.bDelayValid) {
+      ForwardSum += Sample.ForwardDelayMs;
+      ReverseSum += Sample.ReverseDelayMs;
+      DelayCount++;
+    }
+  }
+  Rtts.Sort();
+  auto Percentile = [&Rtts](double P) {
+    return Rtts[FMath::Min(Rtts.Num() - 1, (int32)(P * Rtts.Num()))];
+  };
+  Stats.RttMeanMs = RttSum / Count;
+  Stats.RttP50Ms = Percentile(0.50);
+  Stats.RttP95Ms = Percentile(0.95);
+  Stats.RttP99Ms = Percentile(0.99);
+  Stats.RttMaxMs = Rtts.Last();
+  Stats.bDelayValid = DelayCount > 0;
+  if (DelayCount > 0) {
+    Stats.ForwardDelayMs = ForwardSum / DelayCount;
+    Stats.ReverseDelayMs = ReverseSum / DelayCount;
+  }
+  return Stats;
+}
+
+void FControlLinkQualityTracker::GetRttHistogram(
+    TArray<float> &OutUpperMs, TArray<int64> &OutCounts) const {
+  FScopeLock ScopeLock(&Lock);
+  OutUpperMs.SetNum(HistogramBuckets);
+  OutCounts.SetNum(HistogramBuckets);
+  for (int32 i = 0; i < HistogramBuckets; i++) {
+    OutUpperMs[i] = i < HistogramBuckets - 1
+                        ? HistogramFirstUpperMs * FMath::Pow(2.0, i / 2.0)
+                        : -1.0f;
+    OutCounts[i] = Histogram[i];
+  }
+}
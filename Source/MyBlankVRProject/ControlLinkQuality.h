@@ -0,0 +1,152 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "ControlLinkQuality.generated.h"
+
+struct FClockEstimate;
+
+// Delivery and latency of the control stream as seen through the robot's
+// acknowledgements. Percentiles and delays cover the most recent acks; the
+// counters cover the whole session.
+USTRUCT(BlueprintType)
+struct FControlLinkQuality {
+  GENERATED_BODY()
+
+  UPROPERTY(BlueprintReadOnly, Category = "Control")
+  int64 PacketsSent = 0;
+
+  UPROPERTY(BlueprintReadOnly, Category = "Control")
+  int64 PacketsAcked = 0;
+
+  // Not acknowledged within the loss timeout, directly or in a later ack
+  UPROPERTY(BlueprintReadOnly, Category = "Control")
+  int64 PacketsLost = 0;
+
+  // Acks for a sequence older than one already acknowledged
+  UPROPERTY(BlueprintReadOnly, Category = "Control")
+  int64 PacketsReordered = 0;
+
+  // Lost fraction of the most recently resolved packets
+  UPROPERTY(BlueprintReadOnly, Category = "Control")
+  float RecentLossRate = 0.0f;
+
+  UPROPERTY(BlueprintReadOnly, Category = "Control")
+  float ReorderRate = 0.0f;
+
+  // Round trip without the robot's processing time
+  UPROPERTY(BlueprintReadOnly, Category = "Control")
+  float RttMeanMs = 0.0f;
+
+  UPROPERTY(BlueprintReadOnly, Category = "Control")
+  float RttP50Ms = 0.0f;
+
+  UPROPERTY(BlueprintReadOnly, Category = "Control")
+  float RttP95Ms = 0.0f;
+
+  UPROPERTY(BlueprintReadOnly, Category = "Control")
+  float RttP99Ms = 0.0f;
+
+  UPROPERTY(BlueprintReadOnly, Category = "Control")
+  float RttMaxMs = 0.0f;
+
+  // One-way delays through the synced clock; only meaningful when
+  // bDelayValid
+  UPROPERTY(BlueprintReadOnly, Category = "Control")
+  bool bDelayValid = false;
+
+  UPROPERTY(BlueprintReadOnly, Category = "Control")
+  float ForwardDelayMs = 0.0f;
+
+  UPROPERTY(BlueprintReadOnly, Category = "Control")
+  float ReverseDelayMs = 0.0f;
+
+  // Since the last ack arrived; negative if none has. The signal to fail
+  // safe on.
+  UPROPERTY(BlueprintReadOnly, Category = "Control")
+  float LastAckAgeMs = -1.0f;
+};
+
+// Matches control acks against sent packets. Fed by the control link's I/O
+// thread; GetStats and GetRttHistogram may be called from any thread.
+//
+// Every sent packet occupies a slot in a ring indexed by sequence number. An
+// ack names one sequence, whose send time gives an RTT sample, plus a mask of
+// the 32 before it so a lost ack does not count its packets as lost. Slots
+// still unacknowledged after LossTimeoutUs are counted as lost.
+class MYBLANKVRPROJECT_API FControlLinkQualityTracker {
+public:
+  static constexpr int32 HistogramBuckets = 25;
+
+  FControlLinkQualityTracker();
+
+  void RecordSend(uint32 Sequence, int64 SentLocalUs);
+
+  // RobotReceiveUs and RobotTransmitUs are on the robot's clock; Clock may be
+  // null while unsynced
+  void RecordAck(uint32 AckedSequence, uint32 ReceivedMask,
+                 uint64 RobotReceiveUs, uint64 RobotTransmitUs,
+                 int64 ReceivedLocalUs, const FClockEstimate *Clock);
+
+  // Resolves packets older than the loss timeout
+  void Expire(int64 NowLocalUs);
+
+  FControlLinkQuality GetStats() const;
+
+  // Label slot for the exported metrics, see PipelineMetrics::ClaimLink
+  void SetMetricsLink(int32 Link);
+
+  // Session-wide RTT histogram. Bucket i counts RTTs up to UpperMs[i]; the
+  // last bucket is unbounded and reported as a negative bound.
+  void GetRttHistogram(TArray<float> &OutUpperMs,
+                       TArray<int64> &OutCounts) const;
+
+private:
+  static constexpr int32 SlotCount = 1024;
+  static constexpr int32 RecentCount = 256;
+  static constexpr int64 LossTimeoutUs = 1000000;
+
+  struct FSlot {
+    uint32 Sequence;
+    int64 SentLocalUs;
+    bool bInFlight;
+    bool bAcked;
+  };
+
+  struct FAckSample {
+    float RttMs;
+    float ForwardDelayMs;
+    float ReverseDelayMs;
+    bool bDelayValid;
+  };
+
+  void Resolve(FSlot &Slot);
+  void MarkAcked(uint32 Sequence);
+
+  mutable FCriticalSection Lock;
+
+  FSlot Slots[SlotCount];
+  // Next sequence to resolve; everything before it is acked or lost
+  uint32 OldestUnresolved;
+  uint32 NextSequence;
+  bool bStarted;
+
+  uint32 HighestAcked;
+  int32 MetricsLink;
+  bool bAnyAck;
+  int64 LastAckLocalUs;
+
+  int64 PacketsSent;
+  int64 PacketsAcked;
+  int64 PacketsLost;
+  int64 PacketsReordered;
+
+  // Outcome of the last RecentCount resolved packets, 1 for lost
+  uint8 RecentLost[RecentCount];
+  int32 RecentLostCount;
+  int64 RecentResolved;
+
+  FAckSample RecentAcks[RecentCount];
+  int64 AckSamples;
+
+  int64 Histogram[HistogramBuckets];
+};
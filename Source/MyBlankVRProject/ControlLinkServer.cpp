@@ -0,0 +1,1004 @@
+#include "ControlLinkServer.h"
+#include "Async/Async.h"
+#include "ControlWireProtocol.h"
+#include "HAL/PlatformProcess.h"
+#include "HAL/PlatformTime.h"
+#include "HAL/RunnableThread.h"
+#include "Interfaces/IPv4/IPv4Address.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Guid.h"
+#include "Misc/Paths.h"
+#include "Misc/ScopeLock.h"
+#include "PipelineStats.h"
+#include "RendezvousFallback.h"
+
+#if WITH_CONTROL_LINK_SERVER
+#include <arpa/inet.h>
+#include <cerrno>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#if CONTROL_LINK_USE_EPOLL
+#include <sys/epoll.h>
+#include <sys/timerfd.h>
+#else
+#include <poll.h>
+#endif
+#endif
+
+namespace {
+constexpr double SyncFastIntervalSeconds = 0.05;
+constexpr double SyncSlowIntervalSeconds = 1.0;
+// Clock samples to collect at the fast rate before slowing down
+constexpr int32 SyncSettleSamples = 16;
+// Longest the loop blocks, bounding how long Stop() and new links wait
+constexpr double MaxWaitSeconds = 0.1;
+// The wait sleeps until this long before its deadline and yields through
+// the rest, absorbing the kernel's timer slack
+constexpr double SpinSeconds = 100e-6;
+constexpr double BeaconSearchIntervalSeconds = 0.25;
+constexpr double BeaconIdleIntervalSeconds = 2.0;
+// Administratively scoped group for LAN discovery
+constexpr uint32 DiscoveryMulticastGroup = 0xEFFF4350; // 239.255.67.80
+constexpr double RendezvousFallbackDelaySeconds = 5.0;
+constexpr int32 MaxCachedPeers = 8;
+
+FCriticalSection InstanceLock;
+TWeakPtr<FControlLinkServer, ESPMode::ThreadSafe> Instance;
+bool bPeerCacheEnabled = true;
+
+bool IsSampleStale(const FRobotControlData &Sample, int64 NowUs,
+                   const FControlLinkConfig &Config) {
+  return Config.MaxSampleAgeSeconds > 0.0 && Sample.SampledLocalUs != 0 &&
+         NowUs - Sample.SampledLocalUs >
+             (int64)(Config.MaxSampleAgeSeconds * 1e6);
+}
+
+ControlWire::FControlPayload
+MakeControlPayload(const FRobotControlData &Sample, int64 NowUs,
+                   const FControlLinkConfig &Config) {
+  const FRobotControlData Current =
+      Sample.ExtrapolatedTo(NowUs, Config.MaxExtrapolationSeconds);
+  ControlWire::FControlPayload Payload;
+  Payload.Pitch = Current.Pitch;
+  Payload.Yaw = Current.Yaw;
+  // A stalled game thread must not leave the robot driving on old input
+  if (!IsSampleStale(Sample, NowUs, Config)) {
+    Payload.TriggerPosition = Current.TriggerPosition;
+    Payload.ThumbstickX = Current.ThumbstickX;
+  }
+  return Payload;
+}
+} // namespace
+
+// Everything we know about one robot, keyed by its IPv4 address. A robot
+// may use different source ports for clock sync and control.
+struct FControlLinkPeer {
+  uint32 Address = 0;
+  sockaddr_in SyncAddr;
+  bool bHasSyncAddr = false;
+  sockaddr_in ControlAddr;
+  bool bHasControlAddr = false;
+
+  FControlLink *Link = nullptr;
+
+  double LastHeard = 0.0;
+
+  FClockSyncEstimator Clock;
+  uint32 SyncSequence = 0;
+  double NextSyncRequest = 0.0;
+  // Originate times of requests still awaiting an answer
+  static constexpr int32 MaxOutstanding = 8;
+  int64 Outstanding[MaxOutstanding] = {};
+  int32 NextOutstanding = 0;
+
+  bool bTelemetryReceived = false;
+  uint32 LastTelemetrySequence = 0;
+};
+
+FControlLink::FControlLink(const FControlLinkConfig &InConfig)
+    : Config(InConfig), RobotAddress(0),
+      Scheduler(InConfig.SendRateHz, InConfig.bSendOnChange,
+                InConfig.HeartbeatSeconds) {
+  FIPv4Address Parsed;
+  if (!Config.RobotAddress.IsEmpty() &&
+      FIPv4Address::Parse(Config.RobotAddress, Parsed)) {
+    RobotAddress = Parsed.Value;
+  }
+}
+
+TSharedPtr<FControlLinkServer, ESPMode::ThreadSafe>
+FControlLinkServer::Acquire() {
+  FScopeLock Lock(&InstanceLock);
+  TSharedPtr<FControlLinkServer, ESPMode::ThreadSafe> Server = Instance.Pin();
+  if (!Server) {
+    Server = MakeShareable(
+        new FControlLinkServer(DefaultClockSyncPort, DefaultControlPort,
+                               DefaultDiscoveryPort));
+    if (!Server->Start()) {
+      return nullptr;
+    }
+    Instance = Server;
+  }
+  return Server;
+}
+
+void FControlLinkServer::DisablePeerCache() {
+  FScopeLock Lock(&InstanceLock);
+  bPeerCacheEnabled = false;
+}
+
+FControlLinkServer::FControlLinkServer(int32 InClockSyncPort,
+                                       int32 InControlPort,
+                                       int32 InDiscoveryPort)
+    : bStopThread(false), Thread(nullptr), DiscoveryPort(InDiscoveryPort),
+      SessionId(FGuid::NewGuid().A), BeaconSequence(0), NextBeacon(0.0),
+      StartTime(0.0), bFallbackRun(false),
+      PeerCachePath(bPeerCacheEnabled ? FPaths::ProjectSavedDir() /
+                                            TEXT("ControlLinkPeers.txt")
+                                      : FString()) {
+  SyncSocket.Port = InClockSyncPort;
+  ControlSocket.Port = InControlPort;
+#if CONTROL_LINK_USE_EPOLL
+  EpollFd = -1;
+  TimerFd = -1;
+#endif
+}
+
+FControlLinkServer::~FControlLinkServer() {
+  if (Thread) {
+    Stop();
+    Thread->WaitForCompletion();
+    delete Thread;
+    Thread = nullptr;
+  }
+  for (const TSharedPtr<FControlLink, ESPMode::ThreadSafe> &Link : Links) {
+    SetLinkMetrics(*Link, nullptr);
+  }
+  CloseSocket(SyncSocket);
+  CloseSocket(ControlSocket);
+#if CONTROL_LINK_USE_EPOLL
+  if (EpollFd >= 0) {
+    close(EpollFd);
+  }
+  if (TimerFd >= 0) {
+    close(TimerFd);
+  }
+#endif
+  PeerCachePipe.WaitUntilEmpty();
+}
+
+bool FControlLinkServer::Start() {
+#if WITH_CONTROL_LINK_SERVER
+  // On the caller's thread, so a taken port fails Acquire rather than
+  // leaving a thread that never serves anything
+  if (!OpenSockets()) {
+    return false;
+  }
+  LoadPeerCache();
+  StartTime = FPlatformTime::Seconds();
+  Thread = FRunnableThread::Create(this, TEXT("ControlLinkServerThread"), 0,
+                                   TPri_AboveNormal);
+  return Thread != nullptr;
+#else
+  UE_LOG(LogTemp, Error,
+         TEXT("Control link server is not supported on this platform"));
+  return false;
+#endif
+}
+
+void FControlLinkServer::AddLink(
+    const TSharedPtr<FControlLink, ESPMode::ThreadSafe> &Link) {
+  FScopeLock Lock(&LinkLock);
+  PendingAdds.Add(Link);
+}
+
+void FControlLinkServer::RemoveLink(
+    const TSharedPtr<FControlLink, ESPMode::ThreadSafe> &Link) {
+  FScopeLock Lock(&LinkLock);
+  PendingAdds.Remove(Link);
+  PendingRemoves.Add(Link);
+}
+
+void FControlLinkServer::SetRendezvousFallback(
+    const TSharedPtr<IRendezvousFallback, ESPMode::ThreadSafe> &InFallback) {
+  FScopeLock Lock(&LinkLock);
+  Fallback = InFallback;
+}
+
+void FControlLinkServer::Stop() { bStopThread = true; }
+
+void FControlLinkServer::LoadPeerCache() {
+  TArray<FString> Lines;
+  if (PeerCachePath.IsEmpty() ||
+      !FFileHelper::LoadFileToStringArray(Lines, *PeerCachePath)) {
+    return;
+  }
+  for (const FString &Line : Lines) {
+    FIPv4Address Address;
+    if (CachedPeers.Num() < MaxCachedPeers &&
+        FIPv4Address::Parse(Line.TrimStartAndEnd(), Address)) {
+      CachedPeers.AddUnique(Address.Value);
+    }
+  }
+  UE_LOG(LogTemp, Log, TEXT("Control link: %d cached robot addresses"),
+         CachedPeers.Num());
+}
+
+void FControlLinkServer::RememberPeer(uint32 Address) {
+  if (CachedPeers.Num() > 0 && CachedPeers[0] == Address) {
+    return;
+  }
+  CachedPeers.Remove(Address);
+  CachedPeers.Insert(Address, 0);
+  if (CachedPeers.Num() > MaxCachedPeers) {
+    CachedPeers.SetNum(MaxCachedPeers);
+  }
+  if (PeerCachePath.IsEmpty()) {
+    return;
+  }
+
+  TArray<FString> Lines;
+  for (uint32 Cached : CachedPeers) {
+    Lines.Add(FIPv4Address(Cached).ToString());
+  }
+  // A slow disk must not hold up clock sync and control
+  PeerCachePipe.Launch(
+      TEXT("SaveControlLinkPeers"),
+      [Lines = MoveTemp(Lines), Path = PeerCachePath]() {
+        if (!FFileHelper::SaveStringArrayToFile(Lines, *Path)) {
+          UE_LOG(LogTemp, Warning, TEXT("Control link: failed to write %s"),
+                 *Path);
+        }
+      });
+}
+
+void FControlLinkServer::RunRendezvousFallback() {
+  TSharedPtr<IRendezvousFallback, ESPMode::ThreadSafe> Announcer;
+  {
+    FScopeLock Lock(&LinkLock);
+    Announcer = Fallback;
+  }
+  if (!Announcer) {
+    return;
+  }
+  UE_LOG(LogTemp, Log,
+         TEXT("Control link: no robot found on the LAN, trying rendezvous"));
+  // HTTP requests belong on the game thread
+  AsyncTask(ENamedThreads::GameThread,
+            [Announcer]() { Announcer->Announce(); });
+}
+
+#if WITH_CONTROL_LINK_SERVER
+bool FControlLinkServer::OpenSocket(FSocketState &Socket) {
+  Socket.Fd = socket(AF_INET, SOCK_DGRAM, 0);
+  if (Socket.Fd < 0) {
+    return false;
+  }
+  const int Enable = 1;
+  setsockopt(Socket.Fd, SOL_SOCKET, SO_REUSEADDR, &Enable, sizeof(Enable));
+  // Discovery beacons go out on the LAN broadcast address
+  setsockopt(Socket.Fd, SOL_SOCKET, SO_BROADCAST, &Enable, sizeof(Enable));
+  fcntl(Socket.Fd, F_SETFL, fcntl(Socket.Fd, F_GETFL, 0) | O_NONBLOCK);
+
+  sockaddr_in Addr = {};
+  Addr.sin_family = AF_INET;
+  Addr.sin_addr.s_addr = htonl(INADDR_ANY);
+  Addr.sin_port = htons((uint16)Socket.Port);
+  if (bind(Socket.Fd, (const sockaddr *)&Addr, sizeof(Addr)) != 0) {
+    UE_LOG(LogTemp, Error, TEXT("Control link: failed to bind port %d (%d)"),
+           Socket.Port, errno);
+    CloseSocket(Socket);
+    return false;
+  }
+
+#if CONTROL_LINK_USE_EPOLL
+  epoll_event Event = {};
+  Event.events = EPOLLIN;
+  Event.data.ptr = &Socket;
+  epoll_ctl(EpollFd, EPOLL_CTL_ADD, Socket.Fd, &Event);
+#endif
+  return true;
+}
+
+void FControlLinkServer::CloseSocket(FSocketState &Socket) {
+  if (Socket.Fd >= 0) {
+    close(Socket.Fd);
+    Socket.Fd = -1;
+  }
+}
+
+bool FControlLinkServer::SendTo(FSocketState &Socket, const uint8 *Data,
+                                int32 Size, const sockaddr_in &Address) {
+  const ssize_t Sent = sendto(Socket.Fd, Data, Size, 0,
+                              (const sockaddr *)&Address, sizeof(Address));
+  if (Sent >= 0) {
+    return true;
+  }
+  if (errno != EAGAIN && errno != EWOULDBLOCK && errno != ENOBUFS) {
+    // Unreachable peers and the like: the datagram is simply lost
+    return true;
+  }
+  if (!Socket.bWantWrite) {
+    Socket.bWantWrite = true;
+#if CONTROL_LINK_USE_EPOLL
+    epoll_event Event = {};
+    Event.events = EPOLLIN | EPOLLOUT;
+    Event.data.ptr = &Socket;
+    epoll_ctl(EpollFd, EPOLL_CTL_MOD, Socket.Fd, &Event);
+#endif
+  }
+  return false;
+}
+
+bool FControlLinkServer::OpenSockets() {
+#if CONTROL_LINK_USE_EPOLL
+  EpollFd = epoll_create1(0);
+  TimerFd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+  if (EpollFd < 0 || TimerFd < 0) {
+    UE_LOG(LogTemp, Error, TEXT("Control link: failed to create epoll (%d)"),
+           errno);
+    return false;
+  }
+  // Registered with a null pointer, which no socket has
+  epoll_event TimerEvent = {};
+  TimerEvent.events = EPOLLIN;
+  TimerEvent.data.ptr = nullptr;
+  epoll_ctl(EpollFd, EPOLL_CTL_ADD, TimerFd, &TimerEvent);
+#endif
+  if (!OpenSocket(SyncSocket) || !OpenSocket(ControlSocket)) {
+    return false;
+  }
+  UE_LOG(LogTemp, Log,
+         TEXT("Control link server: clock sync on %d, control on %d"),
+         SyncSocket.Port, ControlSocket.Port);
+  return true;
+}
+
+double FControlLinkServer::WaitForEvents(double Timeout,
+                                         bool &bOutSyncReadable,
+                                         bool &bOutControlReadable,
+                                         bool &bOutWritable) {
+  const double Deadline = FPlatformTime::Seconds() + Timeout;
+  // Sleep in the readiness wait until just short of the deadline
+  const double SleepSeconds = Timeout - SpinSeconds;
+
+  bOutSyncReadable = bOutControlReadable = bOutWritable = false;
+#if CONTROL_LINK_USE_EPOLL
+  int TimeoutMs = 0;
+  if (SleepSeconds > 0.0) {
+    // The timer ends the wait; the millisecond timeout, rounded up so it
+    // can never fire first, only backs it up
+    const int64 SleepNs = FMath::Max((int64)(SleepSeconds * 1e9), (int64)1);
+    itimerspec Spec = {};
+    Spec.it_value.tv_sec = (time_t)(SleepNs / 1000000000);
+    Spec.it_value.tv_nsec = (long)(SleepNs % 1000000000);
+    timerfd_settime(TimerFd, 0, &Spec, nullptr);
+    TimeoutMs = (int)FMath::CeilToDouble(Timeout * 1000.0) + 1;
+  }
+  epoll_event Events[4];
+  const int Count = epoll_wait(EpollFd, Events, 4, TimeoutMs);
+  for (int i = 0; i < Count; i++) {
+    FSocketState *Socket = (FSocketState *)Events[i].data.ptr;
+    if (!Socket) {
+      uint64 Expirations;
+      read(TimerFd, &Expirations, sizeof(Expirations));
+      continue;
+    }
+    if (Events[i].events & EPOLLIN) {
+      (Socket == &SyncSocket ? bOutSyncReadable : bOutControlReadable) = true;
+    }
+    if ((Events[i].events & EPOLLOUT) && Socket->bWantWrite) {
+      Socket->bWantWrite = false;
+      bOutWritable = true;
+      epoll_event Event = {};
+      Event.events = EPOLLIN;
+      Event.data.ptr = Socket;
+      epoll_ctl(EpollFd, EPOLL_CTL_MOD, Socket->Fd, &Event);
+    }
+  }
+#else
+  // poll() only takes whole milliseconds and Mac has neither ppoll nor
+  // timerfd: wait for readiness through the whole milliseconds, then sleep
+  // the fraction left
+  pollfd Fds[2];
+  Fds[0].fd = SyncSocket.Fd;
+  Fds[0].events = POLLIN | (SyncSocket.bWantWrite ? POLLOUT : 0);
+  Fds[1].fd = ControlSocket.Fd;
+  Fds[1].events = POLLIN | (ControlSocket.bWantWrite ? POLLOUT : 0);
+  const int TimeoutMs = SleepSeconds > 0.0 ? (int)(SleepSeconds * 1000.0) : 0;
+  if (poll(Fds, 2, TimeoutMs) > 0) {
+    bOutSyncReadable = (Fds[0].revents & POLLIN) != 0;
+    bOutControlReadable = (Fds[1].revents & POLLIN) != 0;
+    FSocketState *Sockets[2] = {&SyncSocket, &ControlSocket};
+    for (int i = 0; i < 2; i++) {
+      if ((Fds[i].revents & POLLOUT) && Sockets[i]->bWantWrite) {
+        Sockets[i]->bWantWrite = false;
+        bOutWritable = true;
+      }
+    }
+  } else {
+    const double Fraction = Deadline - SpinSeconds - FPlatformTime::Seconds();
+    if (Fraction > 0.0) {
+      FPlatformProcess::SleepNoStats((float)Fraction);
+    }
+  }
+#endif
+
+  double Now = FPlatformTime::Seconds();
+  if (bOutSyncReadable || bOutControlReadable || bOutWritable) {
+    return Now;
+  }
+  // Yield through the last stretch so sends are not late by the timer
+  // slack. A wait cut short by a signal goes back round the loop instead.
+  if (Deadline - Now <= 2.0 * SpinSeconds) {
+    while (Now < Deadline) {
+      FPlatformProcess::Yield();
+      Now = FPlatformTime::Seconds();
+    }
+  }
+  return Now;
+}
+
+uint32 FControlLinkServer::Run() {
+  while (!bStopThread) {
+    ApplyLinkChanges();
+
+    // Sleep until the earliest clock sync request or control deadline
+    double Now = FPlatformTime::Seconds();
+    double NextEvent = Now + MaxWaitSeconds;
+    for (const TUniquePtr<FControlLinkPeer> &Peer : Peers) {
+      if (Peer->bHasSyncAddr) {
+        NextEvent = FMath::Min(NextEvent, Peer->NextSyncRequest);
+      }
+    }
+    for (const TSharedPtr<FControlLink, ESPMode::ThreadSafe> &Link : Links) {
+      if (Link->bStreaming) {
+        NextEvent = FMath::Min(NextEvent, Link->Scheduler.GetNextDeadline());
+      }
+      if (Link->DuplicatesLeft > 0) {
+        NextEvent = FMath::Min(NextEvent, Link->NextDuplicate);
+      }
+    }
+    NextEvent = FMath::Min(NextEvent, NextBeacon);
+
+    bool bSyncReadable, bControlReadable, bWritable;
+    Now = WaitForEvents(FMath::Max(NextEvent - Now, 0.0), bSyncReadable,
+                        bControlReadable, bWritable);
+
+    if (bSyncReadable) {
+      DrainSocket(SyncSocket, Now);
+    }
+    if (bControlReadable) {
+      DrainSocket(ControlSocket, Now);
+    }
+    ExpirePeers(Now);
+    if (bWritable) {
+      // Resend the newest sample for links whose last tick was dropped
+      for (const TSharedPtr<FControlLink, ESPMode::ThreadSafe> &Link : Links) {
+        if (Link->bSendPending) {
+          SendControl(*Link);
+        }
+      }
+    }
+
+    for (const TUniquePtr<FControlLinkPeer> &Peer : Peers) {
+      if (Peer->bHasSyncAddr && Now >= Peer->NextSyncRequest) {
+        SendClockSyncRequest(*Peer);
+        Peer->NextSyncRequest =
+            Now + (Peer->Clock.GetEstimate().SampleCount < SyncSettleSamples
+                       ? SyncFastIntervalSeconds
+                       : SyncSlowIntervalSeconds);
+      }
+    }
+    for (const TSharedPtr<FControlLink, ESPMode::ThreadSafe> &Link : Links) {
+      ServiceLink(*Link, Now);
+    }
+
+    if (Now >= NextBeacon) {
+      SendBeacons(Now);
+    }
+    if (!bFallbackRun && Peers.Num() == 0 &&
+        Now - StartTime >= RendezvousFallbackDelaySeconds) {
+      bFallbackRun = true;
+      RunRendezvousFallback();
+    }
+  }
+  return 0;
+}
+
+void FControlLinkServer::ApplyLinkChanges() {
+  FScopeLock Lock(&LinkLock);
+  if (PendingAdds.Num() == 0 && PendingRemoves.Num() == 0) {
+    return;
+  }
+  const double Now = FPlatformTime::Seconds();
+  for (const TSharedPtr<FControlLink, ESPMode::ThreadSafe> &Link :
+       PendingAdds) {
+    Link->SearchStartTime = Now;
+  }
+  for (const TSharedPtr<FControlLink, ESPMode::ThreadSafe> &Link :
+       PendingRemoves) {
+    if (Link->Peer) {
+      Link->Peer->Link = nullptr;
+      Link->Peer = nullptr;
+    }
+    SetLinkMetrics(*Link, nullptr);
+    Links.Remove(Link);
+  }
+  PendingRemoves.Reset();
+  Links.Append(PendingAdds);
+  PendingAdds.Reset();
+  AttachLinks(Now);
+  // Beacon the new links' robots right away
+  NextBeacon = Now;
+}
+
+void FControlLinkServer::AttachLinks(double Now) {
+  for (const TSharedPtr<FControlLink, ESPMode::ThreadSafe> &Link : Links) {
+    if (Link->Peer) {
+      continue;
+    }
+    for (const TUniquePtr<FControlLinkPeer> &Peer : Peers) {
+      if (Peer->Link || (Link->RobotAddress != 0 &&
+                         Link->RobotAddress != Peer->Address)) {
+        continue;
+      }
+      Peer->Link = Link.Get();
+      Link->Peer = Peer.Get();
+      Link->bAcquiring = true;
+      Link->AttachTime = Now;
+      Link->DiscoverySeconds = Now - Link->SearchStartTime;
+      SetLinkMetrics(*Link, Peer.Get());
+      PublishClock(*Peer);
+      UE_LOG(LogTemp, Log,
+             TEXT("Control link attached to robot %s after %.1f ms"),
+             *FIPv4Address(Peer->Address).ToString(),
+             (Now - Link->SearchStartTime) * 1000.0);
+      break;
+    }
+  }
+}
+
+void FControlLinkServer::SetLinkMetrics(FControlLink &Link,
+                                        const FControlLinkPeer *Peer) {
+  PipelineMetrics::ReleaseLink(Link.MetricsLink);
+  const int32 MetricsLink =
+      Peer ? PipelineMetrics::ClaimLink(Peer->Address) : INDEX_NONE;
+  if (Peer && MetricsLink == INDEX_NONE) {
+    UE_LOG(LogTemp, Warning,
+           TEXT("Control link: more than %d robots, metrics for %s are not "
+                "exported"),
+           PipelineMetrics::MaxLinks, *FIPv4Address(Peer->Address).ToString());
+  }
+  Link.MetricsLink = MetricsLink;
+  Link.Quality.SetMetricsLink(MetricsLink);
+  Link.MotionToPhoton.SetMetricsLink(MetricsLink);
+}
+
+void FControlLinkServer::ExpirePeers(double Now) {
+  bool bDropped = false;
+  for (int32 i = Peers.Num() - 1; i >= 0; i--) {
+    FControlLinkPeer &Peer = *Peers[i];
+    const double Timeout =
+        Peer.Link ? Peer.Link->Config.PeerTimeoutSeconds
+                  : FControlLinkConfig().PeerTimeoutSeconds;
+    if (Now - Peer.LastHeard < Timeout) {
+      continue;
+    }
+    UE_LOG(LogTemp, Warning, TEXT("Control link: lost robot %s"),
+           *FIPv4Address(Peer.Address).ToString());
+    if (FControlLink *Link = Peer.Link) {
+      Link->Peer = nullptr;
+      Link->bStreaming = false;
+      Link->bSendPending = false;
+      Link->bAcquiring = false;
+      Link->DuplicatesLeft = 0;
+      Link->ClockEstimates.Push(FClockEstimate());
+      Link->State = ERobotLinkState::Searching;
+      SetLinkMetrics(*Link, nullptr);
+      Link->SearchStartTime = Now;
+    }
+    Peers.RemoveAt(i);
+    bDropped = true;
+  }
+  if (bDropped) {
+    // Links freed by a lost robot may claim another that is still here
+    AttachLinks(Now);
+  }
+}
+
+void FControlLinkServer::PublishClock(FControlLinkPeer &Peer) {
+  if (!Peer.Link) {
+    return;
+  }
+  const FClockEstimate &Estimate = Peer.Clock.GetEstimate();
+  Peer.Link->ClockEstimates.Push(Estimate);
+  Peer.Link->State = Estimate.bValid ? ERobotLinkState::Synced
+                                     : ERobotLinkState::Connected;
+  if (Estimate.bValid) {
+    const int32 MetricsLink = Peer.Link->MetricsLink;
+    PipelineMetrics::ClockOffset.Set(MetricsLink, Estimate.OffsetUs);
+    PipelineMetrics::ClockUncertainty.Set(MetricsLink,
+                                          (int64)Estimate.UncertaintyUs);
+  }
+}
+
+void FControlLinkServer::DrainSocket(FSocketState &Socket, double Now) {
+  uint8 Buffer[ControlWire::MaxPacketSize];
+  sockaddr_in From;
+  for (;;) {
+    socklen_t FromSize = sizeof(From);
+    const ssize_t Size = recvfrom(Socket.Fd, Buffer, sizeof(Buffer), 0,
+                                  (sockaddr *)&From, &FromSize);
+    if (Size < 0) {
+      // EAGAIN once the socket is empty; anything else is per-datagram
+      if (errno == EAGAIN || errno == EWOULDBLOCK) {
+        return;
+      }
+      continue;
+    }
+    // Stamp before anything else so parsing does not count as network time
+    const int64 ReceivedLocalUs = ClockSync::NowMicros();
+    HandleDatagram(Socket, Buffer, (int32)Size, From, Now, ReceivedLocalUs);
+  }
+}
+
+FControlLinkPeer *FControlLinkServer::FindPeer(uint32 Address) {
+  for (const TUniquePtr<FControlLinkPeer> &Peer : Peers) {
+    if (Peer->Address == Address) {
+      return Peer.Get();
+    }
+  }
+  return nullptr;
+}
+
+void FControlLinkServer::SendBeacons(double Now) {
+  bool bSearching = false;
+  for (const TSharedPtr<FControlLink, ESPMode::ThreadSafe> &Link : Links) {
+    bSearching |= Link->Peer == nullptr;
+  }
+  NextBeacon = Now + (bSearching ? BeaconSearchIntervalSeconds
+                                 : BeaconIdleIntervalSeconds);
+
+  ControlWire::FDiscoveryPayload Payload;
+  Payload.ClockSyncPort = (uint16)SyncSocket.Port;
+  Payload.ControlPort = (uint16)ControlSocket.Port;
+  Payload.Capabilities =
+      ControlWire::CapabilityClockSync | ControlWire::CapabilityControl |
+      ControlWire::CapabilityTelemetry |
+      ControlWire::CapabilityUnsyncedControl |
+      ControlWire::CapabilityControlAck | ControlWire::CapabilityControlBundle;
+  Payload.SessionId = SessionId;
+
+  uint8 Packet[ControlWire::MaxPacketSize];
+  const int32 Size = ControlWire::Encode(BeaconSequence++, 0, Payload, Packet,
+                                         sizeof(Packet));
+
+  TArray<uint32> Targets;
+  Targets.Add(INADDR_BROADCAST);
+  Targets.Add(DiscoveryMulticastGroup);
+  for (uint32 Cached : CachedPeers) {
+    Targets.AddUnique(Cached);
+  }
+  for (const TSharedPtr<FControlLink, ESPMode::ThreadSafe> &Link : Links) {
+    if (Link->RobotAddress != 0) {
+      Targets.AddUnique(Link->RobotAddress);
+    }
+  }
+
+  sockaddr_in Address = {};
+  Address.sin_family = AF_INET;
+  Address.sin_port = htons((uint16)DiscoveryPort);
+  for (uint32 Target : Targets) {
+    Address.sin_addr.s_addr = htonl(Target);
+    SendTo(SyncSocket, Packet, Size, Address);
+  }
+}
+
+void FControlLinkServer::HandleDatagram(FSocketState &Socket,
+                                        const uint8 *Data, int32 Size,
+                                        const sockaddr_in &From, double Now,
+                                        int64 ReceivedLocalUs) {
+  ControlWire::FHeader Header;
+  if (!ControlWire::DecodeHeader(Data, Size, Header)) {
+    return;
+  }
+  if (Header.MessageType == ControlWire::EMessageType::Hello) {
+    HandleHello(Socket, Data, Size, From, Now);
+    return;
+  }
+
+  // Everything else must come from an endpoint a Hello announced
+  FControlLinkPeer *Peer = FindPeer(ntohl(From.sin_addr.s_addr));
+  if (!Peer) {
+    return;
+  }
+  const bool bSync = &Socket == &SyncSocket;
+  const sockaddr_in &Known = bSync ? Peer->SyncAddr : Peer->ControlAddr;
+  if (!(bSync ? Peer->bHasSyncAddr : Peer->bHasControlAddr) ||
+      Known.sin_port != From.sin_port) {
+    return;
+  }
+  Peer->LastHeard = Now;
+
+  switch (Header.MessageType) {
+  case ControlWire::EMessageType::ClockSync:
+    HandleClockSyncReply(*Peer, Data, Size, ReceivedLocalUs);
+    break;
+  case ControlWire::EMessageType::Telemetry:
+    HandleTelemetry(*Peer, Data, Size, ReceivedLocalUs);
+    break;
+  case ControlWire::EMessageType::ControlAck:
+    HandleControlAck(*Peer, Data, Size, ReceivedLocalUs);
+    break;
+  default:
+    break;
+  }
+}
+
+void FControlLinkServer::HandleHello(FSocketState &Socket, const uint8 *Data,
+                                     int32 Size, const sockaddr_in &From,
+                                     double Now) {
+  // A stale SessionId answers a beacon from before this process started
+  ControlWire::FHelloPayload Hello;
+  if (!ControlWire::DecodePayload(Data, Size, Hello) ||
+      Hello.SessionId != SessionId) {
+    return;
+  }
+
+  const uint32 Address = ntohl(From.sin_addr.s_addr);
+  FControlLinkPeer *Peer = FindPeer(Address);
+  if (!Peer) {
+    Peer = Peers.Add_GetRef(MakeUnique<FControlLinkPeer>()).Get();
+    Peer->Address = Address;
+    UE_LOG(LogTemp, Log, TEXT("Control link: robot at %s"),
+           *FIPv4Address(Address).ToString());
+    RememberPeer(Address);
+  }
+  Peer->LastHeard = Now;
+
+  const bool bSync = &Socket == &SyncSocket;
+  sockaddr_in &Known = bSync ? Peer->SyncAddr : Peer->ControlAddr;
+  bool &bKnown = bSync ? Peer->bHasSyncAddr : Peer->bHasControlAddr;
+  if (bKnown && Known.sin_port == From.sin_port) {
+    return;
+  }
+  // A new port means the robot restarted, so its clock samples no longer
+  // apply
+  Known = From;
+  bKnown = true;
+  if (bSync) {
+    Peer->Clock.Reset();
+    Peer->NextSyncRequest = 0.0;
+    FMemory::Memzero(Peer->Outstanding, sizeof(Peer->Outstanding));
+    PublishClock(*Peer);
+  }
+  if (!Peer->Link) {
+    AttachLinks(Now);
+  }
+}
+
+void FControlLinkServer::SendClockSyncRequest(FControlLinkPeer &Peer) {
+  ControlWire::FClockSyncPayload Payload;
+  Payload.OriginateUs = (uint64)ClockSync::NowMicros();
+
+  const FClockEstimate &Estimate = Peer.Clock.GetEstimate();
+  const uint64 TimestampUs =
+      Estimate.bValid ? (uint64)Estimate.ToRemoteUs(Payload.OriginateUs) : 0;
+
+  uint8 Packet[ControlWire::MaxPacketSize];
+  const int32 Size = ControlWire::Encode(Peer.SyncSequence++, TimestampUs,
+                                         Payload, Packet, sizeof(Packet));
+  Peer.Outstanding[Peer.NextOutstanding] = (int64)Payload.OriginateUs;
+  Peer.NextOutstanding =
+      (Peer.NextOutstanding + 1) % FControlLinkPeer::MaxOutstanding;
+  SendTo(SyncSocket, Packet, Size, Peer.SyncAddr);
+}
+
+void FControlLinkServer::HandleClockSyncReply(FControlLinkPeer &Peer,
+                                              const uint8 *Data, int32 Size,
+                                              int64 ReceivedLocalUs) {
+  FPV_SCOPE(Sync);
+  ControlWire::FClockSyncPayload Payload;
+  if (!ControlWire::DecodePayload(Data, Size, Payload)) {
+    return;
+  }
+
+  // Only answers to requests we actually sent, and each only once
+  bool bExpected = false;
+  for (int64 &Originate : Peer.Outstanding) {
+    if (Originate != 0 && Originate == (int64)Payload.OriginateUs) {
+      Originate = 0;
+      bExpected = true;
+      break;
+    }
+  }
+  if (!bExpected) {
+    return;
+  }
+
+  if (Peer.Clock.AddSample((int64)Payload.OriginateUs,
+                           (int64)Payload.ReceiveUs,
+                           (int64)Payload.TransmitUs, ReceivedLocalUs)) {
+    PublishClock(Peer);
+  }
+}
+
+void FControlLinkServer::HandleTelemetry(FControlLinkPeer &Peer,
+                                         const uint8 *Data, int32 Size,
+                                         int64 ReceivedLocalUs) {
+  ControlWire::FHeader Header;
+  ControlWire::FTelemetryPayload Payload;
+  if (!Peer.Link || !ControlWire::DecodeHeader(Data, Size, Header) ||
+      !ControlWire::DecodePayload(Data, Size, Payload)) {
+    return;
+  }
+
+  // Drop reordered packets, but accept a large jump back as a restart
+  const uint32 Behind = Peer.LastTelemetrySequence - Header.Sequence;
+  if (Peer.bTelemetryReceived && Behind > 0 && Behind < 1024) {
+    return;
+  }
+  Peer.bTelemetryReceived = true;
+  Peer.LastTelemetrySequence = Header.Sequence;
+
+  FTelemetrySnapshot Snapshot;
+  Snapshot.SpeedMph = Payload.SpeedMph;
+  Snapshot.DistanceFeet = Payload.DistanceFeet;
+  Snapshot.ControlBatteryPercentage = Payload.ControlBatteryPercentage;
+  Snapshot.DriveBatteryPercentage = Payload.DriveBatteryPercentage;
+  Snapshot.ReceivedLocalUs = ReceivedLocalUs;
+  Snapshot.RobotTimestampUs = Header.TimestampUs;
+  Snapshot.Sequence = Header.Sequence;
+  Peer.Link->TelemetryChannel.Push(Snapshot);
+}
+
+void FControlLinkServer::HandleControlAck(FControlLinkPeer &Peer,
+                                          const uint8 *Data, int32 Size,
+                                          int64 ReceivedLocalUs) {
+  ControlWire::FHeader Header;
+  ControlWire::FControlAckPayload Payload;
+  if (!Peer.Link || !ControlWire::DecodeHeader(Data, Size, Header) ||
+      !ControlWire::DecodePayload(Data, Size, Payload)) {
+    return;
+  }
+  FClockEstimate Clock;
+  const bool bSynced = Peer.Link->GetClockEstimate(Clock);
+  Peer.Link->Quality.RecordAck(Payload.AckedSequence, Payload.ReceivedMask,
+                               Payload.ReceiveUs, Header.TimestampUs,
+                               ReceivedLocalUs, bSynced ? &Clock : nullptr);
+  Peer.Link->MotionToPhoton.RecordAck(Payload.AckedSequence, Payload.ReceiveUs);
+}
+
+void FControlLinkServer::ServiceLink(FControlLink &Link, double Now) {
+  Link.Quality.Expire(ClockSync::NowMicros());
+  if (!Link.Peer || !Link.Peer->bHasControlAddr) {
+    Link.bStreaming = false;
+    return;
+  }
+  if (!Link.bStreaming) {
+    // Streaming does not wait for clock sync; the robot can act on
+    // untimestamped commands while the first estimate converges
+    Link.bStreaming = true;
+    Link.Scheduler.Start(Now);
+  }
+
+  if (Link.DuplicatesLeft > 0 && Now >= Link.NextDuplicate) {
+    // A copy that meets a full socket buffer is skipped, not retried
+    SendTo(ControlSocket, Link.DuplicatePacket, Link.DuplicateSize,
+           Link.Peer->ControlAddr);
+    Link.DuplicatesLeft--;
+    Link.NextDuplicate += Link.Config.DuplicateSpacingSeconds;
+  }
+
+  if (!Link.Scheduler.PollTick(Now)) {
+    return;
+  }
+
+  // Sample the newest input; if the game thread has not produced anything
+  // since, the previous one is carried forward along its rates
+  FPV_LINK_COUNTER_SET(ControlQueueDepth, Link.MetricsLink,
+                       Link.ControlChannel.GetProducedCount() -
+                           Link.ControlChannel.GetConsumedCount() -
+                           Link.ControlChannel.GetOverwrittenCount());
+  if (Link.ControlChannel.PopLatest(Link.Sample)) {
+    Link.bHaveSample = true;
+  }
+  if (!Link.bHaveSample) {
+    return;
+  }
+
+  const ControlWire::FControlPayload Payload =
+      MakeControlPayload(Link.Sample, ClockSync::NowMicros(), Link.Config);
+  const bool bChanged = Link.SentHistoryCount == 0 ||
+                        FMemory::Memcmp(&Payload, &Link.SentHistory[0],
+                                        sizeof(Payload)) != 0;
+  if (Link.bSendPending || Link.Scheduler.ShouldSend(Now, bChanged)) {
+    SendControl(Link);
+  }
+}
+
+void FControlLinkServer::SendControl(FControlLink &Link) {
+  FPV_SCOPE(Send);
+  FClockEstimate Clock;
+  const int64 SentLocalUs = ClockSync::NowMicros();
+  const ControlWire::FControlPayload Payload =
+      MakeControlPayload(Link.Sample, SentLocalUs, Link.Config);
+  const bool bStale = IsSampleStale(Link.Sample, SentLocalUs, Link.Config);
+  if (bStale != Link.bSampleStale) {
+    Link.bSampleStale = bStale;
+    if (bStale) {
+      UE_LOG(LogTemp, Warning,
+             TEXT("Control link: no input for %.0f ms, sending neutral "
+                  "throttle"),
+             (SentLocalUs - Link.Sample.SampledLocalUs) / 1000.0);
+    } else {
+      UE_LOG(LogTemp, Log, TEXT("Control link: input resumed"));
+    }
+  }
+  const uint64 TimestampUs =
+      Link.GetClockEstimate(Clock) ? (uint64)Clock.ToRemoteUs(SentLocalUs)
+                                   : 0;
+
+  uint8 Packet[ControlWire::MaxPacketSize];
+  const int32 BundleSamples = FMath::Clamp(Link.Config.RedundancySamples, 1,
+                                           ControlWire::MaxBundleSamples);
+  int32 Size;
+  if (BundleSamples > 1) {
+    ControlWire::FControlPayload Bundle[ControlWire::MaxBundleSamples];
+    Bundle[0] = Payload;
+    const int32 Count = FMath::Min(BundleSamples, Link.SentHistoryCount + 1);
+    for (int32 i = 1; i < Count; i++) {
+      Bundle[i] = Link.SentHistory[i - 1];
+    }
+    Size = ControlWire::EncodeControlBundle(Link.Sequence, TimestampUs, Bundle,
+                                            Count, Packet, sizeof(Packet));
+  } else {
+    Size = ControlWire::Encode(Link.Sequence, TimestampUs, Payload, Packet,
+                               sizeof(Packet));
+  }
+  if (!SendTo(ControlSocket, Packet, Size, Link.Peer->ControlAddr)) {
+    // Socket buffer full: keep only the newest sample pending rather than
+    // queueing stale ones behind it
+    if (!Link.bSendPending) {
+      Link.bSendPending = true;
+      Link.BackpressureDrops.fetch_add(1, std::memory_order_relaxed);
+    }
+    return;
+  }
+
+  const double SentTime = FPlatformTime::Seconds();
+  if (Link.bAcquiring) {
+    Link.bAcquiring = false;
+    Link.AcquisitionSeconds = SentTime - Link.AttachTime;
+  }
+  Link.bSendPending = false;
+  FPV_LINK_COUNTER_ADD(ControlPacketsSent, Link.MetricsLink, 1);
+  Link.Scheduler.RecordSend(SentTime);
+  Link.Quality.RecordSend(Link.Sequence, SentLocalUs);
+  Link.MotionToPhoton.RecordSend(Link.Sequence, Link.Sample.SampledLocalUs,
+                                 SentLocalUs);
+
+  for (int32 i = ControlWire::MaxBundleSamples - 1; i > 0; i--) {
+    Link.SentHistory[i] = Link.SentHistory[i - 1];
+  }
+  Link.SentHistory[0] = Payload;
+  Link.SentHistoryCount =
+      FMath::Min(Link.SentHistoryCount + 1, ControlWire::MaxBundleSamples);
+
+  if (Link.Config.DuplicateCount > 0) {
+    FMemory::Memcpy(Link.DuplicatePacket, Packet, Size);
+    Link.DuplicateSize = Size;
+    Link.DuplicatesLeft = Link.Config.DuplicateCount;
+    Link.NextDuplicate = SentTime + Link.Config.DuplicateSpacingSeconds;
+  }
+  Link.Sequence++;
+}
+#else
+uint32 FControlLinkServer::Run() { return 0; }
+void FControlLinkServer::CloseSocket(FSocketState &Socket) {}
+void FControlLinkServer::SetLinkMetrics(FControlLink &Link,
+                                        const FControlLinkPeer *Peer) {}
+#endif
@@ -0,0 +1,277 @@
+#pragma once
+
+#include "CameraDataStreamer.h"
+#include "ClockSync.h"
+#include "ControlLinkQuality.h"
+#include "ControlSendScheduler.h"
+#include "ControlWireProtocol.h"
+#include "CoreMinimal.h"
+#include "HAL/Runnable.h"
+#include "MotionToPhoton.h"
+#include "Tasks/Pipe.h"
+
+// The server talks to the OS socket API directly so one thread can wait on
+// every socket at once: epoll on Linux and Android, poll() on Mac.
+#define WITH_CONTROL_LINK_SERVER                                               \
+  (PLATFORM_LINUX || PLATFORM_ANDROID || PLATFORM_MAC)
+#define CONTROL_LINK_USE_EPOLL (PLATFORM_LINUX || PLATFORM_ANDROID)
+
+struct FControlLinkPeer;
+class IRendezvousFallback;
+
+struct FControlLinkConfig {
+  double SendRateHz = 250.0;
+  bool bSendOnChange = false;
+  double HeartbeatSeconds = 0.1;
+  // A robot that sends nothing for this long is dropped and re-acquired
+  // when it reappears
+  double PeerTimeoutSeconds = 3.0;
+
+  // Samples per datagram: the newest plus up to MaxBundleSamples - 1 sent
+  // before it, so a lost datagram's sample rides in the next one. 1 sends
+  // plain Control messages.
+  int32 RedundancySamples = 1;
+  // Extra copies of each datagram, DuplicateSpacingSeconds apart, to get
+  // past short loss bursts without waiting for the next tick
+  int32 DuplicateCount = 0;
+  double DuplicateSpacingSeconds = 0.002;
+  // Each send carries the newest sample's pitch and yaw forward along its
+  // rates to the send time, by at most this much; past it a stalled game
+  // thread's pose holds. 0 sends samples as taken.
+  double MaxExtrapolationSeconds = 0.05;
+  // A sample older than this means the game thread has stalled: sends keep
+  // the last pose but release the throttle and thumbstick until a fresh
+  // sample arrives. 0 drives on the last sample however old.
+  double MaxSampleAgeSeconds = 0.25;
+  // Robot IPv4 address to bind to; empty takes the first unclaimed robot
+  FString RobotAddress;
+};
+
+// One operator <-> robot link. The owning component produces control samples
+// and consumes telemetry through the channels; everything else is run by the
+// server's I/O thread.
+class FControlLink {
+public:
+  explicit FControlLink(const FControlLinkConfig &InConfig);
+
+  // Game thread -> I/O thread
+  FControlSampleChannel ControlChannel{ESampleChannelMode::LatestValue};
+  // I/O thread -> game thread
+  FTelemetryChannel TelemetryChannel{ESampleChannelMode::History};
+
+  // Any thread. False until the robot's clock has been sampled.
+  bool GetClockEstimate(FClockEstimate &OutEstimate) const {
+    return ClockEstimates.PeekLatest(OutEstimate) && OutEstimate.bValid;
+  }
+
+  FControlSendStats GetSendStats() const { return Scheduler.GetStats(); }
+
+  // Any thread: RTT, delay, loss and reordering from the robot's acks
+  const FControlLinkQualityTracker &GetQuality() const { return Quality; }
+
+  // The I/O thread records sends and acks; the owner records the video
+  // frames shown
+  FMotionToPhotonTracker MotionToPhoton;
+
+  // Any thread
+  ERobotLinkState GetState() const {
+    return State.load(std::memory_order_relaxed);
+  }
+  bool HasPeer() const { return GetState() != ERobotLinkState::Searching; }
+
+  // From the robot's first datagram to the first control packet sent to it,
+  // for the latest (re)connect; negative before the first
+  double GetAcquisitionSeconds() const {
+    return AcquisitionSeconds.load(std::memory_order_relaxed);
+  }
+
+  // From the link starting to search (added, or its robot lost) to a robot
+  // being found, for the latest (re)connect; negative before the first
+  double GetDiscoverySeconds() const {
+    return DiscoverySeconds.load(std::memory_order_relaxed);
+  }
+
+  int64 GetBackpressureDrops() const {
+    return BackpressureDrops.load(std::memory_order_relaxed);
+  }
+
+  // Any thread: the label slot of this link's PipelineMetrics while it is
+  // attached to a robot, INDEX_NONE otherwise
+  int32 GetMetricsLink() const {
+    return MetricsLink.load(std::memory_order_relaxed);
+  }
+
+private:
+  friend class FControlLinkServer;
+
+  const FControlLinkConfig Config;
+  // Parsed RobotAddress in host order, 0 for any
+  uint32 RobotAddress;
+
+  // I/O thread state
+  FControlLinkPeer *Peer = nullptr;
+  // Attached and the control endpoint is known; the send schedule is running
+  bool bStreaming = false;
+  double SearchStartTime = 0.0;
+  // Waiting for the first control packet since attaching at AttachTime
+  bool bAcquiring = false;
+  double AttachTime = 0.0;
+  FControlSendScheduler Scheduler;
+  FControlLinkQualityTracker Quality;
+  uint32 Sequence = 0;
+  FRobotControlData Sample;
+  // Newest first, for redundancy bundles
+  ControlWire::FControlPayload SentHistory[ControlWire::MaxBundleSamples];
+  int32 SentHistoryCount = 0;
+  uint8 DuplicatePacket[ControlWire::MaxPacketSize];
+  int32 DuplicateSize = 0;
+  int32 DuplicatesLeft = 0;
+  double NextDuplicate = 0.0;
+  bool bHaveSample = false;
+  // Sample is past MaxSampleAgeSeconds and being sent neutral
+  bool bSampleStale = false;
+  // The last tick's packet hit a full socket buffer; resend when writable
+  bool bSendPending = false;
+
+  TSpscValueChannel<FClockEstimate, 4> ClockEstimates;
+  std::atomic<ERobotLinkState> State{ERobotLinkState::Searching};
+  std::atomic<double> AcquisitionSeconds{-1.0};
+  std::atomic<double> DiscoverySeconds{-1.0};
+  std::atomic<int64> BackpressureDrops{0};
+  std::atomic<int32> MetricsLink{INDEX_NONE};
+};
+
+// Shared networking core for every control link in the process.
+//
+// A single I/O thread owns one UDP socket for clock sync and one for control
+// and telemetry, and demultiplexes datagrams into a per-robot peer table
+// keyed by IPv4 address. Robots announce each socket with a Hello echoing
+// the beacon's SessionId; nothing else adds a peer or moves its endpoints.
+// Each link claims a peer and from then on the thread runs that peer's
+// clock sync and the link's send schedule from one readiness wait.
+//
+// Robots are found by beacons on the discovery port: broadcast and multicast
+// on the LAN, plus unicast to every configured RobotAddress and to robots
+// remembered from earlier sessions in Saved/ControlLinkPeers.txt. Beacons go
+// out every quarter second while any link is searching. If nothing has been
+// found after a few seconds the optional rendezvous fallback is run once.
+//
+// Discovery, clock sync and control run independently: control streams as
+// soon as the robot's control endpoint is known, with zero timestamps until
+// the first clock estimate. A peer that goes silent is dropped and its link
+// searches again, so a rebooted robot is picked up without a restart.
+//
+// Components share the server through Acquire(); it stops when the last
+// reference goes away.
+class FControlLinkServer : public FRunnable {
+public:
+  static constexpr int32 DefaultClockSyncPort = 6778;
+  static constexpr int32 DefaultControlPort = 6779;
+  static constexpr int32 DefaultDiscoveryPort = 6780;
+
+  static TSharedPtr<FControlLinkServer, ESPMode::ThreadSafe> Acquire();
+  // Servers started afterwards neither read nor write the peer cache, so
+  // stand-in robots in benchmarks stay out of it
+  static void DisablePeerCache();
+  virtual ~FControlLinkServer();
+
+  void AddLink(const TSharedPtr<FControlLink, ESPMode::ThreadSafe> &Link);
+  void RemoveLink(const TSharedPtr<FControlLink, ESPMode::ThreadSafe> &Link);
+
+  // Replaces the fallback run when LAN discovery finds nothing; null for
+  // none, which is the default
+  void SetRendezvousFallback(
+      const TSharedPtr<IRendezvousFallback, ESPMode::ThreadSafe> &InFallback);
+
+  // FRunnable interface
+  virtual uint32 Run() override;
+  virtual void Stop() override;
+
+private:
+  struct FSocketState {
+    int Fd = -1;
+    int32 Port = 0;
+    // A send hit a full buffer; waiting for the socket to become writable
+    bool bWantWrite = false;
+  };
+
+  FControlLinkServer(int32 InClockSyncPort, int32 InControlPort,
+                     int32 InDiscoveryPort);
+  bool Start();
+
+  // The epoll set and both sockets; false if a port is taken
+  bool OpenSockets();
+  bool OpenSocket(FSocketState &Socket);
+  void CloseSocket(FSocketState &Socket);
+  // False if the datagram was not sent because the socket buffer is full
+  bool SendTo(FSocketState &Socket, const uint8 *Data, int32 Size,
+              const struct sockaddr_in &Address);
+
+  void ApplyLinkChanges();
+  // Returns the time on waking: at the deadline, give or take the spin, or
+  // earlier if a socket became ready
+  double WaitForEvents(double Timeout, bool &bOutSyncReadable,
+                       bool &bOutControlReadable, bool &bOutWritable);
+  void DrainSocket(FSocketState &Socket, double Now);
+  void HandleDatagram(FSocketState &Socket, const uint8 *Data, int32 Size,
+                      const struct sockaddr_in &From, double Now,
+                      int64 ReceivedLocalUs);
+  FControlLinkPeer *FindPeer(uint32 Address);
+  void HandleHello(FSocketState &Socket, const uint8 *Data, int32 Size,
+                   const struct sockaddr_in &From, double Now);
+  void AttachLinks(double Now);
+  // Labels the link's metrics with Peer's address, or with null stops
+  // exporting them
+  void SetLinkMetrics(FControlLink &Link, const FControlLinkPeer *Peer);
+  void ExpirePeers(double Now);
+  // Pushes the peer's clock estimate to its link and updates the link state
+  void PublishClock(FControlLinkPeer &Peer);
+
+  void SendBeacons(double Now);
+  void LoadPeerCache();
+  // Moves Address to the front of the cache and saves it in the background
+  void RememberPeer(uint32 Address);
+  void RunRendezvousFallback();
+
+  void SendClockSyncRequest(FControlLinkPeer &Peer);
+  void HandleClockSyncReply(FControlLinkPeer &Peer, const uint8 *Data,
+                            int32 Size, int64 ReceivedLocalUs);
+  void HandleTelemetry(FControlLinkPeer &Peer, const uint8 *Data, int32 Size,
+                       int64 ReceivedLocalUs);
+  void HandleControlAck(FControlLinkPeer &Peer, const uint8 *Data, int32 Size,
+                        int64 ReceivedLocalUs);
+  void ServiceLink(FControlLink &Link, double Now);
+  void SendControl(FControlLink &Link);
+
+  FThreadSafeBool bStopThread;
+  FRunnableThread *Thread;
+
+  FSocketState SyncSocket;
+  FSocketState ControlSocket;
+  int32 DiscoveryPort;
+#if CONTROL_LINK_USE_EPOLL
+  int EpollFd;
+  // Wakes the readiness wait at its deadline with nanosecond resolution
+  int TimerFd;
+#endif
+
+  // Game thread hands links over under this lock
+  FCriticalSection LinkLock;
+  TArray<TSharedPtr<FControlLink, ESPMode::ThreadSafe>> PendingAdds;
+  TArray<TSharedPtr<FControlLink, ESPMode::ThreadSafe>> PendingRemoves;
+  TSharedPtr<IRendezvousFallback, ESPMode::ThreadSafe> Fallback;
+
+  // I/O thread only
+  TArray<TSharedPtr<FControlLink, ESPMode::ThreadSafe>> Links;
+  TArray<TUniquePtr<FControlLinkPeer>> Peers;
+  uint32 SessionId;
+  uint32 BeaconSequence;
+  double NextBeacon;
+  double StartTime;
+  bool bFallbackRun;
+  // Most recently seen robot addresses first. Empty path when disabled.
+  FString PeerCachePath;
+  TArray<uint32> CachedPeers;
+  // Cache writes, in order, off the I/O thread
+  UE::Tasks::FPipe PeerCachePipe{TEXT("ControlLinkPeerCache")};
+};
@@ -0,0 +1,42 @@
+#include "ControlPoseAccumulator.h"
+
+void FControlPoseAccumulator::Reset(float Pitch, float Yaw, int64 NowUs) {
+  bStarted = true;
+  PreviousUs = NowUs;
+  PreviousPitch = Pitch;
+  PreviousYaw = Yaw;
+  AccumulatedPitch = 0.0f;
+  AccumulatedYaw = 0.0f;
+  PitchRate = 0.0f;
+  YawRate = 0.0f;
+}
+
+void FControlPoseAccumulator::Update(float Pitch, float Yaw, int64 NowUs,
+                                     bool bAccumulate) {
+  if (!bStarted) {
+    Reset(Pitch, Yaw, NowUs);
+    return;
+  }
+  const double Seconds = (NowUs - PreviousUs) / 1e6;
+  if (Seconds <= 0.0) {
+    return;
+  }
+
+  const float DeltaPitch = Pitch - PreviousPitch;
+  float DeltaYaw = Yaw - PreviousYaw;
+  const float PredictedYaw = (float)(YawRate * Seconds);
+  DeltaYaw -= 360.0f * FMath::RoundToFloat((DeltaYaw - PredictedYaw) / 360.0f);
+
+  const float Alpha = (float)(Seconds / (Seconds + RateSmoothingSeconds));
+  PitchRate += Alpha * ((float)(DeltaPitch / Seconds) - PitchRate);
+  YawRate += Alpha * ((float)(DeltaYaw / Seconds) - YawRate);
+
+  bAccumulating = bAccumulate;
+  if (bAccumulate) {
+    AccumulatedPitch += DeltaPitch;
+    AccumulatedYaw += DeltaYaw;
+  }
+  PreviousUs = NowUs;
+  PreviousPitch = Pitch;
+  PreviousYaw = Yaw;
+}
@@ -0,0 +1,45 @@
+#pragma once
+
+#include "CoreMinimal.h"
+
+// Turns the absolute camera pitch and yaw read on each game tick into the
+// continuous angles driven on the gimbal, plus their rates for extrapolating
+// to send time.
+//
+// Yaw wraps at +-180. Between two ordinary ticks the short way round is the
+// right one, but after a game thread hitch the head may have turned further
+// than that; the unwrap takes the turn closest to what the previous rate
+// predicts, so a hitch does not fold a fast turn back on itself.
+class MYBLANKVRPROJECT_API FControlPoseAccumulator {
+public:
+  // Starts accumulating from zero at the given camera orientation
+  void Reset(float Pitch, float Yaw, int64 NowUs);
+
+  // bAccumulate false holds the output still while the camera moves, so the
+  // operator can re-centre the gimbal
+  void Update(float Pitch, float Yaw, int64 NowUs, bool bAccumulate);
+
+  float GetPitch() const { return AccumulatedPitch; }
+  float GetYaw() const { return AccumulatedYaw; }
+
+  // Degrees per second of the output; zero while not accumulating
+  float GetPitchRate() const { return bAccumulating ? PitchRate : 0.0f; }
+  float GetYawRate() const { return bAccumulating ? YawRate : 0.0f; }
+
+private:
+  // Time constant of the rate smoothing; short against head motion but long
+  // enough to ride out single-tick pose noise
+  static constexpr double RateSmoothingSeconds = 0.01;
+
+  bool bStarted = false;
+  bool bAccumulating = true;
+  int64 PreviousUs = 0;
+  float PreviousPitch = 0.0f;
+  float PreviousYaw = 0.0f;
+
+  float AccumulatedPitch = 0.0f;
+  float AccumulatedYaw = 0.0f;
+  // Of the camera, whether or not it is being accumulated
+  float PitchRate = 0.0f;
+  float YawRate = 0.0f;
+};
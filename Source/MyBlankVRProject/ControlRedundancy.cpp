@@ -0,0 +1,54 @@
+#include "ControlRedundancy.h"
+
+bool FControlRedundancyDecoder::MarkSeen(uint32 Sequence) {
+  const uint32 Behind = Highest - Sequence;
+  if (bAny && Behind > RestartDistance && Behind <= 0x80000000u) {
+    Stats.Restarts++;
+    bAny = false;
+  }
+  if (!bAny) {
+    bAny = true;
+    Highest = Sequence;
+    Seen = 1;
+    return true;
+  }
+
+  const int32 Ahead = (int32)(Sequence - Highest);
+  if (Ahead > 0) {
+    Seen = Ahead >= 64 ? 1 : (Seen << Ahead) | 1;
+    Highest = Sequence;
+    return true;
+  }
+  if (Behind >= 64) {
+    Stats.TooOld++;
+    return false;
+  }
+  const uint64 Bit = 1ull << Behind;
+  if (Seen & Bit) {
+    Stats.Duplicates++;
+    return false;
+  }
+  Seen |= Bit;
+  return true;
+}
+
+void FControlRedundancyDecoder::Receive(
+    uint32 NewestSequence, const ControlWire::FControlPayload *Samples,
+    int32 Count,
+    TFunctionRef<void(uint32 Sequence,
+                      const ControlWire::FControlPayload &Sample)>
+        OnSample) {
+  Stats.Datagrams++;
+  for (int32 i = Count - 1; i >= 0; i--) {
+    const uint32 Sequence = NewestSequence - (uint32)i;
+    if (!MarkSeen(Sequence)) {
+      continue;
+    }
+    Stats.Delivered++;
+    if (i > 0) {
+      // The datagram that carried it first was lost, or is late
+      Stats.Recovered++;
+    }
+    OnSample(Sequence, Samples[i]);
+  }
+}
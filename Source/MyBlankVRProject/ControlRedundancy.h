@@ -0,0 +1,56 @@
+#pragma once
+
+#include "ControlWireProtocol.h"
+#include "CoreMinimal.h"
+
+// Receiver side of control redundancy, for the robot and its stand-ins.
+//
+// Bundles and duplicated datagrams deliver most samples several times. The
+// decoder remembers which of the last 64 sequences it has seen, hands each
+// sample on exactly once, oldest first, and builds the ack mask for
+// FControlAckPayload. A sequence more than RestartDistance behind the
+// highest starts the window over, as the telemetry receiver does, so a
+// restarted operator is not dropped as too old.
+class MYBLANKVRPROJECT_API FControlRedundancyDecoder {
+public:
+  static constexpr uint32 RestartDistance = 1024;
+
+  struct FStats {
+    int64 Datagrams = 0;
+    // Samples handed on
+    int64 Delivered = 0;
+    // Of those, delivered by a redundant copy after the original was lost
+    int64 Recovered = 0;
+    int64 Duplicates = 0;
+    // Older than the seen window; dropped
+    int64 TooOld = 0;
+    // Jumps back far enough to be a new sender, e.g. the operator
+    // restarting its sequence
+    int64 Restarts = 0;
+  };
+
+  // Visits the samples of one datagram not seen before, oldest first.
+  // Samples[i] has sequence NewestSequence - i.
+  void Receive(uint32 NewestSequence,
+               const ControlWire::FControlPayload *Samples, int32 Count,
+               TFunctionRef<void(uint32 Sequence,
+                                 const ControlWire::FControlPayload &Sample)>
+                   OnSample);
+
+  // Highest sequence seen, and bit i set if Highest - 1 - i was seen
+  bool HasReceived() const { return bAny; }
+  uint32 GetHighest() const { return Highest; }
+  uint32 GetReceivedMask() const { return (uint32)(Seen >> 1); }
+
+  const FStats &GetStats() const { return Stats; }
+
+private:
+  // Marks Sequence seen; false if it already was or is too old to tell
+  bool MarkSeen(uint32 Sequence);
+
+  bool bAny = false;
+  uint32 Highest = 0;
+  // Bit i: Highest - i has been seen
+  uint64 Seen = 0;
+  FStats Stats;
+};
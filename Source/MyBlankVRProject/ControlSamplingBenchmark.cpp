@@ -0,0 +1,215 @@
+#include "BenchmarkScenarios.h"
+#include "CameraDataStreamer.h"
+#include "ControlPoseAccumulator.h"
+
+namespace {
+enum class ESamplingMode : uint8 {
+  // Sampled on the game tick once 20 ms have passed, the interval restarting
+  // from whichever tick crossed it; yaw unwrapped the short way round
+  TickGated,
+  // Every tick, sent as taken
+  EveryTick,
+  // Every tick, carried forward to the send time
+  Extrapolated,
+};
+
+struct FSamplingModeInfo {
+  const TCHAR *Name;
+  ESamplingMode Mode;
+};
+
+const FSamplingModeInfo Modes[] = {
+    {TEXT("tick_gated"), ESamplingMode::TickGated},
+    {TEXT("every_tick"), ESamplingMode::EveryTick},
+    {TEXT("extrapolated"), ESamplingMode::Extrapolated},
+};
+
+// Head motion: a slow look around, with a fast continuous turn in the middle
+// that a long hitch lands in
+constexpr double SpinStartSeconds = 5.0;
+constexpr double SpinSeconds = 2.0;
+constexpr double SpinDegreesPerSecond = 360.0;
+constexpr double StallStartSeconds = 5.5;
+
+double TrueYaw(double T) {
+  double Yaw = 60.0 * FMath::Sin(2.0 * UE_DOUBLE_PI * 0.5 * T);
+  if (T > SpinStartSeconds) {
+    Yaw += SpinDegreesPerSecond * FMath::Min(T - SpinStartSeconds, SpinSeconds);
+  }
+  return Yaw;
+}
+
+double TruePitch(double T) {
+  return 20.0 * FMath::Sin(2.0 * UE_DOUBLE_PI * 0.3 * T);
+}
+
+// What the camera manager reports: yaw in [-180, 180)
+float CameraYaw(double T) {
+  return (float)FMath::Fmod(FMath::Fmod(TrueYaw(T) + 180.0, 360.0) + 360.0,
+                            360.0) -
+         180.0f;
+}
+
+struct FSamplingResult {
+  FBenchmarkSamples YawErrorDeg;
+  FBenchmarkSamples PitchErrorDeg;
+  // Largest change between consecutive sends: the jump after a freeze
+  double MaxStepDeg = 0.0;
+  // Whole turns the sent yaw ended up off by, from unwrapping the wrong way
+  int32 TurnsLost = 0;
+};
+
+FSamplingResult RunMode(ESamplingMode Mode, double Seconds, double TickHz,
+                        double RateHz, double HitchEverySeconds,
+                        double HitchSeconds, double StallSeconds,
+                        double MaxExtrapolation) {
+  FSamplingResult Result;
+  const double TickPeriod = 1.0 / TickHz;
+  const double SendPeriod = 1.0 / RateHz;
+  auto ToUs = [](double T) { return (int64)(T * 1e6) + 1; };
+
+  FControlPoseAccumulator Accumulator;
+  Accumulator.Reset((float)TruePitch(0.0), CameraYaw(0.0), ToUs(0.0));
+  // The pre-existing game-thread sampler, for comparison
+  float GatedPreviousYaw = CameraYaw(0.0);
+  float GatedPreviousPitch = (float)TruePitch(0.0);
+  float GatedYaw = 0.0f;
+  float GatedPitch = 0.0f;
+  double TimeSinceLastSend = 0.0;
+
+  FRobotControlData Sample;
+  bool bHaveSample = false;
+  double LastTick = 0.0;
+  double NextTick = TickPeriod;
+  double PreviousSentYaw = 0.0;
+  double PreviousSentPitch = 0.0;
+  double SentYaw = 0.0;
+
+  for (int64 Send = 1; Send * SendPeriod <= Seconds; Send++) {
+    const double SendTime = Send * SendPeriod;
+
+    while (NextTick <= SendTime) {
+      const double Tick = NextTick;
+      const int64 TickUs = ToUs(Tick);
+      if (Mode == ESamplingMode::TickGated) {
+        TimeSinceLastSend += Tick - LastTick;
+        if (TimeSinceLastSend >= 0.02) {
+          TimeSinceLastSend = 0.0;
+          float DeltaYaw = CameraYaw(Tick) - GatedPreviousYaw;
+          if (DeltaYaw > 180.0f) {
+            DeltaYaw -= 360.0f;
+          } else if (DeltaYaw < -180.0f) {
+            DeltaYaw += 360.0f;
+          }
+          GatedYaw += DeltaYaw;
+          GatedPitch += (float)TruePitch(Tick) - GatedPreviousPitch;
+          GatedPreviousYaw = CameraYaw(Tick);
+          GatedPreviousPitch = (float)TruePitch(Tick);
+          Sample = FRobotControlData(GatedPitch, GatedYaw);
+          bHaveSample = true;
+        }
+      } else {
+        Accumulator.Update((float)TruePitch(Tick), CameraYaw(Tick), TickUs,
+                           true);
+        Sample = FRobotControlData(Accumulator.GetPitch(), Accumulator.GetYaw());
+        Sample.PitchRate = Accumulator.GetPitchRate();
+        Sample.YawRate = Accumulator.GetYawRate();
+        Sample.SampledLocalUs = TickUs;
+        bHaveSample = true;
+      }
+
+      LastTick = Tick;
+      NextTick = Tick + TickPeriod;
+      // The game thread stalls; the next tick comes once it recovers
+      const double HitchStart =
+          FMath::CeilToDouble(Tick / HitchEverySeconds) * HitchEverySeconds;
+      if (NextTick > HitchStart && HitchStart > Tick) {
+        NextTick = HitchStart + HitchSeconds;
+      }
+      if (StallSeconds > 0.0 && NextTick > StallStartSeconds &&
+          Tick < StallStartSeconds) {
+        NextTick = StallStartSeconds + StallSeconds;
+      }
+    }
+    if (!bHaveSample) {
+      continue;
+    }
+
+    const FRobotControlData Sent =
+        Mode == ESamplingMode::Extrapolated
+            ? Sample.ExtrapolatedTo(ToUs(SendTime), MaxExtrapolation)
+            : Sample;
+    SentYaw = Sent.Yaw;
+    Result.YawErrorDeg.Add(
+        FMath::Abs(Sent.Yaw - (TrueYaw(SendTime) - TrueYaw(0.0))));
+    Result.PitchErrorDeg.Add(
+        FMath::Abs(Sent.Pitch - (TruePitch(SendTime) - TruePitch(0.0))));
+    if (Result.YawErrorDeg.Num() > 1) {
+      Result.MaxStepDeg = FMath::Max(
+          Result.MaxStepDeg,
+          FMath::Max(FMath::Abs(Sent.Yaw - PreviousSentYaw),
+                     FMath::Abs(Sent.Pitch - PreviousSentPitch)));
+    }
+    PreviousSentYaw = Sent.Yaw;
+    PreviousSentPitch = Sent.Pitch;
+  }
+  Result.TurnsLost = FMath::RoundToInt(
+      (SentYaw - (TrueYaw(Seconds) - TrueYaw(0.0))) / 360.0);
+  return Result;
+}
+} // namespace
+
+bool BenchmarkScenarios::RunControlSampling(const FString &Params,
+                                            TSharedRef<FJsonObject> Report) {
+  double Seconds = 20.0;
+  double TickHz = 90.0;
+  double RateHz = 250.0;
+  double HitchEverySeconds = 2.0;
+  double HitchMs = 100.0;
+  double StallMs = 700.0;
+  double MaxExtrapolationMs = 50.0;
+  FParse::Value(*Params, TEXT("Seconds="), Seconds);
+  FParse::Value(*Params, TEXT("TickHz="), TickHz);
+  FParse::Value(*Params, TEXT("RateHz="), RateHz);
+  FParse::Value(*Params, TEXT("HitchEvery="), HitchEverySeconds);
+  FParse::Value(*Params, TEXT("HitchMs="), HitchMs);
+  FParse::Value(*Params, TEXT("StallMs="), StallMs);
+  FParse::Value(*Params, TEXT("MaxExtrapolationMs="), MaxExtrapolationMs);
+
+  TArray<TSharedPtr<FJsonValue>> Results;
+  bool bUnwrapped = true;
+  for (const FSamplingModeInfo &Mode : Modes) {
+    const FSamplingResult Result =
+        RunMode(Mode.Mode, Seconds, TickHz, RateHz, HitchEverySeconds,
+                HitchMs / 1000.0, StallMs / 1000.0,
+                MaxExtrapolationMs / 1000.0);
+    if (Mode.Mode != ESamplingMode::TickGated && Result.TurnsLost != 0) {
+      bUnwrapped = false;
+    }
+
+    UE_LOG(LogTemp, Display,
+           TEXT("ControlSampling %s: yaw error p50 %.2f p99 %.2f max %.2f "
+                "deg, largest step %.2f deg, %d turns lost"),
+           Mode.Name, Result.YawErrorDeg.Percentile(50.0),
+           Result.YawErrorDeg.Percentile(99.0),
+           Result.YawErrorDeg.Percentile(100.0), Result.MaxStepDeg,
+           Result.TurnsLost);
+
+    TSharedRef<FJsonObject> Json = MakeShared<FJsonObject>();
+    Json->SetStringField(TEXT("mode"), Mode.Name);
+    Json->SetObjectField(TEXT("yaw_error_deg"), Result.YawErrorDeg.ToJson());
+    Json->SetObjectField(TEXT("pitch_error_deg"),
+                         Result.PitchErrorDeg.ToJson());
+    Json->SetNumberField(TEXT("max_step_deg"), Result.MaxStepDeg);
+    Json->SetNumberField(TEXT("turns_lost"), Result.TurnsLost);
+    Results.Add(MakeShared<FJsonValueObject>(Json));
+  }
+
+  Report->SetNumberField(TEXT("seconds"), Seconds);
+  Report->SetNumberField(TEXT("tick_hz"), TickHz);
+  Report->SetNumberField(TEXT("rate_hz"), RateHz);
+  Report->SetNumberField(TEXT("hitch_ms"), HitchMs);
+  Report->SetNumberField(TEXT("stall_ms"), StallMs);
+  Report->SetArrayField(TEXT("results"), Results);
+  return bUnwrapped;
+}
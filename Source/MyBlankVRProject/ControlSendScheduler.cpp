@@ -0,0 +1,68 @@
+#include "ControlSendScheduler.h"
+#include "Misc/ScopeLock.h"
+
+FControlSendScheduler::FControlSendScheduler(double InRateHz,
+                                             bool bInSendOnChange,
+                                             double InHeartbeatSeconds)
+    : Period(1.0 / FMath::Clamp(InRateHz, 1.0, 1000.0)),
+      bSendOnChange(bInSendOnChange),
+      HeartbeatSeconds(FMath::Max(InHeartbeatSeconds, 0.0)), NextDeadline(0.0),
+      LastSendTime(0.0), PacketsSent(0), MissedDeadlines(0), IntervalCount(0),
+      IntervalMean(0.0), IntervalM2(0.0), WakeCount(0), LatenessSum(0.0),
+      MaxLateness(0.0) {}
+
+void FControlSendScheduler::Start(double Now) {
+  NextDeadline = Now;
+  LastSendTime = 0.0;
+}
+
+bool FControlSendScheduler::PollTick(double Now) {
+  if (Now < NextDeadline) {
+    return false;
+  }
+
+  const double Lateness = Now - NextDeadline;
+  const int64 Missed = (int64)(Lateness / Period);
+  NextDeadline += (Missed + 1) * Period;
+
+  FScopeLock Lock(&StatsLock);
+  MissedDeadlines += Missed;
+  WakeCount++;
+  LatenessSum += Lateness;
+  MaxLateness = FMath::Max(MaxLateness, Lateness);
+  return true;
+}
+
+bool FControlSendScheduler::ShouldSend(double Now, bool bSampleChanged) const {
+  if (!bSendOnChange || bSampleChanged || LastSendTime == 0.0) {
+    return true;
+  }
+  return Now - LastSendTime >= HeartbeatSeconds;
+}
+
+void FControlSendScheduler::RecordSend(double Now) {
+  FScopeLock Lock(&StatsLock);
+  if (LastSendTime > 0.0) {
+    const double Interval = Now - LastSendTime;
+    IntervalCount++;
+    const double Delta = Interval - IntervalMean;
+    IntervalMean += Delta / IntervalCount;
+    IntervalM2 += Delta * (Interval - IntervalMean);
+  }
+  LastSendTime = Now;
+  PacketsSent++;
+}
+
+FControlSendStats FControlSendScheduler::GetStats() const {
+  FScopeLock Lock(&StatsLock);
+  FControlSendStats Stats;
+  Stats.PacketsSent = PacketsSent;
+  Stats.MissedDeadlines = MissedDeadlines;
+  Stats.MeanIntervalMs = IntervalMean * 1000.0;
+  Stats.IntervalJitterMs =
+      IntervalCount > 1 ? FMath::Sqrt(IntervalM2 / (IntervalCount - 1)) * 1000.0
+                        : 0.0;
+  Stats.MeanLatenessMs = WakeCount > 0 ? LatenessSum / WakeCount * 1000.0 : 0.0;
+  Stats.MaxLatenessMs = MaxLateness * 1000.0;
+  return Stats;
+}
@@ -0,0 +1,75 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "ControlSendScheduler.generated.h"
+
+USTRUCT(BlueprintType)
+struct FControlSendStats {
+  GENERATED_BODY()
+
+  UPROPERTY(BlueprintReadOnly, Category = "Control")
+  int64 PacketsSent = 0;
+
+  // Deadlines that passed entirely before the sender woke up
+  UPROPERTY(BlueprintReadOnly, Category = "Control")
+  int64 MissedDeadlines = 0;
+
+  UPROPERTY(BlueprintReadOnly, Category = "Control")
+  float MeanIntervalMs = 0.0f;
+
+  // Standard deviation of the interval between sends
+  UPROPERTY(BlueprintReadOnly, Category = "Control")
+  float IntervalJitterMs = 0.0f;
+
+  // How late the sender woke relative to its deadline
+  UPROPERTY(BlueprintReadOnly, Category = "Control")
+  float MeanLatenessMs = 0.0f;
+
+  UPROPERTY(BlueprintReadOnly, Category = "Control")
+  float MaxLatenessMs = 0.0f;
+};
+
+// Fixed-rate send clock on absolute deadlines. Deadlines advance by exactly
+// one period regardless of how long the send took, so the rate does not
+// drift; if the thread oversleeps past whole periods those ticks are
+// counted as missed and skipped rather than sent in a burst.
+class FControlSendScheduler {
+public:
+  FControlSendScheduler(double InRateHz, bool bInSendOnChange,
+                        double InHeartbeatSeconds);
+
+  void Start(double Now);
+
+  // True once Now has reached the next deadline, which is then advanced. The
+  // caller's event loop sleeps until GetNextDeadline().
+  bool PollTick(double Now);
+  double GetNextDeadline() const { return NextDeadline; }
+
+  // Whether the current tick should put a packet on the wire
+  bool ShouldSend(double Now, bool bSampleChanged) const;
+  void RecordSend(double Now);
+
+  double GetPeriod() const { return Period; }
+
+  // Thread safe
+  FControlSendStats GetStats() const;
+
+private:
+  double Period;
+  bool bSendOnChange;
+  double HeartbeatSeconds;
+
+  double NextDeadline;
+  double LastSendTime;
+
+  mutable FCriticalSection StatsLock;
+  int64 PacketsSent;
+  int64 MissedDeadlines;
+  // Welford accumulators
+  int64 IntervalCount;
+  double IntervalMean;
+  double IntervalM2;
+  int64 WakeCount;
+  double LatenessSum;
+  double MaxLateness;
+};
@@ -0,0 +1,127 @@
+#include "ControlWireProtocol.h"
+
+namespace {
+// Reflected Castagnoli polynomial
+constexpr uint32 Crc32cPolynomial = 0x82F63B78u;
+
+struct FCrc32cTable {
+  uint32 Entries[256];
+
+  constexpr FCrc32cTable() : Entries() {
+    for (uint32 i = 0; i < 256; i++) {
+      uint32 Crc = i;
+      for (int32 Bit = 0; Bit < 8; Bit++) {
+        Crc = (Crc >> 1) ^ ((Crc & 1) ? Crc32cPolynomial : 0);
+      }
+      Entries[i] = Crc;
+    }
+  }
+};
+
+constexpr FCrc32cTable Crc32cTable;
+
+using FControlSchema =
+    ControlWire::TMessage<ControlWire::FControlPayload>::FSchema;
+
+int32 BundleSize(int32 Count) {
+  return ControlWire::HeaderSize + 1 + Count * FControlSchema::Size;
+}
+
+// Requires at least HeaderSize bytes
+int32 ExpectedPacketSize(const uint8 *Data, int32 Size) {
+  switch ((ControlWire::EMessageType)Data[1]) {
+  case ControlWire::EMessageType::Control:
+    return ControlWire::PacketSize<ControlWire::FControlPayload>;
+  case ControlWire::EMessageType::Telemetry:
+    return ControlWire::PacketSize<ControlWire::FTelemetryPayload>;
+  case ControlWire::EMessageType::ClockSync:
+    return ControlWire::PacketSize<ControlWire::FClockSyncPayload>;
+  case ControlWire::EMessageType::Discovery:
+    return ControlWire::PacketSize<ControlWire::FDiscoveryPayload>;
+  case ControlWire::EMessageType::ControlAck:
+    return ControlWire::PacketSize<ControlWire::FControlAckPayload>;
+  case ControlWire::EMessageType::Hello:
+    return ControlWire::PacketSize<ControlWire::FHelloPayload>;
+  case ControlWire::EMessageType::ControlBundle: {
+    const int32 Count = Size > ControlWire::HeaderSize
+                            ? Data[ControlWire::HeaderSize]
+                            : 0;
+    return Count >= 1 && Count <= ControlWire::MaxBundleSamples
+               ? BundleSize(Count)
+               : -1;
+  }
+  }
+  return -1;
+}
+} // namespace
+
+uint32 ControlWire::Crc32c(const uint8 *Data, int32 Size, uint32 Crc) {
+  // Packets are a few dozen bytes, so a byte-wise table beats the setup cost
+  // of wider variants.
+  Crc = ~Crc;
+  for (int32 i = 0; i < Size; i++) {
+    Crc = Crc32cTable.Entries[(Crc ^ Data[i]) & 0xff] ^ (Crc >> 8);
+  }
+  return ~Crc;
+}
+
+bool ControlWire::DecodeHeader(const uint8 *Data, int32 Size,
+                               FHeader &OutHeader) {
+  if (Size < HeaderSize || Data[0] != Version ||
+      Size != ExpectedPacketSize(Data, Size)) {
+    return false;
+  }
+
+  uint32 Crc = Crc32c(Data, CrcOffset);
+  Crc = Crc32c(Data + HeaderSize, Size - HeaderSize, Crc);
+  if (Crc != TWireScalar<uint32>::Read(Data + CrcOffset)) {
+    return false;
+  }
+
+  OutHeader.MessageType = (EMessageType)Data[1];
+  OutHeader.Sequence = TWireScalar<uint32>::Read(Data + 2);
+  OutHeader.TimestampUs = TWireScalar<uint64>::Read(Data + 6);
+  return true;
+}
+
+int32 ControlWire::EncodeControlBundle(uint32 NewestSequence,
+                                       uint64 TimestampUs,
+                                       const FControlPayload *Samples,
+                                       int32 Count, uint8 *Out,
+                                       int32 Capacity) {
+  if (Count < 1 || Count > MaxBundleSamples || Capacity < BundleSize(Count)) {
+    return 0;
+  }
+  const int32 Size = BundleSize(Count);
+  Out[0] = Version;
+  Out[1] = (uint8)EMessageType::ControlBundle;
+  TWireScalar<uint32>::Write(Out + 2, NewestSequence);
+  TWireScalar<uint64>::Write(Out + 6, TimestampUs);
+  Out[HeaderSize] = (uint8)Count;
+  for (int32 i = 0; i < Count; i++) {
+    FControlSchema::Write(Samples[i],
+                          Out + HeaderSize + 1 + i * FControlSchema::Size);
+  }
+
+  uint32 Crc = Crc32c(Out, CrcOffset);
+  Crc = Crc32c(Out + HeaderSize, Size - HeaderSize, Crc);
+  TWireScalar<uint32>::Write(Out + CrcOffset, Crc);
+  return Size;
+}
+
+int32 ControlWire::DecodeControlBundle(
+    const uint8 *Data, int32 Size,
+    FControlPayload (&OutSamples)[MaxBundleSamples]) {
+  if (Size <= HeaderSize || Data[1] != (uint8)EMessageType::ControlBundle) {
+    return 0;
+  }
+  const int32 Count = Data[HeaderSize];
+  if (Count < 1 || Count > MaxBundleSamples || Size != BundleSize(Count)) {
+    return 0;
+  }
+  for (int32 i = 0; i < Count; i++) {
+    FControlSchema::Read(Data + HeaderSize + 1 + i * FControlSchema::Size,
+                         OutSamples[i]);
+  }
+  return Count;
+}
@@ -0,0 +1,306 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include <type_traits>
+
+// Wire format shared with the robot for control, telemetry and clock sync.
+//
+// Every datagram is a fixed header followed by one payload:
+//
+//   0  uint8   Version      ControlWire::Version
+//   1  uint8   MessageType  EMessageType
+//   2  uint32  Sequence     per-sender, per-type counter
+//   6  uint64  TimestampUs  send time in microseconds on the robot's clock,
+//                           0 if the sender's clock is not yet synced
+//  14  uint32  Crc32c       CRC-32C of bytes [0, 14) followed by the payload
+//  18  ...     Payload      layout given by the message's TWireSchema
+//
+// ControlBundle is the one variable-length message: a uint8 count followed
+// by that many control payloads, see EncodeControlBundle.
+//
+// All fields are big-endian. Payload layouts are lists of member pointers, so
+// sizes and offsets are compile-time constants and encoding writes straight
+// into a caller-provided stack buffer.
+namespace ControlWire {
+constexpr uint8 Version = 2;
+constexpr int32 HeaderSize = 18;
+constexpr int32 CrcOffset = 14;
+
+enum class EMessageType : uint8 {
+  Control = 1,
+  Telemetry = 2,
+  ClockSync = 3,
+  Discovery = 4,
+  ControlAck = 5,
+  ControlBundle = 6,
+  Hello = 7,
+};
+
+// Capability bits advertised in discovery beacons
+constexpr uint32 CapabilityClockSync = 1 << 0;
+constexpr uint32 CapabilityControl = 1 << 1;
+constexpr uint32 CapabilityTelemetry = 1 << 2;
+// Control may arrive with a zero timestamp before the clock is synced
+constexpr uint32 CapabilityUnsyncedControl = 1 << 3;
+// The operator measures the control link from ControlAck messages
+constexpr uint32 CapabilityControlAck = 1 << 4;
+// The operator may send ControlBundle instead of Control
+constexpr uint32 CapabilityControlBundle = 1 << 5;
+
+// Most control samples one ControlBundle carries
+constexpr int32 MaxBundleSamples = 6;
+
+// CRC-32C (Castagnoli), the polynomial with hardware support on x86 and ARM.
+// Pass the previous result as Crc to continue over several buffers.
+MYBLANKVRPROJECT_API uint32 Crc32c(const uint8 *Data, int32 Size,
+                                   uint32 Crc = 0);
+
+// Big-endian scalar codec. Shifts rather than byte swaps, so the same code is
+// correct on any host and compiles to a plain store plus bswap where needed.
+template <typename T> struct TWireScalar {
+  static_assert(std::is_arithmetic<T>::value, "Wire fields must be scalars");
+  static constexpr int32 Size = sizeof(T);
+  using FBits = typename std::conditional<
+      Size == 1, uint8,
+      typename std::conditional<
+          Size == 2, uint16,
+          typename std::conditional<Size == 4, uint32, uint64>::type>::type>::
+      type;
+
+  static void Write(uint8 *Out, T Value) {
+    FBits Bits;
+    FMemory::Memcpy(&Bits, &Value, Size);
+    for (int32 i = Size - 1; i >= 0; i--) {
+      Out[i] = (uint8)(Bits & 0xff);
+      Bits = (FBits)(Bits >> 8);
+    }
+  }
+
+  static T Read(const uint8 *In) {
+    FBits Bits = 0;
+    for (int32 i = 0; i < Size; i++) {
+      Bits = (FBits)((Bits << 8) | In[i]);
+    }
+    T Value;
+    FMemory::Memcpy(&Value, &Bits, Size);
+    return Value;
+  }
+};
+
+template <typename TMemberPointer> struct TMemberTraits;
+template <typename TClass, typename TField>
+struct TMemberTraits<TField TClass::*> {
+  using FClass = TClass;
+  using FField = TField;
+};
+
+// Ordered list of the struct members that go on the wire
+template <auto... Members> struct TWireSchema {
+  static constexpr int32 Size =
+      (0 + ... +
+       TWireScalar<typename TMemberTraits<decltype(Members)>::FField>::Size);
+
+  template <typename TStruct>
+  static void Write(const TStruct &Value, uint8 *Out) {
+    ((WriteMember<Members>(Value, Out)), ...);
+  }
+
+  template <typename TStruct> static void Read(const uint8 *In, TStruct &Value) {
+    ((ReadMember<Members>(In, Value)), ...);
+  }
+
+private:
+  template <auto Member, typename TStruct>
+  static void WriteMember(const TStruct &Value, uint8 *&Out) {
+    using FScalar =
+        TWireScalar<typename TMemberTraits<decltype(Member)>::FField>;
+    FScalar::Write(Out, Value.*Member);
+    Out += FScalar::Size;
+  }
+
+  template <auto Member, typename TStruct>
+  static void ReadMember(const uint8 *&In, TStruct &Value) {
+    using FScalar =
+        TWireScalar<typename TMemberTraits<decltype(Member)>::FField>;
+    Value.*Member = FScalar::Read(In);
+    In += FScalar::Size;
+  }
+};
+
+struct FHeader {
+  EMessageType MessageType = EMessageType::Control;
+  uint32 Sequence = 0;
+  uint64 TimestampUs = 0;
+};
+
+// Operator input, sent headset -> robot
+struct FControlPayload {
+  float Pitch = 0.0f;
+  float Yaw = 0.0f;
+  float TriggerPosition = 0.0f;
+  float ThumbstickX = 0.0f;
+};
+
+// Vehicle state, sent robot -> headset
+struct FTelemetryPayload {
+  float SpeedMph = 0.0f;
+  float DistanceFeet = 0.0f;
+  uint8 ControlBatteryPercentage = 0;
+  uint8 DriveBatteryPercentage = 0;
+};
+
+// NTP-style exchange. The requester fills OriginateUs from its own clock;
+// the responder echoes it and adds its receive and transmit times.
+struct FClockSyncPayload {
+  uint64 OriginateUs = 0;
+  uint64 ReceiveUs = 0;
+  uint64 TransmitUs = 0;
+};
+
+// Robot -> headset for every control packet accepted, on the control
+// socket. The header timestamp is the ack's send time, so together with
+// ReceiveUs it gives the robot's hold time. ReceivedMask bit i reports
+// sequence AckedSequence - 1 - i as received, covering lost acks.
+struct FControlAckPayload {
+  uint32 AckedSequence = 0;
+  uint32 ReceivedMask = 0;
+  // When the control packet arrived, on the robot's clock
+  uint64 ReceiveUs = 0;
+};
+
+// Operator beacon, broadcast and multicast on the LAN and unicast to known
+// robots. A robot answers with a Hello from each of its clock sync and
+// control sockets to the advertised ports at the beacon's source address.
+struct FDiscoveryPayload {
+  uint16 ClockSyncPort = 0;
+  uint16 ControlPort = 0;
+  uint32 Capabilities = 0;
+  // Random per operator process; a change means the operator restarted
+  uint32 SessionId = 0;
+};
+
+// Robot -> headset answer to a beacon, announcing the socket it is sent
+// from. The operator ignores a robot until a Hello echoing its current
+// SessionId arrives, and learns endpoints from nothing else.
+struct FHelloPayload {
+  uint32 SessionId = 0;
+};
+
+// Binds a payload struct to its message type and schema
+template <typename TPayload> struct TMessage;
+
+template <> struct TMessage<FControlPayload> {
+  static constexpr EMessageType Type = EMessageType::Control;
+  using FSchema = TWireSchema<&FControlPayload::Pitch, &FControlPayload::Yaw,
+                              &FControlPayload::TriggerPosition,
+                              &FControlPayload::ThumbstickX>;
+};
+
+template <> struct TMessage<FTelemetryPayload> {
+  static constexpr EMessageType Type = EMessageType::Telemetry;
+  using FSchema = TWireSchema<&FTelemetryPayload::SpeedMph,
+                              &FTelemetryPayload::DistanceFeet,
+                              &FTelemetryPayload::ControlBatteryPercentage,
+                              &FTelemetryPayload::DriveBatteryPercentage>;
+};
+
+template <> struct TMessage<FClockSyncPayload> {
+  static constexpr EMessageType Type = EMessageType::ClockSync;
+  using FSchema = TWireSchema<&FClockSyncPayload::OriginateUs,
+                              &FClockSyncPayload::ReceiveUs,
+                              &FClockSyncPayload::TransmitUs>;
+};
+
+template <> struct TMessage<FControlAckPayload> {
+  static constexpr EMessageType Type = EMessageType::ControlAck;
+  using FSchema = TWireSchema<&FControlAckPayload::AckedSequence,
+                              &FControlAckPayload::ReceivedMask,
+                              &FControlAckPayload::ReceiveUs>;
+};
+
+template <> struct TMessage<FDiscoveryPayload> {
+  static constexpr EMessageType Type = EMessageType::Discovery;
+  using FSchema = TWireSchema<&FDiscoveryPayload::ClockSyncPort,
+                              &FDiscoveryPayload::ControlPort,
+                              &FDiscoveryPayload::Capabilities,
+                              &FDiscoveryPayload::SessionId>;
+};
+
+template <> struct TMessage<FHelloPayload> {
+  static constexpr EMessageType Type = EMessageType::Hello;
+  using FSchema = TWireSchema<&FHelloPayload::SessionId>;
+};
+
+// Total datagram size for a payload type
+template <typename TPayload>
+constexpr int32 PacketSize = HeaderSize + TMessage<TPayload>::FSchema::Size;
+
+// Largest datagram any message produces; size receive buffers with this
+constexpr int32 MaxPacketSize = 128;
+static_assert(PacketSize<FControlPayload> <= MaxPacketSize &&
+                  PacketSize<FTelemetryPayload> <= MaxPacketSize &&
+                  PacketSize<FClockSyncPayload> <= MaxPacketSize &&
+                  PacketSize<FDiscoveryPayload> <= MaxPacketSize &&
+                  PacketSize<FControlAckPayload> <= MaxPacketSize &&
+                  PacketSize<FHelloPayload> <= MaxPacketSize &&
+                  HeaderSize + 1 +
+                          MaxBundleSamples *
+                              TMessage<FControlPayload>::FSchema::Size <=
+                      MaxPacketSize,
+              "MaxPacketSize too small");
+
+// Writes a complete datagram into Out and returns its size, or 0 if
+// Capacity is too small.
+template <typename TPayload>
+int32 Encode(uint32 Sequence, uint64 TimestampUs, const TPayload &Payload,
+             uint8 *Out, int32 Capacity) {
+  using FMessage = TMessage<TPayload>;
+  constexpr int32 Size = PacketSize<TPayload>;
+  if (Capacity < Size) {
+    return 0;
+  }
+  Out[0] = Version;
+  Out[1] = (uint8)FMessage::Type;
+  TWireScalar<uint32>::Write(Out + 2, Sequence);
+  TWireScalar<uint64>::Write(Out + 6, TimestampUs);
+  FMessage::FSchema::Write(Payload, Out + HeaderSize);
+
+  uint32 Crc = Crc32c(Out, CrcOffset);
+  Crc = Crc32c(Out + HeaderSize, Size - HeaderSize, Crc);
+  TWireScalar<uint32>::Write(Out + CrcOffset, Crc);
+  return Size;
+}
+
+// Control redundancy: the newest sample plus the ones sent just before it,
+// Samples[0] being NewestSequence, Samples[i] NewestSequence - i. The
+// receiver takes whichever it has not seen. Returns the datagram size, or 0
+// if Count is out of [1, MaxBundleSamples] or Capacity is too small.
+MYBLANKVRPROJECT_API int32 EncodeControlBundle(uint32 NewestSequence,
+                                               uint64 TimestampUs,
+                                               const FControlPayload *Samples,
+                                               int32 Count, uint8 *Out,
+                                               int32 Capacity);
+
+// Validates version, type, length and CRC of a received datagram and reads
+// its header. A false return means the datagram should be dropped.
+MYBLANKVRPROJECT_API bool DecodeHeader(const uint8 *Data, int32 Size,
+                                       FHeader &OutHeader);
+
+// Reads the samples of a ControlBundle that already passed DecodeHeader,
+// newest first. Returns the count, or 0 if it is not a bundle.
+MYBLANKVRPROJECT_API int32
+DecodeControlBundle(const uint8 *Data, int32 Size,
+                    FControlPayload (&OutSamples)[MaxBundleSamples]);
+
+// Reads the payload of a datagram that already passed DecodeHeader. Fails if
+// the message is of another type.
+template <typename TPayload>
+bool DecodePayload(const uint8 *Data, int32 Size, TPayload &OutPayload) {
+  using FMessage = TMessage<TPayload>;
+  if (Size != PacketSize<TPayload> || Data[1] != (uint8)FMessage::Type) {
+    return false;
+  }
+  FMessage::FSchema::Read(Data + HeaderSize, OutPayload);
+  return true;
+}
+} // namespace ControlWire
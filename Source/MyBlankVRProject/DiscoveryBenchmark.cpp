@@ -0,0 +1,87 @@
+#include "BenchmarkScenarios.h"
+#include "ClockSync.h"
+#include "ControlLinkServer.h"
+#include "HAL/PlatformProcess.h"
+#include "HAL/PlatformTime.h"
+#include "RobotStandIn.h"
+
+bool BenchmarkScenarios::RunDiscovery(const FString &Params,
+                                      TSharedRef<FJsonObject> Report) {
+  int32 Trials = 20;
+  double TimeoutSeconds = 2.0;
+  FParse::Value(*Params, TEXT("Trials="), Trials);
+  FParse::Value(*Params, TEXT("Timeout="), TimeoutSeconds);
+
+  // Just enough of a robot to be discovered. Telemetry would announce it
+  // to the next trial's server before any beacon, so it stays quiet.
+  FRobotStandInConfig RobotConfig;
+  RobotConfig.DiscoveryPort = FControlLinkServer::DefaultDiscoveryPort;
+  RobotConfig.TelemetryHz = 0.0;
+  RobotConfig.Video = EStandInVideo::Off;
+  FRobotStandIn Robot(RobotConfig);
+  if (!Robot.Open()) {
+    return false;
+  }
+
+  FBenchmarkSamples DiscoveryMs;
+  FBenchmarkSamples FirstControlMs;
+  FBenchmarkSamples SyncedMs;
+  int32 Failures = 0;
+
+  for (int32 Trial = 0; Trial < Trials; Trial++) {
+    // A fresh server per trial, so every trial starts from a cold search
+    FControlLinkConfig Config;
+    Config.RobotAddress = TEXT("127.0.0.1");
+    TSharedPtr<FControlLink, ESPMode::ThreadSafe> Link =
+        MakeShared<FControlLink, ESPMode::ThreadSafe>(Config);
+    Link->ControlChannel.Push(FRobotControlData());
+
+    const double Start = FPlatformTime::Seconds();
+    TSharedPtr<FControlLinkServer, ESPMode::ThreadSafe> Server =
+        FControlLinkServer::Acquire();
+    if (!Server) {
+      return false;
+    }
+    Server->AddLink(Link);
+
+    double Synced = -1.0;
+    while (FPlatformTime::Seconds() - Start < TimeoutSeconds) {
+      Robot.Poll(ClockSync::NowMicros());
+      if (Synced < 0.0 && Link->GetState() == ERobotLinkState::Synced) {
+        Synced = FPlatformTime::Seconds() - Start;
+      }
+      if (Synced >= 0.0 && Link->GetAcquisitionSeconds() >= 0.0) {
+        break;
+      }
+      FPlatformProcess::Sleep(0.0001f);
+    }
+
+    if (Synced < 0.0 || Link->GetAcquisitionSeconds() < 0.0) {
+      Failures++;
+    } else {
+      DiscoveryMs.Add(Link->GetDiscoverySeconds() * 1000.0);
+      FirstControlMs.Add(
+          (Link->GetDiscoverySeconds() + Link->GetAcquisitionSeconds()) *
+          1000.0);
+      SyncedMs.Add(Synced * 1000.0);
+    }
+
+    Server->RemoveLink(Link);
+    // Last reference: stops the I/O thread and closes its sockets
+    Server.Reset();
+    Robot.Poll(ClockSync::NowMicros());
+  }
+
+  UE_LOG(LogTemp, Display,
+         TEXT("Discovery: p50 %.2f ms to find, %.2f ms to first control, "
+              "%.2f ms to clock sync, %d/%d failed"),
+         DiscoveryMs.Percentile(50.0), FirstControlMs.Percentile(50.0),
+         SyncedMs.Percentile(50.0), Failures, Trials);
+
+  Report->SetNumberField(TEXT("trials"), Trials);
+  Report->SetNumberField(TEXT("failures"), Failures);
+  Report->SetObjectField(TEXT("discovery_ms"), DiscoveryMs.ToJson());
+  Report->SetObjectField(TEXT("first_control_ms"), FirstControlMs.ToJson());
+  Report->SetObjectField(TEXT("clock_synced_ms"), SyncedMs.ToJson());
+  return Failures == 0;
+}
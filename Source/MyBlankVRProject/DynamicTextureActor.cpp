@@ -1,19 +1,34 @@
 #include "DynamicTextureActor.h"
+#include "CameraDataStreamer.h"
+#include "ClockSync.h"
+#include "DynamicTextureMaterial.h"
+#include "RtpFecRelay.h"
+#include "SharedMemoryFrameRing.h"
 #include "Engine/Texture2D.h"
 #include "Engine/World.h"
+#include "GameFramework/Pawn.h"
+#include "GameFramework/PlayerController.h"
 #include "Kismet/KismetMathLibrary.h"
+#include "Materials/Material.h"
 #include "Materials/MaterialInstanceDynamic.h"
+#include "PipelineStats.h"
 #include "TimerManager.h"
 
 // Sets default values
 ADynamicTextureActor::ADynamicTextureActor()
-    : formatContext(nullptr), avio_ctx(nullptr), swsCtx(nullptr),
-      codecContext(nullptr), frame(nullptr), latest_frame(nullptr),
-      packet(nullptr), texture_width(854), texture_height(480),
-      videoStreamIndex(-1), stream_initialized(false) {
+    : DynamicMaterial(nullptr), formatContext(nullptr), avio_ctx(nullptr),
+      swsCtx(nullptr), codecContext(nullptr), frame(nullptr),
+      latest_frame(nullptr), packet(nullptr), texture_width(854),
+      texture_height(480), eye_width(854), videoStreamIndex(-1),
+      stream_initialized(false), FFmpegWorkerInstance(nullptr), Thread(nullptr),
+      FecRelay(nullptr), FecRelayThread(nullptr), bPendingFrameHasPose(false),
+      bDisplayedFrameHasPose(false), FramesShown(0),
+      bShowLeftEyeOnly(false), NextShmOpenAttempt(0.0) {
   // Set this actor to call Tick() every frame.  You can turn this off to
   // improve performance if you don't need it.
   PrimaryActorTick.bCanEverTick = true;
+  // Reproject against the head pose the camera ends the frame with
+  PrimaryActorTick.TickGroup = TG_PostUpdateWork;
 
   // Create a scene component and set as root
   USceneComponent *SceneRoot =
@@ -64,23 +79,66 @@ void ADynamicTextureActor::BeginPlay() {
   Super::BeginPlay();
   UE_LOG(LogTemp, Error, TEXT("Begin play called."));
 
-  DynamicTexture =
-      UTexture2D::CreateTransient(texture_width, texture_height, PF_B8G8R8A8);
+  // Side-by-side stereo decodes both eyes into a single texture twice as wide
+  // as one view, so a single upload always carries a matched pair.
+  texture_width = bStereoSideBySide ? eye_width * 2 : eye_width;
+
+  UMaterialInterface *Material =
+      PlaneMesh ? PlaneMesh->GetMaterial(0) : nullptr;
+  bShowLeftEyeOnly = false;
+  const bool bMissingEyeRects =
+      bStereoSideBySide &&
+      !DynamicTextureMaterial::SupportsPerEyeRects(Material);
+  const bool bMissingUVOffset =
+      Reprojection == EVideoReprojectionMode::UVOffset &&
+      !DynamicTextureMaterial::SupportsUVOffset(Material);
+  if (Material && (bMissingEyeRects || bMissingUVOffset)) {
+#if WITH_EDITOR
+    // An asset saved before the material read these parameters; build the
+    // current graph for this session
+    UE_LOG(LogTemp, Warning,
+           TEXT("%s is out of date; rebuild it with "
+                "-run=DynamicTextureMaterial. Using a transient copy."),
+           *Material->GetName());
+    UMaterial *Built = NewObject<UMaterial>(GetTransientPackage());
+    DynamicTextureMaterial::Build(Built);
+    Material = Built;
+#else
+    // Cooks rebuild a stale asset first, so this guards only against a
+    // package cooked without the project's editor module
+    if (bMissingEyeRects) {
+      // Better one eye's view in both eyes than the double-width frame
+      UE_LOG(LogTemp, Error,
+             TEXT("%s cannot pick a view per eye; showing the left eye "
+                  "only. Rebuild it with -run=DynamicTextureMaterial."),
+             *Material->GetName());
+      bShowLeftEyeOnly = true;
+    }
+    if (bMissingUVOffset) {
+      UE_LOG(LogTemp, Error,
+             TEXT("%s cannot offset the video UVs; reprojecting by plane "
+                  "transform. Rebuild it with -run=DynamicTextureMaterial."),
+             *Material->GetName());
+      Reprojection = EVideoReprojectionMode::PlaneTransform;
+    }
+#endif
+  }
+
+  DynamicTexture = UTexture2D::CreateTransient(GetUploadWidth(), texture_height,
+                                               PF_B8G8R8A8);
   if (DynamicTexture) {
     DynamicTexture->UpdateResource();
   }
 
   // Ensure PlaneMesh is set
   if (PlaneMesh) {
-    UMaterialInterface *Material = PlaneMesh->GetMaterial(0);
     if (Material) {
-      UMaterialInstanceDynamic *DynamicMaterial =
-          UMaterialInstanceDynamic::Create(Material, this);
+      DynamicMaterial = UMaterialInstanceDynamic::Create(Material, this);
       if (DynamicMaterial) {
         // Ensure the texture is valid
         if (DynamicTexture) {
-          DynamicMaterial->SetTextureParameterValue(FName("DynamicTexture"),
-                                                    DynamicTexture);
+          DynamicMaterial->SetTextureParameterValue(
+              DynamicTextureMaterial::TextureParameter, DynamicTexture);
           UE_LOG(LogTemp, Log,
                  TEXT("Dynamic texture successfully assigned to material."));
         } else {
@@ -88,6 +146,17 @@ void ADynamicTextureActor::BeginPlay() {
                  TEXT("DynamicTexture is null. Cannot assign to material."));
         }
 
+        // The material picks the rect matching the eye being rendered. In
+        // mono both rects cover the whole texture.
+        const FVector4 LeftRect = GetEyeUVRect(0);
+        const FVector4 RightRect = GetEyeUVRect(1);
+        DynamicMaterial->SetVectorParameterValue(
+            DynamicTextureMaterial::LeftEyeUVRectParameter,
+            FLinearColor(LeftRect.X, LeftRect.Y, LeftRect.Z, LeftRect.W));
+        DynamicMaterial->SetVectorParameterValue(
+            DynamicTextureMaterial::RightEyeUVRectParameter,
+            FLinearColor(RightRect.X, RightRect.Y, RightRect.Z, RightRect.W));
+
         PlaneMesh->SetMaterial(0, DynamicMaterial);
       } else {
         UE_LOG(LogTemp, Error,
@@ -103,11 +172,48 @@ void ADynamicTextureActor::BeginPlay() {
            TEXT("PlaneMesh is not set. Please assign it in the editor."));
   }
 
-  UE_LOG(LogTemp, Error, TEXT("Prepare to open UDP stream."));
-
   bHasNewFrame = false;
   PendingFrameData = nullptr;
   PendingFrameSize = 0;
+  bPendingFrameHasPose = false;
+  bDisplayedFrameHasPose = false;
+  FramesShown = 0;
+
+  // Reprojection swings the plane away from wherever it was placed
+  if (PlaneMesh) {
+    PlaneBaseLocation = PlaneMesh->GetRelativeLocation();
+    PlaneBaseRotation = PlaneMesh->GetRelativeRotation().Quaternion();
+  }
+
+  if (FrameSource == EVideoFrameSource::SharedMemory) {
+    // The producer may start after us; Tick keeps trying to open the ring.
+    ShmReader = MakeShared<FSharedMemoryFrameReader, ESPMode::ThreadSafe>();
+    UE_LOG(LogTemp, Log, TEXT("Reading frames from shared memory %s."),
+           *SharedMemoryName);
+    return;
+  }
+
+  UE_LOG(LogTemp, Error, TEXT("Prepare to open UDP stream."));
+
+  // With FEC enabled the relay owns the public port and feeds the repaired
+  // stream to the decoder over loopback, so it has to be up first. Without
+  // it the decoder reads the public port and goes without repair.
+  if (StreamConfig.bEnableFec) {
+    FecRelay = new FRtpFecReceiveRelay(StreamConfig);
+    if (FecRelay->OpenSockets()) {
+      FecRelayThread =
+          FRunnableThread::Create(FecRelay, TEXT("VideoFecRelayThread"));
+    }
+    if (!FecRelayThread) {
+      UE_LOG(LogTemp, Error,
+             TEXT("Failed to start FEC relay, decoding port %d without "
+                  "FEC."),
+             StreamConfig.Port);
+      delete FecRelay;
+      FecRelay = nullptr;
+      StreamConfig.bEnableFec = false;
+    }
+  }
 
   // Start the worker thread
   FFmpegWorkerInstance = new FFmpegWorker(this);
@@ -120,6 +226,39 @@ void ADynamicTextureActor::BeginPlay() {
   }
 }
 
+int ADynamicTextureActor::GetUploadWidth() const {
+  return bShowLeftEyeOnly ? texture_width / 2 : texture_width;
+}
+
+FVector4 ADynamicTextureActor::GetEyeUVRect(int32 EyeIndex) const {
+  if (!bStereoSideBySide || bShowLeftEyeOnly) {
+    return FVector4(0.0f, 0.0f, 1.0f, 1.0f);
+  }
+  return FVector4(EyeIndex == 0 ? 0.0f : 0.5f, 0.0f, 0.5f, 1.0f);
+}
+
+int64 ADynamicTextureActor::GetFramesShown() const { return FramesShown; }
+
+float ADynamicTextureActor::GetVideoLatencyMs() const {
+  const UCameraDataStreamer *Streamer = PoseSource.Get();
+  FClockEstimate Clock;
+  if (!bDisplayedFrameHasPose || DisplayedFramePose.CaptureRobotUs == 0 ||
+      !Streamer || !Streamer->GetClockEstimate(Clock)) {
+    return -1.0f;
+  }
+  const int64 CaptureLocalUs =
+      Clock.ToLocalUs((int64)DisplayedFramePose.CaptureRobotUs);
+  return (ClockSync::NowMicros() - CaptureLocalUs) / 1000.0f;
+}
+
+int64 ADynamicTextureActor::GetFecRecoveredPackets() const {
+  return FecRelay ? FecRelay->GetRecoveredPacketCount() : 0;
+}
+
+int64 ADynamicTextureActor::GetFecUnrecoverablePackets() const {
+  return FecRelay ? FecRelay->GetUnrecoverablePacketCount() : 0;
+}
+
 struct BufferData {
   const uint8_t *ptr;
   size_t size;
@@ -142,23 +281,16 @@ int ADynamicTextureActor::InitializeUDPVideoStream() {
 
   avformat_network_init();
 
-  // SDP description embedded as a string.
-  const char *sdp_data =
-      "v=0\n"
-      // "o=- 0 0 IN IP4 192.168.0.22\n"   // Use the streaming machine's IP.
-      "o=- 0 0 IN IP4 0.0.0.0\n" // Use the streaming machine's IP.
-      "s=No Name\n"
-      // "c=IN IP4 192.168.1.22\n"
-      "c=IN IP4 0.0.0.0\n"
-      "t=0 0\n"
-      "a=tool:libavformat\n"
-      "m=video 5253 RTP/AVP 96\n"
-      "a=rtpmap:96 H264/90000\n";
+  // SDP description generated from the stream config. The UTF-8 copy must
+  // outlive avformat_open_input, which reads it through the AVIOContext.
+  FString Sdp = StreamConfig.BuildSdp();
+  FTCHARToUTF8 SdpUtf8(*Sdp);
+  UE_LOG(LogTemp, Log, TEXT("Video SDP:\n%s"), *Sdp);
 
   // Initialize buffer data structure
   BufferData bd;
-  bd.ptr = (const uint8_t *)sdp_data;
-  bd.size = strlen(sdp_data);
+  bd.ptr = (const uint8_t *)SdpUtf8.Get();
+  bd.size = SdpUtf8.Length();
 
   // Allocate buffer for AVIOContext (you can choose an appropriate size)
   const int buffer_size = 4096;
@@ -242,6 +374,13 @@ int ADynamicTextureActor::InitializeUDPVideoStream() {
 
   UE_LOG(LogTemp, Warning, TEXT("Found video stream."));
 
+  if (!codec) {
+    UE_LOG(LogTemp, Error,
+           TEXT("Error: No decoder available for %s. Check the FFmpeg build."),
+           GetRtpEncodingName(StreamConfig.Codec));
+    return -1;
+  }
+
   codecContext = avcodec_alloc_context3(codec);
   avcodec_parameters_to_context(
       codecContext, formatContext->streams[videoStreamIndex]->codecpar);
@@ -326,6 +465,24 @@ void ADynamicTextureActor::EndPlay(const EEndPlayReason::Type EndPlayReason) {
     FFmpegWorkerInstance = nullptr;
   }
 
+  if (FecRelay) {
+    FecRelay->Stop();
+  }
+
+  if (FecRelayThread) {
+    FecRelayThread->WaitForCompletion();
+    delete FecRelayThread;
+    FecRelayThread = nullptr;
+  }
+
+  if (FecRelay) {
+    delete FecRelay;
+    FecRelay = nullptr;
+  }
+
+  // An upload still in flight on the render thread keeps its own reference
+  ShmReader.Reset();
+
   FFMpegCleanup();
 
   // Deinitialize network components
@@ -337,8 +494,16 @@ void ADynamicTextureActor::OnNewFrameAvailable() {
   // Use a thread-safe way to mark that a new frame is ready
   {
     FScopeLock Lock(&NewFrameLock);
+    if (PendingFrameData) {
+      // Tick never took the previous frame; it is replaced unseen
+      FPV_COUNTER_ADD(FramesDropped, 1);
+      av_free(PendingFrameData);
+      PendingFrameData = nullptr;
+      PendingFrameSize = 0;
+    }
     if (FFmpegWorkerInstance->GetLatestFrame(PendingFrameData,
-                                             PendingFrameSize)) {
+                                             PendingFrameSize, PendingFramePose,
+                                             bPendingFrameHasPose)) {
       bHasNewFrame = true;
     }
   }
@@ -347,16 +512,23 @@ void ADynamicTextureActor::OnNewFrameAvailable() {
 void ADynamicTextureActor::Tick(float delta_time) {
   Super::Tick(delta_time);
 
-  if (bHasNewFrame) {
+  if (ShmReader) {
+    PollSharedMemoryFrame();
+  } else if (bHasNewFrame) {
     uint8 *FrameData = nullptr;
     int FrameSize = 0;
+    FVideoFramePose FramePose;
+    bool bFrameHasPose = false;
 
     // Copy the frame data
     {
+      FPV_SCOPE(Handoff);
       FScopeLock Lock(&NewFrameLock);
       if (PendingFrameData && PendingFrameSize > 0) {
         FrameData = PendingFrameData;
         FrameSize = PendingFrameSize;
+        FramePose = PendingFramePose;
+        bFrameHasPose = bPendingFrameHasPose;
         PendingFrameData = nullptr;
         PendingFrameSize = 0;
       }
@@ -365,10 +537,173 @@ void ADynamicTextureActor::Tick(float delta_time) {
 
     if (FrameData && FrameSize > 0) {
       // Update the texture
-      UpdateTexture(FrameData, FrameSize);
+      {
+        FPV_SCOPE(Upload);
+        UpdateTexture(FrameData, FrameSize);
+      }
       av_free(FrameData);
+      FramesShown++;
+      FPV_COUNTER_ADD(FramesDisplayed, 1);
+      DisplayedFramePose = FramePose;
+      bDisplayedFrameHasPose = bFrameHasPose;
+      UCameraDataStreamer *Streamer = FindPoseSource();
+      if (bFrameHasPose && Streamer) {
+        Streamer->RecordVideoFrameShown(FramePose, ClockSync::NowMicros());
+      }
+      if (PipelineMetrics::IsCollecting()) {
+        const float LatencyMs = GetVideoLatencyMs();
+        if (LatencyMs >= 0.0f) {
+          PipelineMetrics::VideoLatency.Observe((int64)(LatencyMs * 1000.0f));
+        }
+      }
+    }
+  }
+
+  ApplyReprojection();
+}
+
+UCameraDataStreamer *ADynamicTextureActor::FindPoseSource() {
+  if (PoseSource.IsValid()) {
+    return PoseSource.Get();
+  }
+  // The pawn may be spawned or possessed after us
+  APlayerController *PlayerController = GetWorld()->GetFirstPlayerController();
+  APawn *Pawn = PlayerController ? PlayerController->GetPawn() : nullptr;
+  UCameraDataStreamer *Streamer =
+      Pawn ? Pawn->FindComponentByClass<UCameraDataStreamer>() : nullptr;
+  if (Streamer) {
+    PoseSource = Streamer;
+    // Read the head pose after the streamer has sampled it this frame
+    AddTickPrerequisiteComponent(Streamer);
+  }
+  return Streamer;
+}
+
+void ADynamicTextureActor::ApplyReprojection() {
+  if (!PlaneMesh) {
+    return;
+  }
+
+  // No correction unless the frame on screen can be placed: by the gimbal
+  // pose the robot reported, or else by the commands sent before its
+  // capture time
+  FVideoReprojectionDelta Delta;
+  float DisplayPitch = 0.0f;
+  float DisplayYaw = 0.0f;
+  UCameraDataStreamer *Streamer =
+      Reprojection != EVideoReprojectionMode::None && bDisplayedFrameHasPose
+          ? FindPoseSource()
+          : nullptr;
+  if (Streamer) {
+    DisplayPitch = Streamer->GetAccumulatedPitch();
+    DisplayYaw = Streamer->GetAccumulatedYaw();
+    float CapturePitch = DisplayedFramePose.GimbalPitch;
+    float CaptureYaw = DisplayedFramePose.GimbalYaw;
+    bool bHaveCapturePose = DisplayedFramePose.bHasGimbalPose;
+    FClockEstimate Clock;
+    if (!bHaveCapturePose && DisplayedFramePose.CaptureRobotUs != 0 &&
+        Streamer->GetClockEstimate(Clock)) {
+      bHaveCapturePose = Streamer->GetGimbalPoseAt(
+          Clock.ToLocalUs((int64)DisplayedFramePose.CaptureRobotUs),
+          CapturePitch, CaptureYaw);
+    }
+    if (bHaveCapturePose) {
+      Delta = VideoReprojection::ComputeDelta(CapturePitch, CaptureYaw,
+                                              DisplayPitch, DisplayYaw,
+                                              MaxReprojectionDegrees);
     }
   }
+
+  // The plane hangs in front of the viewer, at the actor's origin, so
+  // rotating its placement about the origin re-aims it
+  const FQuat PlaneCorrection =
+      Reprojection == EVideoReprojectionMode::PlaneTransform
+          ? VideoReprojection::PlaneRotation(DisplayPitch, DisplayYaw, Delta)
+          : FQuat::Identity;
+  PlaneMesh->SetRelativeLocationAndRotation(
+      PlaneCorrection.RotateVector(PlaneBaseLocation),
+      PlaneCorrection * PlaneBaseRotation);
+
+  if (DynamicMaterial && Reprojection == EVideoReprojectionMode::UVOffset) {
+    const float EyeWidth = bStereoSideBySide ? texture_width / 2.0f
+                                             : (float)texture_width;
+    const FVector2D Offset = VideoReprojection::UVOffset(
+        DisplayPitch, DisplayYaw, Delta, CameraHorizontalFovDegrees,
+        EyeWidth / texture_height);
+    DynamicMaterial->SetVectorParameterValue(
+        DynamicTextureMaterial::ReprojectionUVOffsetParameter,
+        FLinearColor(Offset.X, Offset.Y, 0.0f, 0.0f));
+  }
+}
+
+void ADynamicTextureActor::ResizeTexture(int Width, int Height) {
+  texture_width = Width;
+  texture_height = Height;
+  DynamicTexture =
+      UTexture2D::CreateTransient(GetUploadWidth(), Height, PF_B8G8R8A8);
+  if (DynamicTexture) {
+    DynamicTexture->UpdateResource();
+    if (DynamicMaterial) {
+      DynamicMaterial->SetTextureParameterValue(
+          DynamicTextureMaterial::TextureParameter, DynamicTexture);
+    }
+  }
+}
+
+void ADynamicTextureActor::PollSharedMemoryFrame() {
+  if (!ShmReader->IsOpen()) {
+    const double Now = FPlatformTime::Seconds();
+    if (Now < NextShmOpenAttempt) {
+      return;
+    }
+    NextShmOpenAttempt = Now + 1.0;
+    if (!ShmReader->Open(SharedMemoryName)) {
+      return;
+    }
+    if (ShmReader->GetWidth() != texture_width ||
+        ShmReader->GetHeight() != texture_height) {
+      ResizeTexture(ShmReader->GetWidth(), ShmReader->GetHeight());
+    }
+  }
+
+  if (!DynamicTexture) {
+    return;
+  }
+
+  FSharedMemoryFrameReader::FFrame Frame;
+  if (!ShmReader->AcquireLatestFrame(Frame)) {
+    // A restarted producer replaces the segment under the same name, and
+    // the old mapping simply stops advancing
+    const double Now = FPlatformTime::Seconds();
+    if (Now >= NextShmOpenAttempt) {
+      NextShmOpenAttempt = Now + 1.0;
+      if (ShmReader->IsSegmentReplaced()) {
+        UE_LOG(LogTemp, Log, TEXT("Shared memory %s was replaced, reopening."),
+               *SharedMemoryName);
+        // A frame still uploading keeps the old reader and mapping alive
+        ShmReader =
+            MakeShared<FSharedMemoryFrameReader, ESPMode::ThreadSafe>();
+        NextShmOpenAttempt = 0.0;
+      }
+    }
+    return;
+  }
+
+  // Upload straight from the shared mapping. The slot stays claimed, and
+  // the reader alive, until the render thread has consumed the pixels.
+  FPV_SCOPE(Upload);
+  FUpdateTextureRegion2D *Region =
+      new FUpdateTextureRegion2D(0, 0, 0, 0, GetUploadWidth(), texture_height);
+  TSharedPtr<FSharedMemoryFrameReader, ESPMode::ThreadSafe> Reader = ShmReader;
+  DynamicTexture->UpdateTextureRegions(
+      0, 1, Region, ShmReader->GetRowPitch(), 4,
+      const_cast<uint8 *>(Frame.Pixels),
+      [Reader, Frame](uint8 *, const FUpdateTextureRegion2D *Regions) {
+        Reader->ReleaseFrame(Frame);
+        delete Regions;
+      });
+  FramesShown++;
+  FPV_COUNTER_ADD(FramesDisplayed, 1);
 }
 
 void ADynamicTextureActor::UpdateTexture(uint8_t *img_data, int num_bytes) {
@@ -402,7 +737,7 @@ void ADynamicTextureActor::UpdateTexture(uint8_t *img_data, int num_bytes) {
         LogTemp, Warning,
         TEXT("UpdateTexture: Mip.BulkData size is 0. Attempting to realloc."));
     // Reallocate BulkData with the expected size
-    Mip.BulkData.Realloc(num_bytes);
+    Mip.BulkData.Realloc(GetUploadWidth() * texture_height * 4);
     if (Mip.BulkData.GetBulkDataSize() == 0) {
       UE_LOG(LogTemp, Error,
              TEXT("UpdateTexture: Realloc failed. BulkData size is still 0."));
@@ -434,8 +769,17 @@ void ADynamicTextureActor::UpdateTexture(uint8_t *img_data, int num_bytes) {
     return;
   }
 
-  // Copy pixel data in bulk
-  FMemory::Memcpy(Data, img_data, num_bytes);
+  if (bShowLeftEyeOnly) {
+    // The texture holds the left half of each row
+    const int32 RowBytes = GetUploadWidth() * 4;
+    for (int32 Row = 0; Row < texture_height; Row++) {
+      FMemory::Memcpy((uint8 *)Data + Row * RowBytes,
+                      img_data + Row * texture_width * 4, RowBytes);
+    }
+  } else {
+    // Copy pixel data in bulk
+    FMemory::Memcpy(Data, img_data, num_bytes);
+  }
 
   // Unlock the bulk data
   Mip.BulkData.Unlock();
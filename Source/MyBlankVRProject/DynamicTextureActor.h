@@ -7,8 +7,15 @@
 #include "GameFramework/Actor.h"
 #include "Components/StaticMeshComponent.h"
 #include "FFmpegWorker.h"
+#include "VideoFramePose.h"
+#include "VideoReprojection.h"
+#include "VideoStreamConfig.h"
 #include "DynamicTextureActor.generated.h"
 
+class UCameraDataStreamer;
+class UMaterialInstanceDynamic;
+class FSharedMemoryFrameReader;
+
 UCLASS()
 class MYBLANKVRPROJECT_API ADynamicTextureActor : public AActor
 {
@@ -24,6 +31,66 @@ public:
     UPROPERTY(Transient)
     UStaticMeshComponent* PlaneMesh; // The plane to apply the texture to
 
+    UPROPERTY(Transient)
+    UMaterialInstanceDynamic* DynamicMaterial;
+
+    // The incoming stream packs a left/right camera pair side by side. Both
+    // eyes are decoded from the same frame into one texture and each eye
+    // samples its own half, through the UV rects M_DynamicTexture reads
+    // (see DynamicTextureMaterial).
+    UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Video")
+    bool bStereoSideBySide = false;
+
+    // Where frames come from. SharedMemory skips encode/decode entirely and
+    // uploads straight from the producer's ring.
+    UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Video")
+    EVideoFrameSource FrameSource = EVideoFrameSource::Network;
+
+    // POSIX shared memory name of the frame ring
+    UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Video")
+    FString SharedMemoryName = TEXT("/fpvcam_frames");
+
+    // Port, payload type and codec of the incoming RTP stream
+    UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Video")
+    FVideoStreamConfig StreamConfig;
+
+    // Packets rebuilt from FEC parity since the stream started
+    UFUNCTION(BlueprintCallable, Category = "Video|FEC")
+    int64 GetFecRecoveredPackets() const;
+
+    // Lost packets FEC could not rebuild
+    UFUNCTION(BlueprintCallable, Category = "Video|FEC")
+    int64 GetFecUnrecoverablePackets() const;
+
+    // Corrects each rendered frame for the head motion since the video frame
+    // on screen was captured. Needs the actor attached to the VR camera, a
+    // UCameraDataStreamer on the player pawn and a robot that tags frames
+    // with their capture pose.
+    UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Video|Reprojection")
+    EVideoReprojectionMode Reprojection = EVideoReprojectionMode::PlaneTransform;
+
+    // Larger pose differences are only corrected this far
+    UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Video|Reprojection", meta = (ClampMin = "0", ClampMax = "90"))
+    float MaxReprojectionDegrees = 30.0f;
+
+    // The robot camera's horizontal field of view, for UVOffset
+    UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Video|Reprojection", meta = (ClampMin = "1", ClampMax = "170"))
+    float CameraHorizontalFovDegrees = 90.0f;
+
+    // Milliseconds from capture to now of the frame on screen; negative if
+    // the frame carries no capture time or the robot clock is not synced
+    UFUNCTION(BlueprintCallable, Category = "Video|Reprojection")
+    float GetVideoLatencyMs() const;
+
+    // UV rect (offset X, offset Y, width, height) of the given eye's view
+    // within DynamicTexture. 0 is the left eye, 1 the right eye.
+    UFUNCTION(BlueprintCallable, Category = "Video")
+    FVector4 GetEyeUVRect(int32 EyeIndex) const;
+
+    // Frames uploaded to DynamicTexture since play began
+    UFUNCTION(BlueprintCallable, Category = "Video")
+    int64 GetFramesShown() const;
+
     // Callback for ffmpeg frame
     void OnNewFrameAvailable();
 
@@ -41,6 +108,7 @@ public:
     
     int texture_width;
     int texture_height;
+    int eye_width;
     
     int videoStreamIndex;
     
@@ -54,11 +122,37 @@ private:
     FFmpegWorker* FFmpegWorkerInstance;
     FRunnableThread* Thread;
 
+    class FRtpFecReceiveRelay* FecRelay;
+    FRunnableThread* FecRelayThread;
+
     FThreadSafeBool bHasNewFrame;
     FCriticalSection NewFrameLock;
     uint8* PendingFrameData;
     int PendingFrameSize;
+    FVideoFramePose PendingFramePose;
+    bool bPendingFrameHasPose;
+
+    // Capture pose of the frame in DynamicTexture
+    FVideoFramePose DisplayedFramePose;
+    bool bDisplayedFrameHasPose;
+    int64 FramesShown;
+
+    // Stereo with a material that cannot pick a rect per eye: only the left
+    // half of each frame is uploaded, for both eyes
+    bool bShowLeftEyeOnly;
+    int GetUploadWidth() const;
+
+    TWeakObjectPtr<UCameraDataStreamer> PoseSource;
+    FVector PlaneBaseLocation;
+    FQuat PlaneBaseRotation;
+
+    TSharedPtr<FSharedMemoryFrameReader, ESPMode::ThreadSafe> ShmReader;
+    double NextShmOpenAttempt;
 
     void UpdateTexture(uint8_t* img_data, int num_bytes);
+    void PollSharedMemoryFrame();
+    void ResizeTexture(int Width, int Height);
+    UCameraDataStreamer* FindPoseSource();
+    void ApplyReprojection();
     void Tick(float delta_time);
 };
@@ -0,0 +1,200 @@
+#include "DynamicTextureMaterial.h"
+#include "Engine/Texture2D.h"
+#include "Materials/Material.h"
+#include "Materials/MaterialInterface.h"
+
+#if WITH_EDITOR
+#include "Materials/MaterialExpressionAdd.h"
+#include "Materials/MaterialExpressionAppendVector.h"
+#include "Materials/MaterialExpressionClamp.h"
+#include "Materials/MaterialExpressionCustom.h"
+#include "Materials/MaterialExpressionLinearInterpolate.h"
+#include "Materials/MaterialExpressionMultiply.h"
+#include "Materials/MaterialExpressionTextureCoordinate.h"
+#include "Materials/MaterialExpressionTextureSampleParameter2D.h"
+#include "Materials/MaterialExpressionVectorParameter.h"
+#include "Misc/PackageName.h"
+#include "UObject/Package.h"
+#include "UObject/SavePackage.h"
+#endif
+
+namespace DynamicTextureMaterial {
+const TCHAR *AssetPath = TEXT("/Game/CustomStuff/M_DynamicTexture");
+
+const FName TextureParameter(TEXT("DynamicTexture"));
+const FName LeftEyeUVRectParameter(TEXT("LeftEyeUVRect"));
+const FName RightEyeUVRectParameter(TEXT("RightEyeUVRect"));
+const FName ReprojectionUVOffsetParameter(TEXT("ReprojectionUVOffset"));
+
+bool SupportsPerEyeRects(const UMaterialInterface *Material) {
+  FLinearColor Unused;
+  return Material &&
+         Material->GetVectorParameterDefaultValue(
+             FHashedMaterialParameterInfo(LeftEyeUVRectParameter), Unused) &&
+         Material->GetVectorParameterDefaultValue(
+             FHashedMaterialParameterInfo(RightEyeUVRectParameter), Unused);
+}
+
+bool SupportsUVOffset(const UMaterialInterface *Material) {
+  FLinearColor Unused;
+  return Material &&
+         Material->GetVectorParameterDefaultValue(
+             FHashedMaterialParameterInfo(ReprojectionUVOffsetParameter),
+             Unused);
+}
+
+#if WITH_EDITOR
+namespace {
+// Output pins of a vector parameter: 0 is RGB, then R, G, B and A
+constexpr int32 OutputR = 1;
+constexpr int32 OutputG = 2;
+constexpr int32 OutputB = 3;
+constexpr int32 OutputA = 4;
+
+template <typename T>
+T *AddExpression(UMaterial *Material, int32 X, int32 Y) {
+  T *Expression = NewObject<T>(Material);
+  Expression->MaterialExpressionEditorX = X;
+  Expression->MaterialExpressionEditorY = Y;
+  Material->GetExpressionCollection().AddExpression(Expression);
+  return Expression;
+}
+
+UMaterialExpression *AddAppend(UMaterial *Material, UMaterialExpression *From,
+                               int32 FirstOutput, int32 SecondOutput, int32 X,
+                               int32 Y) {
+  auto *Append = AddExpression<UMaterialExpressionAppendVector>(Material, X, Y);
+  Append->A.Connect(FirstOutput, From);
+  Append->B.Connect(SecondOutput, From);
+  return Append;
+}
+
+UMaterialExpression *AddLerp(UMaterial *Material, UMaterialExpression *A,
+                             UMaterialExpression *B, UMaterialExpression *Alpha,
+                             int32 X, int32 Y) {
+  auto *Lerp =
+      AddExpression<UMaterialExpressionLinearInterpolate>(Material, X, Y);
+  Lerp->A.Connect(0, A);
+  Lerp->B.Connect(0, B);
+  Lerp->Alpha.Connect(0, Alpha);
+  return Lerp;
+}
+} // namespace
+
+void Build(UMaterial *Material) {
+  Material->PreEditChange(nullptr);
+  Material->GetExpressionCollection().Empty();
+  Material->BlendMode = BLEND_Opaque;
+  // The video is shown as captured, not lit by the scene
+  Material->SetShadingModel(MSM_Unlit);
+
+  // 0 for the left eye, 1 for the right. With instanced stereo or
+  // multiview ResolvedView is the view of the eye being shaded.
+  auto *EyeIndex = AddExpression<UMaterialExpressionCustom>(Material, -900, 0);
+  EyeIndex->Description = TEXT("EyeIndex");
+  EyeIndex->OutputType = CMOT_Float1;
+  EyeIndex->Code = TEXT("return ResolvedView.StereoPassIndex > 0 ? 1.0 : 0.0;");
+  EyeIndex->Inputs.Reset();
+
+  // Mono rects cover the whole texture
+  auto *LeftRect =
+      AddExpression<UMaterialExpressionVectorParameter>(Material, -1200, 200);
+  LeftRect->ParameterName = LeftEyeUVRectParameter;
+  LeftRect->DefaultValue = FLinearColor(0.0f, 0.0f, 1.0f, 1.0f);
+  auto *RightRect =
+      AddExpression<UMaterialExpressionVectorParameter>(Material, -1200, 450);
+  RightRect->ParameterName = RightEyeUVRectParameter;
+  RightRect->DefaultValue = FLinearColor(0.0f, 0.0f, 1.0f, 1.0f);
+
+  UMaterialExpression *RectOffset = AddLerp(
+      Material,
+      AddAppend(Material, LeftRect, OutputR, OutputG, -900, 200),
+      AddAppend(Material, RightRect, OutputR, OutputG, -900, 300), EyeIndex,
+      -650, 200);
+  UMaterialExpression *RectSize = AddLerp(
+      Material,
+      AddAppend(Material, LeftRect, OutputB, OutputA, -900, 450),
+      AddAppend(Material, RightRect, OutputB, OutputA, -900, 550), EyeIndex,
+      -650, 450);
+
+  // Reprojection slides the image within the eye's view. Clamping keeps
+  // one eye from reading the other's half; the edge pixels smear instead.
+  auto *UVOffset =
+      AddExpression<UMaterialExpressionVectorParameter>(Material, -1200, -300);
+  UVOffset->ParameterName = ReprojectionUVOffsetParameter;
+  UVOffset->DefaultValue = FLinearColor(0.0f, 0.0f, 0.0f, 0.0f);
+  auto *PlaneUV =
+      AddExpression<UMaterialExpressionTextureCoordinate>(Material, -900, -150);
+  auto *ShiftedUV = AddExpression<UMaterialExpressionAdd>(Material, -650, -150);
+  ShiftedUV->A.Connect(0, PlaneUV);
+  ShiftedUV->B.Connect(
+      0, AddAppend(Material, UVOffset, OutputR, OutputG, -900, -300));
+  auto *EyeUV = AddExpression<UMaterialExpressionClamp>(Material, -500, -150);
+  EyeUV->Input.Connect(0, ShiftedUV);
+  EyeUV->MinDefault = 0.0f;
+  EyeUV->MaxDefault = 1.0f;
+
+  // Rect offset + eye UV * rect size
+  auto *Scaled = AddExpression<UMaterialExpressionMultiply>(Material, -400, 0);
+  Scaled->A.Connect(0, EyeUV);
+  Scaled->B.Connect(0, RectSize);
+  auto *TextureUV = AddExpression<UMaterialExpressionAdd>(Material, -250, 0);
+  TextureUV->A.Connect(0, Scaled);
+  TextureUV->B.Connect(0, RectOffset);
+
+  auto *Sample = AddExpression<UMaterialExpressionTextureSampleParameter2D>(
+      Material, -100, 0);
+  Sample->ParameterName = TextureParameter;
+  // Replaced at run time; a parameter cannot compile without a default
+  Sample->Texture = LoadObject<UTexture2D>(
+      nullptr, TEXT("/Engine/EngineResources/DefaultTexture.DefaultTexture"));
+  Sample->SamplerType = SAMPLERTYPE_Color;
+  Sample->Coordinates.Connect(0, TextureUV);
+
+  Material->GetEditorOnlyData()->EmissiveColor.Connect(0, Sample);
+
+  Material->PostEditChange();
+  Material->MarkPackageDirty();
+}
+
+bool RebuildAsset() {
+  const FString PackageName = AssetPath;
+  const FString AssetName = FPackageName::GetShortName(PackageName);
+
+  // Rebuild in place so references to the asset keep resolving
+  UPackage *Package = CreatePackage(*PackageName);
+  Package->FullyLoad();
+  UMaterial *Material = FindObject<UMaterial>(Package, *AssetName);
+  if (!Material) {
+    Material = NewObject<UMaterial>(Package, *AssetName,
+                                    RF_Public | RF_Standalone);
+  }
+  Build(Material);
+
+  const FString Filename = FPackageName::LongPackageNameToFilename(
+      PackageName, FPackageName::GetAssetPackageExtension());
+  FSavePackageArgs SaveArgs;
+  SaveArgs.TopLevelFlags = RF_Public | RF_Standalone;
+  if (!UPackage::SavePackage(Package, Material, *Filename, SaveArgs)) {
+    UE_LOG(LogTemp, Error, TEXT("Failed to save %s"), *Filename);
+    return false;
+  }
+  UE_LOG(LogTemp, Display, TEXT("Rebuilt %s"), *Filename);
+  return true;
+}
+
+bool RebuildAssetIfStale() {
+  const FString PackageName = AssetPath;
+  const FString ObjectPath = FString::Printf(
+      TEXT("%s.%s"), *PackageName, *FPackageName::GetShortName(PackageName));
+  const UMaterialInterface *Material =
+      LoadObject<UMaterialInterface>(nullptr, *ObjectPath);
+  if (SupportsPerEyeRects(Material) && SupportsUVOffset(Material)) {
+    return true;
+  }
+  UE_LOG(LogTemp, Warning, TEXT("%s is out of date; rebuilding it"),
+         *PackageName);
+  return RebuildAsset();
+}
+#endif
+} // namespace DynamicTextureMaterial
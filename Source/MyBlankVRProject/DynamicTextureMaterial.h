@@ -0,0 +1,45 @@
+#pragma once
+
+#include "CoreMinimal.h"
+
+class UMaterial;
+class UMaterialInterface;
+
+// The video plane's material, defined here rather than by hand in the
+// editor so the parameters ADynamicTextureActor drives cannot drift from
+// what the material reads. The graph samples DynamicTexture unlit, through
+// the UV rect of the eye being rendered: LeftEyeUVRect or RightEyeUVRect
+// (offset X, offset Y, width, height), picked by the view's stereo pass.
+// ReprojectionUVOffset (U, V) is added to the plane's UV first, in units
+// of one eye's view.
+//
+// Content/CustomStuff/M_DynamicTexture is rebuilt from this with
+//   UnrealEditor-Cmd MyBlankVRProject.uproject -run=DynamicTextureMaterial
+// and, if the saved asset is stale, automatically when a cook starts.
+namespace DynamicTextureMaterial {
+extern const TCHAR *AssetPath;
+
+extern const FName TextureParameter;
+extern const FName LeftEyeUVRectParameter;
+extern const FName RightEyeUVRectParameter;
+extern const FName ReprojectionUVOffsetParameter;
+
+// True if Material reads the per-eye UV rects
+bool SupportsPerEyeRects(const UMaterialInterface *Material);
+// True if Material reads ReprojectionUVOffset
+bool SupportsUVOffset(const UMaterialInterface *Material);
+
+#if WITH_EDITOR
+// Replaces Material's graph and settings with the video plane's and
+// recompiles it
+void Build(UMaterial *Material);
+
+// Builds the asset at AssetPath in place and saves it to Content/. False if
+// the package could not be saved.
+bool RebuildAsset();
+
+// Rebuilds the asset if it lacks a parameter ADynamicTextureActor drives.
+// False only if a needed rebuild failed.
+bool RebuildAssetIfStale();
+#endif
+} // namespace DynamicTextureMaterial
@@ -0,0 +1,18 @@
+#include "DynamicTextureMaterialCommandlet.h"
+#include "DynamicTextureMaterial.h"
+
+UDynamicTextureMaterialCommandlet::UDynamicTextureMaterialCommandlet() {
+  IsClient = false;
+  IsServer = false;
+  IsEditor = true;
+  LogToConsole = true;
+}
+
+int32 UDynamicTextureMaterialCommandlet::Main(const FString &Params) {
+#if WITH_EDITOR
+  return DynamicTextureMaterial::RebuildAsset() ? 0 : 1;
+#else
+  UE_LOG(LogTemp, Error, TEXT("DynamicTextureMaterial needs an editor build"));
+  return 1;
+#endif
+}
@@ -0,0 +1,18 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Commandlets/Commandlet.h"
+#include "DynamicTextureMaterialCommandlet.generated.h"
+
+// Rebuilds Content/CustomStuff/M_DynamicTexture from DynamicTextureMaterial:
+//   UnrealEditor-Cmd MyBlankVRProject.uproject -run=DynamicTextureMaterial
+// Run it after changing the graph and commit the asset with the code.
+UCLASS()
+class UDynamicTextureMaterialCommandlet : public UCommandlet {
+  GENERATED_BODY()
+
+public:
+  UDynamicTextureMaterialCommandlet();
+
+  virtual int32 Main(const FString &Params) override;
+};
@@ -1,15 +1,23 @@
 // FFmpegWorker.cpp
 #include "FFmpegWorker.h"
+#include "ClockSync.h"
 #include "DynamicTextureActor.h"
 #include "Misc/ScopeLock.h"
+#include "PipelineStats.h"
 
 FFmpegWorker::FFmpegWorker(ADynamicTextureActor* InOwner)
     : Owner(InOwner),
       Thread(nullptr),
       bStopThread(false),
       LatestFrameData(nullptr),
-      FrameDataSize(0)
+      FrameDataSize(0),
+      bLatestFrameHasPose(false),
+      NextPacketPose(0)
 {
+    for (FPacketPose& Entry : PacketPoses)
+    {
+        Entry.Pts = AV_NOPTS_VALUE;
+    }
 }
 
 FFmpegWorker::~FFmpegWorker()
@@ -72,10 +80,28 @@ uint32 FFmpegWorker::Run()
             continue;
         }
 
-        if (av_read_frame(Owner->formatContext, Owner->packet) >= 0)
+        int read_result;
+        {
+            FPV_SCOPE(Read);
+            read_result = av_read_frame(Owner->formatContext, Owner->packet);
+        }
+
+        if (read_result >= 0)
         {
             if (Owner->packet->stream_index == Owner->videoStreamIndex)
             {
+                FPV_SCOPE(Decode);
+
+                FVideoFramePose Pose;
+                if (VideoPoseSei::Find(Owner->StreamConfig.Codec, Owner->packet->data, Owner->packet->size, Pose))
+                {
+                    Pose.ReceivedLocalUs = ClockSync::NowMicros();
+                    FPacketPose& Entry = PacketPoses[NextPacketPose];
+                    Entry.Pts = Owner->packet->pts;
+                    Entry.Pose = Pose;
+                    NextPacketPose = (NextPacketPose + 1) % PacketPoseCount;
+                }
+
                 if (avcodec_send_packet(Owner->codecContext, Owner->packet) < 0)
                 {
                     UE_LOG(LogTemp, Warning, TEXT("FFmpegWorker: Failed to send packet to decoder."));
@@ -85,11 +111,20 @@ uint32 FFmpegWorker::Run()
         }
 
         bool have_new_frame = false;
-        while (avcodec_receive_frame(Owner->codecContext, Owner->frame) == 0)
         {
-            av_frame_unref(Owner->latest_frame);
-            av_frame_move_ref(Owner->latest_frame, Owner->frame);
-            have_new_frame = true;
+            FPV_SCOPE(Decode);
+            while (avcodec_receive_frame(Owner->codecContext, Owner->frame) == 0)
+            {
+                FPV_COUNTER_ADD(FramesDecoded, 1);
+                if (have_new_frame)
+                {
+                    // Only the newest frame of a burst is converted
+                    FPV_COUNTER_ADD(FramesDropped, 1);
+                }
+                av_frame_unref(Owner->latest_frame);
+                av_frame_move_ref(Owner->latest_frame, Owner->frame);
+                have_new_frame = true;
+            }
         }
 
         if (have_new_frame)
@@ -108,15 +143,24 @@ uint32 FFmpegWorker::Run()
             );
 
             // Convert the frame to BGRA
-            sws_scale(
-                Owner->swsCtx,
-                Owner->latest_frame->data,
-                Owner->latest_frame->linesize,
-                0,
-                src_height,
-                dest_data,
-                dest_linesize
-            );
+            {
+                FPV_SCOPE(Convert);
+                sws_scale(
+                    Owner->swsCtx,
+                    Owner->latest_frame->data,
+                    Owner->latest_frame->linesize,
+                    0,
+                    src_height,
+                    dest_data,
+                    dest_linesize
+                );
+            }
+
+            FVideoFramePose Pose;
+            const bool bHasPose = FindPacketPose(Owner->latest_frame->pts, Pose);
+            Pose.DecodedLocalUs = ClockSync::NowMicros();
+
+            FPV_SCOPE(Handoff);
 
             // Lock and update frame data
             {
@@ -127,6 +171,8 @@ uint32 FFmpegWorker::Run()
                 }
                 LatestFrameData = buffer;
                 FrameDataSize = num_bytes;
+                LatestFramePose = Pose;
+                bLatestFrameHasPose = bHasPose;
                 buffer = nullptr; // Ownership transferred
             }
 
@@ -151,7 +197,24 @@ void FFmpegWorker::Stop()
     bStopThread = true;
 }
 
-bool FFmpegWorker::GetLatestFrame(uint8*& OutData, int& OutSize)
+bool FFmpegWorker::FindPacketPose(int64 Pts, FVideoFramePose& OutPose) const
+{
+    if (Pts == AV_NOPTS_VALUE)
+    {
+        return false;
+    }
+    for (const FPacketPose& Entry : PacketPoses)
+    {
+        if (Entry.Pts == Pts)
+        {
+            OutPose = Entry.Pose;
+            return true;
+        }
+    }
+    return false;
+}
+
+bool FFmpegWorker::GetLatestFrame(uint8*& OutData, int& OutSize, FVideoFramePose& OutPose, bool& bOutHasPose)
 {
     FScopeLock Lock(&FrameDataLock);
     if (LatestFrameData && FrameDataSize > 0)
@@ -161,6 +224,8 @@ bool FFmpegWorker::GetLatestFrame(uint8*& OutData, int& OutSize)
         {
             FMemory::Memcpy(OutData, LatestFrameData, FrameDataSize);
             OutSize = FrameDataSize;
+            OutPose = LatestFramePose;
+            bOutHasPose = bLatestFrameHasPose;
             return true;
         }
     }
@@ -15,6 +15,7 @@ extern "C"
 #include "CoreMinimal.h"
 #include "HAL/Runnable.h"
 #include "HAL/RunnableThread.h"
+#include "VideoFramePose.h"
 
 
 class ADynamicTextureActor; // Forward declaration
@@ -31,8 +32,9 @@ public:
     virtual uint32 Run() override;
     virtual void Stop() override;
 
-    // Thread-safe method to retrieve frame data
-    bool GetLatestFrame(uint8*& OutData, int& OutSize);
+    // Thread-safe method to retrieve frame data, with the capture pose the
+    // robot sent for it if any
+    bool GetLatestFrame(uint8*& OutData, int& OutSize, FVideoFramePose& OutPose, bool& bOutHasPose);
 
 private:
     ADynamicTextureActor* Owner;
@@ -43,6 +45,21 @@ private:
     FCriticalSection FrameDataLock;
     uint8* LatestFrameData;
     int FrameDataSize;
+    FVideoFramePose LatestFramePose;
+    bool bLatestFrameHasPose;
+
+    // Poses parsed from recent packets, keyed by pts until the decoder
+    // hands out the matching frame
+    struct FPacketPose
+    {
+        int64 Pts;
+        FVideoFramePose Pose;
+    };
+    static constexpr int32 PacketPoseCount = 16;
+    FPacketPose PacketPoses[PacketPoseCount];
+    int32 NextPacketPose;
+
+    bool FindPacketPose(int64 Pts, FVideoFramePose& OutPose) const;
 };
 
 #endif /* FFmpegWorker_hpp */
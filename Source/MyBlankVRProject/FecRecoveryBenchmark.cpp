@@ -0,0 +1,143 @@
+#include "BenchmarkScenarios.h"
+#include "HAL/PlatformTime.h"
+#include "Math/RandomStream.h"
+#include "NetworkImpairment.h"
+#include "RtpFec.h"
+
+namespace {
+struct FFecTrialResult {
+  int32 MediaPackets = 0;
+  int32 LostPackets = 0;
+  uint64 Recovered = 0;
+  uint64 Unrecoverable = 0;
+  int64 MediaBytes = 0;
+  int64 FecBytes = 0;
+  double DecodeSeconds = 0.0;
+};
+
+// Pushes synthetic RTP packets through encoder -> loss model -> decoder.
+// Parity packets share the link, and so the loss process, with media.
+FFecTrialResult RunTrial(int32 NumPackets, int32 GroupSize,
+                         const FImpairmentConfig &Link) {
+  FFecTrialResult Result;
+  FRandomStream Random(Link.Seed);
+  FImpairmentModel Model(Link);
+  double DeliveryTimes[2];
+  FRtpFecEncoder Encoder(GroupSize);
+  FRtpFecDecoder Decoder;
+  TArray<uint8> FecPacket;
+  uint8 Packet[RtpFec::MaxPacketSize];
+  auto Discard = [](const uint8 *, int32) {};
+
+  for (int32 i = 0; i < NumPackets; i++) {
+    const int32 Size = Random.RandRange(200, 1400);
+    FMemory::Memset(Packet, (uint8)i, Size);
+    Packet[0] = 0x80;
+    Packet[1] = 96;
+    RtpFec::WriteUInt16(Packet + 2, (uint16)i);
+
+    Result.MediaPackets++;
+    Result.MediaBytes += Size;
+    const bool bHasFec = Encoder.AddMediaPacket(Packet, Size, FecPacket);
+
+    const double Start = FPlatformTime::Seconds();
+    if (Model.Process(i * 0.001, Size, DeliveryTimes) == 0) {
+      Result.LostPackets++;
+    } else {
+      Decoder.AddMediaPacket(Packet, Size, Discard);
+    }
+    if (bHasFec) {
+      Result.FecBytes += FecPacket.Num();
+      if (Model.Process(i * 0.001, FecPacket.Num(), DeliveryTimes) > 0) {
+        Decoder.AddFecPacket(FecPacket.GetData(), FecPacket.Num(), Discard);
+      }
+    }
+    Result.DecodeSeconds += FPlatformTime::Seconds() - Start;
+  }
+
+  // Clean packets past the decoder's expiry distance settle the last groups,
+  // so every loss ends up either recovered or counted unrecoverable
+  FMemory::Memzero(Packet, RtpFec::RtpHeaderSize);
+  for (int32 i = 0; i < 256; i++) {
+    RtpFec::WriteUInt16(Packet + 2, (uint16)(NumPackets + i));
+    Decoder.AddMediaPacket(Packet, RtpFec::RtpHeaderSize, Discard);
+  }
+
+  Result.Recovered = Decoder.GetRecoveredCount();
+  Result.Unrecoverable = Decoder.GetUnrecoverableCount();
+  return Result;
+}
+} // namespace
+
+bool BenchmarkScenarios::RunFecRecovery(const FString &Params,
+                                        TSharedRef<FJsonObject> Report) {
+  int32 NumPackets = 100000;
+  FString LossModel = TEXT("Bernoulli");
+  double BurstLength = 2.0;
+  FParse::Value(*Params, TEXT("Packets="), NumPackets);
+  FParse::Value(*Params, TEXT("LossModel="), LossModel);
+  FParse::Value(*Params, TEXT("BurstLength="), BurstLength);
+  const bool bBursty =
+      LossModel.Equals(TEXT("GilbertElliott"), ESearchCase::IgnoreCase);
+
+  const int32 GroupSizes[] = {4, 8, 16};
+  const float LossRates[] = {0.005f, 0.01f, 0.02f, 0.05f, 0.1f};
+
+  TArray<TSharedPtr<FJsonValue>> Results;
+  bool bAllAccounted = true;
+  for (int32 GroupSize : GroupSizes) {
+    for (float LossRate : LossRates) {
+      FImpairmentConfig Link = FImpairmentConfig::FromParams(*Params);
+      if (bBursty) {
+        Link.SetGilbertElliott(LossRate, BurstLength);
+      } else {
+        Link.LossModel = EImpairmentLossModel::Bernoulli;
+        Link.LossRate = LossRate;
+      }
+      const FFecTrialResult Trial = RunTrial(NumPackets, GroupSize, Link);
+      const double ResidualLoss =
+          (double)(Trial.LostPackets - (int64)Trial.Recovered) /
+          FMath::Max(1, Trial.MediaPackets);
+      const bool bAccounted = (int64)(Trial.Recovered + Trial.Unrecoverable) ==
+                              Trial.LostPackets;
+      bAllAccounted &= bAccounted;
+
+      TSharedRef<FJsonObject> Result = MakeShared<FJsonObject>();
+      Result->SetNumberField(TEXT("group_size"), GroupSize);
+      Result->SetNumberField(TEXT("loss_rate"), LossRate);
+      Result->SetNumberField(TEXT("lost"), Trial.LostPackets);
+      Result->SetNumberField(TEXT("recovered"), (double)Trial.Recovered);
+      Result->SetNumberField(TEXT("unrecoverable"),
+                             (double)Trial.Unrecoverable);
+      Result->SetBoolField(TEXT("losses_accounted"), bAccounted);
+      Result->SetNumberField(TEXT("residual_loss_rate"), ResidualLoss);
+      Result->SetNumberField(TEXT("overhead"),
+                             (double)Trial.FecBytes /
+                                 FMath::Max<int64>(1, Trial.MediaBytes));
+      Result->SetNumberField(TEXT("receive_ns_per_packet"),
+                             Trial.DecodeSeconds * 1e9 /
+                                 FMath::Max(1, Trial.MediaPackets));
+      Results.Add(MakeShared<FJsonValueObject>(Result));
+
+      UE_LOG(LogTemp, Display,
+             TEXT("FecRecovery: group %d, loss %.1f%%: lost %d, recovered "
+                  "%llu, unrecoverable %llu, residual %.3f%%"),
+             GroupSize, LossRate * 100.0f, Trial.LostPackets, Trial.Recovered,
+             Trial.Unrecoverable, ResidualLoss * 100.0);
+      if (!bAccounted) {
+        UE_LOG(LogTemp, Error,
+               TEXT("FecRecovery: recovered plus unrecoverable does not "
+                    "match the %d packets lost"),
+               Trial.LostPackets);
+      }
+    }
+  }
+
+  Report->SetNumberField(TEXT("packets"), NumPackets);
+  Report->SetStringField(TEXT("loss_model"), bBursty ? TEXT("GilbertElliott")
+                                                     : TEXT("Bernoulli"));
+  Report->SetNumberField(TEXT("burst_length"), BurstLength);
+  Report->SetArrayField(TEXT("trials"), Results);
+  Report->SetBoolField(TEXT("losses_accounted"), bAllAccounted);
+  return bAllAccounted;
+}
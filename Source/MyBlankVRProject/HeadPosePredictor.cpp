@@ -0,0 +1,198 @@
+#include "HeadPosePredictor.h"
+#include "Misc/FileHelper.h"
+
+void FHeadPosePredictor::FAxis::Reset(double Angle) {
+  State[0] = Angle;
+  State[1] = 0.0;
+  State[2] = 0.0;
+  FMemory::Memzero(Covariance, sizeof(Covariance));
+  // Angle known to the sensor's accuracy; rate and acceleration unknown
+  Covariance[0][0] = 0.01;
+  Covariance[1][1] = 1e4;
+  Covariance[2][2] = 1e6;
+  Measured = Angle;
+}
+
+void FHeadPosePredictor::FAxis::Update(const FHeadPosePredictorConfig &Config,
+                                       double Dt, double Angle) {
+  Measured = Angle;
+  if (Config.Model != EHeadPosePredictionModel::Kalman) {
+    const double Alpha = Dt / (Dt + Config.SmoothingSeconds);
+    const double PreviousRate = State[1];
+    State[1] += Alpha * ((Angle - State[0]) / Dt - State[1]);
+    State[2] += Alpha * ((State[1] - PreviousRate) / Dt - State[2]);
+    State[0] = Angle;
+    return;
+  }
+
+  // Predict: constant acceleration over Dt, white jerk as process noise
+  const double Dt2 = Dt * Dt;
+  const double Dt3 = Dt2 * Dt;
+  const double F[3][3] = {{1.0, Dt, Dt2 / 2.0}, {0.0, 1.0, Dt}, {0.0, 0.0, 1.0}};
+  const double Q = Config.JerkNoise;
+  const double Noise[3][3] = {
+      {Q * Dt3 * Dt2 / 20.0, Q * Dt2 * Dt2 / 8.0, Q * Dt3 / 6.0},
+      {Q * Dt2 * Dt2 / 8.0, Q * Dt3 / 3.0, Q * Dt2 / 2.0},
+      {Q * Dt3 / 6.0, Q * Dt2 / 2.0, Q * Dt},
+  };
+
+  double Predicted[3];
+  for (int32 i = 0; i < 3; i++) {
+    Predicted[i] = F[i][0] * State[0] + F[i][1] * State[1] + F[i][2] * State[2];
+  }
+  double FP[3][3];
+  for (int32 i = 0; i < 3; i++) {
+    for (int32 j = 0; j < 3; j++) {
+      FP[i][j] = F[i][0] * Covariance[0][j] + F[i][1] * Covariance[1][j] +
+                 F[i][2] * Covariance[2][j];
+    }
+  }
+  for (int32 i = 0; i < 3; i++) {
+    for (int32 j = 0; j < 3; j++) {
+      Covariance[i][j] = FP[i][0] * F[j][0] + FP[i][1] * F[j][1] +
+                         FP[i][2] * F[j][2] + Noise[i][j];
+    }
+  }
+
+  // Correct with the measured angle
+  const double Innovation = Angle - Predicted[0];
+  const double InnovationVariance = Covariance[0][0] + Config.MeasurementNoise;
+  double Gain[3];
+  for (int32 i = 0; i < 3; i++) {
+    Gain[i] = Covariance[i][0] / InnovationVariance;
+    State[i] = Predicted[i] + Gain[i] * Innovation;
+  }
+  const double Row0[3] = {Covariance[0][0], Covariance[0][1],
+                          Covariance[0][2]};
+  for (int32 i = 0; i < 3; i++) {
+    for (int32 j = 0; j < 3; j++) {
+      Covariance[i][j] -= Gain[i] * Row0[j];
+    }
+  }
+}
+
+double FHeadPosePredictor::FAxis::Lead(const FHeadPosePredictorConfig &Config,
+                                       double Horizon) const {
+  switch (Config.Model) {
+  case EHeadPosePredictionModel::ConstantVelocity:
+    return State[1] * Horizon;
+  case EHeadPosePredictionModel::ConstantAcceleration:
+    return State[1] * Horizon + State[2] * Horizon * Horizon / 2.0;
+  case EHeadPosePredictionModel::Kalman:
+    return State[0] - Measured + State[1] * Horizon +
+           State[2] * Horizon * Horizon / 2.0;
+  default:
+    return 0.0;
+  }
+}
+
+double FHeadPosePredictor::FAxis::Rate(const FHeadPosePredictorConfig &Config,
+                                       double Horizon) const {
+  switch (Config.Model) {
+  case EHeadPosePredictionModel::ConstantVelocity:
+    return State[1];
+  case EHeadPosePredictionModel::ConstantAcceleration:
+  case EHeadPosePredictionModel::Kalman:
+    return State[1] + State[2] * Horizon;
+  default:
+    return 0.0;
+  }
+}
+
+FHeadPosePredictor::FHeadPosePredictor(
+    const FHeadPosePredictorConfig &InConfig)
+    : Config(InConfig), bHaveSample(false) {}
+
+void FHeadPosePredictor::SetConfig(const FHeadPosePredictorConfig &InConfig) {
+  Config = InConfig;
+  Reset();
+}
+
+void FHeadPosePredictor::Reset() { bHaveSample = false; }
+
+void FHeadPosePredictor::AddSample(const FHeadPoseSample &Sample) {
+  if (!bHaveSample) {
+    bHaveSample = true;
+    Newest = Sample;
+    Pitch.Reset(Sample.Pitch);
+    Yaw.Reset(Sample.Yaw);
+    return;
+  }
+  if (Sample.TimeUs <= Newest.TimeUs) {
+    return;
+  }
+  const double Dt = (Sample.TimeUs - Newest.TimeUs) / 1e6;
+  Newest = Sample;
+  Pitch.Update(Config, Dt, Sample.Pitch);
+  Yaw.Update(Config, Dt, Sample.Yaw);
+}
+
+double FHeadPosePredictor::ClampHorizon(double HorizonSeconds) const {
+  return FMath::Clamp(HorizonSeconds, 0.0, Config.MaxHorizonSeconds);
+}
+
+FHeadPoseSample FHeadPosePredictor::Predict(double HorizonSeconds) const {
+  if (!bHaveSample || Config.Model == EHeadPosePredictionModel::None) {
+    return Newest;
+  }
+  const double Horizon = ClampHorizon(HorizonSeconds);
+  const double MaxLead = Config.MaxLeadDegrees;
+  FHeadPoseSample Predicted = Newest;
+  Predicted.TimeUs += (int64)(Horizon * 1e6);
+  Predicted.Pitch +=
+      (float)FMath::Clamp(Pitch.Lead(Config, Horizon), -MaxLead, MaxLead);
+  Predicted.Yaw +=
+      (float)FMath::Clamp(Yaw.Lead(Config, Horizon), -MaxLead, MaxLead);
+  return Predicted;
+}
+
+float FHeadPosePredictor::GetPitchRate(double HorizonSeconds) const {
+  return bHaveSample ? (float)Pitch.Rate(Config, ClampHorizon(HorizonSeconds))
+                     : 0.0f;
+}
+
+float FHeadPosePredictor::GetYawRate(double HorizonSeconds) const {
+  return bHaveSample ? (float)Yaw.Rate(Config, ClampHorizon(HorizonSeconds))
+                     : 0.0f;
+}
+
+bool HeadMotionTrace::Save(const FString &Path,
+                           const TArray<FHeadPoseSample> &Samples) {
+  TArray<FString> Lines;
+  Lines.Reserve(Samples.Num() + 1);
+  Lines.Add(TEXT("time_us,pitch_deg,yaw_deg"));
+  for (const FHeadPoseSample &Sample : Samples) {
+    Lines.Add(FString::Printf(TEXT("%lld,%.4f,%.4f"), (long long)Sample.TimeUs,
+                              Sample.Pitch, Sample.Yaw));
+  }
+  if (!FFileHelper::SaveStringArrayToFile(Lines, *Path)) {
+    UE_LOG(LogTemp, Warning, TEXT("Could not write head motion trace %s"),
+           *Path);
+    return false;
+  }
+  return true;
+}
+
+bool HeadMotionTrace::Load(const FString &Path,
+                           TArray<FHeadPoseSample> &OutSamples) {
+  TArray<FString> Lines;
+  if (!FFileHelper::LoadFileToStringArray(Lines, *Path)) {
+    UE_LOG(LogTemp, Error, TEXT("Could not read head motion trace %s"), *Path);
+    return false;
+  }
+  OutSamples.Reset();
+  TArray<FString> Fields;
+  for (const FString &Line : Lines) {
+    if (Line.ParseIntoArray(Fields, TEXT(",")) != 3 ||
+        !FChar::IsDigit(Fields[0][0])) {
+      // Header or blank line
+      continue;
+    }
+    FHeadPoseSample Sample;
+    Sample.TimeUs = FCString::Atoi64(*Fields[0]);
+    Sample.Pitch = FCString::Atof(*Fields[1]);
+    Sample.Yaw = FCString::Atof(*Fields[2]);
+    OutSamples.Add(Sample);
+  }
+  return OutSamples.Num() > 0;
+}
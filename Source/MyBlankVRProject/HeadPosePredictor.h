@@ -0,0 +1,99 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "HeadPosePredictor.generated.h"
+
+UENUM(BlueprintType)
+enum class EHeadPosePredictionModel : uint8 {
+  // Send the pose as sampled
+  None,
+  // Extrapolate along the smoothed angular rate
+  ConstantVelocity,
+  // Also follow the smoothed angular acceleration: leads further into a
+  // turn, overshoots more where it stops
+  ConstantAcceleration,
+  // Per-axis Kalman filter over angle, rate and acceleration, driven by
+  // white jerk
+  Kalman,
+};
+
+struct FHeadPosePredictorConfig {
+  EHeadPosePredictionModel Model = EHeadPosePredictionModel::Kalman;
+  // Look-ahead is capped here whatever latency is measured
+  double MaxHorizonSeconds = 0.15;
+  // Largest lead over the sampled pose, per axis, so a misprediction is
+  // bounded
+  float MaxLeadDegrees = 15.0f;
+  // Time constant of the rate and acceleration smoothing for the constant
+  // velocity and acceleration models
+  double SmoothingSeconds = 0.02;
+  // Kalman: jerk spectral density in deg^2/s^5 and measurement variance in
+  // deg^2
+  double JerkNoise = 1e7;
+  double MeasurementNoise = 0.01;
+};
+
+// Head orientation at one instant, angles unwrapped
+struct FHeadPoseSample {
+  // ClockSync::NowMicros() time base
+  int64 TimeUs = 0;
+  float Pitch = 0.0f;
+  float Yaw = 0.0f;
+};
+
+// Predicts where the head will point once a command sent now takes effect
+// on the gimbal, from the stream of sampled orientations. Game thread only.
+class MYBLANKVRPROJECT_API FHeadPosePredictor {
+public:
+  explicit FHeadPosePredictor(
+      const FHeadPosePredictorConfig &InConfig = FHeadPosePredictorConfig());
+
+  void SetConfig(const FHeadPosePredictorConfig &InConfig);
+  const FHeadPosePredictorConfig &GetConfig() const { return Config; }
+
+  void Reset();
+
+  // Samples must come in time order; a sample no newer than the last is
+  // ignored
+  void AddSample(const FHeadPoseSample &Sample);
+
+  // Orientation HorizonSeconds after the newest sample, clamped to the
+  // configured horizon and lead. The newest sample as is for the None model
+  // or before any sample.
+  FHeadPoseSample Predict(double HorizonSeconds) const;
+
+  // Estimated degrees per second at the predicted instant
+  float GetPitchRate(double HorizonSeconds) const;
+  float GetYawRate(double HorizonSeconds) const;
+
+private:
+  // One angle's estimate. The smoothing models keep finite differences in
+  // State; the Kalman model keeps its state and covariance.
+  struct FAxis {
+    double State[3];
+    double Covariance[3][3];
+    double Measured;
+
+    void Reset(double Angle);
+    void Update(const FHeadPosePredictorConfig &Config, double Dt,
+                double Angle);
+    double Lead(const FHeadPosePredictorConfig &Config, double Horizon) const;
+    double Rate(const FHeadPosePredictorConfig &Config, double Horizon) const;
+  };
+
+  double ClampHorizon(double HorizonSeconds) const;
+
+  FHeadPosePredictorConfig Config;
+  bool bHaveSample;
+  FHeadPoseSample Newest;
+  FAxis Pitch;
+  FAxis Yaw;
+};
+
+namespace HeadMotionTrace {
+// CSV with a time_us,pitch_deg,yaw_deg header, one sample per line
+MYBLANKVRPROJECT_API bool Save(const FString &Path,
+                               const TArray<FHeadPoseSample> &Samples);
+MYBLANKVRPROJECT_API bool Load(const FString &Path,
+                               TArray<FHeadPoseSample> &OutSamples);
+} // namespace HeadMotionTrace
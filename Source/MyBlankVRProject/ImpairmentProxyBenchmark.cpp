@@ -0,0 +1,71 @@
+#include "BenchmarkScenarios.h"
+#include "HAL/RunnableThread.h"
+#include "NetworkImpairmentProxy.h"
+
+namespace {
+TSharedRef<FJsonObject> StatsToJson(const FImpairmentStats &Stats) {
+  TSharedRef<FJsonObject> Json = MakeShared<FJsonObject>();
+  Json->SetNumberField(TEXT("packets"), (double)Stats.Packets);
+  Json->SetNumberField(TEXT("delivered"), (double)Stats.Delivered);
+  Json->SetNumberField(TEXT("lost"), (double)Stats.Lost);
+  Json->SetNumberField(TEXT("queue_dropped"), (double)Stats.QueueDropped);
+  Json->SetNumberField(TEXT("duplicated"), (double)Stats.Duplicated);
+  Json->SetNumberField(TEXT("reordered"), (double)Stats.Reordered);
+  return Json;
+}
+} // namespace
+
+bool BenchmarkScenarios::RunImpairmentProxy(const FString &Params,
+                                            TSharedRef<FJsonObject> Report) {
+  int32 ListenPort = 5253;
+  FString UpstreamString = TEXT("127.0.0.1:15253");
+  double Duration = 60.0;
+  FParse::Value(*Params, TEXT("ListenPort="), ListenPort);
+  FParse::Value(*Params, TEXT("Upstream="), UpstreamString);
+  FParse::Value(*Params, TEXT("Duration="), Duration);
+
+  FIPv4Endpoint Upstream;
+  if (!FIPv4Endpoint::Parse(UpstreamString, Upstream)) {
+    UE_LOG(LogTemp, Error, TEXT("ImpairmentProxy: bad -Upstream=%s"),
+           *UpstreamString);
+    return false;
+  }
+
+  // Unprefixed keys configure the forward direction, Reverse.* the replies
+  const FImpairmentConfig Forward = FImpairmentConfig::FromParams(*Params);
+  const FImpairmentConfig Reverse =
+      FImpairmentConfig::FromParams(*Params, TEXT("Reverse."));
+
+  FNetworkImpairmentProxy Proxy(ListenPort, Upstream, Forward, Reverse);
+  if (!Proxy.OpenSockets()) {
+    UE_LOG(LogTemp, Error,
+           TEXT("ImpairmentProxy: cannot open port %d, no proxy running"),
+           ListenPort);
+    return false;
+  }
+  FRunnableThread *Thread =
+      FRunnableThread::Create(&Proxy, TEXT("ImpairmentProxyThread"));
+  if (!Thread) {
+    return false;
+  }
+
+  const double End = FPlatformTime::Seconds() + Duration;
+  while (FPlatformTime::Seconds() < End) {
+    FPlatformProcess::Sleep(1.0f);
+    const FImpairmentStats Stats = Proxy.GetForwardStats();
+    UE_LOG(LogTemp, Display,
+           TEXT("ImpairmentProxy: %llu packets, %llu lost, %llu queue "
+                "dropped, %llu reordered"),
+           Stats.Packets, Stats.Lost, Stats.QueueDropped, Stats.Reordered);
+  }
+
+  Proxy.Stop();
+  Thread->WaitForCompletion();
+  delete Thread;
+
+  Report->SetStringField(TEXT("forward_config"), Forward.ToString());
+  Report->SetStringField(TEXT("reverse_config"), Reverse.ToString());
+  Report->SetObjectField(TEXT("forward"), StatsToJson(Proxy.GetForwardStats()));
+  Report->SetObjectField(TEXT("reverse"), StatsToJson(Proxy.GetReverseStats()));
+  return true;
+}
@@ -0,0 +1,475 @@
+#include "BenchmarkScenarios.h"
+#include "CameraDataStreamer.h"
+#include "ClockSync.h"
+#include "ControlWireProtocol.h"
+#include "HAL/PlatformProcess.h"
+#include "HAL/PlatformTime.h"
+#include "HAL/Runnable.h"
+#include "HAL/RunnableThread.h"
+#include "Math/RandomStream.h"
+#include "PipelineMetrics.h"
+#include "SpscValueChannel.h"
+
+extern "C" {
+#include <libavutil/frame.h>
+#include <libavutil/imgutils.h>
+#include <libavutil/mem.h>
+#include <libswscale/swscale.h>
+}
+
+namespace {
+struct FKernelSettings {
+  int32 Batches = 25;
+  double BatchSeconds = 0.02;
+  FString Filter;
+};
+
+// Kernel results go here so the optimizer cannot drop the work
+std::atomic<uint64> Sink{0};
+
+void Keep(uint64 Value) { Sink.fetch_add(Value, std::memory_order_relaxed); }
+
+// A kernel runs Ops back-to-back operations per call
+using FKernelFunc = TFunctionRef<void(int32 Ops)>;
+
+// Sizes a batch to take about BatchSeconds, drops two batches of warm-up,
+// and returns nanoseconds per op of each timed batch. Batches long enough
+// to swamp timer resolution, summarized by median and MAD, keep the numbers
+// comparable between runs on a busy machine.
+FBenchmarkSamples TimeKernel(FKernelFunc Kernel,
+                             const FKernelSettings &Settings,
+                             int32 &OutBatchOps) {
+  int32 Ops = 1;
+  for (;;) {
+    const double Start = FPlatformTime::Seconds();
+    Kernel(Ops);
+    const double Elapsed = FPlatformTime::Seconds() - Start;
+    if (Elapsed >= Settings.BatchSeconds / 4.0 || Ops >= (1 << 28)) {
+      Ops = FMath::Max(1, (int32)(Ops * Settings.BatchSeconds /
+                                  FMath::Max(Elapsed, 1e-9)));
+      break;
+    }
+    Ops *= 2;
+  }
+
+  FBenchmarkSamples NsPerOp;
+  for (int32 Batch = -2; Batch < Settings.Batches; Batch++) {
+    const double Start = FPlatformTime::Seconds();
+    Kernel(Ops);
+    const double Elapsed = FPlatformTime::Seconds() - Start;
+    if (Batch >= 0) {
+      NsPerOp.Add(Elapsed * 1e9 / Ops);
+    }
+  }
+  OutBatchOps = Ops;
+  return NsPerOp;
+}
+
+class FKernelReport {
+public:
+  explicit FKernelReport(const FKernelSettings &InSettings)
+      : Settings(InSettings) {}
+
+  bool Wants(const FString &Name) const {
+    return Settings.Filter.IsEmpty() || Name.Contains(Settings.Filter);
+  }
+
+  // BytesPerOp adds throughput for kernels that move memory
+  void Run(const FString &Name, FKernelFunc Kernel, int64 BytesPerOp = 0) {
+    if (!Wants(Name)) {
+      return;
+    }
+    int32 BatchOps = 0;
+    const FBenchmarkSamples NsPerOp = TimeKernel(Kernel, Settings, BatchOps);
+    Add(Name, NsPerOp, BatchOps, BytesPerOp);
+  }
+
+  // Samples measured by the kernel itself, one per op
+  void Add(const FString &Name, const FBenchmarkSamples &NsPerOp,
+           int32 BatchOps, int64 BytesPerOp = 0) {
+    const double Median = NsPerOp.Percentile(50.0);
+    const double Mad = NsPerOp.MedianAbsoluteDeviation();
+    TSharedRef<FJsonObject> Json = MakeShared<FJsonObject>();
+    Json->SetStringField(TEXT("name"), Name);
+    Json->SetNumberField(TEXT("ns_median"), Median);
+    Json->SetNumberField(TEXT("ns_mad"), Mad);
+    Json->SetNumberField(TEXT("ns_min"), NsPerOp.Percentile(0.0));
+    Json->SetNumberField(TEXT("ns_p95"), NsPerOp.Percentile(95.0));
+    Json->SetNumberField(TEXT("samples"), NsPerOp.Num());
+    Json->SetNumberField(TEXT("ops_per_sample"), BatchOps);
+    if (BytesPerOp > 0 && Median > 0.0) {
+      Json->SetNumberField(TEXT("gb_per_s"), BytesPerOp / Median);
+    }
+    Results.Add(MakeShared<FJsonValueObject>(Json));
+
+    UE_LOG(LogTemp, Display, TEXT("  %-32s %12.1f ns  +- %6.2f%%"), *Name,
+           Median, Median > 0.0 ? Mad / Median * 100.0 : 0.0);
+  }
+
+  TArray<TSharedPtr<FJsonValue>> Results;
+
+private:
+  const FKernelSettings &Settings;
+};
+
+// FFmpegWorker::Run's conversion of a decoded YUV 4:2:0 frame into the
+// BGRA texture buffer, at the decoded and texture sizes given
+void RunConvertKernels(FKernelReport &Report) {
+  struct FConvertSize {
+    int32 SrcWidth, SrcHeight, DstWidth, DstHeight;
+  };
+  // The default mono texture, the stand-in's stream scaled up into it, a
+  // side-by-side stereo pair, and full HD
+  const FConvertSize Sizes[] = {
+      {854, 480, 854, 480},
+      {640, 360, 854, 480},
+      {1708, 480, 1708, 480},
+      {1920, 1080, 1920, 1080},
+  };
+  for (const FConvertSize &Size : Sizes) {
+    const FString Name =
+        Size.SrcWidth == Size.DstWidth && Size.SrcHeight == Size.DstHeight
+            ? FString::Printf(TEXT("convert_bgra_%dx%d"), Size.DstWidth,
+                              Size.DstHeight)
+            : FString::Printf(TEXT("convert_bgra_%dx%d_to_%dx%d"),
+                              Size.SrcWidth, Size.SrcHeight, Size.DstWidth,
+                              Size.DstHeight);
+    if (!Report.Wants(Name)) {
+      continue;
+    }
+
+    AVFrame *Frame = av_frame_alloc();
+    Frame->format = AV_PIX_FMT_YUV420P;
+    Frame->width = Size.SrcWidth;
+    Frame->height = Size.SrcHeight;
+    av_frame_get_buffer(Frame, 0);
+    // Smooth gradients, like camera content, rather than flat planes
+    for (int32 Plane = 0; Plane < 3; Plane++) {
+      const int32 Rows = Plane == 0 ? Size.SrcHeight : Size.SrcHeight / 2;
+      const int32 Cols = Plane == 0 ? Size.SrcWidth : Size.SrcWidth / 2;
+      for (int32 Y = 0; Y < Rows; Y++) {
+        uint8 *Row = Frame->data[Plane] + Y * Frame->linesize[Plane];
+        for (int32 X = 0; X < Cols; X++) {
+          Row[X] = (uint8)(X + Y * (Plane + 1));
+        }
+      }
+    }
+
+    SwsContext *Context = sws_getContext(
+        Size.SrcWidth, Size.SrcHeight, AV_PIX_FMT_YUV420P, Size.DstWidth,
+        Size.DstHeight, AV_PIX_FMT_BGRA, SWS_BILINEAR, nullptr, nullptr,
+        nullptr);
+    const int32 NumBytes = av_image_get_buffer_size(
+        AV_PIX_FMT_BGRA, Size.DstWidth, Size.DstHeight, 1);
+    uint8 *Buffer = (uint8 *)av_malloc(NumBytes);
+    if (Context && Buffer) {
+      Report.Run(
+          Name,
+          [&](int32 Ops) {
+            for (int32 i = 0; i < Ops; i++) {
+              uint8_t *DestData[4] = {nullptr};
+              int DestLinesize[4] = {0};
+              av_image_fill_arrays(DestData, DestLinesize, Buffer,
+                                   AV_PIX_FMT_BGRA, Size.DstWidth,
+                                   Size.DstHeight, 1);
+              sws_scale(Context, Frame->data, Frame->linesize, 0,
+                        Size.SrcHeight, DestData, DestLinesize);
+            }
+            Keep(Buffer[NumBytes / 2]);
+          },
+          NumBytes);
+    } else {
+      UE_LOG(LogTemp, Error, TEXT("Kernels: %s: could not set up swscale"),
+             *Name);
+    }
+    av_free(Buffer);
+    sws_freeContext(Context);
+    av_frame_free(&Frame);
+  }
+}
+
+// The two copies every BGRA frame takes on its way to the texture: out of
+// the decoder thread into a fresh buffer (FFmpegWorker::GetLatestFrame),
+// and into the texture's mip (ADynamicTextureActor::UpdateTexture)
+void RunCopyKernels(FKernelReport &Report) {
+  const FIntPoint Sizes[] = {{854, 480}, {1708, 480}, {1920, 1080}};
+  for (const FIntPoint &Size : Sizes) {
+    const int32 NumBytes = Size.X * Size.Y * 4;
+    TArray<uint8> Source;
+    Source.SetNumUninitialized(NumBytes);
+    for (int32 i = 0; i < NumBytes; i++) {
+      Source[i] = (uint8)i;
+    }
+
+    Report.Run(
+        FString::Printf(TEXT("frame_handoff_copy_%dx%d"), Size.X, Size.Y),
+        [&](int32 Ops) {
+          for (int32 i = 0; i < Ops; i++) {
+            uint8 *Copy = (uint8 *)av_malloc(NumBytes);
+            FMemory::Memcpy(Copy, Source.GetData(), NumBytes);
+            Keep(Copy[i % NumBytes]);
+            av_free(Copy);
+          }
+        },
+        NumBytes);
+
+    TArray<uint8> Mip;
+    Mip.SetNumUninitialized(NumBytes);
+    Report.Run(
+        FString::Printf(TEXT("texture_copy_%dx%d"), Size.X, Size.Y),
+        [&](int32 Ops) {
+          for (int32 i = 0; i < Ops; i++) {
+            FMemory::Memcpy(Mip.GetData(), Source.GetData(), NumBytes);
+          }
+          Keep(Mip[NumBytes / 2]);
+        },
+        NumBytes);
+  }
+}
+
+// What the control link's I/O thread does per send and per robot reply
+void RunControlWireKernels(FKernelReport &Report) {
+  FRandomStream Random(7);
+  ControlWire::FControlPayload Samples[ControlWire::MaxBundleSamples];
+  for (ControlWire::FControlPayload &Sample : Samples) {
+    Sample.Pitch = Random.FRandRange(-90.0f, 90.0f);
+    Sample.Yaw = Random.FRandRange(-720.0f, 720.0f);
+    Sample.TriggerPosition = Random.FRand();
+    Sample.ThumbstickX = Random.FRandRange(-1.0f, 1.0f);
+  }
+
+  // A single sample, and a bundle carrying the most redundancy allowed
+  const int32 Counts[] = {1, ControlWire::MaxBundleSamples};
+  for (int32 Count : Counts) {
+    uint8 Packet[ControlWire::MaxPacketSize];
+    const int32 Size = ControlWire::EncodeControlBundle(
+        1, 1000, Samples, Count, Packet, sizeof(Packet));
+
+    Report.Run(FString::Printf(TEXT("control_encode_%d"), Count),
+               [&](int32 Ops) {
+                 for (int32 i = 0; i < Ops; i++) {
+                   Keep(ControlWire::EncodeControlBundle(
+                       (uint32)i, (uint64)i * 4000, Samples, Count, Packet,
+                       sizeof(Packet)));
+                 }
+               });
+
+    Report.Run(FString::Printf(TEXT("control_decode_%d"), Count),
+               [&](int32 Ops) {
+                 ControlWire::FHeader Header;
+                 ControlWire::FControlPayload
+                     Decoded[ControlWire::MaxBundleSamples];
+                 for (int32 i = 0; i < Ops; i++) {
+                   if (ControlWire::DecodeHeader(Packet, Size, Header)) {
+                     Keep(ControlWire::DecodeControlBundle(Packet, Size,
+                                                           Decoded));
+                   }
+                 }
+               });
+
+    Report.Run(FString::Printf(TEXT("crc32c_%d_bytes"), Size),
+               [&](int32 Ops) {
+                 uint32 Crc = 0;
+                 for (int32 i = 0; i < Ops; i++) {
+                   Crc = ControlWire::Crc32c(Packet, Size, Crc);
+                 }
+                 Keep(Crc);
+               },
+               Size);
+  }
+}
+
+// FClockSyncEstimator taking a sync reply with a full window, which refits
+// the offset and drift, and the per-frame mapping of capture times
+void RunClockKernels(FKernelReport &Report) {
+  // Round trips of 1-5 ms with the odd queueing spike, against a robot
+  // clock 50 ppm fast and a second ahead
+  FRandomStream Random(11);
+  TArray<int64> RttUs;
+  for (int32 i = 0; i < 1024; i++) {
+    RttUs.Add(Random.RandRange(1000, 5000) +
+              (Random.FRand() < 0.05f ? Random.RandRange(0, 40000) : 0));
+  }
+
+  FClockSyncEstimator Estimator;
+  int64 LocalUs = 1000000;
+  auto AddSample = [&]() {
+    const int64 Rtt = RttUs[LocalUs / 100000 % RttUs.Num()];
+    const int64 T1 = LocalUs;
+    const int64 T2 = T1 + Rtt / 2 + 1000000 + (int64)(T1 * 50e-6);
+    const int64 T3 = T2 + 50;
+    const int64 T4 = T1 + Rtt + 50;
+    Estimator.AddSample(T1, T2, T3, T4);
+    // Sync replies every 100 ms
+    LocalUs += 100000;
+  };
+  for (int32 i = 0; i < FClockSyncEstimator::WindowSize; i++) {
+    AddSample();
+  }
+
+  Report.Run(TEXT("clock_add_sample"), [&](int32 Ops) {
+    for (int32 i = 0; i < Ops; i++) {
+      AddSample();
+    }
+    Keep(Estimator.GetEstimate().OffsetUs);
+  });
+
+  const FClockEstimate Estimate = Estimator.GetEstimate();
+  Report.Run(TEXT("clock_to_local"), [&](int32 Ops) {
+    int64 Sum = 0;
+    for (int32 i = 0; i < Ops; i++) {
+      Sum += Estimate.ToLocalUs(LocalUs + i * 11111);
+    }
+    Keep(Sum);
+  });
+}
+
+// What the pipeline pays per metric update, before and after the first
+// scrape turns histograms on, and what a scrape costs the endpoint thread.
+// Uses the process's own metrics, leaving them collecting.
+void RunMetricsKernels(FKernelReport &Report) {
+  Report.Run(TEXT("metrics_counter_add"), [&](int32 Ops) {
+    for (int32 i = 0; i < Ops; i++) {
+      PipelineMetrics::FramesDecoded.Add(1);
+    }
+    Keep(PipelineMetrics::FramesDecoded.Get());
+  });
+
+  // Round trips spread over the buckets, labelled as a loopback robot so the
+  // scrape below carries one link's series
+  const int32 Link = PipelineMetrics::ClaimLink(0x7f000001);
+  auto ObserveRtts = [&](int32 Ops) {
+    for (int32 i = 0; i < Ops; i++) {
+      PipelineMetrics::ControlRtt.Observe(Link, 1000 + (i & 1023) * 97);
+    }
+    Keep(Ops);
+  };
+  if (!PipelineMetrics::IsCollecting()) {
+    Report.Run(TEXT("metrics_histogram_idle"), ObserveRtts);
+  }
+  PipelineMetrics::StartCollecting();
+  Report.Run(TEXT("metrics_histogram_observe"), ObserveRtts);
+
+  Report.Run(TEXT("metrics_export_text"), [&](int32 Ops) {
+    for (int32 i = 0; i < Ops; i++) {
+      Keep(PipelineMetrics::ExportText().Len());
+    }
+  });
+  PipelineMetrics::ReleaseLink(Link);
+}
+
+struct FStampedSample {
+  uint64 PushedCycles;
+  FRobotControlData Sample;
+};
+
+using FStampedChannel = TSpscValueChannel<FStampedSample, 64>;
+
+// Pushes a stamped sample every IntervalUs, as the game thread hands
+// control to the I/O thread, spinning between pushes so it is never
+// descheduled when a push is due
+class FHandoffProducer : public FRunnable {
+public:
+  FHandoffProducer(FStampedChannel &InChannel, int32 InCount,
+                   double InIntervalUs)
+      : Channel(InChannel), Count(InCount), IntervalUs(InIntervalUs) {}
+
+  virtual uint32 Run() override {
+    double Next = FPlatformTime::Seconds();
+    for (int32 i = 0; i < Count; i++) {
+      while (FPlatformTime::Seconds() < Next) {
+        FPlatformProcess::YieldCycles(100);
+      }
+      Next += IntervalUs * 1e-6;
+      FStampedSample Value;
+      Value.Sample = FRobotControlData((float)i, (float)i, 0.5f, 0.0f);
+      Value.PushedCycles = FPlatformTime::Cycles64();
+      Channel.Push(Value);
+    }
+    bDone = true;
+    return 0;
+  }
+
+  std::atomic<bool> bDone{false};
+
+private:
+  FStampedChannel &Channel;
+  const int32 Count;
+  const double IntervalUs;
+};
+
+// Same-thread cost of a channel push and pop, then the latency of a value
+// crossing between two threads through it. The consumer spins, so the
+// latency needs two free cores; on one it measures the scheduler.
+void RunHandoffKernels(FKernelReport &Report, int32 HandoffCount) {
+  FStampedChannel Channel;
+  Report.Run(TEXT("spsc_push_pop"), [&](int32 Ops) {
+    FStampedSample Value = {};
+    for (int32 i = 0; i < Ops; i++) {
+      Value.PushedCycles = i;
+      Channel.Push(Value);
+      Channel.PopLatest(Value);
+    }
+    Keep(Value.PushedCycles);
+  });
+
+  const FString Name = TEXT("spsc_handoff_latency");
+  if (!Report.Wants(Name)) {
+    return;
+  }
+  FStampedChannel CrossChannel;
+  FHandoffProducer Producer(CrossChannel, HandoffCount, 50.0);
+  FRunnableThread *Thread =
+      FRunnableThread::Create(&Producer, TEXT("KernelsHandoffProducer"));
+  if (!Thread) {
+    UE_LOG(LogTemp, Error, TEXT("Kernels: could not start producer thread"));
+    return;
+  }
+  const double NsPerCycle = FPlatformTime::GetSecondsPerCycle64() * 1e9;
+  FBenchmarkSamples LatencyNs;
+  FStampedSample Value;
+  while (!Producer.bDone || CrossChannel.GetProducedCount() >
+                                CrossChannel.GetConsumedCount() +
+                                    CrossChannel.GetOverwrittenCount()) {
+    if (CrossChannel.PopLatest(Value)) {
+      LatencyNs.Add((FPlatformTime::Cycles64() - Value.PushedCycles) *
+                    NsPerCycle);
+    }
+  }
+  Thread->WaitForCompletion();
+  delete Thread;
+  Report.Add(Name, LatencyNs, 1);
+}
+} // namespace
+
+bool BenchmarkScenarios::RunKernels(const FString &Params,
+                                    TSharedRef<FJsonObject> Report) {
+  FKernelSettings Settings;
+  double BatchMs = Settings.BatchSeconds * 1000.0;
+  int32 HandoffCount = 20000;
+  FParse::Value(*Params, TEXT("Batches="), Settings.Batches);
+  FParse::Value(*Params, TEXT("BatchMs="), BatchMs);
+  FParse::Value(*Params, TEXT("Filter="), Settings.Filter);
+  FParse::Value(*Params, TEXT("Handoffs="), HandoffCount);
+  Settings.Batches = FMath::Max(Settings.Batches, 1);
+  Settings.BatchSeconds = FMath::Max(BatchMs, 0.1) / 1000.0;
+
+  UE_LOG(LogTemp, Display,
+         TEXT("Kernels: %d batches of %.1f ms each, median ns per op and "
+              "MAD"),
+         Settings.Batches, Settings.BatchSeconds * 1000.0);
+
+  FKernelReport Kernels(Settings);
+  RunConvertKernels(Kernels);
+  RunCopyKernels(Kernels);
+  RunControlWireKernels(Kernels);
+  RunClockKernels(Kernels);
+  RunMetricsKernels(Kernels);
+  RunHandoffKernels(Kernels, HandoffCount);
+
+  Report->SetNumberField(TEXT("batches"), Settings.Batches);
+  Report->SetNumberField(TEXT("batch_ms"), Settings.BatchSeconds * 1000.0);
+  Report->SetStringField(TEXT("filter"), Settings.Filter);
+  Report->SetArrayField(TEXT("kernels"), Kernels.Results);
+  return Kernels.Results.Num() > 0;
+}
@@ -0,0 +1,181 @@
+#include "MetricsEndpoint.h"
+#include "HAL/PlatformTime.h"
+#include "HAL/RunnableThread.h"
+#include "Misc/ScopeLock.h"
+#include "PipelineMetrics.h"
+#include "SocketSubsystem.h"
+#include "Sockets.h"
+
+namespace {
+// Longest the accept wait blocks, bounding how long Stop() waits
+constexpr double AcceptWaitSeconds = 0.1;
+// A client gets this long to send its request line and headers
+constexpr double RequestTimeoutSeconds = 1.0;
+constexpr int32 MaxRequestBytes = 4096;
+
+FCriticalSection InstanceLock;
+TWeakPtr<FMetricsEndpoint, ESPMode::ThreadSafe> Instance;
+
+bool SendAll(FSocket &Socket, const uint8 *Data, int32 Size) {
+  while (Size > 0) {
+    int32 Sent = 0;
+    if (!Socket.Send(Data, Size, Sent) || Sent <= 0) {
+      return false;
+    }
+    Data += Sent;
+    Size -= Sent;
+  }
+  return true;
+}
+
+void Respond(FSocket &Socket, const TCHAR *Status, const TCHAR *ContentType,
+             const FString &Body) {
+  FTCHARToUTF8 BodyUtf8(*Body);
+  const FString Header = FString::Printf(
+      TEXT("HTTP/1.1 %s\r\nContent-Type: %s\r\nContent-Length: %d\r\n"
+           "Connection: close\r\n\r\n"),
+      Status, ContentType, BodyUtf8.Length());
+  FTCHARToUTF8 HeaderUtf8(*Header);
+  if (SendAll(Socket, (const uint8 *)HeaderUtf8.Get(), HeaderUtf8.Length())) {
+    SendAll(Socket, (const uint8 *)BodyUtf8.Get(), BodyUtf8.Length());
+  }
+}
+} // namespace
+
+TSharedPtr<FMetricsEndpoint, ESPMode::ThreadSafe>
+FMetricsEndpoint::Acquire(int32 Port) {
+  FScopeLock Lock(&InstanceLock);
+  TSharedPtr<FMetricsEndpoint, ESPMode::ThreadSafe> Endpoint = Instance.Pin();
+  if (!Endpoint) {
+    Endpoint = MakeShareable(new FMetricsEndpoint(Port));
+    if (!Endpoint->Start()) {
+      return nullptr;
+    }
+    Instance = Endpoint;
+  }
+  return Endpoint;
+}
+
+FMetricsEndpoint::FMetricsEndpoint(int32 InPort)
+    : Port(InPort), bStopThread(false), Thread(nullptr),
+      ListenSocket(nullptr) {}
+
+FMetricsEndpoint::~FMetricsEndpoint() {
+  if (Thread) {
+    Stop();
+    Thread->WaitForCompletion();
+    delete Thread;
+    Thread = nullptr;
+  }
+  if (ListenSocket) {
+    ListenSocket->Close();
+    ISocketSubsystem::Get(PLATFORM_SOCKETSUBSYSTEM)
+        ->DestroySocket(ListenSocket);
+    ListenSocket = nullptr;
+  }
+}
+
+bool FMetricsEndpoint::Start() {
+  ISocketSubsystem *SocketSubsystem =
+      ISocketSubsystem::Get(PLATFORM_SOCKETSUBSYSTEM);
+  ListenSocket = SocketSubsystem->CreateSocket(
+      NAME_Stream, TEXT("MetricsEndpointSocket"), false);
+  if (!ListenSocket) {
+    return false;
+  }
+  ListenSocket->SetReuseAddr(true);
+
+  // Scraped from the vehicle network, not just this machine
+  TSharedRef<FInternetAddr> Addr = SocketSubsystem->CreateInternetAddr();
+  Addr->SetAnyAddress();
+  Addr->SetPort(Port);
+  if (!ListenSocket->Bind(*Addr) || !ListenSocket->Listen(8)) {
+    UE_LOG(LogTemp, Warning,
+           TEXT("Metrics endpoint: failed to listen on port %d"), Port);
+    return false;
+  }
+
+  Thread = FRunnableThread::Create(this, TEXT("MetricsEndpointThread"), 0,
+                                   TPri_BelowNormal);
+  if (Thread) {
+    UE_LOG(LogTemp, Log, TEXT("Metrics endpoint: http://*:%d/metrics"), Port);
+  }
+  return Thread != nullptr;
+}
+
+uint32 FMetricsEndpoint::Run() {
+  while (!bStopThread) {
+    bool bPending = false;
+    if (!ListenSocket->WaitForPendingConnection(
+            bPending, FTimespan::FromSeconds(AcceptWaitSeconds)) ||
+        !bPending) {
+      continue;
+    }
+    FSocket *Client = ListenSocket->Accept(TEXT("MetricsClientSocket"));
+    if (!Client) {
+      continue;
+    }
+    Serve(*Client);
+    Client->Close();
+    ISocketSubsystem::Get(PLATFORM_SOCKETSUBSYSTEM)->DestroySocket(Client);
+  }
+  return 0;
+}
+
+void FMetricsEndpoint::Stop() { bStopThread = true; }
+
+void FMetricsEndpoint::Serve(FSocket &Client) {
+  // Only the request line matters, but the headers are read too so the
+  // client is not reset while still sending them
+  TArray<uint8> Request;
+  const double Deadline = FPlatformTime::Seconds() + RequestTimeoutSeconds;
+  bool bComplete = false;
+  while (!bComplete && Request.Num() < MaxRequestBytes && !bStopThread) {
+    const double Remaining = Deadline - FPlatformTime::Seconds();
+    if (Remaining <= 0.0) {
+      return;
+    }
+    if (!Client.Wait(ESocketWaitConditions::WaitForRead,
+                     FTimespan::FromSeconds(Remaining))) {
+      continue;
+    }
+    uint8 Buffer[1024];
+    int32 BytesRead = 0;
+    if (!Client.Recv(Buffer, sizeof(Buffer), BytesRead) || BytesRead <= 0) {
+      return;
+    }
+    Request.Append(Buffer, BytesRead);
+    for (int32 i = FMath::Max(0, Request.Num() - BytesRead - 3);
+         i + 3 < Request.Num(); i++) {
+      if (Request[i] == '\r' && Request[i + 1] == '\n' &&
+          Request[i + 2] == '\r' && Request[i + 3] == '\n') {
+        bComplete = true;
+        break;
+      }
+    }
+  }
+
+  // "GET /metrics HTTP/1.1", possibly with a query string
+  int32 LineLength = 0;
+  while (LineLength < Request.Num() && Request[LineLength] != '\r') {
+    LineLength++;
+  }
+  const FString Line(LineLength, (const ANSICHAR *)Request.GetData());
+  TArray<FString> Parts;
+  Line.ParseIntoArray(Parts, TEXT(" "));
+  const FString Target = Parts.Num() >= 2 ? Parts[1] : FString();
+  FString Path = Target;
+  Target.Split(TEXT("?"), &Path, nullptr);
+
+  if (Parts.Num() < 2 || Parts[0] != TEXT("GET") || Path != TEXT("/metrics")) {
+    Respond(Client, TEXT("404 Not Found"), TEXT("text/plain; charset=utf-8"),
+            TEXT("Metrics are at /metrics\n"));
+    return;
+  }
+
+  PipelineMetrics::StartCollecting();
+  Scrapes.Increment();
+  Respond(Client, TEXT("200 OK"),
+          TEXT("text/plain; version=0.0.4; charset=utf-8"),
+          PipelineMetrics::ExportText());
+}
@@ -0,0 +1,44 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "HAL/Runnable.h"
+#include "HAL/ThreadSafeCounter64.h"
+
+class FSocket;
+
+// Serves PipelineMetrics on http://<any address>:<port>/metrics in the
+// Prometheus text format, from its own thread so a scrape never touches the
+// game thread. One request per connection; anything but GET /metrics is a
+// 404. Metrics that cost something to record start doing so on the first
+// scrape.
+//
+// Components share the endpoint through Acquire(); it stops when the last
+// reference goes away. The port of the first acquirer wins.
+class FMetricsEndpoint : public FRunnable {
+public:
+  static constexpr int32 DefaultPort = 9464;
+
+  // Null if the port could not be bound
+  static TSharedPtr<FMetricsEndpoint, ESPMode::ThreadSafe>
+  Acquire(int32 Port = DefaultPort);
+  virtual ~FMetricsEndpoint();
+
+  int32 GetPort() const { return Port; }
+  int64 GetScrapeCount() const { return Scrapes.GetValue(); }
+
+  // FRunnable interface
+  virtual uint32 Run() override;
+  virtual void Stop() override;
+
+private:
+  explicit FMetricsEndpoint(int32 InPort);
+  bool Start();
+
+  void Serve(FSocket &Client);
+
+  int32 Port;
+  FThreadSafeBool bStopThread;
+  FRunnableThread *Thread;
+  FSocket *ListenSocket;
+  FThreadSafeCounter64 Scrapes;
+};
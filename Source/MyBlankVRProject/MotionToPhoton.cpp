@@ -0,0 +1,121 @@
+#include "MotionToPhoton.h"
+#include "ClockSync.h"
+#include "Misc/ScopeLock.h"
+#include "PipelineMetrics.h"
+
+FMotionToPhotonTracker::FMotionToPhotonTracker()
+    : LastFrameSequence(0), bAnyFrame(false), MetricsLink(INDEX_NONE),
+      Loops(0), Unmatched(0) {
+  FMemory::Memzero(Slots, sizeof(Slots));
+  FMemory::Memzero(Recent, sizeof(Recent));
+}
+
+void FMotionToPhotonTracker::RecordSend(uint32 Sequence, int64 SampledLocalUs,
+                                        int64 SentLocalUs) {
+  FScopeLock ScopeLock(&Lock);
+  FSlot &Slot = Slots[Sequence % SlotCount];
+  Slot.Sequence = Sequence;
+  // Untimestamped samples count from the send
+  Slot.SampledLocalUs = SampledLocalUs > 0 ? SampledLocalUs : SentLocalUs;
+  Slot.bSent = true;
+  Slot.bAcked = false;
+}
+
+void FMotionToPhotonTracker::RecordAck(uint32 Sequence,
+                                       uint64 RobotReceiveUs) {
+  FScopeLock ScopeLock(&Lock);
+  FSlot &Slot = Slots[Sequence % SlotCount];
+  if (Slot.bSent && Slot.Sequence == Sequence && !Slot.bAcked) {
+    Slot.RobotReceiveUs = RobotReceiveUs;
+    Slot.bAcked = true;
+  }
+}
+
+void FMotionToPhotonTracker::RecordFrame(const FVideoFramePose &Pose,
+                                         int64 DisplayedLocalUs,
+                                         const FClockEstimate &Clock) {
+  FScopeLock ScopeLock(&Lock);
+  // Later frames showing the same command add waiting, not latency
+  if (bAnyFrame && (int32)(Pose.ControlSequence - LastFrameSequence) <= 0) {
+    return;
+  }
+  bAnyFrame = true;
+  LastFrameSequence = Pose.ControlSequence;
+
+  const FSlot &Slot = Slots[Pose.ControlSequence % SlotCount];
+  if (!Slot.bAcked || Slot.Sequence != Pose.ControlSequence ||
+      !Clock.bValid || Pose.CaptureRobotUs == 0 ||
+      Pose.ReceivedLocalUs == 0) {
+    Unmatched++;
+    return;
+  }
+
+  const int64 RobotReceiveLocalUs = Clock.ToLocalUs((int64)Slot.RobotReceiveUs);
+  const int64 CaptureLocalUs = Clock.ToLocalUs((int64)Pose.CaptureRobotUs);
+  FMotionToPhotonLoop &Loop = Recent[Loops % RecentCount];
+  Loop.ControlSequence = Pose.ControlSequence;
+  Loop.UplinkMs = (RobotReceiveLocalUs - Slot.SampledLocalUs) / 1000.0f;
+  Loop.ActuationCaptureMs = (CaptureLocalUs - RobotReceiveLocalUs) / 1000.0f;
+  Loop.EncodeNetworkMs = (Pose.ReceivedLocalUs - CaptureLocalUs) / 1000.0f;
+  Loop.DecodeDisplayMs = (DisplayedLocalUs - Pose.ReceivedLocalUs) / 1000.0f;
+  Loop.TotalMs = (DisplayedLocalUs - Slot.SampledLocalUs) / 1000.0f;
+  Loops++;
+  PipelineMetrics::MotionToPhoton.Observe(
+      MetricsLink, DisplayedLocalUs - Slot.SampledLocalUs);
+}
+
+void FMotionToPhotonTracker::SetMetricsLink(int32 Link) {
+  FScopeLock ScopeLock(&Lock);
+  MetricsLink = Link;
+}
+
+FMotionToPhotonStats FMotionToPhotonTracker::GetStats() const {
+  TArray<FMotionToPhotonLoop> RecentLoops;
+  FMotionToPhotonStats Stats;
+  {
+    FScopeLock ScopeLock(&Lock);
+    Stats.Loops = Loops;
+    Stats.Unmatched = Unmatched;
+  }
+  GetRecentLoops(RecentLoops);
+  if (RecentLoops.Num() == 0) {
+    return Stats;
+  }
+
+  // Sorts one field of the recent loops into Values
+  TArray<float> Values;
+  auto Collect = [&](float FMotionToPhotonLoop::*Field) {
+    Values.Reset();
+    for (const FMotionToPhotonLoop &Loop : RecentLoops) {
+      Values.Add(Loop.*Field);
+    }
+    Values.Sort();
+  };
+  auto Percentile = [&Values](double P) {
+    return Values[FMath::Min(Values.Num() - 1, (int32)(P * Values.Num()))];
+  };
+
+  Collect(&FMotionToPhotonLoop::TotalMs);
+  Stats.TotalP50Ms = Percentile(0.50);
+  Stats.TotalP95Ms = Percentile(0.95);
+  Stats.TotalP99Ms = Percentile(0.99);
+  Collect(&FMotionToPhotonLoop::UplinkMs);
+  Stats.UplinkMs = Percentile(0.50);
+  Collect(&FMotionToPhotonLoop::ActuationCaptureMs);
+  Stats.ActuationCaptureMs = Percentile(0.50);
+  Collect(&FMotionToPhotonLoop::EncodeNetworkMs);
+  Stats.EncodeNetworkMs = Percentile(0.50);
+  Collect(&FMotionToPhotonLoop::DecodeDisplayMs);
+  Stats.DecodeDisplayMs = Percentile(0.50);
+  return Stats;
+}
+
+void FMotionToPhotonTracker::GetRecentLoops(
+    TArray<FMotionToPhotonLoop> &OutLoops) const {
+  FScopeLock ScopeLock(&Lock);
+  const int32 Count = (int32)FMath::Min<int64>(Loops, RecentCount);
+  OutLoops.Reset(Count);
+  for (int64 i = Loops - Count; i < Loops; i++) {
+    OutLoops.Add(Recent[i % RecentCount]);
+  }
+}
@@ -0,0 +1,110 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "VideoFramePose.h"
+#include "MotionToPhoton.generated.h"
+
+struct FClockEstimate;
+
+// One head pose followed around the loop: sampled here, sent, applied on
+// the robot, captured, and shown. Stages add up to TotalMs.
+struct FMotionToPhotonLoop {
+  uint32 ControlSequence = 0;
+  // Head sample to the robot receiving the command: send pacing plus the
+  // network
+  float UplinkMs = 0.0f;
+  // Robot receipt to the capture of the first frame with the command
+  // applied: gimbal response plus waiting for the next exposure
+  float ActuationCaptureMs = 0.0f;
+  // Capture to the frame's access unit arriving here
+  float EncodeNetworkMs = 0.0f;
+  // Arrival to the frame going up to the texture
+  float DecodeDisplayMs = 0.0f;
+  float TotalMs = 0.0f;
+};
+
+// Motion-to-photon latency and its split over the most recent loops
+USTRUCT(BlueprintType)
+struct FMotionToPhotonStats {
+  GENERATED_BODY()
+
+  UPROPERTY(BlueprintReadOnly, Category = "Latency")
+  int64 Loops = 0;
+
+  // Frames naming a control packet that could not be placed: its ack was
+  // lost, it is too old, or the clock was not synced
+  UPROPERTY(BlueprintReadOnly, Category = "Latency")
+  int64 Unmatched = 0;
+
+  UPROPERTY(BlueprintReadOnly, Category = "Latency")
+  float TotalP50Ms = 0.0f;
+
+  UPROPERTY(BlueprintReadOnly, Category = "Latency")
+  float TotalP95Ms = 0.0f;
+
+  UPROPERTY(BlueprintReadOnly, Category = "Latency")
+  float TotalP99Ms = 0.0f;
+
+  // Stage medians, as in FMotionToPhotonLoop
+  UPROPERTY(BlueprintReadOnly, Category = "Latency")
+  float UplinkMs = 0.0f;
+
+  UPROPERTY(BlueprintReadOnly, Category = "Latency")
+  float ActuationCaptureMs = 0.0f;
+
+  UPROPERTY(BlueprintReadOnly, Category = "Latency")
+  float EncodeNetworkMs = 0.0f;
+
+  UPROPERTY(BlueprintReadOnly, Category = "Latency")
+  float DecodeDisplayMs = 0.0f;
+};
+
+// Closes the loop from control to video. The control link's I/O thread
+// records each packet's sample and send time and the robot's receipt from
+// its ack; the game thread records each frame shown, whose pose SEI names
+// the newest control packet the gimbal had applied at capture. The first
+// frame naming a packet closes that packet's loop. Any thread may read.
+class MYBLANKVRPROJECT_API FMotionToPhotonTracker {
+public:
+  FMotionToPhotonTracker();
+
+  void RecordSend(uint32 Sequence, int64 SampledLocalUs, int64 SentLocalUs);
+
+  // RobotReceiveUs is on the robot's clock
+  void RecordAck(uint32 Sequence, uint64 RobotReceiveUs);
+
+  // Pose.ReceivedLocalUs must be set
+  void RecordFrame(const FVideoFramePose &Pose, int64 DisplayedLocalUs,
+                   const FClockEstimate &Clock);
+
+  FMotionToPhotonStats GetStats() const;
+
+  // Label slot for the exported metric, see PipelineMetrics::ClaimLink
+  void SetMetricsLink(int32 Link);
+
+  // Oldest first
+  void GetRecentLoops(TArray<FMotionToPhotonLoop> &OutLoops) const;
+
+private:
+  static constexpr int32 SlotCount = 1024;
+  static constexpr int32 RecentCount = 256;
+
+  struct FSlot {
+    uint32 Sequence;
+    int64 SampledLocalUs;
+    uint64 RobotReceiveUs;
+    bool bSent;
+    bool bAcked;
+  };
+
+  mutable FCriticalSection Lock;
+
+  FSlot Slots[SlotCount];
+  uint32 LastFrameSequence;
+  bool bAnyFrame;
+  int32 MetricsLink;
+
+  int64 Loops;
+  int64 Unmatched;
+  FMotionToPhotonLoop Recent[RecentCount];
+};
@@ -0,0 +1,201 @@
+#include "BenchmarkScenarios.h"
+#include "ClockSync.h"
+#include "ControlLinkServer.h"
+#include "HAL/PlatformProcess.h"
+#include "HAL/PlatformTime.h"
+#include "RobotStandIn.h"
+#include "RtpFec.h"
+#include "SocketSubsystem.h"
+#include "Sockets.h"
+#include "VideoFramePose.h"
+
+bool BenchmarkScenarios::RunMotionToPhoton(const FString &Params,
+                                           TSharedRef<FJsonObject> Report) {
+  double Seconds = 10.0;
+  double TickHz = 90.0;
+  double DisplayMs = 8.0;
+  // A robot reduced to its timing, on a clock far from ours, sending
+  // marker frames so encoder time does not blur the stages
+  FRobotStandInConfig Timing;
+  Timing.ClockOffsetUs = 5000000000;
+  Timing.UplinkMs = 10.0;
+  Timing.ActuationMs = 25.0;
+  Timing.FrameHz = 60.0;
+  Timing.EncodeMs = 15.0;
+  Timing.Video = EStandInVideo::Marker;
+  FParse::Value(*Params, TEXT("Seconds="), Seconds);
+  FParse::Value(*Params, TEXT("TickHz="), TickHz);
+  FParse::Value(*Params, TEXT("UplinkMs="), Timing.UplinkMs);
+  FParse::Value(*Params, TEXT("ActuationMs="), Timing.ActuationMs);
+  FParse::Value(*Params, TEXT("FrameHz="), Timing.FrameHz);
+  FParse::Value(*Params, TEXT("EncodeMs="), Timing.EncodeMs);
+  FParse::Value(*Params, TEXT("DisplayMs="), DisplayMs);
+
+  // Our end of the video stream
+  ISocketSubsystem *SocketSubsystem =
+      ISocketSubsystem::Get(PLATFORM_SOCKETSUBSYSTEM);
+  FSocket *VideoSocket =
+      SocketSubsystem->CreateSocket(NAME_DGram, TEXT("MotionToPhotonVideo"),
+                                    false);
+  TSharedRef<FInternetAddr> VideoAddr = SocketSubsystem->CreateInternetAddr();
+  VideoAddr->SetLoopbackAddress();
+  VideoAddr->SetPort(0);
+  if (!VideoSocket || !VideoSocket->Bind(*VideoAddr)) {
+    UE_LOG(LogTemp, Error, TEXT("MotionToPhoton: failed to bind video socket"));
+    return false;
+  }
+  VideoSocket->SetNonBlocking(true);
+
+  Timing.VideoPort = VideoSocket->GetPortNo();
+  FRobotStandIn Robot(Timing);
+  FControlLinkConfig Config;
+  Config.RobotAddress = TEXT("127.0.0.1");
+  TSharedPtr<FControlLink, ESPMode::ThreadSafe> Link =
+      MakeShared<FControlLink, ESPMode::ThreadSafe>(Config);
+  TSharedPtr<FControlLinkServer, ESPMode::ThreadSafe> Server =
+      FControlLinkServer::Acquire();
+  bool bOk = Server && Robot.Open();
+  if (bOk) {
+    Server->AddLink(Link);
+  }
+
+  struct FShownFrame {
+    int64 ShowUs;
+    FVideoFramePose Pose;
+  };
+  TArray<FShownFrame> Decoding;
+  int64 NextTickUs = 0;
+  double SyncedAt = -1.0;
+  const double Start = FPlatformTime::Seconds();
+  while (bOk) {
+    const double Now = FPlatformTime::Seconds();
+    if (SyncedAt < 0.0) {
+      if (Link->GetState() == ERobotLinkState::Synced) {
+        SyncedAt = Now;
+      } else if (Now - Start > 5.0) {
+        UE_LOG(LogTemp, Error, TEXT("MotionToPhoton: stand-in never synced"));
+        bOk = false;
+        break;
+      }
+    } else if (Now - SyncedAt > Seconds) {
+      break;
+    }
+
+    // Game ticks sampling a slowly turning head
+    const int64 NowUs = ClockSync::NowMicros();
+    if (NowUs >= NextTickUs) {
+      NextTickUs = NowUs + (int64)(1e6 / TickHz);
+      FRobotControlData Sample(
+          10.0f * FMath::Sin(Now), 45.0f * FMath::Sin(0.5 * Now), 0.0f, 0.0f);
+      Sample.SampledLocalUs = NowUs;
+      Link->ControlChannel.Push(Sample);
+    }
+
+    Robot.Poll(NowUs);
+
+    // Received frames are shown DisplayMs later, standing in for decode,
+    // upload and the render frame. The pose SEI travels in an RTP packet
+    // of its own; put its start code back for the parser.
+    uint8 Packet[RtpFec::MaxPacketSize];
+    int32 BytesRead = 0;
+    while (VideoSocket->Recv(Packet, sizeof(Packet), BytesRead) &&
+           BytesRead > RtpFec::RtpHeaderSize) {
+      uint8 Nal[RtpFec::MaxPacketSize] = {0, 0, 0, 1};
+      const int32 NalSize = BytesRead - RtpFec::RtpHeaderSize;
+      FMemory::Memcpy(Nal + 4, Packet + RtpFec::RtpHeaderSize, NalSize);
+      FShownFrame Frame;
+      if (VideoPoseSei::Find(EVideoCodec::H264, Nal, 4 + NalSize,
+                             Frame.Pose)) {
+        Frame.Pose.ReceivedLocalUs = NowUs;
+        Frame.ShowUs = NowUs + (int64)(DisplayMs * 1000.0);
+        Decoding.Add(Frame);
+      }
+    }
+    FClockEstimate Clock;
+    while (Decoding.Num() > 0 && Decoding[0].ShowUs <= NowUs) {
+      // Frames before the clock settled are left out
+      if (SyncedAt >= 0.0 && Link->GetClockEstimate(Clock)) {
+        Link->MotionToPhoton.RecordFrame(Decoding[0].Pose, NowUs, Clock);
+      }
+      Decoding.RemoveAt(0);
+    }
+
+    FPlatformProcess::Sleep(0.0001f);
+  }
+
+  if (Server) {
+    Server->RemoveLink(Link);
+    Server.Reset();
+  }
+  Robot.Close();
+  VideoSocket->Close();
+  SocketSubsystem->DestroySocket(VideoSocket);
+  if (!bOk) {
+    return false;
+  }
+
+  TArray<FMotionToPhotonLoop> Loops;
+  Link->MotionToPhoton.GetRecentLoops(Loops);
+  FBenchmarkSamples UplinkMs;
+  FBenchmarkSamples ActuationCaptureMs;
+  FBenchmarkSamples EncodeNetworkMs;
+  FBenchmarkSamples DecodeDisplayMs;
+  FBenchmarkSamples TotalMs;
+  for (const FMotionToPhotonLoop &Loop : Loops) {
+    UplinkMs.Add(Loop.UplinkMs);
+    ActuationCaptureMs.Add(Loop.ActuationCaptureMs);
+    EncodeNetworkMs.Add(Loop.EncodeNetworkMs);
+    DecodeDisplayMs.Add(Loop.DecodeDisplayMs);
+    TotalMs.Add(Loop.TotalMs);
+  }
+  const FMotionToPhotonStats Stats = Link->MotionToPhoton.GetStats();
+
+  UE_LOG(LogTemp, Display,
+         TEXT("MotionToPhoton: p50 %.1f ms = uplink %.1f + actuation/capture "
+              "%.1f + encode/network %.1f + decode/display %.1f, %lld loops, "
+              "%lld unmatched"),
+         TotalMs.Percentile(50.0), UplinkMs.Percentile(50.0),
+         ActuationCaptureMs.Percentile(50.0), EncodeNetworkMs.Percentile(50.0),
+         DecodeDisplayMs.Percentile(50.0), (long long)Stats.Loops,
+         (long long)Stats.Unmatched);
+
+  Report->SetNumberField(TEXT("loops"), Stats.Loops);
+  Report->SetNumberField(TEXT("unmatched"), Stats.Unmatched);
+  Report->SetObjectField(TEXT("total_ms"), TotalMs.ToJson());
+  Report->SetObjectField(TEXT("uplink_ms"), UplinkMs.ToJson());
+  Report->SetObjectField(TEXT("actuation_capture_ms"),
+                         ActuationCaptureMs.ToJson());
+  Report->SetObjectField(TEXT("encode_network_ms"), EncodeNetworkMs.ToJson());
+  Report->SetObjectField(TEXT("decode_display_ms"), DecodeDisplayMs.ToJson());
+
+  // Each stage should land on what the stand-in was told to do, give or
+  // take the game tick, the send interval and scheduling
+  const double SlackMs = 3.0;
+  const double SendIntervalMs = 1000.0 / Config.SendRateHz;
+  struct FStageCheck {
+    const TCHAR *Name;
+    double Median;
+    double Low;
+    double High;
+  };
+  const FStageCheck Checks[] = {
+      {TEXT("uplink"), UplinkMs.Percentile(50.0), Timing.UplinkMs,
+       Timing.UplinkMs + 1000.0 / TickHz + SlackMs},
+      {TEXT("actuation/capture"), ActuationCaptureMs.Percentile(50.0),
+       Timing.ActuationMs, Timing.ActuationMs + SendIntervalMs + SlackMs},
+      {TEXT("encode/network"), EncodeNetworkMs.Percentile(50.0),
+       Timing.EncodeMs, Timing.EncodeMs + SlackMs},
+      {TEXT("decode/display"), DecodeDisplayMs.Percentile(50.0), DisplayMs,
+       DisplayMs + SlackMs},
+  };
+  bool bPass = Loops.Num() > 0;
+  for (const FStageCheck &Check : Checks) {
+    if (Check.Median < Check.Low - 0.5 || Check.Median > Check.High) {
+      UE_LOG(LogTemp, Error,
+             TEXT("MotionToPhoton: %s median %.1f ms outside %.1f-%.1f ms"),
+             Check.Name, Check.Median, Check.Low, Check.High);
+      bPass = false;
+    }
+  }
+  return bPass;
+}
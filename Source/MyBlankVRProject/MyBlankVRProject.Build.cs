@@ -1,6 +1,7 @@
 // Fill out your copyright notice in the Description page of Project Settings.
 
 using UnrealBuildTool;
+using System.Collections.Generic;
 using System.IO;
 
 public class MyBlankVRProject : ModuleRules
@@ -11,7 +12,7 @@ public class MyBlankVRProject : ModuleRules
 	
 		PublicDependencyModuleNames.AddRange(new string[] { "Core", "CoreUObject", "Engine", "InputCore", "EnhancedInput", "Sockets", "Networking", "HTTP" });
 
-		 PrivateDependencyModuleNames.AddRange(new string[] {  });
+		 PrivateDependencyModuleNames.AddRange(new string[] { "Json", "RenderCore" });
     
      string PlatformName = "mac";
      if (Target.Platform == UnrealTargetPlatform.Mac)
@@ -22,6 +23,10 @@ public class MyBlankVRProject : ModuleRules
      {
        PlatformName = "android";
      }
+     else if (Target.Platform == UnrealTargetPlatform.Linux)
+     {
+       PlatformName = "linux";
+     }
      
      // Base directory for ThirdParty libraries
      string ThirdPartyPath = Path.Combine(Path.Combine(ModuleDirectory, "../../ThirdParty/"), PlatformName);
@@ -53,11 +58,34 @@ public class MyBlankVRProject : ModuleRules
      PublicAdditionalLibraries.Add(Path.Combine(LibPath, "libx264.a"));
      /* PublicAdditionalLibraries.Add(Path.Combine(LibPath, "libiconv.a")); */
 
+     // Optional codec libraries. HEVC decode is native to libavcodec; AV1
+     // software decode needs dav1d. The HEVC/AV1 encoders are only used by
+     // the codec benchmark on desktop perf machines, so shipping and headset
+     // builds leave them out (their FFmpeg drop must be configured without
+     // libx265 and libsvtav1). Link whichever are present in the drop.
+     List<string> OptionalCodecLibs = new List<string> { "libdav1d.a" };
+     bool bDesktop = Target.Platform == UnrealTargetPlatform.Mac ||
+                     Target.Platform == UnrealTargetPlatform.Linux;
+     if (bDesktop && Target.Configuration != UnrealTargetConfiguration.Shipping)
+     {
+         OptionalCodecLibs.Add("libx265.a");
+         OptionalCodecLibs.Add("libSvtAv1Enc.a");
+     }
+     foreach (string OptionalLib in OptionalCodecLibs)
+     {
+         string OptionalLibPath = Path.Combine(LibPath, OptionalLib);
+         if (File.Exists(OptionalLibPath))
+         {
+             PublicAdditionalLibraries.Add(OptionalLibPath);
+         }
+     }
+
 
      // Log target platform
      System.Console.WriteLine("Target.Platform: " + Target.Platform);
      System.Console.WriteLine("Target.MacPlatform: " + UnrealTargetPlatform.Mac);
      System.Console.WriteLine("Target.AndroidPlatform: " + UnrealTargetPlatform.Android);
+     System.Console.WriteLine("Target.LinuxPlatform: " + UnrealTargetPlatform.Linux);
      
      
      if (Target.Platform == UnrealTargetPlatform.Mac)
@@ -97,6 +125,17 @@ public class MyBlankVRProject : ModuleRules
              /* "OpenSLES" */
          });
 
+     }
+     else if (Target.Platform == UnrealTargetPlatform.Linux)
+     {
+         // Headless perf machines run the Benchmark commandlet against the
+         // same static FFmpeg drop, built with -fPIC for ThirdParty/linux
+         PublicSystemLibraries.AddRange(new string[] {
+             "z",
+             "m",
+             "dl",
+             "pthread"
+         });
      }
 
 	}
@@ -3,4 +3,35 @@
 #include "MyBlankVRProject.h"
 #include "Modules/ModuleManager.h"
 
-IMPLEMENT_PRIMARY_GAME_MODULE( FDefaultGameModuleImpl, MyBlankVRProject, "MyBlankVRProject" );
+#if WITH_EDITOR
+#include "DynamicTextureMaterial.h"
+#include "UObject/ICookInfo.h"
+#endif
+
+class FMyBlankVRProjectModule : public FDefaultGameModuleImpl {
+public:
+  virtual void StartupModule() override {
+#if WITH_EDITOR
+    // The video material is generated from code. A cook must not ship an
+    // asset saved before the graph last changed, or the headset loses
+    // per-eye stereo and UV offset reprojection.
+    CookStartedHandle = UE::Cook::FDelegates::CookByTheBookStarted.AddLambda(
+        [](UE::Cook::ICookInfo &) {
+          DynamicTextureMaterial::RebuildAssetIfStale();
+        });
+#endif
+  }
+
+  virtual void ShutdownModule() override {
+#if WITH_EDITOR
+    UE::Cook::FDelegates::CookByTheBookStarted.Remove(CookStartedHandle);
+#endif
+  }
+
+private:
+#if WITH_EDITOR
+  FDelegateHandle CookStartedHandle;
+#endif
+};
+
+IMPLEMENT_PRIMARY_GAME_MODULE( FMyBlankVRProjectModule, MyBlankVRProject, "MyBlankVRProject" );
@@ -0,0 +1,161 @@
+#include "NetworkImpairment.h"
+
+void FImpairmentConfig::SetGilbertElliott(double MeanLossRate,
+                                          double MeanBurstLength) {
+  const double Loss = FMath::Clamp(MeanLossRate, 0.0, 0.99);
+  LossModel = EImpairmentLossModel::GilbertElliott;
+  LossInGood = 0.0;
+  LossInBad = 1.0;
+  // Mean bad-state sojourn is 1/r packets; the stationary bad probability
+  // p/(p+r) equals the loss rate.
+  BadToGood = 1.0 / FMath::Max(1.0, MeanBurstLength);
+  GoodToBad = BadToGood * Loss / (1.0 - Loss);
+}
+
+FImpairmentConfig FImpairmentConfig::FromParams(const TCHAR *Params,
+                                                const TCHAR *Prefix) {
+  FImpairmentConfig Config;
+  auto Key = [Prefix](const TCHAR *Name) {
+    return FString::Printf(TEXT("%s%s="), Prefix, Name);
+  };
+
+  FString LossModelName;
+  FParse::Value(Params, *Key(TEXT("LossRate")), Config.LossRate);
+  if (FParse::Value(Params, *Key(TEXT("LossModel")), LossModelName)) {
+    if (LossModelName.Equals(TEXT("GilbertElliott"), ESearchCase::IgnoreCase)) {
+      double BurstLength = 2.0;
+      FParse::Value(Params, *Key(TEXT("BurstLength")), BurstLength);
+      Config.SetGilbertElliott(Config.LossRate, BurstLength);
+      FParse::Value(Params, *Key(TEXT("GoodToBad")), Config.GoodToBad);
+      FParse::Value(Params, *Key(TEXT("BadToGood")), Config.BadToGood);
+      FParse::Value(Params, *Key(TEXT("LossInGood")), Config.LossInGood);
+      FParse::Value(Params, *Key(TEXT("LossInBad")), Config.LossInBad);
+    } else if (LossModelName.Equals(TEXT("Bernoulli"),
+                                    ESearchCase::IgnoreCase)) {
+      Config.LossModel = EImpairmentLossModel::Bernoulli;
+    }
+  } else if (Config.LossRate > 0.0) {
+    Config.LossModel = EImpairmentLossModel::Bernoulli;
+  }
+
+  FString JitterName;
+  if (FParse::Value(Params, *Key(TEXT("Jitter")), JitterName)) {
+    if (JitterName.Equals(TEXT("Normal"), ESearchCase::IgnoreCase)) {
+      Config.JitterDistribution = EImpairmentJitterDistribution::Normal;
+    } else if (JitterName.Equals(TEXT("Exponential"),
+                                 ESearchCase::IgnoreCase)) {
+      Config.JitterDistribution = EImpairmentJitterDistribution::Exponential;
+    }
+  }
+
+  FParse::Value(Params, *Key(TEXT("DelayMs")), Config.DelayMs);
+  FParse::Value(Params, *Key(TEXT("JitterMs")), Config.JitterMs);
+  FParse::Bool(Params, *Key(TEXT("PreserveOrder")), Config.bPreserveOrder);
+  FParse::Value(Params, *Key(TEXT("ReorderRate")), Config.ReorderRate);
+  FParse::Value(Params, *Key(TEXT("ReorderDelayMs")), Config.ReorderDelayMs);
+  FParse::Value(Params, *Key(TEXT("DuplicateRate")), Config.DuplicateRate);
+  FParse::Value(Params, *Key(TEXT("RateKbps")), Config.RateKbps);
+  FParse::Value(Params, *Key(TEXT("MaxQueueMs")), Config.MaxQueueMs);
+  FParse::Value(Params, *Key(TEXT("Seed")), Config.Seed);
+  return Config;
+}
+
+FString FImpairmentConfig::ToString() const {
+  const TCHAR *LossName = LossModel == EImpairmentLossModel::GilbertElliott
+                              ? TEXT("GilbertElliott")
+                          : LossModel == EImpairmentLossModel::Bernoulli
+                              ? TEXT("Bernoulli")
+                              : TEXT("None");
+  return FString::Printf(
+      TEXT("loss=%s(rate %.4f, p %.4f, r %.4f) delay=%.1fms jitter=%.1fms "
+           "reorder=%.4f dup=%.4f rate=%.0fkbps"),
+      LossName, LossRate, GoodToBad, BadToGood, DelayMs, JitterMs,
+      ReorderRate, DuplicateRate, RateKbps);
+}
+
+FImpairmentModel::FImpairmentModel(const FImpairmentConfig &InConfig)
+    : Config(InConfig), Random(InConfig.Seed), bBadState(false),
+      LinkFreeAt(0.0), LastDelivery(0.0) {}
+
+bool FImpairmentModel::DecideLoss() {
+  switch (Config.LossModel) {
+  case EImpairmentLossModel::Bernoulli:
+    return Random.GetFraction() < Config.LossRate;
+  case EImpairmentLossModel::GilbertElliott:
+    if (bBadState) {
+      bBadState = Random.GetFraction() >= Config.BadToGood;
+    } else {
+      bBadState = Random.GetFraction() < Config.GoodToBad;
+    }
+    return Random.GetFraction() <
+           (bBadState ? Config.LossInBad : Config.LossInGood);
+  case EImpairmentLossModel::None:
+  default:
+    return false;
+  }
+}
+
+double FImpairmentModel::SampleJitterMs() {
+  if (Config.JitterMs <= 0.0) {
+    return 0.0;
+  }
+  switch (Config.JitterDistribution) {
+  case EImpairmentJitterDistribution::Normal: {
+    // Box-Muller
+    const double U1 = FMath::Max(1e-12, (double)Random.GetFraction());
+    const double U2 = Random.GetFraction();
+    return Config.JitterMs * FMath::Sqrt(-2.0 * FMath::Loge(U1)) *
+           FMath::Cos(2.0 * UE_DOUBLE_PI * U2);
+  }
+  case EImpairmentJitterDistribution::Exponential:
+    return -Config.JitterMs * FMath::Loge(1.0 - Random.GetFraction());
+  case EImpairmentJitterDistribution::Uniform:
+  default:
+    return (2.0 * Random.GetFraction() - 1.0) * Config.JitterMs;
+  }
+}
+
+int32 FImpairmentModel::Process(double Now, int32 Size,
+                                double OutDeliveryTimes[2]) {
+  Stats.Packets++;
+  if (DecideLoss()) {
+    Stats.Lost++;
+    return 0;
+  }
+
+  double Release = Now;
+  if (Config.RateKbps > 0.0) {
+    const double Start = FMath::Max(Now, LinkFreeAt);
+    if ((Start - Now) * 1000.0 > Config.MaxQueueMs) {
+      Stats.QueueDropped++;
+      return 0;
+    }
+    LinkFreeAt = Start + Size * 8.0 / (Config.RateKbps * 1000.0);
+    Release = LinkFreeAt;
+  }
+
+  const double DelayMs = FMath::Max(0.0, Config.DelayMs + SampleJitterMs());
+  double Delivery = Release + DelayMs / 1000.0;
+
+  if (Config.ReorderRate > 0.0 && Random.GetFraction() < Config.ReorderRate) {
+    // Held back without moving the ordering floor, so later packets pass it
+    Delivery += Config.ReorderDelayMs / 1000.0;
+    Stats.Reordered++;
+  } else {
+    if (Config.bPreserveOrder) {
+      Delivery = FMath::Max(Delivery, LastDelivery);
+    }
+    LastDelivery = Delivery;
+  }
+
+  int32 Copies = 1;
+  OutDeliveryTimes[0] = Delivery;
+  if (Config.DuplicateRate > 0.0 &&
+      Random.GetFraction() < Config.DuplicateRate) {
+    OutDeliveryTimes[1] = Delivery;
+    Copies = 2;
+    Stats.Duplicated++;
+  }
+  Stats.Delivered += Copies;
+  return Copies;
+}
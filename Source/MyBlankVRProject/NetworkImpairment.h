@@ -0,0 +1,105 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Math/RandomStream.h"
+
+enum class EImpairmentLossModel : uint8 {
+  None,
+  // Independent per-packet loss at LossRate
+  Bernoulli,
+  // Two-state Markov chain producing bursty loss
+  GilbertElliott,
+};
+
+enum class EImpairmentJitterDistribution : uint8 {
+  // Uniform in [-JitterMs, +JitterMs]
+  Uniform,
+  // Gaussian with standard deviation JitterMs
+  Normal,
+  // One-sided exponential with mean JitterMs, i.e. occasional long stalls
+  Exponential,
+};
+
+// Impairments applied to one direction of a link. Everything is off by
+// default.
+struct MYBLANKVRPROJECT_API FImpairmentConfig {
+  EImpairmentLossModel LossModel = EImpairmentLossModel::None;
+
+  // Bernoulli loss probability
+  double LossRate = 0.0;
+
+  // Gilbert-Elliott transition and per-state loss probabilities
+  double GoodToBad = 0.0;
+  double BadToGood = 1.0;
+  double LossInGood = 0.0;
+  double LossInBad = 1.0;
+
+  double DelayMs = 0.0;
+  double JitterMs = 0.0;
+  EImpairmentJitterDistribution JitterDistribution =
+      EImpairmentJitterDistribution::Uniform;
+  // Jitter never lets a packet overtake an earlier one, like a real link
+  // with a single queue. Reordering is then only what ReorderRate adds.
+  bool bPreserveOrder = true;
+
+  // Fraction of packets held back by an extra ReorderDelayMs so that later
+  // packets overtake them
+  double ReorderRate = 0.0;
+  double ReorderDelayMs = 10.0;
+
+  double DuplicateRate = 0.0;
+
+  // Link rate in kbit/s, 0 for unlimited. Packets that would wait longer
+  // than MaxQueueMs behind the rate limit are tail-dropped.
+  double RateKbps = 0.0;
+  double MaxQueueMs = 200.0;
+
+  int32 Seed = 0;
+
+  // Gilbert-Elliott parameters for a mean loss rate and mean burst length
+  // (in packets), with every packet lost in the bad state.
+  void SetGilbertElliott(double MeanLossRate, double MeanBurstLength);
+
+  // Parses command line style keys, each optionally prefixed, e.g.
+  //   -LossModel=GilbertElliott -LossRate=0.02 -BurstLength=4 -DelayMs=30
+  //   -JitterMs=5 -Jitter=Normal -ReorderRate=0.01 -DuplicateRate=0.001
+  //   -RateKbps=4000 -MaxQueueMs=100 -Seed=7
+  static FImpairmentConfig FromParams(const TCHAR *Params,
+                                      const TCHAR *Prefix = TEXT(""));
+
+  FString ToString() const;
+};
+
+struct FImpairmentStats {
+  uint64 Packets = 0;
+  uint64 Delivered = 0;
+  uint64 Lost = 0;
+  uint64 QueueDropped = 0;
+  uint64 Duplicated = 0;
+  uint64 Reordered = 0;
+};
+
+// Deterministic (per seed) model deciding the fate of each packet. Holds no
+// packet data, so it can drive both the proxy and in-process simulations.
+class MYBLANKVRPROJECT_API FImpairmentModel {
+public:
+  explicit FImpairmentModel(const FImpairmentConfig &InConfig);
+
+  // Decides what happens to a packet of Size bytes offered at Now (seconds).
+  // Returns the number of copies to deliver, 0 if dropped, and writes each
+  // copy's delivery time.
+  int32 Process(double Now, int32 Size, double OutDeliveryTimes[2]);
+
+  const FImpairmentStats &GetStats() const { return Stats; }
+
+private:
+  bool DecideLoss();
+  double SampleJitterMs();
+
+  FImpairmentConfig Config;
+  FRandomStream Random;
+  bool bBadState;
+  double LinkFreeAt;
+  double LastDelivery;
+  FImpairmentStats Stats;
+};
@@ -0,0 +1,180 @@
+#include "NetworkImpairmentProxy.h"
+#include "HAL/PlatformTime.h"
+#include "Misc/ScopeLock.h"
+#include "SocketSubsystem.h"
+#include "Sockets.h"
+
+namespace {
+constexpr int32 MaxDatagramSize = 65536;
+} // namespace
+
+bool FNetworkImpairmentProxy::DeliversBefore(const FDelayedPacket &A,
+                                             const FDelayedPacket &B) {
+  return A.DeliveryTime < B.DeliveryTime ||
+         (A.DeliveryTime == B.DeliveryTime && A.Order < B.Order);
+}
+
+FNetworkImpairmentProxy::FNetworkImpairmentProxy(
+    int32 InListenPort, const FIPv4Endpoint &InUpstream,
+    const FImpairmentConfig &InForwardConfig,
+    const FImpairmentConfig &InReverseConfig)
+    : ListenPort(InListenPort), Upstream(InUpstream), bStopThread(false),
+      ListenSocket(nullptr), UpstreamSocket(nullptr), bHaveClient(false),
+      ForwardModel(InForwardConfig), ReverseModel(InReverseConfig),
+      NextOrder(0) {
+  UE_LOG(LogTemp, Log, TEXT("Impairment proxy %d -> %s"), ListenPort,
+         *Upstream.ToString());
+  UE_LOG(LogTemp, Log, TEXT("  forward: %s"), *InForwardConfig.ToString());
+  UE_LOG(LogTemp, Log, TEXT("  reverse: %s"), *InReverseConfig.ToString());
+}
+
+FNetworkImpairmentProxy::~FNetworkImpairmentProxy() {
+  ISocketSubsystem *SocketSubsystem =
+      ISocketSubsystem::Get(PLATFORM_SOCKETSUBSYSTEM);
+  for (FSocket *Socket : {ListenSocket, UpstreamSocket}) {
+    if (Socket) {
+      Socket->Close();
+      SocketSubsystem->DestroySocket(Socket);
+    }
+  }
+}
+
+bool FNetworkImpairmentProxy::OpenSockets() {
+  ISocketSubsystem *SocketSubsystem =
+      ISocketSubsystem::Get(PLATFORM_SOCKETSUBSYSTEM);
+
+  ListenSocket = SocketSubsystem->CreateSocket(
+      NAME_DGram, TEXT("ImpairmentProxyListenSocket"), false);
+  UpstreamSocket = SocketSubsystem->CreateSocket(
+      NAME_DGram, TEXT("ImpairmentProxyUpstreamSocket"), false);
+  if (!ListenSocket || !UpstreamSocket) {
+    return false;
+  }
+
+  int32 ActualSize = 0;
+  for (FSocket *Socket : {ListenSocket, UpstreamSocket}) {
+    Socket->SetNonBlocking(true);
+    Socket->SetReceiveBufferSize(4 * 1024 * 1024, ActualSize);
+    Socket->SetSendBufferSize(4 * 1024 * 1024, ActualSize);
+  }
+
+  TSharedRef<FInternetAddr> Addr = SocketSubsystem->CreateInternetAddr();
+  Addr->SetLoopbackAddress();
+  Addr->SetPort(ListenPort);
+  if (!ListenSocket->Bind(*Addr)) {
+    UE_LOG(LogTemp, Error, TEXT("Impairment proxy: failed to bind port %d"),
+           ListenPort);
+    return false;
+  }
+
+  ClientAddr = SocketSubsystem->CreateInternetAddr();
+  return true;
+}
+
+int32 FNetworkImpairmentProxy::AcquireBuffer(int32 Size) {
+  int32 Index;
+  if (FreeBuffers.Num() > 0) {
+    Index = FreeBuffers.Pop();
+  } else {
+    Index = Buffers.AddDefaulted();
+  }
+  // Buffers only ever grow, so steady state does not allocate
+  if (Buffers[Index].Num() < Size) {
+    Buffers[Index].SetNumUninitialized(Size);
+  }
+  return Index;
+}
+
+void FNetworkImpairmentProxy::Enqueue(FImpairmentModel &Model,
+                                      bool bToUpstream, const uint8 *Data,
+                                      int32 Size, double Now) {
+  double DeliveryTimes[2];
+  int32 Copies;
+  {
+    FScopeLock Lock(&ModelLock);
+    Copies = Model.Process(Now, Size, DeliveryTimes);
+  }
+
+  for (int32 Copy = 0; Copy < Copies; Copy++) {
+    FDelayedPacket Packet;
+    Packet.DeliveryTime = DeliveryTimes[Copy];
+    Packet.Order = NextOrder++;
+    Packet.bToUpstream = bToUpstream;
+    Packet.BufferIndex = AcquireBuffer(Size);
+    Packet.Size = Size;
+    FMemory::Memcpy(Buffers[Packet.BufferIndex].GetData(), Data, Size);
+    Pending.HeapPush(Packet, &FNetworkImpairmentProxy::DeliversBefore);
+  }
+}
+
+double FNetworkImpairmentProxy::Deliver(double Now) {
+  TSharedRef<FInternetAddr> UpstreamAddr = Upstream.ToInternetAddr();
+
+  while (Pending.Num() > 0 && Pending.HeapTop().DeliveryTime <= Now) {
+    FDelayedPacket Packet;
+    Pending.HeapPop(Packet, &FNetworkImpairmentProxy::DeliversBefore);
+
+    int32 Sent = 0;
+    const uint8 *Data = Buffers[Packet.BufferIndex].GetData();
+    if (Packet.bToUpstream) {
+      UpstreamSocket->SendTo(Data, Packet.Size, Sent, *UpstreamAddr);
+    } else if (bHaveClient) {
+      ListenSocket->SendTo(Data, Packet.Size, Sent, *ClientAddr);
+    }
+    FreeBuffers.Push(Packet.BufferIndex);
+  }
+
+  return Pending.Num() > 0 ? Pending.HeapTop().DeliveryTime : Now + 1.0;
+}
+
+uint32 FNetworkImpairmentProxy::Run() {
+  TArray<uint8> Buffer;
+  Buffer.SetNumUninitialized(MaxDatagramSize);
+  TSharedRef<FInternetAddr> Sender =
+      ISocketSubsystem::Get(PLATFORM_SOCKETSUBSYSTEM)->CreateInternetAddr();
+
+  while (!bStopThread) {
+    double Now = FPlatformTime::Seconds();
+    int32 BytesRead = 0;
+
+    while (ListenSocket->RecvFrom(Buffer.GetData(), Buffer.Num(), BytesRead,
+                                  *Sender) &&
+           BytesRead > 0) {
+      ClientAddr->SetRawIp(Sender->GetRawIp());
+      ClientAddr->SetPort(Sender->GetPort());
+      bHaveClient = true;
+      Enqueue(ForwardModel, true, Buffer.GetData(), BytesRead, Now);
+    }
+
+    while (UpstreamSocket->RecvFrom(Buffer.GetData(), Buffer.Num(), BytesRead,
+                                    *Sender) &&
+           BytesRead > 0) {
+      Enqueue(ReverseModel, false, Buffer.GetData(), BytesRead, Now);
+    }
+
+    Now = FPlatformTime::Seconds();
+    const double NextDelivery = Deliver(Now);
+
+    // Sleep until the next delivery or new traffic, capped so upstream
+    // replies are not starved while waiting on the listen socket.
+    const double WaitSeconds =
+        FMath::Clamp(NextDelivery - Now, 0.0, 0.001);
+    if (WaitSeconds > 0.0) {
+      ListenSocket->Wait(ESocketWaitConditions::WaitForRead,
+                         FTimespan::FromSeconds(WaitSeconds));
+    }
+  }
+  return 0;
+}
+
+void FNetworkImpairmentProxy::Stop() { bStopThread = true; }
+
+FImpairmentStats FNetworkImpairmentProxy::GetForwardStats() const {
+  FScopeLock Lock(&ModelLock);
+  return ForwardModel.GetStats();
+}
+
+FImpairmentStats FNetworkImpairmentProxy::GetReverseStats() const {
+  FScopeLock Lock(&ModelLock);
+  return ReverseModel.GetStats();
+}
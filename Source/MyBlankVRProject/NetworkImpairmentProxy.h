@@ -0,0 +1,68 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "HAL/Runnable.h"
+#include "Interfaces/IPv4/IPv4Endpoint.h"
+#include "NetworkImpairment.h"
+
+class FSocket;
+
+// UDP proxy that applies loss, delay, jitter, reordering, duplication and a
+// rate limit between a local sender and a receiver. Point the sender at
+// ListenPort; packets are forwarded to Upstream, and replies coming back
+// from Upstream are returned to the last sender through the reverse model.
+// Runs on plain loopback sockets, no privileges needed.
+class MYBLANKVRPROJECT_API FNetworkImpairmentProxy : public FRunnable {
+public:
+  FNetworkImpairmentProxy(int32 InListenPort, const FIPv4Endpoint &InUpstream,
+                          const FImpairmentConfig &InForwardConfig,
+                          const FImpairmentConfig &InReverseConfig);
+  virtual ~FNetworkImpairmentProxy();
+
+  // Binds ListenPort and opens the upstream socket. Call before starting
+  // the thread; false if the port is taken.
+  bool OpenSockets();
+
+  // FRunnable interface
+  virtual uint32 Run() override;
+  virtual void Stop() override;
+
+  FImpairmentStats GetForwardStats() const;
+  FImpairmentStats GetReverseStats() const;
+
+private:
+  struct FDelayedPacket {
+    double DeliveryTime;
+    uint64 Order;
+    bool bToUpstream;
+    int32 BufferIndex;
+    int32 Size;
+  };
+
+  static bool DeliversBefore(const FDelayedPacket &A, const FDelayedPacket &B);
+
+  void Enqueue(FImpairmentModel &Model, bool bToUpstream, const uint8 *Data,
+               int32 Size, double Now);
+  // Sends every packet due by Now and returns the time of the next one
+  double Deliver(double Now);
+  int32 AcquireBuffer(int32 Size);
+
+  int32 ListenPort;
+  FIPv4Endpoint Upstream;
+  FThreadSafeBool bStopThread;
+
+  FSocket *ListenSocket;
+  FSocket *UpstreamSocket;
+  TSharedPtr<FInternetAddr> ClientAddr;
+  bool bHaveClient;
+
+  mutable FCriticalSection ModelLock;
+  FImpairmentModel ForwardModel;
+  FImpairmentModel ReverseModel;
+
+  // Min-heap on delivery time; packet bytes live in a reused buffer pool
+  TArray<FDelayedPacket> Pending;
+  TArray<TArray<uint8>> Buffers;
+  TArray<int32> FreeBuffers;
+  uint64 NextOrder;
+};
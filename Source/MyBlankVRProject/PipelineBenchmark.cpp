@@ -0,0 +1,349 @@
+#include "BenchmarkScenarios.h"
+#include "CameraDataStreamer.h"
+#include "ClockSync.h"
+#include "DynamicTextureActor.h"
+#include "Engine/Engine.h"
+#include "Engine/World.h"
+#include "GameFramework/PlayerController.h"
+#include "GameFramework/WorldSettings.h"
+#include "HAL/PlatformMemory.h"
+#include "HAL/PlatformProcess.h"
+#include "HAL/PlatformTime.h"
+#include "MyVRPawn.h"
+#include "RenderCommandFence.h"
+#include "RobotStandIn.h"
+
+#if PLATFORM_LINUX
+#include <dirent.h>
+#include <stdio.h>
+#include <unistd.h>
+#endif
+
+namespace {
+// CPU seconds used so far by every thread in the process, summed by thread
+// name (Linux cuts names to 15 characters). Empty where /proc is missing.
+TMap<FString, double> SampleThreadCpuSeconds() {
+  TMap<FString, double> Result;
+#if PLATFORM_LINUX
+  const double TicksPerSecond = (double)sysconf(_SC_CLK_TCK);
+  DIR *Tasks = opendir("/proc/self/task");
+  if (!Tasks) {
+    return Result;
+  }
+  while (dirent *Entry = readdir(Tasks)) {
+    if (Entry->d_name[0] == '.') {
+      continue;
+    }
+    char Path[64];
+    snprintf(Path, sizeof(Path), "/proc/self/task/%s/stat", Entry->d_name);
+    FILE *File = fopen(Path, "r");
+    if (!File) {
+      continue;
+    }
+    char Line[512];
+    const bool bRead = fgets(Line, sizeof(Line), File) != nullptr;
+    fclose(File);
+    // pid (name) state ppid ... with utime and stime the 14th and 15th
+    // fields; the name may itself hold spaces or parentheses
+    char *NameStart = bRead ? strchr(Line, '(') : nullptr;
+    char *NameEnd = bRead ? strrchr(Line, ')') : nullptr;
+    if (!NameStart || !NameEnd || NameEnd < NameStart) {
+      continue;
+    }
+    unsigned long long UserTicks = 0;
+    unsigned long long SystemTicks = 0;
+    if (sscanf(NameEnd + 1,
+               " %*c %*d %*d %*d %*d %*d %*u %*u %*u %*u %*u %llu %llu",
+               &UserTicks, &SystemTicks) != 2) {
+      continue;
+    }
+    *NameEnd = '\0';
+    Result.FindOrAdd(FString(UTF8_TO_TCHAR(NameStart + 1))) +=
+        (UserTicks + SystemTicks) / TicksPerSecond;
+  }
+  closedir(Tasks);
+#endif
+  return Result;
+}
+
+double ToMegabytes(uint64 Bytes) { return Bytes / (1024.0 * 1024.0); }
+} // namespace
+
+bool BenchmarkScenarios::RunPipeline(const FString &Params,
+                                     TSharedRef<FJsonObject> Report) {
+  double Seconds = 30.0;
+  double TickHz = 90.0;
+  double StartTimeout = 20.0;
+  FParse::Value(*Params, TEXT("Seconds="), Seconds);
+  FParse::Value(*Params, TEXT("TickHz="), TickHz);
+  FParse::Value(*Params, TEXT("StartTimeout="), StartTimeout);
+  TickHz = FMath::Max(TickHz, 1.0);
+
+  // The robot: encoded video the decoder can take, on the headset's usual
+  // ports unless the params move them
+  FRobotStandInConfig RobotConfig = FRobotStandInConfig::FromParams(*Params);
+  RobotConfig.Video = EStandInVideo::Encoded;
+  FRobotStandIn Robot(RobotConfig);
+  if (!Robot.Open()) {
+    return false;
+  }
+  if (Robot.GetVideoMode() != EStandInVideo::Encoded) {
+    UE_LOG(LogTemp, Error,
+           TEXT("Pipeline: no H.264 encoder for the stand-in; the video "
+                "pipeline needs a decodable stream"));
+    return false;
+  }
+
+  // A bare game world holding what the VR map would: a player with the
+  // control streamer on its pawn, and the video plane
+  UWorld *World = UWorld::CreateWorld(EWorldType::Game, false,
+                                      TEXT("PipelineBenchmark"));
+  FWorldContext &Context = GEngine->CreateNewWorldContext(EWorldType::Game);
+  Context.SetCurrentWorld(World);
+  World->InitializeActorsForPlay(FURL());
+
+  APlayerController *Controller = World->SpawnActor<APlayerController>();
+  AMyVRPawn *Pawn = World->SpawnActor<AMyVRPawn>();
+  Controller->Possess(Pawn);
+
+  UCameraDataStreamer *Streamer = NewObject<UCameraDataStreamer>(Pawn);
+  Streamer->RobotAddress = RobotConfig.Address;
+  Streamer->bUseRemoteRendezvous = false;
+  Pawn->AddInstanceComponent(Streamer);
+  Streamer->RegisterComponent();
+
+  ADynamicTextureActor *Video = World->SpawnActorDeferred<ADynamicTextureActor>(
+      ADynamicTextureActor::StaticClass(), FTransform::Identity);
+  Video->StreamConfig.Port = RobotConfig.VideoPort;
+  Video->StreamConfig.bEnableFec = RobotConfig.FecGroupSize > 0;
+  Video->StreamConfig.FecPort = RobotConfig.FecPort;
+  Video->FinishSpawning(FTransform::Identity);
+
+  // Starts the control link and the decoder threads
+  World->GetWorldSettings()->NotifyBeginPlay();
+
+  UE_LOG(LogTemp, Display,
+         TEXT("Pipeline: %.0f s at %.0f Hz against stand-in %s"), Seconds,
+         TickHz, *RobotConfig.ToString());
+
+  const float DeltaSeconds = (float)(1.0 / TickHz);
+  const int64 TickIntervalUs = (int64)(1e6 / TickHz);
+  FBenchmarkSamples TickMs;
+  FBenchmarkSamples VideoLatencyMs;
+  TMap<FString, double> ThreadCpuStart;
+  double GameThreadCpuStart = 0.0;
+  FPlatformMemoryStats MemoryStart;
+  FRobotStandInStats RobotStart;
+  int64 ShownStart = 0;
+  int64 LastShown = 0;
+
+  const double Launch = FPlatformTime::Seconds();
+  double MeasureStart = -1.0;
+  int64 NextTickUs = 0;
+  bool bStarted = false;
+  while (true) {
+    const int64 NowUs = ClockSync::NowMicros();
+    Robot.Poll(NowUs);
+    if (NowUs < NextTickUs) {
+      FPlatformProcess::Sleep(0.0002f);
+      continue;
+    }
+    NextTickUs = NowUs + TickIntervalUs;
+
+    // A game frame: the head wanders, the world ticks, and the frame waits
+    // for the render thread as the engine loop would
+    const double Now = FPlatformTime::Seconds();
+    Controller->SetControlRotation(FRotator(10.0 * FMath::Sin(Now),
+                                            45.0 * FMath::Sin(0.5 * Now),
+                                            0.0));
+    const double TickStart = FPlatformTime::Seconds();
+    World->Tick(LEVELTICK_All, DeltaSeconds);
+    FRenderCommandFence Fence;
+    Fence.BeginFence();
+    Fence.Wait();
+    GFrameCounter++;
+    const double TickSeconds = FPlatformTime::Seconds() - TickStart;
+
+    const int64 Shown = Video->GetFramesShown();
+    if (!bStarted) {
+      // Measure from the first frame on screen with the clock synced, so
+      // connection and decoder start-up stay out of the numbers
+      if (Shown > 0 && Streamer->IsClockSynced()) {
+        bStarted = true;
+        MeasureStart = FPlatformTime::Seconds();
+        ThreadCpuStart = SampleThreadCpuSeconds();
+        GameThreadCpuStart = GetThreadCpuSeconds();
+        MemoryStart = FPlatformMemory::GetStats();
+        RobotStart = Robot.GetStats();
+        ShownStart = Shown;
+        LastShown = Shown;
+        UE_LOG(LogTemp, Display, TEXT("Pipeline: first frame after %.2f s"),
+               MeasureStart - Launch);
+      } else if (Now - Launch > StartTimeout) {
+        break;
+      }
+      continue;
+    }
+
+    TickMs.Add(TickSeconds * 1000.0);
+    if (Shown != LastShown) {
+      LastShown = Shown;
+      const float LatencyMs = Video->GetVideoLatencyMs();
+      if (LatencyMs >= 0.0f) {
+        VideoLatencyMs.Add(LatencyMs);
+      }
+    }
+    if (FPlatformTime::Seconds() - MeasureStart >= Seconds) {
+      break;
+    }
+  }
+
+  const double Elapsed =
+      bStarted ? FPlatformTime::Seconds() - MeasureStart : 0.0;
+  const double GameThreadCpuEnd = GetThreadCpuSeconds();
+  const TMap<FString, double> ThreadCpuEnd = SampleThreadCpuSeconds();
+  const FPlatformMemoryStats MemoryEnd = FPlatformMemory::GetStats();
+  const FRobotStandInStats &RobotEnd = Robot.GetStats();
+  const int64 FramesShown = Video->GetFramesShown() - ShownStart;
+  const int64 FramesSent = RobotEnd.Frames - RobotStart.Frames;
+  const FMotionToPhotonStats MotionToPhoton =
+      Streamer->GetMotionToPhotonStats();
+  const FControlLinkQuality Quality = Streamer->GetControlLinkQuality();
+  const FControlSendStats SendStats = Streamer->GetControlSendStats();
+  const bool bSynced = Streamer->IsClockSynced();
+  const int64 FecRecovered = Video->GetFecRecoveredPackets();
+  const int64 FecUnrecoverable = Video->GetFecUnrecoverablePackets();
+  const int64 SamplesOverwritten = Streamer->GetControlSamplesOverwritten();
+  const int64 BackpressureDrops = Streamer->GetControlBackpressureDrops();
+
+  // EndPlay joins the decoder thread, which may be blocked reading the
+  // stream, so the stand-in keeps sending until the actors are gone
+  Video->Destroy();
+  Pawn->Destroy();
+  Controller->Destroy();
+  GEngine->DestroyWorldContext(World);
+  World->DestroyWorld(false);
+  Robot.Close();
+
+  if (!bStarted) {
+    UE_LOG(LogTemp, Error,
+           TEXT("Pipeline: no frame shown with the clock synced within "
+                "%.0f s"),
+           StartTimeout);
+    return false;
+  }
+
+  UE_LOG(LogTemp, Display,
+         TEXT("Pipeline: %.1f fps shown of %.1f sent, tick p50 %.2f p99 "
+              "%.2f ms, capture to display p50 %.1f ms, motion to photon "
+              "p50 %.1f ms over %lld loops"),
+         FramesShown / Elapsed, FramesSent / Elapsed, TickMs.Percentile(50.0),
+         TickMs.Percentile(99.0), VideoLatencyMs.Percentile(50.0),
+         MotionToPhoton.TotalP50Ms, (long long)MotionToPhoton.Loops);
+
+  TSharedRef<FJsonObject> Frames = MakeShared<FJsonObject>();
+  Frames->SetNumberField(TEXT("sent"), (double)FramesSent);
+  Frames->SetNumberField(TEXT("shown"), (double)FramesShown);
+  Frames->SetNumberField(TEXT("sent_fps"), FramesSent / Elapsed);
+  Frames->SetNumberField(TEXT("shown_fps"), FramesShown / Elapsed);
+
+  TSharedRef<FJsonObject> Latency = MakeShared<FJsonObject>();
+  Latency->SetObjectField(TEXT("game_tick_ms"), TickMs.ToJson());
+  Latency->SetObjectField(TEXT("capture_to_display_ms"),
+                          VideoLatencyMs.ToJson());
+  TSharedRef<FJsonObject> M2p = MakeShared<FJsonObject>();
+  M2p->SetNumberField(TEXT("loops"), (double)MotionToPhoton.Loops);
+  M2p->SetNumberField(TEXT("unmatched"), (double)MotionToPhoton.Unmatched);
+  M2p->SetNumberField(TEXT("p50"), MotionToPhoton.TotalP50Ms);
+  M2p->SetNumberField(TEXT("p95"), MotionToPhoton.TotalP95Ms);
+  M2p->SetNumberField(TEXT("p99"), MotionToPhoton.TotalP99Ms);
+  M2p->SetNumberField(TEXT("uplink_p50"), MotionToPhoton.UplinkMs);
+  M2p->SetNumberField(TEXT("actuation_capture_p50"),
+                      MotionToPhoton.ActuationCaptureMs);
+  M2p->SetNumberField(TEXT("encode_network_p50"),
+                      MotionToPhoton.EncodeNetworkMs);
+  M2p->SetNumberField(TEXT("decode_display_p50"),
+                      MotionToPhoton.DecodeDisplayMs);
+  Latency->SetObjectField(TEXT("motion_to_photon_ms"), M2p);
+
+  // Percent of one core over the measured window
+  TSharedRef<FJsonObject> Cpu = MakeShared<FJsonObject>();
+  if (GameThreadCpuStart >= 0.0 && GameThreadCpuEnd >= 0.0) {
+    Cpu->SetNumberField(TEXT("GameThread"),
+                        (GameThreadCpuEnd - GameThreadCpuStart) / Elapsed *
+                            100.0);
+  }
+  for (const TPair<FString, double> &Thread : ThreadCpuEnd) {
+    const double *Before = ThreadCpuStart.Find(Thread.Key);
+    const double Used = Thread.Value - (Before ? *Before : 0.0);
+    if (Used > 0.0) {
+      Cpu->SetNumberField(Thread.Key, Used / Elapsed * 100.0);
+    }
+  }
+
+  TSharedRef<FJsonObject> Memory = MakeShared<FJsonObject>();
+  Memory->SetNumberField(TEXT("used_physical_start_mb"),
+                         ToMegabytes(MemoryStart.UsedPhysical));
+  Memory->SetNumberField(TEXT("used_physical_end_mb"),
+                         ToMegabytes(MemoryEnd.UsedPhysical));
+  Memory->SetNumberField(TEXT("peak_used_physical_mb"),
+                         ToMegabytes(MemoryEnd.PeakUsedPhysical));
+  Memory->SetNumberField(TEXT("growth_mb_per_minute"),
+                         (ToMegabytes(MemoryEnd.UsedPhysical) -
+                          ToMegabytes(MemoryStart.UsedPhysical)) /
+                             Elapsed * 60.0);
+
+  TSharedRef<FJsonObject> Packets = MakeShared<FJsonObject>();
+  Packets->SetNumberField(
+      TEXT("video_sent"),
+      (double)(RobotEnd.VideoPackets - RobotStart.VideoPackets));
+  Packets->SetNumberField(
+      TEXT("video_kbps"),
+      (RobotEnd.VideoBytes - RobotStart.VideoBytes) * 8 / 1000.0 / Elapsed);
+  Packets->SetNumberField(
+      TEXT("fec_sent"), (double)(RobotEnd.FecPackets - RobotStart.FecPackets));
+  Packets->SetNumberField(TEXT("fec_recovered"), (double)FecRecovered);
+  Packets->SetNumberField(TEXT("fec_unrecoverable"), (double)FecUnrecoverable);
+  Packets->SetNumberField(TEXT("control_sent"), (double)Quality.PacketsSent);
+  Packets->SetNumberField(TEXT("control_acked"), (double)Quality.PacketsAcked);
+  Packets->SetNumberField(TEXT("control_lost"), (double)Quality.PacketsLost);
+  Packets->SetNumberField(TEXT("control_rtt_p50_ms"), Quality.RttP50Ms);
+  Packets->SetNumberField(TEXT("control_rtt_p99_ms"), Quality.RttP99Ms);
+  Packets->SetNumberField(TEXT("control_send_jitter_ms"),
+                          SendStats.IntervalJitterMs);
+  Packets->SetNumberField(TEXT("control_missed_deadlines"),
+                          (double)SendStats.MissedDeadlines);
+  Packets->SetNumberField(TEXT("control_samples_overwritten"),
+                          (double)SamplesOverwritten);
+  Packets->SetNumberField(TEXT("control_backpressure_drops"),
+                          (double)BackpressureDrops);
+  Packets->SetNumberField(
+      TEXT("control_delivered"),
+      (double)(RobotEnd.ControlDelivered - RobotStart.ControlDelivered));
+  Packets->SetNumberField(
+      TEXT("telemetry_sent"),
+      (double)(RobotEnd.Telemetry - RobotStart.Telemetry));
+
+  Report->SetNumberField(TEXT("seconds"), Elapsed);
+  Report->SetNumberField(TEXT("tick_hz"), TickHz);
+  Report->SetStringField(TEXT("robot"), RobotConfig.ToString());
+  Report->SetObjectField(TEXT("frames"), Frames);
+  Report->SetObjectField(TEXT("latency"), Latency);
+  Report->SetObjectField(TEXT("cpu_percent"), Cpu);
+  Report->SetObjectField(TEXT("memory"), Memory);
+  Report->SetObjectField(TEXT("packets"), Packets);
+
+  // The whole loop has to have run: frames on screen, control acked, and
+  // at least one head motion seen all the way to a photon
+  const bool bPass = bSynced && FramesShown > 0 && Quality.PacketsAcked > 0 &&
+                     MotionToPhoton.Loops > 0;
+  if (!bPass) {
+    UE_LOG(LogTemp, Error,
+           TEXT("Pipeline: %lld frames shown, %lld control packets acked, "
+                "%lld motion-to-photon loops, clock %s"),
+           (long long)FramesShown, (long long)Quality.PacketsAcked,
+           (long long)MotionToPhoton.Loops,
+           bSynced ? TEXT("synced") : TEXT("not synced"));
+  }
+  return bPass;
+}
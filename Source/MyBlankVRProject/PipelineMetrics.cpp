@@ -0,0 +1,270 @@
+#include "PipelineMetrics.h"
+
+namespace PipelineMetrics {
+namespace Private {
+std::atomic<bool> bCollecting{false};
+} // namespace Private
+
+namespace {
+// Constant-initialized, so it is ready before any metric constructor runs
+std::atomic<FMetric *> Head{nullptr};
+
+// A slot is claimed first, then its series are zeroed, then its address is
+// published; exports skip slots without an address
+std::atomic<bool> LinkClaimed[MaxLinks] = {};
+std::atomic<uint32> LinkAddresses[MaxLinks] = {};
+
+constexpr double Micros = 1e-6;
+
+FString FormatNumber(double Value) {
+  if (Value == FMath::RoundToDouble(Value) && FMath::Abs(Value) < 1e15) {
+    return FString::Printf(TEXT("%lld"), (long long)Value);
+  }
+  return FString::Printf(TEXT("%.9g"), Value);
+}
+
+const TCHAR *TypeName(EMetricType Type) {
+  switch (Type) {
+  case EMetricType::Counter:
+    return TEXT("counter");
+  case EMetricType::Gauge:
+    return TEXT("gauge");
+  default:
+    return TEXT("histogram");
+  }
+}
+
+// The robot label of a published slot, with a trailing comma if asked for
+// so bucket labels can follow; empty if the slot is not in use
+FString LinkLabel(int32 Link, bool bTrailingComma) {
+  const uint32 Address = LinkAddresses[Link].load(std::memory_order_acquire);
+  if (Address == 0) {
+    return FString();
+  }
+  return FString::Printf(TEXT("robot=\"%u.%u.%u.%u\"%s"), Address >> 24,
+                         (Address >> 16) & 0xff, (Address >> 8) & 0xff,
+                         Address & 0xff, bTrailingComma ? TEXT(",") : TEXT(""));
+}
+} // namespace
+
+FMetric::FMetric(const TCHAR *InName, const TCHAR *InHelp, EMetricType InType)
+    : Name(InName), Help(InHelp), Type(InType),
+      Next(Head.load(std::memory_order_relaxed)) {
+  while (!Head.compare_exchange_weak(Next, this, std::memory_order_release,
+                                     std::memory_order_relaxed)) {
+  }
+}
+
+void FMetric::ExportHeader(FString &Out) const {
+  Out += FString::Printf(TEXT("# HELP %s %s\n# TYPE %s %s\n"), Name, Help,
+                         Name, TypeName(Type));
+}
+
+FValueMetric::FValueMetric(const TCHAR *InName, const TCHAR *InHelp,
+                           EMetricType InType, double InScale)
+    : FMetric(InName, InHelp, InType), Scale(InScale) {}
+
+void FValueMetric::Export(FString &Out) const {
+  ExportHeader(Out);
+  Out += FString::Printf(TEXT("%s %s\n"), Name,
+                         *FormatNumber(Get() * Scale));
+}
+
+FLinkValueMetric::FLinkValueMetric(const TCHAR *InName, const TCHAR *InHelp,
+                                   EMetricType InType, double InScale)
+    : FMetric(InName, InHelp, InType), Scale(InScale) {}
+
+void FLinkValueMetric::Export(FString &Out) const {
+  ExportHeader(Out);
+  for (int32 Link = 0; Link < MaxLinks; Link++) {
+    const FString Label = LinkLabel(Link, false);
+    if (!Label.IsEmpty()) {
+      Out += FString::Printf(TEXT("%s{%s} %s\n"), Name, *Label,
+                             *FormatNumber(Get(Link) * Scale));
+    }
+  }
+}
+
+void FLinkValueMetric::ResetLink(int32 Link) { Set(Link, 0); }
+
+FHistogramBase::FHistogramBase(const TCHAR *InName, const TCHAR *InHelp,
+                               std::initializer_list<int64> InBounds,
+                               double InScale)
+    : FMetric(InName, InHelp, EMetricType::Histogram), Scale(InScale),
+      NumBounds(0) {
+  check(InBounds.size() <= MaxBounds);
+  for (int64 Bound : InBounds) {
+    Bounds[NumBounds++] = Bound;
+  }
+}
+
+void FHistogramBase::Record(FSeries &Series, int64 Value) {
+  int32 Bucket = 0;
+  while (Bucket < NumBounds && Value > Bounds[Bucket]) {
+    Bucket++;
+  }
+  Series.Buckets[Bucket].fetch_add(1, std::memory_order_relaxed);
+  Series.Sum.fetch_add(Value, std::memory_order_relaxed);
+}
+
+void FHistogramBase::ExportSeries(FString &Out, const FString &Labels,
+                                  const FSeries &Series) const {
+  // The count is taken from the buckets so a scrape racing an observation
+  // still sees +Inf equal to _count
+  uint64 Cumulative = 0;
+  for (int32 i = 0; i <= NumBounds; i++) {
+    Cumulative += Series.Buckets[i].load(std::memory_order_relaxed);
+    const FString Bound =
+        i < NumBounds ? FormatNumber(Bounds[i] * Scale) : TEXT("+Inf");
+    Out += FString::Printf(TEXT("%s_bucket{%sle=\"%s\"} %llu\n"), Name,
+                           *Labels, *Bound, (unsigned long long)Cumulative);
+  }
+  // Drop the trailing comma for the sum and count label sets
+  const FString SumLabels =
+      Labels.IsEmpty() ? FString()
+                       : FString::Printf(TEXT("{%s}"), *Labels.LeftChop(1));
+  Out += FString::Printf(
+      TEXT("%s_sum%s %s\n%s_count%s %llu\n"), Name, *SumLabels,
+      *FormatNumber(Series.Sum.load(std::memory_order_relaxed) * Scale), Name,
+      *SumLabels, (unsigned long long)Cumulative);
+}
+
+void FHistogramBase::ResetSeries(FSeries &Series) {
+  for (std::atomic<uint64> &Bucket : Series.Buckets) {
+    Bucket.store(0, std::memory_order_relaxed);
+  }
+  Series.Sum.store(0, std::memory_order_relaxed);
+}
+
+FHistogram::FHistogram(const TCHAR *InName, const TCHAR *InHelp,
+                       std::initializer_list<int64> InBounds, double InScale)
+    : FHistogramBase(InName, InHelp, InBounds, InScale) {
+  ResetSeries(Series);
+}
+
+void FHistogram::Export(FString &Out) const {
+  ExportHeader(Out);
+  ExportSeries(Out, FString(), Series);
+}
+
+FLinkHistogram::FLinkHistogram(const TCHAR *InName, const TCHAR *InHelp,
+                               std::initializer_list<int64> InBounds,
+                               double InScale)
+    : FHistogramBase(InName, InHelp, InBounds, InScale) {
+  for (FSeries &Link : Series) {
+    ResetSeries(Link);
+  }
+}
+
+void FLinkHistogram::Export(FString &Out) const {
+  ExportHeader(Out);
+  for (int32 Link = 0; Link < MaxLinks; Link++) {
+    const FString Label = LinkLabel(Link, true);
+    if (!Label.IsEmpty()) {
+      ExportSeries(Out, Label, Series[Link]);
+    }
+  }
+}
+
+void FLinkHistogram::ResetLink(int32 Link) {
+  if (IsValidLink(Link)) {
+    ResetSeries(Series[Link]);
+  }
+}
+
+void StartCollecting() {
+  Private::bCollecting.store(true, std::memory_order_relaxed);
+}
+
+int32 ClaimLink(uint32 RobotAddress) {
+  for (int32 Link = 0; Link < MaxLinks; Link++) {
+    bool bClaimed = false;
+    if (!LinkClaimed[Link].compare_exchange_strong(
+            bClaimed, true, std::memory_order_acquire)) {
+      continue;
+    }
+    for (FMetric *Metric = Head.load(std::memory_order_acquire); Metric;
+         Metric = const_cast<FMetric *>(Metric->GetNext())) {
+      Metric->ResetLink(Link);
+    }
+    LinkAddresses[Link].store(RobotAddress, std::memory_order_release);
+    return Link;
+  }
+  return INDEX_NONE;
+}
+
+void ReleaseLink(int32 Link) {
+  if (IsValidLink(Link)) {
+    LinkAddresses[Link].store(0, std::memory_order_relaxed);
+    LinkClaimed[Link].store(false, std::memory_order_release);
+  }
+}
+
+const FMetric *GetFirstMetric() {
+  return Head.load(std::memory_order_acquire);
+}
+
+FString ExportText() {
+  // The list is newest first; export in definition order
+  TArray<const FMetric *> Metrics;
+  for (const FMetric *Metric = GetFirstMetric(); Metric;
+       Metric = Metric->GetNext()) {
+    Metrics.Add(Metric);
+  }
+  FString Out;
+  for (int32 i = Metrics.Num() - 1; i >= 0; i--) {
+    Metrics[i]->Export(Out);
+  }
+  return Out;
+}
+
+FCounter FramesDecoded(TEXT("fpv_video_frames_decoded_total"),
+                       TEXT("Video frames out of the decoder."));
+FCounter FramesDropped(
+    TEXT("fpv_video_frames_dropped_total"),
+    TEXT("Decoded frames replaced by a newer one before being shown."));
+FCounter FramesDisplayed(TEXT("fpv_video_frames_displayed_total"),
+                         TEXT("Video frames uploaded for display."));
+FCounter VideoPacketsRecovered(TEXT("fpv_video_packets_recovered_total"),
+                               TEXT("Lost video packets rebuilt from FEC."));
+FCounter VideoPacketsLost(
+    TEXT("fpv_video_packets_lost_total"),
+    TEXT("Lost video packets FEC could not rebuild."));
+FHistogram VideoLatency(
+    TEXT("fpv_video_latency_seconds"),
+    TEXT("Capture on the robot to the frame being shown."),
+    {20000, 30000, 40000, 50000, 60000, 80000, 100000, 120000, 150000, 200000,
+     300000, 500000, 1000000},
+    Micros);
+
+FLinkCounter ControlPacketsSent(TEXT("fpv_control_packets_sent_total"),
+                                TEXT("Control datagrams sent to the robot."));
+FLinkCounter ControlPacketsLost(
+    TEXT("fpv_control_packets_lost_total"),
+    TEXT("Control datagrams the robot's acks never covered."));
+FLinkHistogram ControlRtt(TEXT("fpv_control_rtt_seconds"),
+                          TEXT("Control datagram send to its ack."),
+                          {1000, 2000, 5000, 10000, 20000, 30000, 50000,
+                           75000, 100000, 150000, 250000, 500000},
+                          Micros);
+FLinkHistogram MotionToPhoton(
+    TEXT("fpv_motion_to_photon_seconds"),
+    TEXT("Head pose sampled to the video frame it moved the camera for."),
+    {50000, 75000, 100000, 125000, 150000, 175000, 200000, 250000, 300000,
+     400000, 500000, 750000, 1000000},
+    Micros);
+
+FLinkGauge ClockOffset(TEXT("fpv_clock_offset_seconds"),
+                       TEXT("Robot clock minus local clock."), Micros);
+FLinkGauge ClockUncertainty(TEXT("fpv_clock_uncertainty_seconds"),
+                            TEXT("Uncertainty of the robot clock estimate."),
+                            Micros);
+
+FLinkGauge ControlQueueDepth(
+    TEXT("fpv_control_queue_depth"),
+    TEXT("Control samples waiting when the I/O thread last took one."));
+FLinkGauge TelemetryQueueDepth(
+    TEXT("fpv_telemetry_queue_depth"),
+    TEXT("Telemetry snapshots waiting when the game thread last drained."));
+
+} // namespace PipelineMetrics
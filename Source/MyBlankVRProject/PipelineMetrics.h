@@ -0,0 +1,248 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include <atomic>
+#include <initializer_list>
+
+// Process-wide pipeline metrics for the operations tooling, exported in the
+// Prometheus text format by FMetricsEndpoint. Metrics are static objects
+// that link themselves into a lock-free list as they are constructed, so
+// the registry never allocates or locks and any thread may update them.
+//
+// Counters and gauges are single relaxed atomics on their own cache line.
+// Histograms cost a bucket search and two atomic adds, so they only
+// record once the endpoint has been scraped; until then an observation is
+// one relaxed load.
+//
+// Metrics of a control link are labelled robot="<IPv4 address>". A link
+// claims one of MaxLinks label slots when it attaches to a robot and frees
+// it when the robot goes; updates made without a slot are dropped.
+namespace PipelineMetrics {
+
+constexpr int32 MaxLinks = 8;
+
+enum class EMetricType : uint8 {
+  Counter,
+  Gauge,
+  Histogram,
+};
+
+// Metrics are never unlinked, so they must be static
+class FMetric {
+public:
+  FMetric(const TCHAR *InName, const TCHAR *InHelp, EMetricType InType);
+  virtual ~FMetric() = default;
+
+  // Appends the HELP, TYPE and sample lines
+  virtual void Export(FString &Out) const = 0;
+  // Zeroes one link's series; unlabelled metrics have none
+  virtual void ResetLink(int32 Link) {}
+
+  const TCHAR *GetName() const { return Name; }
+  const FMetric *GetNext() const { return Next; }
+
+protected:
+  void ExportHeader(FString &Out) const;
+
+  const TCHAR *Name;
+  const TCHAR *Help;
+  EMetricType Type;
+
+private:
+  FMetric *Next;
+};
+
+// A counter or gauge. Values are kept in whatever integer unit the producer
+// has at hand and multiplied by Scale on export, e.g. 1e-6 for
+// microseconds exported as seconds.
+class FValueMetric : public FMetric {
+public:
+  FValueMetric(const TCHAR *InName, const TCHAR *InHelp, EMetricType InType,
+               double InScale = 1.0);
+
+  void Add(int64 Amount) {
+    Value.fetch_add(Amount, std::memory_order_relaxed);
+  }
+  // For totals that are kept elsewhere and mirrored here
+  void Set(int64 NewValue) {
+    Value.store(NewValue, std::memory_order_relaxed);
+  }
+  int64 Get() const { return Value.load(std::memory_order_relaxed); }
+
+  virtual void Export(FString &Out) const override;
+
+private:
+  double Scale;
+  alignas(64) std::atomic<int64> Value{0};
+};
+
+class FCounter : public FValueMetric {
+public:
+  FCounter(const TCHAR *InName, const TCHAR *InHelp, double InScale = 1.0)
+      : FValueMetric(InName, InHelp, EMetricType::Counter, InScale) {}
+};
+
+class FGauge : public FValueMetric {
+public:
+  FGauge(const TCHAR *InName, const TCHAR *InHelp, double InScale = 1.0)
+      : FValueMetric(InName, InHelp, EMetricType::Gauge, InScale) {}
+};
+
+namespace Private {
+extern std::atomic<bool> bCollecting;
+}
+
+// False until the first scrape; histograms skip their work while false
+inline bool IsCollecting() {
+  return Private::bCollecting.load(std::memory_order_relaxed);
+}
+void StartCollecting();
+
+// Takes a label slot for a robot's link and zeroes its series, so a robot
+// that reconnects starts over. Returns INDEX_NONE when all are in use.
+int32 ClaimLink(uint32 RobotAddress);
+void ReleaseLink(int32 Link);
+
+inline bool IsValidLink(int32 Link) { return Link >= 0 && Link < MaxLinks; }
+
+// Counter or gauge with one value per link
+class FLinkValueMetric : public FMetric {
+public:
+  FLinkValueMetric(const TCHAR *InName, const TCHAR *InHelp,
+                   EMetricType InType, double InScale = 1.0);
+
+  void Add(int32 Link, int64 Amount) {
+    if (IsValidLink(Link)) {
+      Values[Link].Value.fetch_add(Amount, std::memory_order_relaxed);
+    }
+  }
+  void Set(int32 Link, int64 NewValue) {
+    if (IsValidLink(Link)) {
+      Values[Link].Value.store(NewValue, std::memory_order_relaxed);
+    }
+  }
+  int64 Get(int32 Link) const {
+    return IsValidLink(Link)
+               ? Values[Link].Value.load(std::memory_order_relaxed)
+               : 0;
+  }
+
+  virtual void Export(FString &Out) const override;
+  virtual void ResetLink(int32 Link) override;
+
+private:
+  struct alignas(64) FSlot {
+    std::atomic<int64> Value{0};
+  };
+
+  double Scale;
+  FSlot Values[MaxLinks];
+};
+
+class FLinkCounter : public FLinkValueMetric {
+public:
+  FLinkCounter(const TCHAR *InName, const TCHAR *InHelp, double InScale = 1.0)
+      : FLinkValueMetric(InName, InHelp, EMetricType::Counter, InScale) {}
+};
+
+class FLinkGauge : public FLinkValueMetric {
+public:
+  FLinkGauge(const TCHAR *InName, const TCHAR *InHelp, double InScale = 1.0)
+      : FLinkValueMetric(InName, InHelp, EMetricType::Gauge, InScale) {}
+};
+
+// Fixed upper bounds, ascending, in the unit Observe is called with; the
+// +Inf bucket is implicit
+class FHistogramBase : public FMetric {
+public:
+  static constexpr int32 MaxBounds = 15;
+
+protected:
+  struct alignas(64) FSeries {
+    std::atomic<uint64> Buckets[MaxBounds + 1];
+    std::atomic<int64> Sum;
+  };
+
+  FHistogramBase(const TCHAR *InName, const TCHAR *InHelp,
+                 std::initializer_list<int64> InBounds, double InScale);
+
+  void Record(FSeries &Series, int64 Value);
+  // Labels go before le, e.g. robot="10.0.0.2",
+  void ExportSeries(FString &Out, const FString &Labels,
+                    const FSeries &Series) const;
+  static void ResetSeries(FSeries &Series);
+
+private:
+  double Scale;
+  int64 Bounds[MaxBounds];
+  int32 NumBounds;
+};
+
+class FHistogram : public FHistogramBase {
+public:
+  FHistogram(const TCHAR *InName, const TCHAR *InHelp,
+             std::initializer_list<int64> InBounds, double InScale = 1.0);
+
+  void Observe(int64 Value) {
+    if (IsCollecting()) {
+      Record(Series, Value);
+    }
+  }
+
+  virtual void Export(FString &Out) const override;
+
+private:
+  FSeries Series;
+};
+
+// Histogram with one series per link
+class FLinkHistogram : public FHistogramBase {
+public:
+  FLinkHistogram(const TCHAR *InName, const TCHAR *InHelp,
+                 std::initializer_list<int64> InBounds, double InScale = 1.0);
+
+  void Observe(int32 Link, int64 Value) {
+    if (IsCollecting() && IsValidLink(Link)) {
+      Record(Series[Link], Value);
+    }
+  }
+
+  virtual void Export(FString &Out) const override;
+  virtual void ResetLink(int32 Link) override;
+
+private:
+  FSeries Series[MaxLinks];
+};
+
+// Head of the registry; walk it with FMetric::GetNext()
+const FMetric *GetFirstMetric();
+
+// The whole registry in the Prometheus text exposition format (0.0.4)
+FString ExportText();
+
+// Video
+extern FCounter FramesDecoded;
+extern FCounter FramesDropped;
+extern FCounter FramesDisplayed;
+extern FCounter VideoPacketsRecovered;
+extern FCounter VideoPacketsLost;
+// Capture on the robot to the frame being shown, in microseconds
+extern FHistogram VideoLatency;
+
+// Control, per link
+extern FLinkCounter ControlPacketsSent;
+extern FLinkCounter ControlPacketsLost;
+// Send to ack, in microseconds
+extern FLinkHistogram ControlRtt;
+// Head pose sampled to the frame it moved the camera for, in microseconds
+extern FLinkHistogram MotionToPhoton;
+
+// Clock, in microseconds; robot minus local, per link
+extern FLinkGauge ClockOffset;
+extern FLinkGauge ClockUncertainty;
+
+// Values waiting in a link's channel when its consumer came for them
+extern FLinkGauge ControlQueueDepth;
+extern FLinkGauge TelemetryQueueDepth;
+
+} // namespace PipelineMetrics
@@ -0,0 +1,34 @@
+#include "PipelineStats.h"
+
+DEFINE_STAT(STAT_FpvRead);
+DEFINE_STAT(STAT_FpvDecode);
+DEFINE_STAT(STAT_FpvConvert);
+DEFINE_STAT(STAT_FpvHandoff);
+DEFINE_STAT(STAT_FpvUpload);
+DEFINE_STAT(STAT_FpvSend);
+DEFINE_STAT(STAT_FpvSync);
+
+DEFINE_STAT(STAT_FpvFramesDecoded);
+DEFINE_STAT(STAT_FpvFramesDropped);
+DEFINE_STAT(STAT_FpvFramesDisplayed);
+DEFINE_STAT(STAT_FpvControlPacketsSent);
+DEFINE_STAT(STAT_FpvControlPacketsLost);
+DEFINE_STAT(STAT_FpvVideoPacketsRecovered);
+DEFINE_STAT(STAT_FpvVideoPacketsLost);
+DEFINE_STAT(STAT_FpvControlQueueDepth);
+DEFINE_STAT(STAT_FpvTelemetryQueueDepth);
+
+TRACE_DECLARE_INT_COUNTER(FpvFramesDecoded, TEXT("FPV/Frames decoded"));
+TRACE_DECLARE_INT_COUNTER(FpvFramesDropped, TEXT("FPV/Frames dropped"));
+TRACE_DECLARE_INT_COUNTER(FpvFramesDisplayed, TEXT("FPV/Frames displayed"));
+TRACE_DECLARE_INT_COUNTER(FpvControlPacketsSent,
+                          TEXT("FPV/Control packets sent"));
+TRACE_DECLARE_INT_COUNTER(FpvControlPacketsLost,
+                          TEXT("FPV/Control packets lost"));
+TRACE_DECLARE_INT_COUNTER(FpvVideoPacketsRecovered,
+                          TEXT("FPV/Video packets recovered"));
+TRACE_DECLARE_INT_COUNTER(FpvVideoPacketsLost, TEXT("FPV/Video packets lost"));
+TRACE_DECLARE_INT_COUNTER(FpvControlQueueDepth,
+                          TEXT("FPV/Control queue depth"));
+TRACE_DECLARE_INT_COUNTER(FpvTelemetryQueueDepth,
+                          TEXT("FPV/Telemetry queue depth"));
@@ -0,0 +1,126 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "PipelineMetrics.h"
+#include "ProfilingDebugging/CountersTrace.h"
+#include "ProfilingDebugging/CpuProfilerTrace.h"
+#include "Stats/Stats.h"
+
+// Video and control pipeline instrumentation: `stat FpvPipeline` live in
+// the headset or editor, and the same scopes and counters in Unreal
+// Insights (-trace=cpu,counters).
+DECLARE_STATS_GROUP(TEXT("FPV Pipeline"), STATGROUP_FpvPipeline,
+                    STATCAT_Advanced);
+
+// Per-stage time. Read includes waiting on the network; Handoff covers both
+// sides of the decoder-to-game-thread frame copy.
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Video read"), STAT_FpvRead,
+                          STATGROUP_FpvPipeline, MYBLANKVRPROJECT_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Video decode"), STAT_FpvDecode,
+                          STATGROUP_FpvPipeline, MYBLANKVRPROJECT_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Video convert"), STAT_FpvConvert,
+                          STATGROUP_FpvPipeline, MYBLANKVRPROJECT_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Frame handoff"), STAT_FpvHandoff,
+                          STATGROUP_FpvPipeline, MYBLANKVRPROJECT_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Texture upload"), STAT_FpvUpload,
+                          STATGROUP_FpvPipeline, MYBLANKVRPROJECT_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Control send"), STAT_FpvSend,
+                          STATGROUP_FpvPipeline, MYBLANKVRPROJECT_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Clock sync"), STAT_FpvSync,
+                          STATGROUP_FpvPipeline, MYBLANKVRPROJECT_API);
+
+// Totals since start
+DECLARE_DWORD_ACCUMULATOR_STAT_EXTERN(TEXT("Frames decoded"),
+                                      STAT_FpvFramesDecoded,
+                                      STATGROUP_FpvPipeline,
+                                      MYBLANKVRPROJECT_API);
+// Decoded but replaced by a newer frame before the game thread took it
+DECLARE_DWORD_ACCUMULATOR_STAT_EXTERN(TEXT("Frames dropped"),
+                                      STAT_FpvFramesDropped,
+                                      STATGROUP_FpvPipeline,
+                                      MYBLANKVRPROJECT_API);
+DECLARE_DWORD_ACCUMULATOR_STAT_EXTERN(TEXT("Frames displayed"),
+                                      STAT_FpvFramesDisplayed,
+                                      STATGROUP_FpvPipeline,
+                                      MYBLANKVRPROJECT_API);
+DECLARE_DWORD_ACCUMULATOR_STAT_EXTERN(TEXT("Control packets sent"),
+                                      STAT_FpvControlPacketsSent,
+                                      STATGROUP_FpvPipeline,
+                                      MYBLANKVRPROJECT_API);
+// Sent control the robot's acks never covered
+DECLARE_DWORD_ACCUMULATOR_STAT_EXTERN(TEXT("Control packets lost"),
+                                      STAT_FpvControlPacketsLost,
+                                      STATGROUP_FpvPipeline,
+                                      MYBLANKVRPROJECT_API);
+DECLARE_DWORD_ACCUMULATOR_STAT_EXTERN(TEXT("Video packets recovered"),
+                                      STAT_FpvVideoPacketsRecovered,
+                                      STATGROUP_FpvPipeline,
+                                      MYBLANKVRPROJECT_API);
+// Lost video packets FEC could not rebuild
+DECLARE_DWORD_ACCUMULATOR_STAT_EXTERN(TEXT("Video packets lost"),
+                                      STAT_FpvVideoPacketsLost,
+                                      STATGROUP_FpvPipeline,
+                                      MYBLANKVRPROJECT_API);
+
+// Values waiting in a channel when its consumer came for them
+DECLARE_DWORD_ACCUMULATOR_STAT_EXTERN(TEXT("Control queue depth"),
+                                      STAT_FpvControlQueueDepth,
+                                      STATGROUP_FpvPipeline,
+                                      MYBLANKVRPROJECT_API);
+DECLARE_DWORD_ACCUMULATOR_STAT_EXTERN(TEXT("Telemetry queue depth"),
+                                      STAT_FpvTelemetryQueueDepth,
+                                      STATGROUP_FpvPipeline,
+                                      MYBLANKVRPROJECT_API);
+
+TRACE_DECLARE_INT_COUNTER_EXTERN(FpvFramesDecoded);
+TRACE_DECLARE_INT_COUNTER_EXTERN(FpvFramesDropped);
+TRACE_DECLARE_INT_COUNTER_EXTERN(FpvFramesDisplayed);
+TRACE_DECLARE_INT_COUNTER_EXTERN(FpvControlPacketsSent);
+TRACE_DECLARE_INT_COUNTER_EXTERN(FpvControlPacketsLost);
+TRACE_DECLARE_INT_COUNTER_EXTERN(FpvVideoPacketsRecovered);
+TRACE_DECLARE_INT_COUNTER_EXTERN(FpvVideoPacketsLost);
+TRACE_DECLARE_INT_COUNTER_EXTERN(FpvControlQueueDepth);
+TRACE_DECLARE_INT_COUNTER_EXTERN(FpvTelemetryQueueDepth);
+
+// Times the enclosing scope as STAT_Fpv<Name>. Cycle stats reach Insights
+// as CPU scopes themselves; builds without stats still get the trace scope.
+#if STATS
+#define FPV_SCOPE(Name) SCOPE_CYCLE_COUNTER(STAT_Fpv##Name)
+#else
+#define FPV_SCOPE(Name) TRACE_CPUPROFILER_EVENT_SCOPE(Fpv##Name)
+#endif
+
+// Counters are updated in the stats, the trace and PipelineMetrics::<Name>
+// at once. Safe from any thread.
+#define FPV_COUNTER_ADD(Name, Amount)                                          \
+  do {                                                                         \
+    INC_DWORD_STAT_BY(STAT_Fpv##Name, Amount);                                 \
+    TRACE_COUNTER_ADD(Fpv##Name, Amount);                                      \
+    PipelineMetrics::Name.Add(Amount);                                         \
+  } while (0)
+
+#define FPV_COUNTER_SET(Name, Value)                                           \
+  do {                                                                         \
+    const int64 FpvCounterValue = (Value);                                     \
+    SET_DWORD_STAT(STAT_Fpv##Name, FpvCounterValue);                           \
+    TRACE_COUNTER_SET(Fpv##Name, FpvCounterValue);                             \
+    PipelineMetrics::Name.Set(FpvCounterValue);                                \
+  } while (0)
+
+// For per-link metrics: Link is the label slot from PipelineMetrics::
+// ClaimLink. Stats and trace have no labels, so with several links they
+// show the sum, or for a set the latest link to write.
+#define FPV_LINK_COUNTER_ADD(Name, Link, Amount)                               \
+  do {                                                                         \
+    INC_DWORD_STAT_BY(STAT_Fpv##Name, Amount);                                 \
+    TRACE_COUNTER_ADD(Fpv##Name, Amount);                                      \
+    PipelineMetrics::Name.Add(Link, Amount);                                   \
+  } while (0)
+
+#define FPV_LINK_COUNTER_SET(Name, Link, Value)                                \
+  do {                                                                         \
+    const int64 FpvCounterValue = (Value);                                     \
+    SET_DWORD_STAT(STAT_Fpv##Name, FpvCounterValue);                           \
+    TRACE_COUNTER_SET(Fpv##Name, FpvCounterValue);                             \
+    PipelineMetrics::Name.Set(Link, FpvCounterValue);                          \
+  } while (0)
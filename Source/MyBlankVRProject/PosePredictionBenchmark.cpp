@@ -0,0 +1,169 @@
+#include "BenchmarkScenarios.h"
+#include "HeadPosePredictor.h"
+#include "Math/RandomStream.h"
+
+namespace {
+struct FModelInfo {
+  const TCHAR *Name;
+  EHeadPosePredictionModel Model;
+};
+
+const FModelInfo Models[] = {
+    {TEXT("none"), EHeadPosePredictionModel::None},
+    {TEXT("constant_velocity"), EHeadPosePredictionModel::ConstantVelocity},
+    {TEXT("constant_acceleration"),
+     EHeadPosePredictionModel::ConstantAcceleration},
+    {TEXT("kalman"), EHeadPosePredictionModel::Kalman},
+};
+
+const double HorizonsMs[] = {25.0, 50.0, 75.0, 100.0, 150.0};
+
+// Minimum-jerk profile from 0 to 1 over Phase in [0, 1]
+double MinimumJerk(double Phase) {
+  const double T = FMath::Clamp(Phase, 0.0, 1.0);
+  return T * T * T * (10.0 - 15.0 * T + 6.0 * T * T);
+}
+
+// A driver looking around: slow drift, and quick gaze shifts of up to 90
+// degrees every second or so, sampled with a little sensor noise
+TArray<FHeadPoseSample> SynthesizeTrace(double Seconds, double SampleHz,
+                                        int32 Seed) {
+  FRandomStream Random(Seed);
+  struct FShift {
+    double Start;
+    double Duration;
+    double Pitch;
+    double Yaw;
+  };
+  TArray<FShift> Shifts;
+  for (double T = 0.5; T < Seconds; T += Random.FRandRange(0.7, 3.0)) {
+    FShift Shift;
+    Shift.Start = T;
+    Shift.Duration = Random.FRandRange(0.2, 0.5);
+    Shift.Yaw = Random.FRandRange(20.0, 90.0) * (Random.FRand() < 0.5 ? -1 : 1);
+    Shift.Pitch = Random.FRandRange(-15.0, 15.0);
+    Shifts.Add(Shift);
+  }
+
+  TArray<FHeadPoseSample> Samples;
+  const int32 Count = (int32)(Seconds * SampleHz);
+  Samples.Reserve(Count);
+  for (int32 i = 0; i < Count; i++) {
+    const double T = i / SampleHz;
+    double Pitch = 4.0 * FMath::Sin(2.0 * UE_DOUBLE_PI * 0.23 * T);
+    double Yaw = 8.0 * FMath::Sin(2.0 * UE_DOUBLE_PI * 0.17 * T) +
+                 3.0 * FMath::Sin(2.0 * UE_DOUBLE_PI * 0.71 * T);
+    for (const FShift &Shift : Shifts) {
+      if (Shift.Start > T) {
+        break;
+      }
+      const double Progress = MinimumJerk((T - Shift.Start) / Shift.Duration);
+      Pitch += Shift.Pitch * Progress;
+      Yaw += Shift.Yaw * Progress;
+    }
+    FHeadPoseSample Sample;
+    Sample.TimeUs = (int64)(T * 1e6);
+    Sample.Pitch = (float)(Pitch + Random.FRandRange(-0.02, 0.02));
+    Sample.Yaw = (float)(Yaw + Random.FRandRange(-0.02, 0.02));
+    Samples.Add(Sample);
+  }
+  return Samples;
+}
+
+// Where the head actually was at TimeUs, interpolated; Cursor only moves
+// forward
+bool PoseAt(const TArray<FHeadPoseSample> &Trace, int64 TimeUs, int32 &Cursor,
+            float &OutPitch, float &OutYaw) {
+  while (Cursor + 1 < Trace.Num() && Trace[Cursor + 1].TimeUs < TimeUs) {
+    Cursor++;
+  }
+  if (Cursor + 1 >= Trace.Num()) {
+    return false;
+  }
+  const FHeadPoseSample &A = Trace[Cursor];
+  const FHeadPoseSample &B = Trace[Cursor + 1];
+  const float Alpha = (float)(TimeUs - A.TimeUs) / (B.TimeUs - A.TimeUs);
+  OutPitch = FMath::Lerp(A.Pitch, B.Pitch, Alpha);
+  OutYaw = FMath::Lerp(A.Yaw, B.Yaw, Alpha);
+  return true;
+}
+
+// Angular error of predicting HorizonSeconds ahead from every sample
+FBenchmarkSamples Evaluate(const TArray<FHeadPoseSample> &Trace,
+                           const FHeadPosePredictorConfig &Config,
+                           double HorizonSeconds) {
+  FBenchmarkSamples ErrorDeg;
+  FHeadPosePredictor Predictor(Config);
+  int32 Cursor = 0;
+  for (const FHeadPoseSample &Sample : Trace) {
+    Predictor.AddSample(Sample);
+    const FHeadPoseSample Predicted = Predictor.Predict(HorizonSeconds);
+    float ActualPitch;
+    float ActualYaw;
+    if (!PoseAt(Trace, Sample.TimeUs + (int64)(HorizonSeconds * 1e6), Cursor,
+                ActualPitch, ActualYaw)) {
+      break;
+    }
+    ErrorDeg.Add(FMath::Sqrt(FMath::Square(Predicted.Pitch - ActualPitch) +
+                             FMath::Square(Predicted.Yaw - ActualYaw)));
+  }
+  return ErrorDeg;
+}
+} // namespace
+
+bool BenchmarkScenarios::RunPosePrediction(const FString &Params,
+                                           TSharedRef<FJsonObject> Report) {
+  FString TracePath;
+  double Seconds = 120.0;
+  double SampleHz = 90.0;
+  int32 Seed = 1;
+  FHeadPosePredictorConfig BaseConfig;
+  FParse::Value(*Params, TEXT("Trace="), TracePath);
+  FParse::Value(*Params, TEXT("Seconds="), Seconds);
+  FParse::Value(*Params, TEXT("SampleHz="), SampleHz);
+  FParse::Value(*Params, TEXT("Seed="), Seed);
+  FParse::Value(*Params, TEXT("JerkNoise="), BaseConfig.JerkNoise);
+  FParse::Value(*Params, TEXT("MaxLeadDegrees="), BaseConfig.MaxLeadDegrees);
+  // Evaluate the horizons as given, not capped
+  BaseConfig.MaxHorizonSeconds = 1.0;
+
+  TArray<FHeadPoseSample> Trace;
+  if (!TracePath.IsEmpty()) {
+    if (!HeadMotionTrace::Load(TracePath, Trace)) {
+      return false;
+    }
+  } else {
+    Trace = SynthesizeTrace(Seconds, SampleHz, Seed);
+  }
+
+  TArray<TSharedPtr<FJsonValue>> Results;
+  for (const double HorizonMs : HorizonsMs) {
+    for (const FModelInfo &Model : Models) {
+      FHeadPosePredictorConfig Config = BaseConfig;
+      Config.Model = Model.Model;
+      const FBenchmarkSamples ErrorDeg =
+          Evaluate(Trace, Config, HorizonMs / 1000.0);
+
+      UE_LOG(LogTemp, Display,
+             TEXT("PosePrediction %3.0f ms %-22s: error p50 %.2f p95 %.2f "
+                  "p99 %.2f max %.2f deg"),
+             HorizonMs, Model.Name, ErrorDeg.Percentile(50.0),
+             ErrorDeg.Percentile(95.0), ErrorDeg.Percentile(99.0),
+             ErrorDeg.Percentile(100.0));
+
+      TSharedRef<FJsonObject> Json = MakeShared<FJsonObject>();
+      Json->SetNumberField(TEXT("horizon_ms"), HorizonMs);
+      Json->SetStringField(TEXT("model"), Model.Name);
+      Json->SetObjectField(TEXT("error_deg"), ErrorDeg.ToJson());
+      Results.Add(MakeShared<FJsonValueObject>(Json));
+    }
+  }
+
+  Report->SetStringField(TEXT("trace"),
+                         TracePath.IsEmpty() ? TEXT("synthetic") : TracePath);
+  Report->SetNumberField(TEXT("samples"), Trace.Num());
+  Report->SetNumberField(TEXT("jerk_noise"), BaseConfig.JerkNoise);
+  Report->SetNumberField(TEXT("max_lead_degrees"), BaseConfig.MaxLeadDegrees);
+  Report->SetArrayField(TEXT("results"), Results);
+  return true;
+}
@@ -0,0 +1,228 @@
+#include "BenchmarkScenarios.h"
+#include "ControlRedundancy.h"
+#include "ControlWireProtocol.h"
+#include "NetworkImpairment.h"
+
+namespace {
+struct FRedundancyMode {
+  const TCHAR *Name;
+  int32 Samples;
+  int32 Duplicates;
+  double SpacingMs;
+};
+
+const FRedundancyMode Modes[] = {
+    {TEXT("plain"), 1, 0, 0.0},
+    {TEXT("bundle2"), 2, 0, 0.0},
+    {TEXT("bundle4"), 4, 0, 0.0},
+    {TEXT("dup1_2ms"), 1, 1, 2.0},
+    {TEXT("dup1_10ms"), 1, 1, 10.0},
+    {TEXT("bundle2_dup1_10ms"), 2, 1, 10.0},
+};
+
+struct FLinkCondition {
+  const TCHAR *Name;
+  bool bBursty;
+  double LossRate;
+  double BurstLength;
+};
+
+// Loss seen on field Wi-Fi: light random loss, and fades that take out runs
+// of packets
+const FLinkCondition Conditions[] = {
+    {TEXT("bernoulli_1pct"), false, 0.01, 1.0},
+    {TEXT("bernoulli_5pct"), false, 0.05, 1.0},
+    {TEXT("burst_5pct_len4"), true, 0.05, 4.0},
+    {TEXT("burst_10pct_len8"), true, 0.10, 8.0},
+};
+
+constexpr int32 ControlSampleSize =
+    ControlWire::TMessage<ControlWire::FControlPayload>::FSchema::Size;
+
+struct FDatagram {
+  double SendTime;
+  uint32 Sequence;
+  int32 Size;
+  int32 Count;
+};
+
+struct FDelivery {
+  double Time;
+  int32 Datagram;
+};
+
+struct FRedundancyResult {
+  int64 Datagrams = 0;
+  int64 Bytes = 0;
+  int64 Lost = 0;
+  int64 Recovered = 0;
+  FBenchmarkSamples UpdateGapsMs;
+};
+
+// Sends NumSamples control samples at RateHz through one impairment model
+// and feeds whatever arrives to the robot-side decoder. Samples the robot
+// never sees count as lost; the gaps between the robot's newest-sample
+// updates are what it experiences as a stale command.
+FRedundancyResult RunTrial(const FRedundancyMode &Mode,
+                           const FImpairmentConfig &Link, int32 NumSamples,
+                           double RateHz) {
+  FRedundancyResult Result;
+  const double Period = 1.0 / RateHz;
+
+  // Every datagram in send order, copies included
+  TArray<FDatagram> Datagrams;
+  Datagrams.Reserve(NumSamples * (Mode.Duplicates + 1));
+  for (int32 i = 0; i < NumSamples; i++) {
+    FDatagram Datagram;
+    Datagram.Sequence = (uint32)i;
+    Datagram.Count = FMath::Min(Mode.Samples, i + 1);
+    Datagram.Size = Mode.Samples > 1
+                        ? ControlWire::HeaderSize + 1 +
+                              Datagram.Count * ControlSampleSize
+                        : ControlWire::PacketSize<ControlWire::FControlPayload>;
+    for (int32 Copy = 0; Copy <= Mode.Duplicates; Copy++) {
+      Datagram.SendTime = i * Period + Copy * Mode.SpacingMs / 1000.0;
+      Datagrams.Add(Datagram);
+    }
+  }
+  Datagrams.Sort([](const FDatagram &A, const FDatagram &B) {
+    return A.SendTime < B.SendTime;
+  });
+
+  FImpairmentModel Model(Link);
+  TArray<FDelivery> Deliveries;
+  double DeliveryTimes[2];
+  for (int32 i = 0; i < Datagrams.Num(); i++) {
+    Result.Datagrams++;
+    Result.Bytes += Datagrams[i].Size;
+    const int32 Copies =
+        Model.Process(Datagrams[i].SendTime, Datagrams[i].Size, DeliveryTimes);
+    for (int32 Copy = 0; Copy < Copies; Copy++) {
+      Deliveries.Add({DeliveryTimes[Copy], i});
+    }
+  }
+  Deliveries.Sort([](const FDelivery &A, const FDelivery &B) {
+    return A.Time < B.Time;
+  });
+
+  FControlRedundancyDecoder Decoder;
+  ControlWire::FControlPayload Samples[ControlWire::MaxBundleSamples] = {};
+  bool bUpdated = false;
+  double LastUpdate = 0.0;
+  uint32 Newest = 0;
+  for (const FDelivery &Delivery : Deliveries) {
+    const FDatagram &Datagram = Datagrams[Delivery.Datagram];
+    Decoder.Receive(Datagram.Sequence, Samples, Datagram.Count,
+                    [&](uint32 Sequence, const ControlWire::FControlPayload &) {
+                      if (bUpdated && (int32)(Sequence - Newest) <= 0) {
+                        return;
+                      }
+                      if (bUpdated) {
+                        Result.UpdateGapsMs.Add(
+                            (Delivery.Time - LastUpdate) * 1000.0);
+                      }
+                      bUpdated = true;
+                      LastUpdate = Delivery.Time;
+                      Newest = Sequence;
+                    });
+  }
+
+  Result.Lost = NumSamples - Decoder.GetStats().Delivered;
+  Result.Recovered = Decoder.GetStats().Recovered;
+  return Result;
+}
+
+// An operator restarting mid-stream sends sequence 0 again. Its samples
+// must be delivered as a new session, not dropped as too old, while late
+// and duplicated copies of the old session are still filtered.
+bool CheckRestart() {
+  FControlRedundancyDecoder Decoder;
+  ControlWire::FControlPayload Samples[2];
+  int64 Delivered = 0;
+  auto Count = [&Delivered](uint32, const ControlWire::FControlPayload &) {
+    Delivered++;
+  };
+  for (uint32 Sequence = 0; Sequence < 5000; Sequence++) {
+    Decoder.Receive(Sequence, Samples, 1, Count);
+  }
+  // A late copy and a duplicate of the old session
+  Decoder.Receive(4990, Samples, 1, Count);
+  Decoder.Receive(4999, Samples, 1, Count);
+  if (Delivered != 5000 || Decoder.GetStats().Restarts != 0) {
+    return false;
+  }
+
+  Decoder.Receive(0, Samples, 1, Count);
+  Decoder.Receive(1, Samples, 2, Count);
+  return Delivered == 5002 && Decoder.GetStats().Restarts == 1 &&
+         Decoder.GetHighest() == 1 && Decoder.GetReceivedMask() == 1;
+}
+} // namespace
+
+bool BenchmarkScenarios::RunRedundancyLoss(const FString &Params,
+                                           TSharedRef<FJsonObject> Report) {
+  int32 NumSamples = 250000;
+  double RateHz = 250.0;
+  int32 Seed = 1;
+  FParse::Value(*Params, TEXT("Samples="), NumSamples);
+  FParse::Value(*Params, TEXT("RateHz="), RateHz);
+  FParse::Value(*Params, TEXT("Seed="), Seed);
+
+  if (!CheckRestart()) {
+    UE_LOG(LogTemp, Error,
+           TEXT("RedundancyLoss: decoder dropped a restarted sender"));
+    return false;
+  }
+
+  TArray<TSharedPtr<FJsonValue>> Results;
+  for (const FLinkCondition &Condition : Conditions) {
+    FImpairmentConfig Link;
+    Link.DelayMs = 5.0;
+    Link.JitterMs = 2.0;
+    Link.Seed = Seed;
+    if (Condition.bBursty) {
+      Link.SetGilbertElliott(Condition.LossRate, Condition.BurstLength);
+    } else {
+      Link.LossModel = EImpairmentLossModel::Bernoulli;
+      Link.LossRate = Condition.LossRate;
+    }
+
+    int64 BaselineBytes = 0;
+    for (const FRedundancyMode &Mode : Modes) {
+      FRedundancyResult Result = RunTrial(Mode, Link, NumSamples, RateHz);
+      if (BaselineBytes == 0) {
+        BaselineBytes = Result.Bytes;
+      }
+      const double EffectiveLoss = (double)Result.Lost / NumSamples;
+      const double Kbps = Result.Bytes * 8.0 / 1000.0 / (NumSamples / RateHz);
+
+      UE_LOG(LogTemp, Display,
+             TEXT("RedundancyLoss %s %s: effective loss %.4f%%, %.1f kbit/s "
+                  "(x%.2f), update gap p99 %.2f ms max %.2f ms"),
+             Condition.Name, Mode.Name, EffectiveLoss * 100.0, Kbps,
+             (double)Result.Bytes / BaselineBytes,
+             Result.UpdateGapsMs.Percentile(99.0),
+             Result.UpdateGapsMs.Percentile(100.0));
+
+      TSharedRef<FJsonObject> Json = MakeShared<FJsonObject>();
+      Json->SetStringField(TEXT("condition"), Condition.Name);
+      Json->SetStringField(TEXT("mode"), Mode.Name);
+      Json->SetNumberField(TEXT("samples_per_datagram"), Mode.Samples);
+      Json->SetNumberField(TEXT("duplicates"), Mode.Duplicates);
+      Json->SetNumberField(TEXT("duplicate_spacing_ms"), Mode.SpacingMs);
+      Json->SetNumberField(TEXT("effective_loss"), EffectiveLoss);
+      Json->SetNumberField(TEXT("recovered"), (double)Result.Recovered);
+      Json->SetNumberField(TEXT("datagrams"), (double)Result.Datagrams);
+      Json->SetNumberField(TEXT("kbps"), Kbps);
+      Json->SetNumberField(TEXT("bandwidth_ratio"),
+                           (double)Result.Bytes / BaselineBytes);
+      Json->SetObjectField(TEXT("update_gap_ms"), Result.UpdateGapsMs.ToJson());
+      Results.Add(MakeShared<FJsonValueObject>(Json));
+    }
+  }
+
+  Report->SetNumberField(TEXT("samples"), NumSamples);
+  Report->SetNumberField(TEXT("rate_hz"), RateHz);
+  Report->SetArrayField(TEXT("results"), Results);
+  return true;
+}
@@ -0,0 +1,65 @@
+#include "RendezvousFallback.h"
+#include "HttpModule.h"
+#include "SocketSubsystem.h"
+#include "interfaces/IHttpRequest.h"
+#include "interfaces/IHttpResponse.h"
+
+void FHttpRendezvousFallback::Announce() {
+  // 1) Get local IP
+  bool bCanBindAll;
+  TSharedRef<FInternetAddr> LocalAddr =
+      ISocketSubsystem::Get(PLATFORM_SOCKETSUBSYSTEM)
+          ->GetLocalHostAddr(*GLog, bCanBindAll);
+  FString LocalIP = LocalAddr->IsValid() ? LocalAddr->ToString(false)
+                                         : TEXT("UnknownLocalIP");
+
+  // 2) Get public IP from a simple external service
+  TSharedRef<IHttpRequest> PublicIPRequest = FHttpModule::Get().CreateRequest();
+  PublicIPRequest->SetURL(TEXT(
+      "https://api.ipify.org?format=text")); // or another service you prefer
+  PublicIPRequest->SetVerb(TEXT("GET"));
+
+  PublicIPRequest->OnProcessRequestComplete().BindLambda(
+      [LocalIP](FHttpRequestPtr Request, FHttpResponsePtr Response,
+                bool bConnectedSuccessfully) {
+        if (!bConnectedSuccessfully || !Response.IsValid()) {
+          UE_LOG(LogTemp, Warning, TEXT("Failed to retrieve public IP."));
+          return;
+        }
+
+        FString PublicIP = Response->GetContentAsString();
+        UE_LOG(LogTemp, Log, TEXT("Local IP: %s, Public IP: %s"), *LocalIP,
+               *PublicIP);
+
+        // 3) Now POST to http://{IP}:{PORT}/server with the JSON payload
+        FString ServerIP = TEXT("3.215.138.208"); // hard-coded server to notify
+        FString PostURL =
+            FString::Printf(TEXT("http://%s:%d/server"), *ServerIP, 4337);
+
+        TSharedRef<IHttpRequest> PostRequest =
+            FHttpModule::Get().CreateRequest();
+        PostRequest->SetURL(PostURL);
+        PostRequest->SetVerb(TEXT("POST"));
+        PostRequest->SetHeader(TEXT("Content-Type"), TEXT("application/json"));
+
+        FString Payload =
+            FString::Printf(TEXT("{\"server_port\":\"12345\",\"server_local_"
+                                 "ip\":\"%s\",\"server_public_ip\":\"%s\"}"),
+                            *LocalIP, *PublicIP);
+        PostRequest->SetContentAsString(Payload);
+
+        PostRequest->OnProcessRequestComplete().BindLambda(
+            [](FHttpRequestPtr Req, FHttpResponsePtr Resp, bool bConn) {
+              if (bConn && Resp.IsValid()) {
+                UE_LOG(LogTemp, Log, TEXT("POST response: %s"),
+                       *Resp->GetContentAsString());
+              } else {
+                UE_LOG(LogTemp, Warning, TEXT("POST failed."));
+              }
+            });
+        PostRequest->ProcessRequest();
+      });
+
+  // Start the GET to find public IP
+  PublicIPRequest->ProcessRequest();
+}
@@ -0,0 +1,20 @@
+#pragma once
+
+#include "CoreMinimal.h"
+
+// Last resort for reaching a robot that LAN discovery cannot see, e.g. one
+// behind NAT. The control link server calls Announce on the game thread once
+// discovery has found nobody for a while.
+class IRendezvousFallback {
+public:
+  virtual ~IRendezvousFallback() = default;
+
+  virtual void Announce() = 0;
+};
+
+// Looks up our public IP and registers local and public addresses with the
+// remote rendezvous server over HTTP.
+class FHttpRendezvousFallback : public IRendezvousFallback {
+public:
+  virtual void Announce() override;
+};
@@ -0,0 +1,585 @@
+#include "RobotStandIn.h"
+#include "ClockSync.h"
+#include "HAL/PlatformTime.h"
+#include "Misc/FileHelper.h"
+#include "SocketSubsystem.h"
+#include "Sockets.h"
+
+extern "C" {
+#include <libavcodec/avcodec.h>
+#include <libavutil/opt.h>
+}
+
+namespace {
+// RTP payload per packet, well inside a 1500 byte MTU with FEC headers
+constexpr int32 MaxRtpPayload = 1200;
+constexpr uint8 RtpPayloadType = 96;
+constexpr uint8 FuANalType = 28;
+// Horizontal field of view the test pattern pans across, as the video
+// actor's default
+constexpr float PatternFovDegrees = 90.0f;
+
+const TCHAR *VideoModeName(EStandInVideo Mode) {
+  switch (Mode) {
+  case EStandInVideo::Marker:
+    return TEXT("Marker");
+  case EStandInVideo::Encoded:
+    return TEXT("Encoded");
+  default:
+    return TEXT("Off");
+  }
+}
+
+// Calls Visit for each NAL unit of an Annex-B access unit, start code
+// stripped
+template <typename TVisit>
+void ForEachNal(const uint8 *Data, int32 Size, TVisit Visit) {
+  int32 Start = -1;
+  int32 i = 0;
+  while (i + 3 <= Size) {
+    if (Data[i] == 0 && Data[i + 1] == 0 && Data[i + 2] == 1) {
+      if (Start >= 0) {
+        // A four-byte start code leaves a zero on the previous unit
+        int32 End = i;
+        while (End > Start && Data[End - 1] == 0) {
+          End--;
+        }
+        Visit(Data + Start, End - Start);
+      }
+      i += 3;
+      Start = i;
+      continue;
+    }
+    i++;
+  }
+  if (Start >= 0 && Start < Size) {
+    Visit(Data + Start, Size - Start);
+  }
+}
+} // namespace
+
+FRobotStandInConfig FRobotStandInConfig::FromParams(const TCHAR *Params) {
+  FRobotStandInConfig Config;
+  FParse::Value(Params, TEXT("Bind="), Config.Address);
+  FParse::Value(Params, TEXT("DiscoveryPort="), Config.DiscoveryPort);
+  double ClockOffsetMs = 0.0;
+  if (FParse::Value(Params, TEXT("ClockOffsetMs="), ClockOffsetMs)) {
+    Config.ClockOffsetUs = (int64)(ClockOffsetMs * 1000.0);
+  }
+  FParse::Value(Params, TEXT("UplinkMs="), Config.UplinkMs);
+  FParse::Value(Params, TEXT("ActuationMs="), Config.ActuationMs);
+  FParse::Value(Params, TEXT("TelemetryHz="), Config.TelemetryHz);
+
+  FString VideoName;
+  if (FParse::Value(Params, TEXT("Video="), VideoName)) {
+    for (EStandInVideo Mode : {EStandInVideo::Off, EStandInVideo::Marker,
+                               EStandInVideo::Encoded}) {
+      if (VideoName.Equals(VideoModeName(Mode), ESearchCase::IgnoreCase)) {
+        Config.Video = Mode;
+      }
+    }
+  }
+  FParse::Value(Params, TEXT("VideoHost="), Config.VideoAddress);
+  FParse::Value(Params, TEXT("VideoPort="), Config.VideoPort);
+  FParse::Value(Params, TEXT("Width="), Config.Width);
+  FParse::Value(Params, TEXT("Height="), Config.Height);
+  FParse::Value(Params, TEXT("FrameHz="), Config.FrameHz);
+  FParse::Value(Params, TEXT("Bitrate="), Config.Bitrate);
+  FParse::Value(Params, TEXT("EncodeMs="), Config.EncodeMs);
+  FParse::Value(Params, TEXT("FecGroup="), Config.FecGroupSize);
+  FParse::Value(Params, TEXT("FecPort="), Config.FecPort);
+  Config.bLogControl = FParse::Param(Params, TEXT("LogControl"));
+  return Config;
+}
+
+FString FRobotStandInConfig::ToString() const {
+  FString Result = FString::Printf(
+      TEXT("%s clock %+.1f ms, uplink %.1f ms, actuation %.1f ms, "
+           "telemetry %.0f Hz, video %s"),
+      *Address, ClockOffsetUs / 1000.0, UplinkMs, ActuationMs, TelemetryHz,
+      VideoModeName(Video));
+  if (Video != EStandInVideo::Off) {
+    Result += FString::Printf(TEXT(" %dx%d@%.0f to %s:%d, encode %.1f ms"),
+                              Width, Height, FrameHz, *VideoAddress,
+                              VideoPort, EncodeMs);
+    if (FecGroupSize > 0) {
+      Result += FString::Printf(TEXT(", FEC 1/%d to %d"), FecGroupSize,
+                                FecPort);
+    }
+  }
+  return Result;
+}
+
+FRobotStandIn::FRobotStandIn(const FRobotStandInConfig &InConfig)
+    : Config(InConfig), VideoMode(InConfig.Video),
+      RtpSsrc(FGuid::NewGuid().B),
+      FecEncoder(FMath::Max(InConfig.FecGroupSize, 1)) {}
+
+FRobotStandIn::~FRobotStandIn() { Close(); }
+
+bool FRobotStandIn::Open() {
+  ISocketSubsystem *SocketSubsystem =
+      ISocketSubsystem::Get(PLATFORM_SOCKETSUBSYSTEM);
+  DiscoverySocket = SocketSubsystem->CreateSocket(
+      NAME_DGram, TEXT("RobotStandInDiscovery"), false);
+  SyncSocket = SocketSubsystem->CreateSocket(
+      NAME_DGram, TEXT("RobotStandInSync"), false);
+  ControlSocket = SocketSubsystem->CreateSocket(
+      NAME_DGram, TEXT("RobotStandInControl"), false);
+  VideoSocket = SocketSubsystem->CreateSocket(
+      NAME_DGram, TEXT("RobotStandInVideo"), false);
+  if (!DiscoverySocket || !SyncSocket || !ControlSocket || !VideoSocket) {
+    return false;
+  }
+
+  bool bValid = false;
+  TSharedRef<FInternetAddr> Addr = SocketSubsystem->CreateInternetAddr();
+  Addr->SetIp(*Config.Address, bValid);
+  if (!bValid) {
+    UE_LOG(LogTemp, Error, TEXT("RobotStandIn: bad address %s"),
+           *Config.Address);
+    return false;
+  }
+  int32 ActualSize = 0;
+  for (FSocket *Socket :
+       {DiscoverySocket, SyncSocket, ControlSocket, VideoSocket}) {
+    Socket->SetNonBlocking(true);
+    Addr->SetPort(Socket == DiscoverySocket ? Config.DiscoveryPort : 0);
+    if (!Socket->Bind(*Addr)) {
+      UE_LOG(LogTemp, Error, TEXT("RobotStandIn: failed to bind %s:%d"),
+             *Config.Address, Addr->GetPort());
+      return false;
+    }
+  }
+  // Keyframes burst well past the default buffer
+  VideoSocket->SetSendBufferSize(1024 * 1024, ActualSize);
+
+  VideoAddr = SocketSubsystem->CreateInternetAddr();
+  VideoAddr->SetIp(*Config.VideoAddress, bValid);
+  VideoAddr->SetPort(Config.VideoPort);
+  FecAddr = SocketSubsystem->CreateInternetAddr();
+  FecAddr->SetIp(*Config.VideoAddress, bValid);
+  FecAddr->SetPort(Config.FecPort);
+
+  if (VideoMode == EStandInVideo::Encoded && !OpenEncoder()) {
+    UE_LOG(LogTemp, Warning,
+           TEXT("RobotStandIn: no H.264 encoder, sending marker frames"));
+    VideoMode = EStandInVideo::Marker;
+  }
+  UE_LOG(LogTemp, Log, TEXT("Robot stand-in %s"), *Config.ToString());
+  return true;
+}
+
+void FRobotStandIn::Close() {
+  ISocketSubsystem *SocketSubsystem =
+      ISocketSubsystem::Get(PLATFORM_SOCKETSUBSYSTEM);
+  for (FSocket **Socket :
+       {&DiscoverySocket, &SyncSocket, &ControlSocket, &VideoSocket}) {
+    if (*Socket) {
+      (*Socket)->Close();
+      SocketSubsystem->DestroySocket(*Socket);
+      *Socket = nullptr;
+    }
+  }
+  CloseEncoder();
+}
+
+void FRobotStandIn::Poll(int64 NowUs) {
+  ReceiveDiscovery();
+  ReceiveClockSync();
+  ReceiveControl(NowUs);
+  ApplyArrivedControl(NowUs);
+  UpdateGimbal(NowUs);
+  SendTelemetry(NowUs);
+  if (VideoMode != EStandInVideo::Off) {
+    Capture(NowUs);
+    SendFrames(NowUs);
+  }
+}
+
+void FRobotStandIn::ReceiveDiscovery() {
+  TSharedRef<FInternetAddr> Sender =
+      ISocketSubsystem::Get(PLATFORM_SOCKETSUBSYSTEM)->CreateInternetAddr();
+  uint8 Buffer[ControlWire::MaxPacketSize];
+  int32 BytesRead = 0;
+  while (DiscoverySocket->RecvFrom(Buffer, sizeof(Buffer), BytesRead,
+                                   *Sender) &&
+         BytesRead > 0) {
+    ControlWire::FHeader Header;
+    ControlWire::FDiscoveryPayload Beacon;
+    if (!ControlWire::DecodeHeader(Buffer, BytesRead, Header) ||
+        !ControlWire::DecodePayload(Buffer, BytesRead, Beacon)) {
+      continue;
+    }
+    Stats.Beacons++;
+    // Announce both endpoints from the sockets they live on
+    ControlWire::FHelloPayload Hello;
+    Hello.SessionId = Beacon.SessionId;
+    uint8 Packet[ControlWire::MaxPacketSize];
+    const int32 Size =
+        ControlWire::Encode(HelloSequence++, 0, Hello, Packet, sizeof(Packet));
+    int32 Sent = 0;
+    Sender->SetPort(Beacon.ClockSyncPort);
+    SyncSocket->SendTo(Packet, Size, Sent, *Sender);
+    Sender->SetPort(Beacon.ControlPort);
+    ControlSocket->SendTo(Packet, Size, Sent, *Sender);
+    OperatorAddr = Sender->Clone();
+  }
+}
+
+void FRobotStandIn::ReceiveClockSync() {
+  TSharedRef<FInternetAddr> Sender =
+      ISocketSubsystem::Get(PLATFORM_SOCKETSUBSYSTEM)->CreateInternetAddr();
+  uint8 Buffer[ControlWire::MaxPacketSize];
+  int32 BytesRead = 0;
+  while (SyncSocket->RecvFrom(Buffer, sizeof(Buffer), BytesRead, *Sender) &&
+         BytesRead > 0) {
+    ControlWire::FHeader Header;
+    ControlWire::FClockSyncPayload Sync;
+    if (!ControlWire::DecodeHeader(Buffer, BytesRead, Header) ||
+        !ControlWire::DecodePayload(Buffer, BytesRead, Sync)) {
+      continue;
+    }
+    Sync.ReceiveUs = ToRobotUs(ClockSync::NowMicros());
+    Sync.TransmitUs = Sync.ReceiveUs;
+    uint8 Reply[ControlWire::MaxPacketSize];
+    const int32 Size = ControlWire::Encode(Header.Sequence, Sync.TransmitUs,
+                                           Sync, Reply, sizeof(Reply));
+    int32 Sent = 0;
+    SyncSocket->SendTo(Reply, Size, Sent, *Sender);
+    Stats.ClockSyncReplies++;
+  }
+}
+
+void FRobotStandIn::ReceiveControl(int64 NowUs) {
+  TSharedRef<FInternetAddr> Sender =
+      ISocketSubsystem::Get(PLATFORM_SOCKETSUBSYSTEM)->CreateInternetAddr();
+  uint8 Buffer[ControlWire::MaxPacketSize];
+  int32 BytesRead = 0;
+  while (ControlSocket->RecvFrom(Buffer, sizeof(Buffer), BytesRead,
+                                 *Sender) &&
+         BytesRead > 0) {
+    ControlWire::FHeader Header;
+    if (!ControlWire::DecodeHeader(Buffer, BytesRead, Header)) {
+      continue;
+    }
+    FControlDatagram Datagram;
+    Datagram.ArrivalUs = NowUs + (int64)(Config.UplinkMs * 1000.0);
+    Datagram.Sequence = Header.Sequence;
+    Datagram.Count =
+        ControlWire::DecodePayload(Buffer, BytesRead, Datagram.Samples[0])
+            ? 1
+            : ControlWire::DecodeControlBundle(Buffer, BytesRead,
+                                               Datagram.Samples);
+    if (Datagram.Count == 0) {
+      continue;
+    }
+    Stats.ControlDatagrams++;
+    OperatorAddr = Sender->Clone();
+    Uplink.Add(Datagram);
+  }
+}
+
+void FRobotStandIn::ApplyArrivedControl(int64 NowUs) {
+  int32 Arrived = 0;
+  for (; Arrived < Uplink.Num() && Uplink[Arrived].ArrivalUs <= NowUs;
+       Arrived++) {
+    const FControlDatagram &Datagram = Uplink[Arrived];
+    const uint64 ReceiveUs = ToRobotUs(Datagram.ArrivalUs);
+    Decoder.Receive(
+        Datagram.Sequence, Datagram.Samples, Datagram.Count,
+        [&](uint32 Sequence, const ControlWire::FControlPayload &Sample) {
+          Actuating.Add({Datagram.ArrivalUs +
+                             (int64)(Config.ActuationMs * 1000.0),
+                         Sequence, Sample});
+          if (Config.bLogControl) {
+            ControlLog.Add({Sequence, ReceiveUs, Sample});
+          }
+        });
+
+    // Every datagram is acked, late and duplicate ones included. The mask
+    // is only known relative to the newest sequence.
+    ControlWire::FControlAckPayload Ack;
+    Ack.AckedSequence = Datagram.Sequence;
+    Ack.ReceivedMask = Decoder.GetHighest() == Datagram.Sequence
+                           ? Decoder.GetReceivedMask()
+                           : 0;
+    Ack.ReceiveUs = ReceiveUs;
+    uint8 Packet[ControlWire::MaxPacketSize];
+    const int32 Size = ControlWire::Encode(AckSequence++, ToRobotUs(NowUs),
+                                           Ack, Packet, sizeof(Packet));
+    int32 Sent = 0;
+    ControlSocket->SendTo(Packet, Size, Sent, *OperatorAddr);
+    Stats.Acks++;
+  }
+  Uplink.RemoveAt(0, Arrived);
+
+  const FControlRedundancyDecoder::FStats &DecoderStats = Decoder.GetStats();
+  Stats.ControlDelivered = DecoderStats.Delivered;
+  Stats.ControlRecovered = DecoderStats.Recovered;
+}
+
+void FRobotStandIn::UpdateGimbal(int64 NowUs) {
+  int32 Applied = 0;
+  for (; Applied < Actuating.Num() && Actuating[Applied].AppliedUs <= NowUs;
+       Applied++) {
+    // A recovered older sample does not move the gimbal back
+    if (!bGimbalMoved ||
+        (int32)(Actuating[Applied].Sequence - Gimbal.Sequence) > 0) {
+      Gimbal = Actuating[Applied];
+      bGimbalMoved = true;
+    }
+  }
+  Actuating.RemoveAt(0, Applied);
+}
+
+void FRobotStandIn::SendTelemetry(int64 NowUs) {
+  if (Config.TelemetryHz <= 0.0 || !OperatorAddr.IsValid() ||
+      NowUs < NextTelemetryUs) {
+    return;
+  }
+  const int64 IntervalUs = (int64)(1e6 / Config.TelemetryHz);
+  NextTelemetryUs = FMath::Max(NextTelemetryUs + IntervalUs, NowUs);
+  const double Seconds =
+      LastTelemetryUs > 0 ? (NowUs - LastTelemetryUs) / 1e6 : 0.0;
+  LastTelemetryUs = NowUs;
+  PoweredSeconds += Seconds;
+
+  // Speed eases toward the trigger's share of 15 mph with a half-second
+  // time constant. The drive battery empties over about ten miles, the
+  // control battery over a couple of hours.
+  const float TargetMph = 15.0f * FMath::Clamp(Gimbal.Sample.TriggerPosition,
+                                               0.0f, 1.0f);
+  SpeedMph += (TargetMph - SpeedMph) *
+              (float)FMath::Min(1.0, Seconds / 0.5);
+  DistanceFeet += SpeedMph * 5280.0 / 3600.0 * Seconds;
+
+  ControlWire::FTelemetryPayload Payload;
+  Payload.SpeedMph = SpeedMph;
+  Payload.DistanceFeet = (float)DistanceFeet;
+  Payload.DriveBatteryPercentage =
+      (uint8)FMath::Clamp(100 - (int32)(DistanceFeet / 500.0), 5, 100);
+  Payload.ControlBatteryPercentage =
+      (uint8)FMath::Clamp(100 - (int32)(PoweredSeconds / 72.0), 5, 100);
+  uint8 Packet[ControlWire::MaxPacketSize];
+  const int32 Size = ControlWire::Encode(TelemetrySequence++, ToRobotUs(NowUs),
+                                         Payload, Packet, sizeof(Packet));
+  int32 Sent = 0;
+  ControlSocket->SendTo(Packet, Size, Sent, *OperatorAddr);
+  Stats.Telemetry++;
+}
+
+void FRobotStandIn::Capture(int64 NowUs) {
+  if (NextCaptureUs == 0) {
+    NextCaptureUs = NowUs;
+  }
+  if (NowUs < NextCaptureUs) {
+    return;
+  }
+  FFrameInFlight Frame;
+  Frame.CaptureUs = NextCaptureUs;
+  NextCaptureUs += (int64)(1e6 / Config.FrameHz);
+  if (NextCaptureUs < NowUs) {
+    // Fell a whole frame behind; skip ahead rather than burst
+    NextCaptureUs = NowUs;
+  }
+
+  FVideoFramePose Pose;
+  Pose.CaptureRobotUs = ToRobotUs(Frame.CaptureUs);
+  Pose.ControlSequence = Gimbal.Sequence;
+  Pose.bHasGimbalPose = bGimbalMoved;
+  Pose.GimbalPitch = Gimbal.Sample.Pitch;
+  Pose.GimbalYaw = Gimbal.Sample.Yaw;
+  uint8 Sei[128];
+  const int32 SeiSize =
+      VideoPoseSei::Encode(EVideoCodec::H264, Pose, Sei, sizeof(Sei));
+  Frame.AccessUnit.Append(Sei, SeiSize);
+
+  if (VideoMode == EStandInVideo::Encoded) {
+    const double EncodeStart = FPlatformTime::Seconds();
+    if (!EncodeTestPattern(FrameIndex++, Frame.AccessUnit)) {
+      return;
+    }
+    Stats.EncodeSeconds += FPlatformTime::Seconds() - EncodeStart;
+  } else {
+    // Stand-in IDR slice
+    const uint8 Slice[] = {0, 0, 0, 1, 0x65, 0x88, 0x84, 0x21, 0xa0};
+    Frame.AccessUnit.Append(Slice, sizeof(Slice));
+  }
+
+  Frame.SendUs = Frame.CaptureUs + (int64)(Config.EncodeMs * 1000.0);
+  const int64 DoneUs = ClockSync::NowMicros();
+  if (DoneUs > Frame.SendUs + (int64)(1e6 / Config.FrameHz)) {
+    Stats.LateFrames++;
+  }
+  Encoding.Add(MoveTemp(Frame));
+}
+
+void FRobotStandIn::SendFrames(int64 NowUs) {
+  int32 Due = 0;
+  for (; Due < Encoding.Num() && Encoding[Due].SendUs <= NowUs; Due++) {
+    SendRtp(Encoding[Due]);
+    Stats.Frames++;
+  }
+  Encoding.RemoveAt(0, Due);
+}
+
+void FRobotStandIn::SendRtp(const FFrameInFlight &Frame) {
+  const uint32 Timestamp = (uint32)(Frame.CaptureUs * 9 / 100);
+  uint8 Packet[RtpFec::RtpHeaderSize + MaxRtpPayload];
+  auto WriteHeader = [&](bool bMarker) {
+    Packet[0] = 0x80;
+    Packet[1] = (uint8)((bMarker ? 0x80 : 0) | RtpPayloadType);
+    RtpFec::WriteUInt16(Packet + 2, RtpSequence++);
+    for (int32 i = 0; i < 4; i++) {
+      Packet[4 + i] = (uint8)(Timestamp >> (24 - 8 * i));
+      Packet[8 + i] = (uint8)(RtpSsrc >> (24 - 8 * i));
+    }
+  };
+
+  // Find the last NAL unit first, for the marker bit
+  const uint8 *LastNal = nullptr;
+  ForEachNal(Frame.AccessUnit.GetData(), Frame.AccessUnit.Num(),
+             [&](const uint8 *Nal, int32) { LastNal = Nal; });
+
+  ForEachNal(
+      Frame.AccessUnit.GetData(), Frame.AccessUnit.Num(),
+      [&](const uint8 *Nal, int32 NalSize) {
+        const bool bLastNal = Nal == LastNal;
+        if (NalSize <= MaxRtpPayload) {
+          WriteHeader(bLastNal);
+          FMemory::Memcpy(Packet + RtpFec::RtpHeaderSize, Nal, NalSize);
+          SendVideoPacket(Packet, RtpFec::RtpHeaderSize + NalSize);
+          return;
+        }
+        // FU-A: the NAL header is split over the indicator and the
+        // fragment header of each piece
+        const int32 FragmentPayload = MaxRtpPayload - 2;
+        for (int32 Offset = 1; Offset < NalSize;
+             Offset += FragmentPayload) {
+          const int32 Size = FMath::Min(FragmentPayload, NalSize - Offset);
+          const bool bStart = Offset == 1;
+          const bool bEnd = Offset + Size >= NalSize;
+          WriteHeader(bLastNal && bEnd);
+          uint8 *Payload = Packet + RtpFec::RtpHeaderSize;
+          Payload[0] = (uint8)((Nal[0] & 0xe0) | FuANalType);
+          Payload[1] = (uint8)((bStart ? 0x80 : 0) | (bEnd ? 0x40 : 0) |
+                               (Nal[0] & 0x1f));
+          FMemory::Memcpy(Payload + 2, Nal + Offset, Size);
+          SendVideoPacket(Packet, RtpFec::RtpHeaderSize + 2 + Size);
+        }
+      });
+}
+
+void FRobotStandIn::SendVideoPacket(const uint8 *Data, int32 Size) {
+  int32 Sent = 0;
+  VideoSocket->SendTo(Data, Size, Sent, *VideoAddr);
+  Stats.VideoPackets++;
+  Stats.VideoBytes += Size;
+  if (Config.FecGroupSize > 0 &&
+      FecEncoder.AddMediaPacket(Data, Size, FecPacket)) {
+    VideoSocket->SendTo(FecPacket.GetData(), FecPacket.Num(), Sent,
+                        *FecAddr);
+    Stats.FecPackets++;
+  }
+}
+
+bool FRobotStandIn::OpenEncoder() {
+  const AVCodec *Encoder = avcodec_find_encoder_by_name("libx264");
+  if (!Encoder) {
+    return false;
+  }
+  EncoderContext = avcodec_alloc_context3(Encoder);
+  if (!EncoderContext) {
+    return false;
+  }
+  const int32 Fps = FMath::Max(1, FMath::RoundToInt32(Config.FrameHz));
+  EncoderContext->width = Config.Width & ~1;
+  EncoderContext->height = Config.Height & ~1;
+  EncoderContext->pix_fmt = AV_PIX_FMT_YUV420P;
+  EncoderContext->time_base = AVRational{1, Fps};
+  EncoderContext->framerate = AVRational{Fps, 1};
+  EncoderContext->bit_rate = Config.Bitrate;
+  // A keyframe a second, so a late receiver starts quickly
+  EncoderContext->gop_size = Fps;
+  EncoderContext->max_b_frames = 0;
+  av_opt_set(EncoderContext->priv_data, "preset", "veryfast", 0);
+  av_opt_set(EncoderContext->priv_data, "tune", "zerolatency", 0);
+  if (avcodec_open2(EncoderContext, Encoder, nullptr) < 0) {
+    CloseEncoder();
+    return false;
+  }
+
+  EncoderFrame = av_frame_alloc();
+  EncoderFrame->format = EncoderContext->pix_fmt;
+  EncoderFrame->width = EncoderContext->width;
+  EncoderFrame->height = EncoderContext->height;
+  av_frame_get_buffer(EncoderFrame, 0);
+  EncoderPacket = av_packet_alloc();
+  return true;
+}
+
+void FRobotStandIn::CloseEncoder() {
+  av_packet_free(&EncoderPacket);
+  av_frame_free(&EncoderFrame);
+  avcodec_free_context(&EncoderContext);
+}
+
+bool FRobotStandIn::EncodeTestPattern(int64 Index,
+                                      TArray<uint8> &OutAccessUnit) {
+  // A checkerboard fixed in the world, so the image pans as the gimbal
+  // turns, with chroma drifting frame to frame
+  AVFrame *Frame = EncoderFrame;
+  av_frame_make_writable(Frame);
+  const float PixelsPerDegree = Frame->width / PatternFovDegrees;
+  const int32 OffsetX = (int32)(Gimbal.Sample.Yaw * PixelsPerDegree);
+  const int32 OffsetY = (int32)(-Gimbal.Sample.Pitch * PixelsPerDegree);
+  for (int32 Y = 0; Y < Frame->height; Y++) {
+    uint8 *Row = Frame->data[0] + Y * Frame->linesize[0];
+    const int32 CellY = ((Y + OffsetY) >> 5) & 1;
+    for (int32 X = 0; X < Frame->width; X++) {
+      Row[X] = (((X + OffsetX) >> 5) & 1) != CellY ? 200 : 56;
+    }
+  }
+  for (int32 Y = 0; Y < Frame->height / 2; Y++) {
+    uint8 *RowU = Frame->data[1] + Y * Frame->linesize[1];
+    uint8 *RowV = Frame->data[2] + Y * Frame->linesize[2];
+    for (int32 X = 0; X < Frame->width / 2; X++) {
+      RowU[X] = (uint8)(128 + Y - Index);
+      RowV[X] = (uint8)(64 + X + Index * 2);
+    }
+  }
+  Frame->pts = Index;
+
+  if (avcodec_send_frame(EncoderContext, Frame) < 0) {
+    return false;
+  }
+  bool bAny = false;
+  // Zero latency tuning hands the frame straight back
+  while (avcodec_receive_packet(EncoderContext, EncoderPacket) == 0) {
+    OutAccessUnit.Append(EncoderPacket->data, EncoderPacket->size);
+    av_packet_unref(EncoderPacket);
+    bAny = true;
+  }
+  return bAny;
+}
+
+bool FRobotStandIn::SaveControlLog(const FString &Path) const {
+  TArray<FString> Lines;
+  Lines.Reserve(ControlLog.Num() + 1);
+  Lines.Add(TEXT("sequence,receive_robot_us,pitch_deg,yaw_deg,trigger,"
+                 "thumbstick_x"));
+  for (const FLoggedControl &Entry : ControlLog) {
+    Lines.Add(FString::Printf(TEXT("%u,%llu,%.4f,%.4f,%.3f,%.3f"),
+                              Entry.Sequence,
+                              (unsigned long long)Entry.RobotReceiveUs,
+                              Entry.Sample.Pitch, Entry.Sample.Yaw,
+                              Entry.Sample.TriggerPosition,
+                              Entry.Sample.ThumbstickX));
+  }
+  if (!FFileHelper::SaveStringArrayToFile(Lines, *Path)) {
+    UE_LOG(LogTemp, Warning, TEXT("Could not write control log %s"), *Path);
+    return false;
+  }
+  return true;
+}
@@ -0,0 +1,209 @@
+#pragma once
+
+#include "ControlRedundancy.h"
+#include "ControlWireProtocol.h"
+#include "CoreMinimal.h"
+#include "RtpFec.h"
+#include "VideoFramePose.h"
+
+class FInternetAddr;
+class FSocket;
+struct AVCodecContext;
+struct AVFrame;
+struct AVPacket;
+
+enum class EStandInVideo : uint8 {
+  Off,
+  // Pose SEI plus a token slice per frame: no encoder, exact timing
+  Marker,
+  // x264-encoded test pattern that pans with the gimbal
+  Encoded,
+};
+
+// What a stand-in robot does and how long it takes. Delays are added on
+// top of whatever the host really spends.
+struct MYBLANKVRPROJECT_API FRobotStandInConfig {
+  // Address every socket binds to (-Bind=). Stand-ins sharing a host need
+  // one each, e.g. 127.0.0.2, 127.0.0.3, as the operator tells robots apart
+  // by address; Linux routes all of 127/8 to loopback, Mac needs aliases.
+  FString Address = TEXT("127.0.0.1");
+  // FControlLinkServer::DefaultDiscoveryPort
+  int32 DiscoveryPort = 6780;
+  // Robot clock minus ours
+  int64 ClockOffsetUs = 0;
+
+  // Control takes effect UplinkMs after it arrives, and moves the gimbal
+  // ActuationMs after that
+  double UplinkMs = 0.0;
+  double ActuationMs = 20.0;
+
+  // 0 sends none
+  double TelemetryHz = 10.0;
+
+  EStandInVideo Video = EStandInVideo::Encoded;
+  FString VideoAddress = TEXT("127.0.0.1");
+  int32 VideoPort = 5253;
+  int32 Width = 640;
+  int32 Height = 360;
+  double FrameHz = 30.0;
+  int64 Bitrate = 1500000;
+  // Held between capture and send
+  double EncodeMs = 0.0;
+  // Parity per this many RTP packets to FecPort (see RtpFec.h); 0 for none
+  int32 FecGroupSize = 0;
+  int32 FecPort = 5255;
+
+  // Keep every control sample received for SaveControlLog
+  bool bLogControl = false;
+
+  // Parses command line style keys, e.g.
+  //   -Bind=127.0.0.2 -ClockOffsetMs=250 -UplinkMs=10 -ActuationMs=25
+  //   -TelemetryHz=20 -Video=Marker -VideoHost=10.0.0.5 -VideoPort=5253
+  //   -Width=1280 -Height=720 -FrameHz=60 -Bitrate=4000000 -EncodeMs=8
+  //   -FecGroup=8 -FecPort=5255 -LogControl
+  static FRobotStandInConfig FromParams(const TCHAR *Params);
+
+  FString ToString() const;
+};
+
+struct FRobotStandInStats {
+  int64 Beacons = 0;
+  int64 ClockSyncReplies = 0;
+  int64 ControlDatagrams = 0;
+  // Samples applied, and those of them only a redundant copy brought
+  int64 ControlDelivered = 0;
+  int64 ControlRecovered = 0;
+  int64 Acks = 0;
+  int64 Telemetry = 0;
+  int64 Frames = 0;
+  int64 VideoPackets = 0;
+  int64 VideoBytes = 0;
+  int64 FecPackets = 0;
+  // Wall time spent in the encoder, and frames it held past the next
+  // capture
+  double EncodeSeconds = 0.0;
+  int64 LateFrames = 0;
+};
+
+// The robot side of every protocol the operator speaks, for running the
+// headset against something without hardware: answers discovery beacons
+// and clock sync on a clock ClockOffsetUs from ours, takes control through
+// the same redundancy decoder as the robot and acks it, drives a gimbal
+// from it, sends telemetry that follows the throttle, and streams H.264
+// over RTP with the capture pose SEI on every frame.
+//
+// Nothing runs on its own; Poll does whatever has come due. One thread may
+// poll many stand-ins.
+class MYBLANKVRPROJECT_API FRobotStandIn {
+public:
+  explicit FRobotStandIn(const FRobotStandInConfig &InConfig);
+  ~FRobotStandIn();
+
+  bool Open();
+  void Close();
+
+  // NowUs is ClockSync::NowMicros(). Poll every millisecond or so; the
+  // delays above are only as fine as that.
+  void Poll(int64 NowUs);
+
+  const FRobotStandInConfig &GetConfig() const { return Config; }
+  // Config.Video, or Marker once Open finds no H.264 encoder
+  EStandInVideo GetVideoMode() const { return VideoMode; }
+  const FRobotStandInStats &GetStats() const { return Stats; }
+  const FControlRedundancyDecoder::FStats &GetControlStats() const {
+    return Decoder.GetStats();
+  }
+
+  // Writes every control sample received as CSV; needs bLogControl
+  bool SaveControlLog(const FString &Path) const;
+
+private:
+  struct FControlDatagram {
+    // Our clock
+    int64 ArrivalUs;
+    uint32 Sequence;
+    int32 Count;
+    ControlWire::FControlPayload Samples[ControlWire::MaxBundleSamples];
+  };
+
+  struct FGimbalCommand {
+    int64 AppliedUs;
+    uint32 Sequence;
+    ControlWire::FControlPayload Sample;
+  };
+
+  struct FFrameInFlight {
+    int64 SendUs;
+    int64 CaptureUs;
+    // Annex-B, pose SEI first
+    TArray<uint8> AccessUnit;
+  };
+
+  struct FLoggedControl {
+    uint32 Sequence;
+    uint64 RobotReceiveUs;
+    ControlWire::FControlPayload Sample;
+  };
+
+  uint64 ToRobotUs(int64 LocalUs) const {
+    return (uint64)(LocalUs + Config.ClockOffsetUs);
+  }
+
+  void ReceiveDiscovery();
+  void ReceiveClockSync();
+  void ReceiveControl(int64 NowUs);
+  void ApplyArrivedControl(int64 NowUs);
+  void UpdateGimbal(int64 NowUs);
+  void SendTelemetry(int64 NowUs);
+  void Capture(int64 NowUs);
+  void SendFrames(int64 NowUs);
+
+  bool OpenEncoder();
+  void CloseEncoder();
+  bool EncodeTestPattern(int64 FrameIndex, TArray<uint8> &OutAccessUnit);
+  // One RTP packet per NAL unit, FU-A fragments past the MTU
+  void SendRtp(const FFrameInFlight &Frame);
+  void SendVideoPacket(const uint8 *Data, int32 Size);
+
+  const FRobotStandInConfig Config;
+  FRobotStandInStats Stats;
+
+  FSocket *DiscoverySocket = nullptr;
+  FSocket *SyncSocket = nullptr;
+  FSocket *ControlSocket = nullptr;
+  FSocket *VideoSocket = nullptr;
+  // The operator's control port, from its beacon or latest control
+  TSharedPtr<FInternetAddr> OperatorAddr;
+  TSharedPtr<FInternetAddr> VideoAddr;
+  TSharedPtr<FInternetAddr> FecAddr;
+
+  FControlRedundancyDecoder Decoder;
+  TArray<FControlDatagram> Uplink;
+  TArray<FGimbalCommand> Actuating;
+  TArray<FLoggedControl> ControlLog;
+  uint32 AckSequence = 0;
+  uint32 HelloSequence = 0;
+
+  // Newest command the gimbal has finished
+  bool bGimbalMoved = false;
+  FGimbalCommand Gimbal = {};
+
+  uint32 TelemetrySequence = 0;
+  int64 NextTelemetryUs = 0;
+  int64 LastTelemetryUs = 0;
+  double PoweredSeconds = 0.0;
+  float SpeedMph = 0.0f;
+  double DistanceFeet = 0.0;
+
+  EStandInVideo VideoMode;
+  int64 NextCaptureUs = 0;
+  int64 FrameIndex = 0;
+  TArray<FFrameInFlight> Encoding;
+  uint16 RtpSequence = 0;
+  uint32 RtpSsrc = 0;
+  FRtpFecEncoder FecEncoder;
+  TArray<uint8> FecPacket;
+  AVCodecContext *EncoderContext = nullptr;
+  AVFrame *EncoderFrame = nullptr;
+  AVPacket *EncoderPacket = nullptr;
+};
@@ -0,0 +1,207 @@
+#include "BenchmarkScenarios.h"
+#include "ClockSync.h"
+#include "ControlLinkServer.h"
+#include "HAL/PlatformProcess.h"
+#include "HAL/PlatformTime.h"
+#include "Misc/Paths.h"
+#include "RobotStandIn.h"
+
+namespace {
+// Address, video and FEC ports of the Index'th stand-in
+constexpr int32 PortStride = 10;
+
+FString StandInAddress(int32 Index) {
+  return FString::Printf(TEXT("127.0.0.%d"), Index + 1);
+}
+
+TSharedRef<FJsonObject> StatsToJson(const FRobotStandIn &Robot,
+                                    double Seconds) {
+  const FRobotStandInStats &Stats = Robot.GetStats();
+  TSharedRef<FJsonObject> Json = MakeShared<FJsonObject>();
+  Json->SetStringField(TEXT("config"), Robot.GetConfig().ToString());
+  Json->SetNumberField(TEXT("beacons"), (double)Stats.Beacons);
+  Json->SetNumberField(TEXT("clock_sync_replies"),
+                       (double)Stats.ClockSyncReplies);
+  Json->SetNumberField(TEXT("control_datagrams"),
+                       (double)Stats.ControlDatagrams);
+  Json->SetNumberField(TEXT("control_delivered"),
+                       (double)Stats.ControlDelivered);
+  Json->SetNumberField(TEXT("control_recovered"),
+                       (double)Stats.ControlRecovered);
+  Json->SetNumberField(TEXT("acks"), (double)Stats.Acks);
+  Json->SetNumberField(TEXT("telemetry"), (double)Stats.Telemetry);
+  Json->SetNumberField(TEXT("frames"), (double)Stats.Frames);
+  Json->SetNumberField(TEXT("video_packets"), (double)Stats.VideoPackets);
+  Json->SetNumberField(TEXT("fec_packets"), (double)Stats.FecPackets);
+  Json->SetNumberField(TEXT("video_kbps"),
+                       Seconds > 0.0 ? Stats.VideoBytes * 8 / 1000.0 / Seconds
+                                     : 0.0);
+  Json->SetNumberField(TEXT("encode_ms_per_frame"),
+                       Stats.Frames > 0
+                           ? Stats.EncodeSeconds * 1000.0 / Stats.Frames
+                           : 0.0);
+  Json->SetNumberField(TEXT("late_frames"), (double)Stats.LateFrames);
+  return Json;
+}
+} // namespace
+
+bool BenchmarkScenarios::RunRobotStandIn(const FString &Params,
+                                         TSharedRef<FJsonObject> Report) {
+  int32 NumRobots = 1;
+  int32 VideoStreams = 1;
+  double Seconds = 60.0;
+  FParse::Value(*Params, TEXT("Robots="), NumRobots);
+  FParse::Value(*Params, TEXT("VideoStreams="), VideoStreams);
+  FParse::Value(*Params, TEXT("Seconds="), Seconds);
+  const bool bLink = FParse::Param(*Params, TEXT("Link"));
+  NumRobots = FMath::Clamp(NumRobots, 1, 250);
+
+  // Every stand-in gets its own loopback address and port pair; only the
+  // first VideoStreams of them send video
+  const FRobotStandInConfig Base = FRobotStandInConfig::FromParams(*Params);
+  TArray<TUniquePtr<FRobotStandIn>> Robots;
+  for (int32 i = 0; i < NumRobots; i++) {
+    FRobotStandInConfig Config = Base;
+    if (NumRobots > 1) {
+      Config.Address = StandInAddress(i);
+    }
+    Config.VideoPort += i * PortStride;
+    Config.FecPort += i * PortStride;
+    if (i >= VideoStreams) {
+      Config.Video = EStandInVideo::Off;
+    }
+    Robots.Add(MakeUnique<FRobotStandIn>(Config));
+    if (!Robots.Last()->Open()) {
+      return false;
+    }
+  }
+
+  // With -Link the operator side runs in-process, one control link per
+  // stand-in; otherwise the stand-ins wait for a headset or editor
+  TSharedPtr<FControlLinkServer, ESPMode::ThreadSafe> Server;
+  TArray<TSharedPtr<FControlLink, ESPMode::ThreadSafe>> Links;
+  TArray<int64> TelemetryReceived;
+  if (bLink) {
+    Server = FControlLinkServer::Acquire();
+    if (!Server) {
+      return false;
+    }
+    for (const TUniquePtr<FRobotStandIn> &Robot : Robots) {
+      FControlLinkConfig Config;
+      Config.RobotAddress = Robot->GetConfig().Address;
+      Links.Add(MakeShared<FControlLink, ESPMode::ThreadSafe>(Config));
+      Server->AddLink(Links.Last());
+    }
+    TelemetryReceived.SetNumZeroed(Links.Num());
+  }
+
+  UE_LOG(LogTemp, Display,
+         TEXT("RobotStandIn: %d robot(s), %d with video, for %.0f s%s"),
+         NumRobots, FMath::Min(VideoStreams, NumRobots), Seconds,
+         bLink ? TEXT(" against in-process links") : TEXT(""));
+
+  const double Start = FPlatformTime::Seconds();
+  double NextLog = Start + 5.0;
+  int64 NextTickUs = 0;
+  while (FPlatformTime::Seconds() - Start < Seconds) {
+    const double Now = FPlatformTime::Seconds();
+    const int64 NowUs = ClockSync::NowMicros();
+    for (const TUniquePtr<FRobotStandIn> &Robot : Robots) {
+      Robot->Poll(NowUs);
+    }
+
+    if (bLink && NowUs >= NextTickUs) {
+      // A 90 Hz game tick per link: a wandering head, a throttle
+      // pulsing between stop and full
+      NextTickUs = NowUs + 11111;
+      for (int32 i = 0; i < Links.Num(); i++) {
+        const double Phase = Now + i;
+        const float Throttle = (float)FMath::Max(0.0, FMath::Sin(0.2 * Phase));
+        FRobotControlData Sample(10.0f * FMath::Sin(Phase),
+                                 45.0f * FMath::Sin(0.5 * Phase), Throttle,
+                                 0.0f);
+        Sample.SampledLocalUs = NowUs;
+        Links[i]->ControlChannel.Push(Sample);
+        FTelemetrySnapshot Snapshot;
+        while (Links[i]->TelemetryChannel.Pop(Snapshot)) {
+          TelemetryReceived[i]++;
+        }
+      }
+    }
+
+    if (Now >= NextLog) {
+      NextLog += 5.0;
+      int64 Delivered = 0;
+      int64 Frames = 0;
+      for (const TUniquePtr<FRobotStandIn> &Robot : Robots) {
+        Delivered += Robot->GetStats().ControlDelivered;
+        Frames += Robot->GetStats().Frames;
+      }
+      UE_LOG(LogTemp, Display,
+             TEXT("RobotStandIn: %.0f s, %lld control samples, %lld frames"),
+             Now - Start, (long long)Delivered, (long long)Frames);
+    }
+    FPlatformProcess::Sleep(0.0002f);
+  }
+  const double Elapsed = FPlatformTime::Seconds() - Start;
+
+  // Read before the links are detached
+  TArray<bool> LinkSynced;
+  TArray<int64> LinkAcked;
+  for (const TSharedPtr<FControlLink, ESPMode::ThreadSafe> &Link : Links) {
+    LinkSynced.Add(Link->GetState() == ERobotLinkState::Synced);
+    LinkAcked.Add(Link->GetQuality().GetStats().PacketsAcked);
+    Server->RemoveLink(Link);
+  }
+  Server.Reset();
+
+  const FString LogDir = FPaths::ProjectSavedDir() / TEXT("RobotStandIn");
+  const FString Stamp = FDateTime::Now().ToString();
+  TArray<TSharedPtr<FJsonValue>> Results;
+  bool bPass = true;
+  for (int32 i = 0; i < Robots.Num(); i++) {
+    FRobotStandIn &Robot = *Robots[i];
+    Robot.Close();
+    TSharedRef<FJsonObject> Json = StatsToJson(Robot, Elapsed);
+    if (Base.bLogControl) {
+      Robot.SaveControlLog(LogDir / FString::Printf(TEXT("Control-%s-%d.csv"),
+                                                    *Stamp, i));
+    }
+
+    const FRobotStandInStats &Stats = Robot.GetStats();
+    UE_LOG(LogTemp, Display,
+           TEXT("RobotStandIn %s: %lld control samples (%lld recovered), "
+                "%lld acks, %lld telemetry, %lld frames"),
+           *Robot.GetConfig().Address, (long long)Stats.ControlDelivered,
+           (long long)Stats.ControlRecovered, (long long)Stats.Acks,
+           (long long)Stats.Telemetry, (long long)Stats.Frames);
+
+    if (bLink) {
+      // Each link should have found its own robot, synced to its clock,
+      // streamed control to it and heard telemetry and acks back
+      const bool bSynced = LinkSynced[i];
+      const bool bHeard =
+          Stats.ControlDelivered > 0 && LinkAcked[i] > 0 &&
+          (Robot.GetConfig().TelemetryHz <= 0.0 || TelemetryReceived[i] > 0);
+      Json->SetBoolField(TEXT("link_synced"), bSynced);
+      Json->SetNumberField(TEXT("link_telemetry"), TelemetryReceived[i]);
+      if (!bSynced || !bHeard) {
+        UE_LOG(LogTemp, Error,
+               TEXT("RobotStandIn %s: link %s, %lld samples delivered, "
+                    "%lld telemetry received"),
+               *Robot.GetConfig().Address,
+               bSynced ? TEXT("synced") : TEXT("not synced"),
+               (long long)Stats.ControlDelivered,
+               (long long)TelemetryReceived[i]);
+        bPass = false;
+      }
+    }
+    Results.Add(MakeShared<FJsonValueObject>(Json));
+  }
+
+  Report->SetNumberField(TEXT("robots"), NumRobots);
+  Report->SetNumberField(TEXT("seconds"), Elapsed);
+  Report->SetBoolField(TEXT("link"), bLink);
+  Report->SetArrayField(TEXT("results"), Results);
+  return bPass;
+}
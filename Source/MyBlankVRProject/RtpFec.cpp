@@ -0,0 +1,216 @@
+#include "RtpFec.h"
+
+FRtpFecEncoder::FRtpFecEncoder(int32 InGroupSize)
+    : GroupSize(FMath::Clamp(InGroupSize, 2, 255)) {
+  Reset();
+}
+
+void FRtpFecEncoder::Reset() {
+  Count = 0;
+  SequenceBase = 0;
+  LengthRecovery = 0;
+  ParitySize = 0;
+  FMemory::Memzero(Parity, sizeof(Parity));
+}
+
+bool FRtpFecEncoder::AddMediaPacket(const uint8 *Data, int32 Size,
+                                    TArray<uint8> &OutFecPacket) {
+  if (!Data || Size < RtpFec::RtpHeaderSize || Size > RtpFec::MaxPacketSize) {
+    return false;
+  }
+
+  const uint16 Sequence = RtpFec::ReadUInt16(Data + 2);
+
+  // Groups cover consecutive sequence numbers only. A gap on the sending
+  // side starts a fresh group.
+  if (Count > 0 && Sequence != (uint16)(SequenceBase + Count)) {
+    Reset();
+  }
+  if (Count == 0) {
+    SequenceBase = Sequence;
+  }
+
+  for (int32 i = 0; i < Size; i++) {
+    Parity[i] ^= Data[i];
+  }
+  LengthRecovery ^= (uint16)Size;
+  ParitySize = FMath::Max(ParitySize, Size);
+  Count++;
+
+  if (Count < GroupSize) {
+    return false;
+  }
+
+  OutFecPacket.SetNumUninitialized(RtpFec::HeaderSize + ParitySize);
+  uint8 *Out = OutFecPacket.GetData();
+  RtpFec::WriteUInt16(Out, SequenceBase);
+  Out[2] = (uint8)Count;
+  Out[3] = RtpFec::Version;
+  RtpFec::WriteUInt16(Out + 4, LengthRecovery);
+  FMemory::Memcpy(Out + RtpFec::HeaderSize, Parity, ParitySize);
+
+  Reset();
+  return true;
+}
+
+FRtpFecDecoder::FRtpFecDecoder()
+    : HighestSequence(0), bHaveHighest(false), NextUncheckedSequence(0),
+      RecoveredCount(0), UnrecoverableCount(0) {
+  History.SetNum(HistorySize);
+  Groups.SetNum(MaxPendingGroups);
+}
+
+const FRtpFecDecoder::FMediaSlot *
+FRtpFecDecoder::FindMedia(uint16 Sequence) const {
+  const FMediaSlot &Slot = History[Sequence % HistorySize];
+  return Slot.bValid && Slot.Sequence == Sequence ? &Slot : nullptr;
+}
+
+void FRtpFecDecoder::StoreMedia(const uint8 *Data, int32 Size) {
+  const uint16 Sequence = RtpFec::ReadUInt16(Data + 2);
+  FMediaSlot &Slot = History[Sequence % HistorySize];
+  Slot.bValid = true;
+  Slot.Sequence = Sequence;
+  Slot.Size = Size;
+  FMemory::Memcpy(Slot.Data, Data, Size);
+
+  if (!bHaveHighest) {
+    NextUncheckedSequence = Sequence;
+  }
+  if (!bHaveHighest ||
+      RtpFec::SequenceDelta(Sequence, HighestSequence) > 0) {
+    HighestSequence = Sequence;
+    bHaveHighest = true;
+  }
+}
+
+void FRtpFecDecoder::AddMediaPacket(const uint8 *Data, int32 Size,
+                                    FPacketSink OnRecovered) {
+  if (!Data || Size < RtpFec::RtpHeaderSize || Size > RtpFec::MaxPacketSize) {
+    return;
+  }
+  StoreMedia(Data, Size);
+
+  // A late media packet can leave a pending group one short of recovery
+  const uint16 Sequence = RtpFec::ReadUInt16(Data + 2);
+  for (FPendingGroup &Group : Groups) {
+    if (Group.bActive) {
+      const int32 Offset = RtpFec::SequenceDelta(Sequence, Group.SequenceBase);
+      if (Offset >= 0 && Offset < Group.Count &&
+          TryRecover(Group, OnRecovered)) {
+        Group.bActive = false;
+      }
+    }
+  }
+
+  Expire();
+}
+
+void FRtpFecDecoder::AddFecPacket(const uint8 *Data, int32 Size,
+                                  FPacketSink OnRecovered) {
+  if (!Data || Size < RtpFec::HeaderSize + RtpFec::RtpHeaderSize ||
+      Size > RtpFec::HeaderSize + RtpFec::MaxPacketSize ||
+      Data[3] != RtpFec::Version || Data[2] == 0) {
+    return;
+  }
+  // Its packets may already have been counted lost
+  if (bHaveHighest && RtpFec::SequenceDelta(RtpFec::ReadUInt16(Data),
+                                            NextUncheckedSequence) < 0) {
+    return;
+  }
+
+  // Take a free slot, or evict the oldest pending group
+  FPendingGroup *Target = nullptr;
+  for (FPendingGroup &Group : Groups) {
+    if (!Group.bActive) {
+      Target = &Group;
+      break;
+    }
+    if (!Target || RtpFec::SequenceDelta(Group.SequenceBase,
+                                         Target->SequenceBase) < 0) {
+      Target = &Group;
+    }
+  }
+
+  Target->bActive = true;
+  Target->SequenceBase = RtpFec::ReadUInt16(Data);
+  Target->Count = Data[2];
+  Target->LengthRecovery = RtpFec::ReadUInt16(Data + 4);
+  Target->ParitySize = Size - RtpFec::HeaderSize;
+  FMemory::Memcpy(Target->Parity, Data + RtpFec::HeaderSize,
+                  Target->ParitySize);
+
+  if (TryRecover(*Target, OnRecovered)) {
+    Target->bActive = false;
+  }
+}
+
+bool FRtpFecDecoder::TryRecover(FPendingGroup &Group,
+                                FPacketSink OnRecovered) {
+  int32 Missing = 0;
+  uint16 MissingSequence = 0;
+  for (int32 i = 0; i < Group.Count; i++) {
+    const uint16 Sequence = (uint16)(Group.SequenceBase + i);
+    if (!FindMedia(Sequence)) {
+      MissingSequence = Sequence;
+      Missing++;
+    }
+  }
+
+  if (Missing == 0) {
+    return true;
+  }
+  if (Missing > 1) {
+    // Wait for more media, or for expiry
+    return false;
+  }
+
+  uint8 Rebuilt[RtpFec::MaxPacketSize];
+  FMemory::Memcpy(Rebuilt, Group.Parity, Group.ParitySize);
+  uint16 Length = Group.LengthRecovery;
+  for (int32 i = 0; i < Group.Count; i++) {
+    const FMediaSlot *Slot = FindMedia((uint16)(Group.SequenceBase + i));
+    if (Slot) {
+      const int32 Overlap = FMath::Min(Slot->Size, Group.ParitySize);
+      for (int32 j = 0; j < Overlap; j++) {
+        Rebuilt[j] ^= Slot->Data[j];
+      }
+      Length ^= (uint16)Slot->Size;
+    }
+  }
+
+  if (Length < RtpFec::RtpHeaderSize || Length > Group.ParitySize ||
+      RtpFec::ReadUInt16(Rebuilt + 2) != MissingSequence) {
+    // Parity does not line up with what we hold; the group is corrupt and
+    // the packet is counted once it expires
+    return true;
+  }
+
+  StoreMedia(Rebuilt, Length);
+  RecoveredCount++;
+  OnRecovered(Rebuilt, Length);
+  return true;
+}
+
+void FRtpFecDecoder::Expire() {
+  const int32 Behind =
+      RtpFec::SequenceDelta(HighestSequence, NextUncheckedSequence);
+  if (Behind > HistorySize) {
+    // A jump past the history is the sender restarting, not a loss burst
+    NextUncheckedSequence = (uint16)(HighestSequence - ExpiryDistance);
+  }
+  while (RtpFec::SequenceDelta(HighestSequence, NextUncheckedSequence) >
+         ExpiryDistance) {
+    if (!FindMedia(NextUncheckedSequence)) {
+      UnrecoverableCount++;
+    }
+    NextUncheckedSequence++;
+  }
+
+  for (FPendingGroup &Group : Groups) {
+    if (Group.bActive && RtpFec::SequenceDelta(Group.SequenceBase,
+                                               NextUncheckedSequence) < 0) {
+      Group.bActive = false;
+    }
+  }
+}
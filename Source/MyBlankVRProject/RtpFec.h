@@ -0,0 +1,114 @@
+#pragma once
+
+#include "CoreMinimal.h"
+
+// Packet-level forward error correction for the RTP video stream.
+//
+// Media packets are protected in groups of consecutive sequence numbers.
+// After each group the sender emits one XOR parity packet on a separate port:
+//
+//   0  uint16  SequenceBase    first protected RTP sequence number
+//   2  uint8   Count           number of protected packets
+//   3  uint8   Version         RtpFec::Version
+//   4  uint16  LengthRecovery  XOR of the protected packet lengths
+//   6  ...     Parity          XOR of the protected packets, zero padded
+//
+// Whole RTP packets (header included) are XORed, so one missing packet per
+// group is rebuilt byte for byte, sequence number and all. Fields are
+// big-endian like RTP itself.
+namespace RtpFec {
+constexpr uint8 Version = 1;
+constexpr int32 HeaderSize = 6;
+constexpr int32 RtpHeaderSize = 12;
+constexpr int32 MaxPacketSize = 1500;
+
+inline uint16 ReadUInt16(const uint8 *Data) {
+  return (uint16)((Data[0] << 8) | Data[1]);
+}
+
+inline void WriteUInt16(uint8 *Data, uint16 Value) {
+  Data[0] = (uint8)(Value >> 8);
+  Data[1] = (uint8)(Value & 0xff);
+}
+
+// Signed distance between two RTP sequence numbers, wrap-around aware
+inline int32 SequenceDelta(uint16 A, uint16 B) { return (int16)(A - B); }
+} // namespace RtpFec
+
+// Sender side: accumulates parity over outgoing RTP packets.
+class MYBLANKVRPROJECT_API FRtpFecEncoder {
+public:
+  explicit FRtpFecEncoder(int32 InGroupSize = 8);
+
+  // Feeds one outgoing RTP packet. Returns true and fills OutFecPacket once
+  // a group is complete. OutFecPacket keeps its allocation across calls.
+  bool AddMediaPacket(const uint8 *Data, int32 Size,
+                      TArray<uint8> &OutFecPacket);
+
+  void Reset();
+
+private:
+  int32 GroupSize;
+  int32 Count;
+  uint16 SequenceBase;
+  uint16 LengthRecovery;
+  int32 ParitySize;
+  uint8 Parity[RtpFec::MaxPacketSize];
+};
+
+// Receiver side: remembers recent media packets and rebuilds a single
+// missing packet per protected group. Media packets are never delayed;
+// recovered packets are handed out as soon as the group allows it. Losses
+// are counted per sequence number once they fall ExpiryDistance behind the
+// newest packet, so groups whose parity was lost as well still count.
+class MYBLANKVRPROJECT_API FRtpFecDecoder {
+public:
+  using FPacketSink = TFunctionRef<void(const uint8 *Data, int32 Size)>;
+
+  FRtpFecDecoder();
+
+  void AddMediaPacket(const uint8 *Data, int32 Size, FPacketSink OnRecovered);
+  void AddFecPacket(const uint8 *Data, int32 Size, FPacketSink OnRecovered);
+
+  uint64 GetRecoveredCount() const { return RecoveredCount; }
+  uint64 GetUnrecoverableCount() const { return UnrecoverableCount; }
+
+private:
+  static constexpr int32 HistorySize = 256;
+  static constexpr int32 MaxPendingGroups = 32;
+  // Media this far behind the newest packet is counted lost if still
+  // missing, and groups starting that far back are given up on
+  static constexpr int32 ExpiryDistance = 96;
+
+  struct FMediaSlot {
+    bool bValid = false;
+    uint16 Sequence = 0;
+    int32 Size = 0;
+    uint8 Data[RtpFec::MaxPacketSize];
+  };
+
+  struct FPendingGroup {
+    bool bActive = false;
+    uint16 SequenceBase = 0;
+    int32 Count = 0;
+    uint16 LengthRecovery = 0;
+    int32 ParitySize = 0;
+    uint8 Parity[RtpFec::MaxPacketSize];
+  };
+
+  const FMediaSlot *FindMedia(uint16 Sequence) const;
+  void StoreMedia(const uint8 *Data, int32 Size);
+  // Returns true once the group needs no more attention
+  bool TryRecover(FPendingGroup &Group, FPacketSink OnRecovered);
+  void Expire();
+
+  TArray<FMediaSlot> History;
+  TArray<FPendingGroup> Groups;
+  uint16 HighestSequence;
+  bool bHaveHighest;
+  // Oldest sequence number not yet checked for loss
+  uint16 NextUncheckedSequence;
+
+  uint64 RecoveredCount;
+  uint64 UnrecoverableCount;
+};
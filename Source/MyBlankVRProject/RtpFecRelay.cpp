@@ -0,0 +1,182 @@
+#include "RtpFecRelay.h"
+#include "PipelineStats.h"
+#include "SocketSubsystem.h"
+#include "Sockets.h"
+
+namespace {
+// An idle relay blocks on the media socket only, so media is read the moment
+// it lands; parity is drained on every wake and so waits at most one
+// timeout. The timeout grows once the stream has gone quiet.
+const FTimespan ActiveWaitTimeout = FTimespan::FromMilliseconds(1);
+const FTimespan QuietWaitTimeout = FTimespan::FromMilliseconds(5);
+constexpr int32 QuietIdleRounds = 1000;
+
+FSocket *CreateUdpSocket(const TCHAR *Description, int32 Port) {
+  ISocketSubsystem *SocketSubsystem =
+      ISocketSubsystem::Get(PLATFORM_SOCKETSUBSYSTEM);
+  FSocket *Socket = SocketSubsystem->CreateSocket(NAME_DGram, Description, false);
+  if (!Socket) {
+    return nullptr;
+  }
+
+  // Video arrives in bursts of a whole frame's worth of packets
+  int32 ActualSize = 0;
+  Socket->SetReceiveBufferSize(2 * 1024 * 1024, ActualSize);
+  Socket->SetNonBlocking(true);
+
+  if (Port > 0) {
+    TSharedRef<FInternetAddr> Addr = SocketSubsystem->CreateInternetAddr();
+    Addr->SetAnyAddress();
+    Addr->SetPort(Port);
+    if (!Socket->Bind(*Addr)) {
+      UE_LOG(LogTemp, Error, TEXT("%s: failed to bind port %d"), Description,
+             Port);
+      Socket->Close();
+      SocketSubsystem->DestroySocket(Socket);
+      return nullptr;
+    }
+  }
+  return Socket;
+}
+
+void DestroyUdpSocket(FSocket *&Socket) {
+  if (Socket) {
+    Socket->Close();
+    ISocketSubsystem::Get(PLATFORM_SOCKETSUBSYSTEM)->DestroySocket(Socket);
+    Socket = nullptr;
+  }
+}
+} // namespace
+
+FRtpFecReceiveRelay::FRtpFecReceiveRelay(const FVideoStreamConfig &InConfig)
+    : Config(InConfig), bStopThread(false), MediaSocket(nullptr),
+      FecSocket(nullptr), RelaySocket(nullptr) {}
+
+FRtpFecReceiveRelay::~FRtpFecReceiveRelay() {
+  DestroyUdpSocket(MediaSocket);
+  DestroyUdpSocket(FecSocket);
+  DestroyUdpSocket(RelaySocket);
+}
+
+bool FRtpFecReceiveRelay::OpenSockets() {
+  MediaSocket = CreateUdpSocket(TEXT("VideoMediaSocket"), Config.Port);
+  FecSocket = CreateUdpSocket(TEXT("VideoFecSocket"), Config.FecPort);
+  RelaySocket = CreateUdpSocket(TEXT("VideoRelaySocket"), 0);
+  if (!MediaSocket || !FecSocket || !RelaySocket) {
+    // Free the media port for whoever reads it instead
+    DestroyUdpSocket(MediaSocket);
+    DestroyUdpSocket(FecSocket);
+    DestroyUdpSocket(RelaySocket);
+    return false;
+  }
+
+  RelayAddr = ISocketSubsystem::Get(PLATFORM_SOCKETSUBSYSTEM)
+                  ->CreateInternetAddr();
+  RelayAddr->SetLoopbackAddress();
+  RelayAddr->SetPort(Config.DecoderRelayPort);
+
+  UE_LOG(LogTemp, Log,
+         TEXT("FEC relay: media on %d, parity on %d, decoder on %d"),
+         Config.Port, Config.FecPort, Config.DecoderRelayPort);
+  return true;
+}
+
+void FRtpFecReceiveRelay::Relay(const uint8 *Data, int32 Size) {
+  int32 Sent = 0;
+  RelaySocket->SendTo(Data, Size, Sent, *RelayAddr);
+}
+
+uint32 FRtpFecReceiveRelay::Run() {
+  uint8 Buffer[RtpFec::HeaderSize + RtpFec::MaxPacketSize];
+  auto RelayRecovered = [this](const uint8 *Data, int32 Size) {
+    Relay(Data, Size);
+  };
+  int32 IdleRounds = 0;
+
+  while (!bStopThread) {
+    bool bIdle = true;
+    int32 BytesRead = 0;
+
+    // Media goes straight through; the decoder only keeps a copy in case a
+    // neighbour is lost.
+    while (MediaSocket->Recv(Buffer, sizeof(Buffer), BytesRead) &&
+           BytesRead > 0) {
+      bIdle = false;
+      MediaPackets.Increment();
+      Relay(Buffer, BytesRead);
+      Decoder.AddMediaPacket(Buffer, BytesRead, RelayRecovered);
+    }
+
+    while (FecSocket->Recv(Buffer, sizeof(Buffer), BytesRead) &&
+           BytesRead > 0) {
+      bIdle = false;
+      Decoder.AddFecPacket(Buffer, BytesRead, RelayRecovered);
+    }
+
+    if (bIdle) {
+      MediaSocket->Wait(ESocketWaitConditions::WaitForRead,
+                        IdleRounds++ < QuietIdleRounds ? ActiveWaitTimeout
+                                                       : QuietWaitTimeout);
+    } else {
+      IdleRounds = 0;
+      RecoveredPackets.Set(Decoder.GetRecoveredCount());
+      UnrecoverablePackets.Set(Decoder.GetUnrecoverableCount());
+      FPV_COUNTER_SET(VideoPacketsRecovered, Decoder.GetRecoveredCount());
+      FPV_COUNTER_SET(VideoPacketsLost, Decoder.GetUnrecoverableCount());
+    }
+  }
+
+  UE_LOG(LogTemp, Log,
+         TEXT("FEC relay stopped. Media: %lld, recovered: %lld, "
+              "unrecoverable: %lld"),
+         MediaPackets.GetValue(), RecoveredPackets.GetValue(),
+         UnrecoverablePackets.GetValue());
+  return 0;
+}
+
+void FRtpFecReceiveRelay::Stop() { bStopThread = true; }
+
+FRtpFecSendRelay::FRtpFecSendRelay(int32 InListenPort,
+                                   const FIPv4Endpoint &InMediaDestination,
+                                   const FIPv4Endpoint &InFecDestination,
+                                   int32 InGroupSize)
+    : ListenPort(InListenPort), MediaDestination(InMediaDestination),
+      FecDestination(InFecDestination), bStopThread(false),
+      ListenSocket(nullptr), SendSocket(nullptr), Encoder(InGroupSize) {}
+
+FRtpFecSendRelay::~FRtpFecSendRelay() {
+  DestroyUdpSocket(ListenSocket);
+  DestroyUdpSocket(SendSocket);
+}
+
+bool FRtpFecSendRelay::Init() {
+  ListenSocket = CreateUdpSocket(TEXT("FecSenderListenSocket"), ListenPort);
+  SendSocket = CreateUdpSocket(TEXT("FecSenderSendSocket"), 0);
+  return ListenSocket && SendSocket;
+}
+
+uint32 FRtpFecSendRelay::Run() {
+  uint8 Buffer[RtpFec::MaxPacketSize];
+  TSharedRef<FInternetAddr> MediaAddr = MediaDestination.ToInternetAddr();
+  TSharedRef<FInternetAddr> FecAddr = FecDestination.ToInternetAddr();
+
+  while (!bStopThread) {
+    int32 BytesRead = 0;
+    if (ListenSocket->Recv(Buffer, sizeof(Buffer), BytesRead) &&
+        BytesRead > 0) {
+      int32 Sent = 0;
+      SendSocket->SendTo(Buffer, BytesRead, Sent, *MediaAddr);
+      if (Encoder.AddMediaPacket(Buffer, BytesRead, FecPacket)) {
+        SendSocket->SendTo(FecPacket.GetData(), FecPacket.Num(), Sent,
+                           *FecAddr);
+        FecPackets.Increment();
+      }
+    } else {
+      ListenSocket->Wait(ESocketWaitConditions::WaitForRead,
+                         FTimespan::FromMilliseconds(1));
+    }
+  }
+  return 0;
+}
+
+void FRtpFecSendRelay::Stop() { bStopThread = true; }
@@ -0,0 +1,81 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "HAL/Runnable.h"
+#include "HAL/ThreadSafeCounter64.h"
+#include "Interfaces/IPv4/IPv4Endpoint.h"
+#include "RtpFec.h"
+#include "VideoStreamConfig.h"
+
+class FSocket;
+
+// Receives the RTP video stream and its FEC packets, repairs losses and
+// relays the result to the loopback port libavformat reads from.
+class FRtpFecReceiveRelay : public FRunnable {
+public:
+  explicit FRtpFecReceiveRelay(const FVideoStreamConfig &InConfig);
+  virtual ~FRtpFecReceiveRelay();
+
+  // Binds the media, parity and relay sockets. Call before starting the
+  // thread; on failure the caller should have the decoder read the media
+  // port directly.
+  bool OpenSockets();
+
+  // FRunnable interface
+  virtual uint32 Run() override;
+  virtual void Stop() override;
+
+  int64 GetMediaPacketCount() const { return MediaPackets.GetValue(); }
+  int64 GetRecoveredPacketCount() const { return RecoveredPackets.GetValue(); }
+  int64 GetUnrecoverablePacketCount() const {
+    return UnrecoverablePackets.GetValue();
+  }
+
+private:
+  void Relay(const uint8 *Data, int32 Size);
+
+  FVideoStreamConfig Config;
+  FThreadSafeBool bStopThread;
+
+  FSocket *MediaSocket;
+  FSocket *FecSocket;
+  FSocket *RelaySocket;
+  TSharedPtr<FInternetAddr> RelayAddr;
+
+  FRtpFecDecoder Decoder;
+
+  FThreadSafeCounter64 MediaPackets;
+  FThreadSafeCounter64 RecoveredPackets;
+  FThreadSafeCounter64 UnrecoverablePackets;
+};
+
+// Local sender for tests: takes a plain RTP stream (e.g. from the ffmpeg CLI)
+// on ListenPort and forwards it to MediaDestination, with parity packets for
+// every GroupSize media packets sent to FecDestination.
+class FRtpFecSendRelay : public FRunnable {
+public:
+  FRtpFecSendRelay(int32 InListenPort, const FIPv4Endpoint &InMediaDestination,
+                   const FIPv4Endpoint &InFecDestination, int32 InGroupSize);
+  virtual ~FRtpFecSendRelay();
+
+  // FRunnable interface
+  virtual bool Init() override;
+  virtual uint32 Run() override;
+  virtual void Stop() override;
+
+  int64 GetFecPacketCount() const { return FecPackets.GetValue(); }
+
+private:
+  int32 ListenPort;
+  FIPv4Endpoint MediaDestination;
+  FIPv4Endpoint FecDestination;
+  FThreadSafeBool bStopThread;
+
+  FSocket *ListenSocket;
+  FSocket *SendSocket;
+
+  FRtpFecEncoder Encoder;
+  TArray<uint8> FecPacket;
+
+  FThreadSafeCounter64 FecPackets;
+};
@@ -0,0 +1,350 @@
+#include "SharedMemoryFrameRing.h"
+#include "HAL/PlatformProcess.h"
+#include "HAL/PlatformTime.h"
+
+#if WITH_SHARED_MEMORY_FRAMES
+#include <cerrno>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#if PLATFORM_LINUX
+#include <climits>
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#endif
+
+namespace {
+constexpr uint64 SlotAlignment = 64;
+
+uint64 AlignUp(uint64 Value, uint64 Alignment) {
+  return (Value + Alignment - 1) & ~(Alignment - 1);
+}
+
+#if PLATFORM_LINUX
+// Shared (not FUTEX_PRIVATE) futex so it works across processes
+void FutexWait(std::atomic<uint32> *Word, uint32 Expected,
+               double TimeoutSeconds) {
+  struct timespec Timeout;
+  Timeout.tv_sec = (time_t)TimeoutSeconds;
+  Timeout.tv_nsec = (long)((TimeoutSeconds - Timeout.tv_sec) * 1e9);
+  syscall(SYS_futex, reinterpret_cast<uint32 *>(Word), FUTEX_WAIT, Expected,
+          &Timeout, nullptr, 0);
+}
+
+void FutexWakeAll(std::atomic<uint32> *Word) {
+  syscall(SYS_futex, reinterpret_cast<uint32 *>(Word), FUTEX_WAKE, INT_MAX,
+          nullptr, nullptr, 0);
+}
+#endif
+} // namespace
+
+FSharedMemoryFrameReader::FSharedMemoryFrameReader()
+    : SegmentDevice(0), SegmentInode(0), Mapping(nullptr), MappingSize(0),
+      Header(nullptr), LastSequence(0), DroppedFrames(0),
+      bFrameInFlight(false), TornFrames(0) {}
+
+FSharedMemoryFrameReader::~FSharedMemoryFrameReader() { Close(); }
+
+bool FSharedMemoryFrameReader::Open(const FString &Name) {
+#if WITH_SHARED_MEMORY_FRAMES
+  Close();
+
+  // Read-write: the reader publishes the slot it is using
+  const int Fd = shm_open(TCHAR_TO_UTF8(*Name), O_RDWR, 0);
+  if (Fd < 0) {
+    return false;
+  }
+
+  struct stat Stat;
+  if (fstat(Fd, &Stat) != 0 || Stat.st_size < (off_t)sizeof(ShmFrameRing::FHeader)) {
+    close(Fd);
+    return false;
+  }
+
+  void *Mapped = mmap(nullptr, Stat.st_size, PROT_READ | PROT_WRITE,
+                      MAP_SHARED, Fd, 0);
+  close(Fd);
+  if (Mapped == MAP_FAILED) {
+    return false;
+  }
+
+  ShmFrameRing::FHeader *Candidate =
+      static_cast<ShmFrameRing::FHeader *>(Mapped);
+  const uint64 Required =
+      Candidate->FirstSlotOffset +
+      (uint64)Candidate->SlotCount * Candidate->SlotStride;
+  if (Candidate->Magic != ShmFrameRing::Magic ||
+      Candidate->Version != ShmFrameRing::Version ||
+      Candidate->PixelFormat != ShmFrameRing::PixelFormatBGRA8 ||
+      Candidate->SlotCount < ShmFrameRing::MinSlots ||
+      Candidate->RowPitch < Candidate->Width * 4 ||
+      Required > (uint64)Stat.st_size) {
+    UE_LOG(LogTemp, Error, TEXT("Shared memory %s is not a valid frame ring."),
+           *Name);
+    munmap(Mapped, Stat.st_size);
+    return false;
+  }
+
+  SegmentName = Name;
+  SegmentDevice = Stat.st_dev;
+  SegmentInode = Stat.st_ino;
+  Mapping = Mapped;
+  MappingSize = Stat.st_size;
+  Header = Candidate;
+  LastSequence = 0;
+  UE_LOG(LogTemp, Log, TEXT("Opened shared memory frame ring %s: %dx%d, %d slots"),
+         *Name, Header->Width, Header->Height, Header->SlotCount);
+  return true;
+#else
+  UE_LOG(LogTemp, Error,
+         TEXT("Shared memory frames are not supported on this platform."));
+  return false;
+#endif
+}
+
+void FSharedMemoryFrameReader::Close() {
+#if WITH_SHARED_MEMORY_FRAMES
+  if (Header) {
+    Header->ReaderSlot.store(ShmFrameRing::NoSlot);
+    munmap(Mapping, MappingSize);
+  }
+#endif
+  Mapping = nullptr;
+  MappingSize = 0;
+  Header = nullptr;
+}
+
+bool FSharedMemoryFrameReader::IsSegmentReplaced() const {
+#if WITH_SHARED_MEMORY_FRAMES
+  if (!Header) {
+    return false;
+  }
+  const int Fd = shm_open(TCHAR_TO_UTF8(*SegmentName), O_RDONLY, 0);
+  if (Fd < 0) {
+    return errno == ENOENT;
+  }
+  struct stat Stat;
+  const bool bSame = fstat(Fd, &Stat) == 0 &&
+                     (uint64)Stat.st_dev == SegmentDevice &&
+                     (uint64)Stat.st_ino == SegmentInode;
+  close(Fd);
+  return !bSame;
+#else
+  return false;
+#endif
+}
+
+ShmFrameRing::FSlotHeader *
+FSharedMemoryFrameReader::GetSlot(uint32 Slot) const {
+  return reinterpret_cast<ShmFrameRing::FSlotHeader *>(
+      static_cast<uint8 *>(Mapping) + Header->FirstSlotOffset +
+      Slot * Header->SlotStride);
+}
+
+bool FSharedMemoryFrameReader::AcquireLatestFrame(FFrame &OutFrame) {
+  if (!Header || bFrameInFlight.load()) {
+    return false;
+  }
+
+  const uint64 Sequence = Header->WriteSequence.load(std::memory_order_acquire);
+  if (Sequence == 0 || Sequence == LastSequence) {
+    return false;
+  }
+  const uint32 Slot = Header->LatestSlot.load(std::memory_order_acquire);
+  if (Slot >= Header->SlotCount) {
+    return false;
+  }
+
+  // Claim, then confirm the producer has not started rewriting the slot.
+  // Pairs with the producer's store-then-recheck in BeginFrame.
+  Header->ReaderSlot.store(Slot);
+  ShmFrameRing::FSlotHeader *SlotHeader = GetSlot(Slot);
+  if (SlotHeader->Sequence.load() != Sequence) {
+    // Raced with a newer publish; pick it up on the next poll
+    Header->ReaderSlot.store(ShmFrameRing::NoSlot);
+    return false;
+  }
+
+  if (LastSequence != 0 && Sequence > LastSequence + 1) {
+    DroppedFrames += Sequence - LastSequence - 1;
+  }
+  LastSequence = Sequence;
+
+  OutFrame.Pixels = reinterpret_cast<const uint8 *>(SlotHeader) +
+                    sizeof(ShmFrameRing::FSlotHeader);
+  OutFrame.Sequence = Sequence;
+  OutFrame.CaptureTimeNs = SlotHeader->CaptureTimeNs;
+  OutFrame.Slot = Slot;
+  bFrameInFlight.store(true);
+  return true;
+}
+
+bool FSharedMemoryFrameReader::ReleaseFrame(const FFrame &Frame) {
+  bool bIntact = true;
+  if (Header && Frame.Slot < Header->SlotCount) {
+    std::atomic_thread_fence(std::memory_order_acquire);
+    bIntact = GetSlot(Frame.Slot)->Sequence.load() == Frame.Sequence;
+    if (!bIntact) {
+      TornFrames++;
+    }
+    Header->ReaderSlot.store(ShmFrameRing::NoSlot,
+                             std::memory_order_release);
+  }
+  bFrameInFlight.store(false);
+  return bIntact;
+}
+
+bool FSharedMemoryFrameReader::WaitForFrame(double TimeoutSeconds) const {
+  if (!Header) {
+    return false;
+  }
+  const double Deadline = FPlatformTime::Seconds() + TimeoutSeconds;
+  for (;;) {
+    const uint32 Bell = Header->Doorbell.load(std::memory_order_acquire);
+    if (Header->WriteSequence.load(std::memory_order_acquire) != LastSequence) {
+      return true;
+    }
+    const double Remaining = Deadline - FPlatformTime::Seconds();
+    if (Remaining <= 0.0) {
+      return false;
+    }
+#if PLATFORM_LINUX
+    FutexWait(&Header->Doorbell, Bell, Remaining);
+#else
+    FPlatformProcess::SleepNoStats(0.0005f);
+#endif
+  }
+}
+
+FSharedMemoryFrameWriter::FSharedMemoryFrameWriter()
+    : Mapping(nullptr), MappingSize(0), Header(nullptr), WriteSlot(0),
+      NextSequence(1) {}
+
+FSharedMemoryFrameWriter::~FSharedMemoryFrameWriter() { Close(); }
+
+bool FSharedMemoryFrameWriter::Create(const FString &Name, int32 Width,
+                                      int32 Height, int32 SlotCount) {
+#if WITH_SHARED_MEMORY_FRAMES
+  Close();
+  SlotCount = FMath::Max<int32>(SlotCount, ShmFrameRing::MinSlots);
+
+  const uint64 RowPitch = AlignUp((uint64)Width * 4, SlotAlignment);
+  const uint64 SlotStride = AlignUp(
+      sizeof(ShmFrameRing::FSlotHeader) + RowPitch * Height, SlotAlignment);
+  const uint64 FirstSlotOffset =
+      AlignUp(sizeof(ShmFrameRing::FHeader), SlotAlignment);
+  const uint64 Size = FirstSlotOffset + SlotStride * SlotCount;
+
+  const FTCHARToUTF8 NameUtf8(*Name);
+  shm_unlink(NameUtf8.Get());
+  const int Fd = shm_open(NameUtf8.Get(), O_CREAT | O_RDWR, 0600);
+  if (Fd < 0) {
+    return false;
+  }
+  if (ftruncate(Fd, Size) != 0) {
+    close(Fd);
+    shm_unlink(NameUtf8.Get());
+    return false;
+  }
+  void *Mapped =
+      mmap(nullptr, Size, PROT_READ | PROT_WRITE, MAP_SHARED, Fd, 0);
+  close(Fd);
+  if (Mapped == MAP_FAILED) {
+    shm_unlink(NameUtf8.Get());
+    return false;
+  }
+
+  Mapping = Mapped;
+  MappingSize = Size;
+  SegmentName = Name;
+  Header = new (Mapped) ShmFrameRing::FHeader();
+  Header->Version = ShmFrameRing::Version;
+  Header->Width = Width;
+  Header->Height = Height;
+  Header->PixelFormat = ShmFrameRing::PixelFormatBGRA8;
+  Header->SlotCount = SlotCount;
+  Header->SlotStride = SlotStride;
+  Header->FirstSlotOffset = FirstSlotOffset;
+  Header->RowPitch = (uint32)RowPitch;
+  Header->WriteSequence.store(0);
+  Header->LatestSlot.store(SlotCount - 1);
+  Header->ReaderSlot.store(ShmFrameRing::NoSlot);
+  Header->Doorbell.store(0);
+  for (int32 Slot = 0; Slot < SlotCount; Slot++) {
+    new (GetSlot(Slot)) ShmFrameRing::FSlotHeader();
+    GetSlot(Slot)->Sequence.store(0);
+  }
+  NextSequence = 1;
+
+  // Magic last, so a reader never sees a half-initialized header
+  std::atomic_thread_fence(std::memory_order_release);
+  Header->Magic = ShmFrameRing::Magic;
+  return true;
+#else
+  return false;
+#endif
+}
+
+void FSharedMemoryFrameWriter::Close() {
+#if WITH_SHARED_MEMORY_FRAMES
+  if (Header) {
+    munmap(Mapping, MappingSize);
+    shm_unlink(TCHAR_TO_UTF8(*SegmentName));
+  }
+#endif
+  Mapping = nullptr;
+  MappingSize = 0;
+  Header = nullptr;
+}
+
+ShmFrameRing::FSlotHeader *
+FSharedMemoryFrameWriter::GetSlot(uint32 Slot) const {
+  return reinterpret_cast<ShmFrameRing::FSlotHeader *>(
+      static_cast<uint8 *>(Mapping) + Header->FirstSlotOffset +
+      Slot * Header->SlotStride);
+}
+
+uint8 *FSharedMemoryFrameWriter::BeginFrame() {
+  if (!Header) {
+    return nullptr;
+  }
+
+  uint32 Slot = Header->LatestSlot.load(std::memory_order_relaxed);
+  for (;;) {
+    Slot = (Slot + 1) % Header->SlotCount;
+    if (Slot == Header->ReaderSlot.load()) {
+      continue;
+    }
+
+    // Mark the slot as being written, then make sure the reader did not
+    // claim it in the meantime. Pairs with AcquireLatestFrame.
+    ShmFrameRing::FSlotHeader *SlotHeader = GetSlot(Slot);
+    const uint64 Previous = SlotHeader->Sequence.load();
+    SlotHeader->Sequence.store(0);
+    if (Header->ReaderSlot.load() != Slot) {
+      WriteSlot = Slot;
+      return reinterpret_cast<uint8 *>(SlotHeader) +
+             sizeof(ShmFrameRing::FSlotHeader);
+    }
+    SlotHeader->Sequence.store(Previous);
+  }
+}
+
+void FSharedMemoryFrameWriter::PublishFrame(uint64 CaptureTimeNs) {
+  if (!Header) {
+    return;
+  }
+  const uint64 Sequence = NextSequence++;
+  ShmFrameRing::FSlotHeader *SlotHeader = GetSlot(WriteSlot);
+  SlotHeader->CaptureTimeNs = CaptureTimeNs;
+  SlotHeader->Sequence.store(Sequence, std::memory_order_release);
+  Header->LatestSlot.store(WriteSlot, std::memory_order_release);
+  Header->WriteSequence.store(Sequence, std::memory_order_release);
+  Header->Doorbell.fetch_add(1, std::memory_order_release);
+#if PLATFORM_LINUX
+  FutexWakeAll(&Header->Doorbell);
+#endif
+}
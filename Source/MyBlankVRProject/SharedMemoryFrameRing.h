@@ -0,0 +1,160 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include <atomic>
+#include <cstddef>
+
+// POSIX shared memory is not available in Android's bionic
+#define WITH_SHARED_MEMORY_FRAMES (PLATFORM_LINUX || PLATFORM_MAC)
+
+// Raw frame ring shared with a camera producer on the same machine. The
+// producer creates the segment with shm_open; layout (little-endian, all
+// offsets in bytes):
+//
+//   Header
+//    0  u32  Magic           'FPVR' (0x52565046)
+//    4  u32  Version         1
+//    8  u32  Width
+//   12  u32  Height
+//   16  u32  PixelFormat     0 = BGRA8
+//   20  u32  SlotCount       >= 3
+//   24  u64  SlotStride      bytes from one slot to the next
+//   32  u64  FirstSlotOffset
+//   40  u32  RowPitch        bytes per pixel row
+//   44  u32  Reserved
+//   48  u64  WriteSequence   last published frame, 0 before the first
+//   56  u32  LatestSlot      slot holding WriteSequence
+//   60  u32  ReaderSlot      slot the reader is uploading from, ~0 if none
+//   64  u32  Doorbell        futex word, incremented on every publish
+//
+//   Slot (64-byte header, then Height * RowPitch bytes of pixels)
+//    0  u64  Sequence        frame number, 0 while being written
+//    8  u64  CaptureTimeNs   producer's capture timestamp
+//
+// Publishing frame N: pick the slot after LatestSlot, skipping ReaderSlot;
+// set its Sequence to 0, re-check ReaderSlot (back off if the reader just
+// claimed it), write pixels, set Sequence = N, then LatestSlot, then
+// WriteSequence, then bump Doorbell and FUTEX_WAKE it. The reader claims a
+// slot through ReaderSlot and validates Sequence before and after use, so
+// it uploads straight from the mapping without copying.
+namespace ShmFrameRing {
+constexpr uint32 Magic = 0x52565046;
+constexpr uint32 Version = 1;
+constexpr uint32 PixelFormatBGRA8 = 0;
+constexpr uint32 NoSlot = 0xFFFFFFFFu;
+constexpr uint32 MinSlots = 3;
+
+struct FHeader {
+  uint32 Magic;
+  uint32 Version;
+  uint32 Width;
+  uint32 Height;
+  uint32 PixelFormat;
+  uint32 SlotCount;
+  uint64 SlotStride;
+  uint64 FirstSlotOffset;
+  uint32 RowPitch;
+  uint32 Reserved;
+  std::atomic<uint64> WriteSequence;
+  std::atomic<uint32> LatestSlot;
+  std::atomic<uint32> ReaderSlot;
+  std::atomic<uint32> Doorbell;
+};
+
+struct alignas(64) FSlotHeader {
+  std::atomic<uint64> Sequence;
+  uint64 CaptureTimeNs;
+};
+
+static_assert(std::atomic<uint64>::is_always_lock_free,
+              "Shared atomics must be address free");
+static_assert(offsetof(FHeader, WriteSequence) == 48 &&
+                  offsetof(FHeader, Doorbell) == 64,
+              "Header layout is part of the protocol");
+static_assert(sizeof(FSlotHeader) == 64, "Slot header is 64 bytes");
+} // namespace ShmFrameRing
+
+// Consumer side, used by ADynamicTextureActor.
+class MYBLANKVRPROJECT_API FSharedMemoryFrameReader {
+public:
+  struct FFrame {
+    const uint8 *Pixels = nullptr;
+    uint64 Sequence = 0;
+    uint64 CaptureTimeNs = 0;
+    uint32 Slot = ShmFrameRing::NoSlot;
+  };
+
+  FSharedMemoryFrameReader();
+  ~FSharedMemoryFrameReader();
+
+  bool Open(const FString &Name);
+  void Close();
+  bool IsOpen() const { return Header != nullptr; }
+
+  // True once the name no longer refers to the mapped segment, e.g. after a
+  // producer restart unlinked it and created a new one.
+  bool IsSegmentReplaced() const;
+
+  int32 GetWidth() const { return Header ? Header->Width : 0; }
+  int32 GetHeight() const { return Header ? Header->Height : 0; }
+  int32 GetRowPitch() const { return Header ? Header->RowPitch : 0; }
+
+  // Claims the newest frame if it is newer than the last one claimed. The
+  // producer will not reuse the slot until ReleaseFrame. Only one frame can
+  // be claimed at a time.
+  bool AcquireLatestFrame(FFrame &OutFrame);
+
+  // Returns the slot to the producer. Safe to call from another thread.
+  // Returns false if the frame was overwritten while in use.
+  bool ReleaseFrame(const FFrame &Frame);
+
+  bool HasFrameInFlight() const { return bFrameInFlight.load(); }
+
+  // Blocks on the doorbell until a frame newer than the last one claimed is
+  // published or the timeout expires.
+  bool WaitForFrame(double TimeoutSeconds) const;
+
+  uint64 GetDroppedFrames() const { return DroppedFrames; }
+  uint64 GetTornFrames() const { return TornFrames.load(); }
+
+private:
+  ShmFrameRing::FSlotHeader *GetSlot(uint32 Slot) const;
+
+  FString SegmentName;
+  uint64 SegmentDevice;
+  uint64 SegmentInode;
+  void *Mapping;
+  SIZE_T MappingSize;
+  ShmFrameRing::FHeader *Header;
+  uint64 LastSequence;
+  uint64 DroppedFrames;
+  std::atomic<bool> bFrameInFlight;
+  std::atomic<uint64> TornFrames;
+};
+
+// Producer side, for in-tree producers such as simulators and tests.
+class MYBLANKVRPROJECT_API FSharedMemoryFrameWriter {
+public:
+  FSharedMemoryFrameWriter();
+  ~FSharedMemoryFrameWriter();
+
+  bool Create(const FString &Name, int32 Width, int32 Height,
+              int32 SlotCount = ShmFrameRing::MinSlots);
+  void Close();
+
+  int32 GetRowPitch() const { return Header ? Header->RowPitch : 0; }
+
+  // Reserves a free slot and returns its pixel memory to fill in
+  uint8 *BeginFrame();
+  void PublishFrame(uint64 CaptureTimeNs);
+
+private:
+  ShmFrameRing::FSlotHeader *GetSlot(uint32 Slot) const;
+
+  FString SegmentName;
+  void *Mapping;
+  SIZE_T MappingSize;
+  ShmFrameRing::FHeader *Header;
+  uint32 WriteSlot;
+  uint64 NextSequence;
+};
@@ -0,0 +1,141 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include <atomic>
+#include <type_traits>
+
+enum class ESampleChannelMode : uint8 {
+  // Mailbox: the consumer only takes the newest value, older ones are
+  // skipped
+  LatestValue,
+  // Ring: the consumer reads every value in order until the producer laps it
+  History,
+};
+
+// Fixed-capacity, allocation-free single-producer/single-consumer channel of
+// trivially copyable values. Every slot is guarded by its own sequence
+// number (a seqlock), so the producer never waits on the consumer: values
+// the consumer falls behind on are overwritten and counted instead.
+template <typename T, uint32 Capacity = 64> class TSpscValueChannel {
+  static_assert(std::is_trivially_copyable<T>::value,
+                "Channel values are copied as raw bytes");
+  static_assert(Capacity >= 2 && (Capacity & (Capacity - 1)) == 0,
+                "Capacity must be a power of two");
+
+public:
+  explicit TSpscValueChannel(
+      ESampleChannelMode InMode = ESampleChannelMode::LatestValue)
+      : Mode(InMode) {}
+
+  ESampleChannelMode GetMode() const { return Mode; }
+
+  // Producer side
+  void Push(const T &Value) {
+    const uint64 Index = Head.load(std::memory_order_relaxed) + 1;
+    FSlot &Slot = Slots[Index & (Capacity - 1)];
+    Slot.Sequence.store(Index * 2 - 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    FMemory::Memcpy(&Slot.Value, &Value, sizeof(T));
+    Slot.Sequence.store(Index * 2, std::memory_order_release);
+    Head.store(Index, std::memory_order_release);
+  }
+
+  // Consumer side: next value according to the channel mode
+  bool Pop(T &OutValue) {
+    return Mode == ESampleChannelMode::LatestValue ? PopLatest(OutValue)
+                                                   : PopNext(OutValue);
+  }
+
+  // Consumer side: newest value, skipping anything older
+  bool PopLatest(T &OutValue) {
+    for (;;) {
+      const uint64 Index = Head.load(std::memory_order_acquire);
+      if (Index <= Tail) {
+        return false;
+      }
+      if (ReadSlot(Index, OutValue)) {
+        Overwritten.fetch_add(Index - Tail - 1, std::memory_order_relaxed);
+        Consumed.fetch_add(1, std::memory_order_relaxed);
+        Tail = Index;
+        return true;
+      }
+      // Lapped while copying; newer values are already there
+    }
+  }
+
+  // Consumer side: oldest value not yet consumed
+  bool PopNext(T &OutValue) {
+    for (;;) {
+      const uint64 Newest = Head.load(std::memory_order_acquire);
+      uint64 Index = Tail + 1;
+      if (Index > Newest) {
+        return false;
+      }
+      if (Newest - Index >= Capacity) {
+        // The producer lapped us; jump to the oldest value still held
+        const uint64 Oldest = Newest - Capacity + 1;
+        Overwritten.fetch_add(Oldest - Index, std::memory_order_relaxed);
+        Tail = Oldest - 1;
+        Index = Oldest;
+      }
+      if (ReadSlot(Index, OutValue)) {
+        Consumed.fetch_add(1, std::memory_order_relaxed);
+        Tail = Index;
+        return true;
+      }
+    }
+  }
+
+  // Any thread: newest value without consuming it
+  bool PeekLatest(T &OutValue) const {
+    for (;;) {
+      const uint64 Index = Head.load(std::memory_order_acquire);
+      if (Index == 0) {
+        return false;
+      }
+      if (ReadSlot(Index, OutValue)) {
+        return true;
+      }
+    }
+  }
+
+  uint64 GetProducedCount() const {
+    return Head.load(std::memory_order_relaxed);
+  }
+  uint64 GetConsumedCount() const {
+    return Consumed.load(std::memory_order_relaxed);
+  }
+  // Values the consumer never saw, because they were overwritten (History)
+  // or superseded (LatestValue)
+  uint64 GetOverwrittenCount() const {
+    return Overwritten.load(std::memory_order_relaxed);
+  }
+
+private:
+  struct alignas(64) FSlot {
+    std::atomic<uint64> Sequence{0};
+    T Value;
+  };
+
+  bool ReadSlot(uint64 Index, T &OutValue) const {
+    const FSlot &Slot = Slots[Index & (Capacity - 1)];
+    const uint64 Before = Slot.Sequence.load(std::memory_order_acquire);
+    if (Before != Index * 2) {
+      return false;
+    }
+    FMemory::Memcpy(&OutValue, &Slot.Value, sizeof(T));
+    std::atomic_thread_fence(std::memory_order_acquire);
+    return Slot.Sequence.load(std::memory_order_relaxed) == Before;
+  }
+
+  const ESampleChannelMode Mode;
+  FSlot Slots[Capacity];
+
+  // Count of values pushed; the newest value has index Head
+  alignas(64) std::atomic<uint64> Head{0};
+
+  // Consumer-owned: index of the last value consumed
+  alignas(64) uint64 Tail = 0;
+  std::atomic<uint64> Consumed{0};
+  std::atomic<uint64> Overwritten{0};
+};
@@ -0,0 +1,188 @@
+#include "TelemetryHistory.h"
+
+namespace {
+constexpr uint64 RawMask = FTelemetrySeries::RawCapacity - 1;
+static_assert((FTelemetrySeries::RawCapacity & RawMask) == 0,
+              "RawCapacity must be a power of two");
+
+// 5 minutes at 1 s, an hour at 10 s, a day at 1 min
+constexpr double TierBucketSeconds[FTelemetrySeries::NumTiers] = {1.0, 10.0,
+                                                                  60.0};
+constexpr int32 TierBucketCount[FTelemetrySeries::NumTiers] = {300, 360, 1440};
+
+int32 BucketSlot(int64 Bucket, int32 NumBuckets) {
+  return (int32)(((Bucket % NumBuckets) + NumBuckets) % NumBuckets);
+}
+} // namespace
+
+FTelemetrySeries::FTelemetrySeries()
+    : WindowSeconds(5.0), Count(0), WindowBegin(0), WindowSum(0.0),
+      MinHead(0), MinTail(0), MaxHead(0), MaxTail(0) {
+  Times.SetNumZeroed(RawCapacity);
+  Values.SetNumZeroed(RawCapacity);
+  MinQueue.SetNumZeroed(RawCapacity);
+  MaxQueue.SetNumZeroed(RawCapacity);
+  for (int32 i = 0; i < NumTiers; i++) {
+    Tiers[i].BucketSeconds = TierBucketSeconds[i];
+    Tiers[i].NewestBucket = MIN_int64;
+    Tiers[i].Buckets.SetNumZeroed(TierBucketCount[i]);
+  }
+}
+
+void FTelemetrySeries::SetWindow(double InWindowSeconds) {
+  WindowSeconds = FMath::Max(InWindowSeconds, 0.0);
+}
+
+void FTelemetrySeries::Add(double Time, float Value) {
+  if (Count - WindowBegin == RawCapacity) {
+    // More samples inside the window than we hold; the window shrinks
+    PopFront();
+  }
+
+  const uint64 Index = Count++;
+  Times[Index & RawMask] = Time;
+  Values[Index & RawMask] = Value;
+  WindowSum += Value;
+
+  while (MinTail > MinHead &&
+         Values[MinQueue[(MinTail - 1) & RawMask] & RawMask] >= Value) {
+    MinTail--;
+  }
+  MinQueue[MinTail++ & RawMask] = Index;
+
+  while (MaxTail > MaxHead &&
+         Values[MaxQueue[(MaxTail - 1) & RawMask] & RawMask] <= Value) {
+    MaxTail--;
+  }
+  MaxQueue[MaxTail++ & RawMask] = Index;
+
+  for (FTier &Tier : Tiers) {
+    AddToTier(Tier, Time, Value);
+  }
+  Expire(Time);
+}
+
+void FTelemetrySeries::PopFront() {
+  const uint64 Index = WindowBegin++;
+  WindowSum -= Values[Index & RawMask];
+  if (MinHead < MinTail && MinQueue[MinHead & RawMask] == Index) {
+    MinHead++;
+  }
+  if (MaxHead < MaxTail && MaxQueue[MaxHead & RawMask] == Index) {
+    MaxHead++;
+  }
+  if (WindowBegin == Count) {
+    // Shed accumulated rounding whenever the window empties
+    WindowSum = 0.0;
+  }
+}
+
+void FTelemetrySeries::Expire(double Now) {
+  const double Cutoff = Now - WindowSeconds;
+  while (WindowBegin < Count && Times[WindowBegin & RawMask] < Cutoff) {
+    PopFront();
+  }
+}
+
+FTelemetryWindowStats FTelemetrySeries::GetStats() const {
+  FTelemetryWindowStats Stats;
+  if (Count > 0) {
+    Stats.Latest = Values[(Count - 1) & RawMask];
+  }
+  const uint64 InWindow = Count - WindowBegin;
+  if (InWindow == 0) {
+    return Stats;
+  }
+  Stats.Min = Values[MinQueue[MinHead & RawMask] & RawMask];
+  Stats.Max = Values[MaxQueue[MaxHead & RawMask] & RawMask];
+  Stats.Mean = (float)(WindowSum / InWindow);
+  Stats.SampleCount = (int32)InWindow;
+  return Stats;
+}
+
+void FTelemetrySeries::AddToTier(FTier &Tier, double Time, float Value) {
+  const int32 NumBuckets = Tier.Buckets.Num();
+  const int64 Bucket = (int64)FMath::FloorToDouble(Time / Tier.BucketSeconds);
+
+  if (Tier.NewestBucket == MIN_int64 || Bucket > Tier.NewestBucket) {
+    // Clear every bucket we skip over, at most one full lap
+    const int64 First = Tier.NewestBucket == MIN_int64
+                            ? Bucket
+                            : FMath::Max(Tier.NewestBucket + 1,
+                                         Bucket - NumBuckets + 1);
+    for (int64 Skipped = First; Skipped <= Bucket; Skipped++) {
+      FMemory::Memzero(Tier.Buckets[BucketSlot(Skipped, NumBuckets)]);
+    }
+    Tier.NewestBucket = Bucket;
+  } else if (Bucket <= Tier.NewestBucket - NumBuckets) {
+    return;
+  }
+
+  FBucket &Slot = Tier.Buckets[BucketSlot(Bucket, NumBuckets)];
+  if (Slot.Count == 0) {
+    Slot.Min = Value;
+    Slot.Max = Value;
+  } else {
+    Slot.Min = FMath::Min(Slot.Min, Value);
+    Slot.Max = FMath::Max(Slot.Max, Value);
+  }
+  Slot.Sum += Value;
+  Slot.Count++;
+}
+
+void FTelemetrySeries::GetHistory(
+    double Now, double SpanSeconds,
+    TArray<FTelemetryHistoryPoint> &OutPoints) const {
+  OutPoints.Reset();
+
+  const FTier *Tier = &Tiers[NumTiers - 1];
+  for (const FTier &Candidate : Tiers) {
+    if (Candidate.BucketSeconds * Candidate.Buckets.Num() >= SpanSeconds) {
+      Tier = &Candidate;
+      break;
+    }
+  }
+  if (Tier->NewestBucket == MIN_int64) {
+    return;
+  }
+
+  const int32 NumBuckets = Tier->Buckets.Num();
+  const int64 NowBucket =
+      (int64)FMath::FloorToDouble(Now / Tier->BucketSeconds);
+  const int64 Last = FMath::Min(NowBucket, Tier->NewestBucket);
+  int64 First = NowBucket -
+                (int64)FMath::CeilToDouble(SpanSeconds / Tier->BucketSeconds) +
+                1;
+  First = FMath::Max(First, Tier->NewestBucket - NumBuckets + 1);
+
+  for (int64 Bucket = First; Bucket <= Last; Bucket++) {
+    const FBucket &Slot = Tier->Buckets[BucketSlot(Bucket, NumBuckets)];
+    if (Slot.Count == 0) {
+      continue;
+    }
+    FTelemetryHistoryPoint &Point = OutPoints.AddDefaulted_GetRef();
+    Point.TimeSeconds = (float)(Bucket * Tier->BucketSeconds - Now);
+    Point.Min = Slot.Min;
+    Point.Max = Slot.Max;
+    Point.Mean = (float)(Slot.Sum / Slot.Count);
+  }
+}
+
+void FTelemetryHistory::SetWindow(double WindowSeconds) {
+  for (FTelemetrySeries &Channel : Series) {
+    Channel.SetWindow(WindowSeconds);
+  }
+}
+
+void FTelemetryHistory::Add(double Time,
+                            const float (&ChannelValues)[NumChannels]) {
+  for (int32 i = 0; i < NumChannels; i++) {
+    Series[i].Add(Time, ChannelValues[i]);
+  }
+}
+
+void FTelemetryHistory::Expire(double Now) {
+  for (FTelemetrySeries &Channel : Series) {
+    Channel.Expire(Now);
+  }
+}
@@ -0,0 +1,139 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "TelemetryHistory.generated.h"
+
+UENUM(BlueprintType)
+enum class ETelemetryChannel : uint8 {
+  SpeedMph,
+  DistanceFeet,
+  ControlBattery,
+  DriveBattery,
+};
+
+// Rolling statistics over the configured window, see FTelemetrySeries
+USTRUCT(BlueprintType)
+struct FTelemetryWindowStats {
+  GENERATED_BODY()
+
+  UPROPERTY(BlueprintReadOnly, Category = "Telemetry")
+  float Min = 0.0f;
+
+  UPROPERTY(BlueprintReadOnly, Category = "Telemetry")
+  float Max = 0.0f;
+
+  UPROPERTY(BlueprintReadOnly, Category = "Telemetry")
+  float Mean = 0.0f;
+
+  UPROPERTY(BlueprintReadOnly, Category = "Telemetry")
+  float Latest = 0.0f;
+
+  // Zero when no sample falls inside the window
+  UPROPERTY(BlueprintReadOnly, Category = "Telemetry")
+  int32 SampleCount = 0;
+};
+
+// One downsampled bucket for graphs
+USTRUCT(BlueprintType)
+struct FTelemetryHistoryPoint {
+  GENERATED_BODY()
+
+  // Start of the bucket relative to now, so always <= 0
+  UPROPERTY(BlueprintReadOnly, Category = "Telemetry")
+  float TimeSeconds = 0.0f;
+
+  UPROPERTY(BlueprintReadOnly, Category = "Telemetry")
+  float Min = 0.0f;
+
+  UPROPERTY(BlueprintReadOnly, Category = "Telemetry")
+  float Max = 0.0f;
+
+  UPROPERTY(BlueprintReadOnly, Category = "Telemetry")
+  float Mean = 0.0f;
+};
+
+// Time series for one telemetry channel in fixed memory.
+//
+// The newest RawCapacity samples feed a rolling window whose min and max are
+// kept in monotonic queues and whose mean is a running sum, so adding a
+// sample is amortized O(1) and reading the stats is O(1). Older history is
+// kept only as min/max/mean buckets in coarser tiers.
+class MYBLANKVRPROJECT_API FTelemetrySeries {
+public:
+  static constexpr int32 RawCapacity = 1024;
+  static constexpr int32 NumTiers = 3;
+
+  FTelemetrySeries();
+
+  void SetWindow(double InWindowSeconds);
+  double GetWindow() const { return WindowSeconds; }
+
+  // Samples must arrive in time order (seconds on any monotonic clock)
+  void Add(double Time, float Value);
+
+  // Drops samples that have left the window; call as time passes even if
+  // nothing new arrives
+  void Expire(double Now);
+
+  FTelemetryWindowStats GetStats() const;
+
+  // Buckets covering at least SpanSeconds, from the finest tier that holds
+  // that much, oldest first. Empty buckets are skipped.
+  void GetHistory(double Now, double SpanSeconds,
+                  TArray<FTelemetryHistoryPoint> &OutPoints) const;
+
+private:
+  struct FBucket {
+    float Min;
+    float Max;
+    double Sum;
+    int32 Count;
+  };
+
+  struct FTier {
+    double BucketSeconds;
+    // Index of the newest bucket as floor(Time / BucketSeconds)
+    int64 NewestBucket;
+    TArray<FBucket> Buckets;
+  };
+
+  void AddToTier(FTier &Tier, double Time, float Value);
+  void PopFront();
+
+  double WindowSeconds;
+
+  // Ring of raw samples addressed by a running sample index
+  TArray<double> Times;
+  TArray<float> Values;
+  uint64 Count;
+  // Index of the oldest sample still in the window
+  uint64 WindowBegin;
+  double WindowSum;
+
+  // Sample indices with increasing values (Min) / decreasing values (Max)
+  TArray<uint64> MinQueue;
+  TArray<uint64> MaxQueue;
+  uint64 MinHead, MinTail;
+  uint64 MaxHead, MaxTail;
+
+  FTier Tiers[NumTiers];
+};
+
+// Histories for all telemetry channels, fed and read on the game thread
+class MYBLANKVRPROJECT_API FTelemetryHistory {
+public:
+  static constexpr int32 NumChannels = 4;
+
+  void SetWindow(double WindowSeconds);
+
+  // Values in the same order as ETelemetryChannel
+  void Add(double Time, const float (&ChannelValues)[NumChannels]);
+  void Expire(double Now);
+
+  const FTelemetrySeries &Get(ETelemetryChannel Channel) const {
+    return Series[FMath::Clamp((int32)Channel, 0, NumChannels - 1)];
+  }
+
+private:
+  FTelemetrySeries Series[NumChannels];
+};
@@ -0,0 +1,182 @@
+#include "VideoFramePose.h"
+
+const uint8 VideoPoseSei::PoseUuid[16] = {0x5a, 0x1c, 0x7e, 0x42, 0x93, 0x0b,
+                                          0x4f, 0x6d, 0xa8, 0x21, 0xc4, 0x3e,
+                                          0x70, 0x95, 0xd2, 0x18};
+
+namespace {
+constexpr uint8 SeiPayloadUserDataUnregistered = 5;
+constexpr int32 MessageSize = 16 + VideoPoseSei::BodySize;
+// Longest SEI RBSP we unescape while looking for ours
+constexpr int32 MaxSeiSize = 512;
+
+int32 NalHeaderSize(EVideoCodec Codec) {
+  return Codec == EVideoCodec::H265 ? 2 : 1;
+}
+
+bool IsSeiNal(EVideoCodec Codec, const uint8 *Nal) {
+  if (Codec == EVideoCodec::H265) {
+    // Prefix SEI
+    return ((Nal[0] >> 1) & 0x3f) == 39;
+  }
+  return (Nal[0] & 0x1f) == 6;
+}
+
+void WriteLittleEndian(uint8 *Out, uint64 Value, int32 Bytes) {
+  for (int32 i = 0; i < Bytes; i++) {
+    Out[i] = (uint8)(Value >> (8 * i));
+  }
+}
+
+uint64 ReadLittleEndian(const uint8 *Data, int32 Bytes) {
+  uint64 Value = 0;
+  for (int32 i = 0; i < Bytes; i++) {
+    Value |= (uint64)Data[i] << (8 * i);
+  }
+  return Value;
+}
+
+bool ParseBody(const uint8 *Body, FVideoFramePose &OutPose) {
+  if (Body[0] != VideoPoseSei::Version) {
+    return false;
+  }
+  OutPose.bHasGimbalPose = (Body[1] & VideoPoseSei::FlagGimbalPose) != 0;
+  OutPose.ControlSequence = (uint32)ReadLittleEndian(Body + 2, 4);
+  OutPose.CaptureRobotUs = ReadLittleEndian(Body + 6, 8);
+  const uint32 PitchBits = (uint32)ReadLittleEndian(Body + 14, 4);
+  const uint32 YawBits = (uint32)ReadLittleEndian(Body + 18, 4);
+  FMemory::Memcpy(&OutPose.GimbalPitch, &PitchBits, 4);
+  FMemory::Memcpy(&OutPose.GimbalYaw, &YawBits, 4);
+  return true;
+}
+
+// Walks the SEI messages of one unescaped SEI RBSP
+bool ParseSei(const uint8 *Rbsp, int32 Size, FVideoFramePose &OutPose) {
+  int32 Offset = 0;
+  // Stop at the trailing bits
+  while (Offset < Size && Rbsp[Offset] != 0x80) {
+    int32 Type = 0;
+    while (Offset < Size && Rbsp[Offset] == 0xff) {
+      Type += 255;
+      Offset++;
+    }
+    if (Offset >= Size) {
+      return false;
+    }
+    Type += Rbsp[Offset++];
+    int32 PayloadSize = 0;
+    while (Offset < Size && Rbsp[Offset] == 0xff) {
+      PayloadSize += 255;
+      Offset++;
+    }
+    if (Offset >= Size) {
+      return false;
+    }
+    PayloadSize += Rbsp[Offset++];
+    if (PayloadSize > Size - Offset) {
+      return false;
+    }
+    if (Type == SeiPayloadUserDataUnregistered && PayloadSize >= MessageSize &&
+        FMemory::Memcmp(Rbsp + Offset, VideoPoseSei::PoseUuid, 16) == 0) {
+      return ParseBody(Rbsp + Offset + 16, OutPose);
+    }
+    Offset += PayloadSize;
+  }
+  return false;
+}
+} // namespace
+
+int32 VideoPoseSei::Encode(EVideoCodec Codec, const FVideoFramePose &Pose,
+                           uint8 *Out, int32 Capacity) {
+  if (Codec == EVideoCodec::AV1) {
+    return 0;
+  }
+
+  uint8 Rbsp[2 + MessageSize + 1];
+  Rbsp[0] = SeiPayloadUserDataUnregistered;
+  Rbsp[1] = (uint8)MessageSize;
+  FMemory::Memcpy(Rbsp + 2, PoseUuid, 16);
+  uint8 *Body = Rbsp + 2 + 16;
+  Body[0] = Version;
+  Body[1] = Pose.bHasGimbalPose ? FlagGimbalPose : 0;
+  WriteLittleEndian(Body + 2, Pose.ControlSequence, 4);
+  WriteLittleEndian(Body + 6, Pose.CaptureRobotUs, 8);
+  uint32 PitchBits;
+  uint32 YawBits;
+  FMemory::Memcpy(&PitchBits, &Pose.GimbalPitch, 4);
+  FMemory::Memcpy(&YawBits, &Pose.GimbalYaw, 4);
+  WriteLittleEndian(Body + 14, PitchBits, 4);
+  WriteLittleEndian(Body + 18, YawBits, 4);
+  Rbsp[sizeof(Rbsp) - 1] = 0x80;
+
+  // Start code, NAL header, then the RBSP with emulation prevention; at
+  // worst one escape byte per two input bytes
+  const int32 HeaderSize = NalHeaderSize(Codec);
+  if (Capacity < 4 + HeaderSize + (int32)sizeof(Rbsp) * 3 / 2 + 1) {
+    return 0;
+  }
+  int32 Size = 0;
+  Out[Size++] = 0;
+  Out[Size++] = 0;
+  Out[Size++] = 0;
+  Out[Size++] = 1;
+  if (Codec == EVideoCodec::H265) {
+    Out[Size++] = 39 << 1;
+    Out[Size++] = 1;
+  } else {
+    Out[Size++] = 6;
+  }
+  int32 Zeros = 0;
+  for (const uint8 Byte : Rbsp) {
+    if (Zeros == 2 && Byte <= 3) {
+      Out[Size++] = 3;
+      Zeros = 0;
+    }
+    Out[Size++] = Byte;
+    Zeros = Byte == 0 ? Zeros + 1 : 0;
+  }
+  return Size;
+}
+
+bool VideoPoseSei::Find(EVideoCodec Codec, const uint8 *Data, int32 Size,
+                        FVideoFramePose &OutPose) {
+  if (Codec == EVideoCodec::AV1) {
+    return false;
+  }
+  const int32 HeaderSize = NalHeaderSize(Codec);
+  int32 Offset = 0;
+  while (Offset + 3 <= Size) {
+    // Next start code
+    if (Data[Offset] != 0 || Data[Offset + 1] != 0 || Data[Offset + 2] != 1) {
+      Offset++;
+      continue;
+    }
+    const int32 NalStart = Offset + 3;
+    if (NalStart + HeaderSize > Size || !IsSeiNal(Codec, Data + NalStart)) {
+      Offset = NalStart;
+      continue;
+    }
+
+    // Unescape up to the next start code
+    uint8 Rbsp[MaxSeiSize];
+    int32 RbspSize = 0;
+    int32 Zeros = 0;
+    int32 i = NalStart + HeaderSize;
+    for (; i < Size && RbspSize < MaxSeiSize; i++) {
+      if (Zeros == 2 && Data[i] <= 1) {
+        break;
+      }
+      if (Zeros == 2 && Data[i] == 3) {
+        Zeros = 0;
+        continue;
+      }
+      Rbsp[RbspSize++] = Data[i];
+      Zeros = Data[i] == 0 ? Zeros + 1 : 0;
+    }
+    if (ParseSei(Rbsp, RbspSize, OutPose)) {
+      return true;
+    }
+    Offset = i;
+  }
+  return false;
+}
@@ -0,0 +1,53 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "VideoStreamConfig.h"
+
+// Where the camera pointed when a video frame was captured, as the robot
+// reports it in an SEI message ahead of the frame's slices.
+struct FVideoFramePose {
+  // Robot clock, as in control and telemetry timestamps; 0 if unknown
+  uint64 CaptureRobotUs = 0;
+  // Newest control sequence the gimbal had applied
+  uint32 ControlSequence = 0;
+  // Gimbal angles in the control stream's accumulated frame, valid if
+  // bHasGimbalPose. Without them the capture pose is inferred from the
+  // commands sent around the capture time.
+  bool bHasGimbalPose = false;
+  float GimbalPitch = 0.0f;
+  float GimbalYaw = 0.0f;
+
+  // Stamped here rather than sent, ClockSync::NowMicros() time base: when
+  // the access unit was read off the network and when it was decoded
+  int64 ReceivedLocalUs = 0;
+  int64 DecodedLocalUs = 0;
+};
+
+// The pose travels as user_data_unregistered SEI (payload type 5) tagged
+// with PoseUuid, in H.264 and H.265 streams. Body, little-endian:
+//
+//    0  u8   Version         1
+//    1  u8   Flags           bit 0: gimbal pose present
+//    2  u32  ControlSequence
+//    6  u64  CaptureRobotUs
+//   14  f32  GimbalPitch
+//   18  f32  GimbalYaw
+//
+// AV1 streams carry no pose; frames are then left uncorrected.
+namespace VideoPoseSei {
+constexpr uint8 Version = 1;
+constexpr uint8 FlagGimbalPose = 1 << 0;
+constexpr int32 BodySize = 22;
+extern MYBLANKVRPROJECT_API const uint8 PoseUuid[16];
+
+// Writes a complete SEI NAL unit, start code included, to Out. Returns its
+// size, or 0 for AV1 or if Capacity is too small.
+MYBLANKVRPROJECT_API int32 Encode(EVideoCodec Codec,
+                                  const FVideoFramePose &Pose, uint8 *Out,
+                                  int32 Capacity);
+
+// Scans an Annex-B access unit, as the RTP depacketizer hands it out, for
+// a pose SEI
+MYBLANKVRPROJECT_API bool Find(EVideoCodec Codec, const uint8 *Data,
+                               int32 Size, FVideoFramePose &OutPose);
+} // namespace VideoPoseSei
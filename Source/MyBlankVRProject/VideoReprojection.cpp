@@ -0,0 +1,101 @@
+#include "VideoReprojection.h"
+
+FPoseHistory::FPoseHistory(int32 InCapacity)
+    : Capacity(FMath::Max(InCapacity, 2)), Oldest(0) {
+  Samples.Reserve(Capacity);
+}
+
+void FPoseHistory::Reset() {
+  Samples.Reset();
+  Oldest = 0;
+}
+
+const FHeadPoseSample &FPoseHistory::At(int32 Index) const {
+  return Samples[(Oldest + Index) % Samples.Num()];
+}
+
+void FPoseHistory::Add(const FHeadPoseSample &Sample) {
+  if (Samples.Num() > 0 && Sample.TimeUs <= At(Samples.Num() - 1).TimeUs) {
+    return;
+  }
+  if (Samples.Num() < Capacity) {
+    Samples.Add(Sample);
+    return;
+  }
+  Samples[Oldest] = Sample;
+  Oldest = (Oldest + 1) % Capacity;
+}
+
+bool FPoseHistory::Sample(int64 TimeUs, float &OutPitch,
+                          float &OutYaw) const {
+  const int32 Count = Samples.Num();
+  if (Count == 0 || TimeUs < At(0).TimeUs || TimeUs > At(Count - 1).TimeUs) {
+    return false;
+  }
+
+  // Last sample at or before TimeUs
+  int32 Low = 0;
+  int32 High = Count - 1;
+  while (Low < High) {
+    const int32 Mid = (Low + High + 1) / 2;
+    if (At(Mid).TimeUs <= TimeUs) {
+      Low = Mid;
+    } else {
+      High = Mid - 1;
+    }
+  }
+  const FHeadPoseSample &A = At(Low);
+  if (Low == Count - 1) {
+    OutPitch = A.Pitch;
+    OutYaw = A.Yaw;
+    return true;
+  }
+  const FHeadPoseSample &B = At(Low + 1);
+  const float Alpha = (float)(TimeUs - A.TimeUs) / (B.TimeUs - A.TimeUs);
+  OutPitch = FMath::Lerp(A.Pitch, B.Pitch, Alpha);
+  OutYaw = FMath::Lerp(A.Yaw, B.Yaw, Alpha);
+  return true;
+}
+
+FVideoReprojectionDelta
+VideoReprojection::ComputeDelta(float CapturePitch, float CaptureYaw,
+                                float DisplayPitch, float DisplayYaw,
+                                float MaxDegrees) {
+  const float Pitch = CapturePitch - DisplayPitch;
+  // Both sides are unwrapped, but a robot may report its own wrap
+  const float Yaw = FMath::UnwindDegrees(CaptureYaw - DisplayYaw);
+
+  FVideoReprojectionDelta Delta;
+  Delta.Pitch = FMath::Clamp(Pitch, -MaxDegrees, MaxDegrees);
+  Delta.Yaw = FMath::Clamp(Yaw, -MaxDegrees, MaxDegrees);
+  Delta.bClamped = Delta.Pitch != Pitch || Delta.Yaw != Yaw;
+  return Delta;
+}
+
+FQuat VideoReprojection::PlaneRotation(float DisplayPitch, float DisplayYaw,
+                                       const FVideoReprojectionDelta &Delta) {
+  const FQuat Display = FRotator(DisplayPitch, DisplayYaw, 0.0f).Quaternion();
+  const FQuat Capture = FRotator(DisplayPitch + Delta.Pitch,
+                                 DisplayYaw + Delta.Yaw, 0.0f)
+                            .Quaternion();
+  return Display.Inverse() * Capture;
+}
+
+FVector2D VideoReprojection::UVOffset(float DisplayPitch, float DisplayYaw,
+                                      const FVideoReprojectionDelta &Delta,
+                                      float HorizontalFovDegrees,
+                                      float AspectRatio) {
+  // Where the view centre falls in the captured image
+  const FVector Centre =
+      PlaneRotation(DisplayPitch, DisplayYaw, Delta)
+          .UnrotateVector(FVector(1.0f, 0.0f, 0.0f));
+  if (Centre.X <= KINDA_SMALL_NUMBER) {
+    return FVector2D(0.0f, 0.0f);
+  }
+  // Image-plane half extents at unit distance
+  const float HalfWidth =
+      FMath::Tan(FMath::DegreesToRadians(HorizontalFovDegrees) / 2.0f);
+  const float HalfHeight = HalfWidth / FMath::Max(AspectRatio, 0.01f);
+  return FVector2D(Centre.Y / Centre.X / (2.0f * HalfWidth),
+                   -Centre.Z / Centre.X / (2.0f * HalfHeight));
+}
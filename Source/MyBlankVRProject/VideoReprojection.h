@@ -0,0 +1,74 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "HeadPosePredictor.h"
+#include "VideoReprojection.generated.h"
+
+UENUM(BlueprintType)
+enum class EVideoReprojectionMode : uint8 {
+  // Show each frame where the plane sits
+  None,
+  // Swing the head-locked plane about the viewer to where the camera
+  // pointed at capture; exact for a plane that spans the camera's field of
+  // view
+  PlaneTransform,
+  // Slide the image by the pose change through the material's
+  // ReprojectionUVOffset parameter; exact at the centre only
+  UVOffset,
+};
+
+// Capture pose minus display pose, degrees
+struct FVideoReprojectionDelta {
+  float Pitch = 0.0f;
+  float Yaw = 0.0f;
+  // An axis exceeded the limit and was cut back to it
+  bool bClamped = false;
+};
+
+// Fixed-length history of poses in time order, looked up by interpolation.
+// Game thread only.
+class MYBLANKVRPROJECT_API FPoseHistory {
+public:
+  explicit FPoseHistory(int32 InCapacity = 512);
+
+  void Reset();
+
+  // Samples no newer than the last are ignored
+  void Add(const FHeadPoseSample &Sample);
+
+  // Pose at TimeUs; false outside the recorded span
+  bool Sample(int64 TimeUs, float &OutPitch, float &OutYaw) const;
+
+private:
+  const FHeadPoseSample &At(int32 Index) const;
+
+  TArray<FHeadPoseSample> Samples;
+  int32 Capacity;
+  // Index of the oldest sample once the history has wrapped
+  int32 Oldest;
+};
+
+// Re-aims video captured at one head pose for display at another, so the
+// scene holds still in the world while the frame is in flight. Angles are
+// the gimbal angles the control stream drives, pitch up and yaw right.
+namespace VideoReprojection {
+// Capture pose minus display pose, each axis limited to MaxDegrees so a
+// bad timestamp cannot throw the image out of view
+MYBLANKVRPROJECT_API FVideoReprojectionDelta
+ComputeDelta(float CapturePitch, float CaptureYaw, float DisplayPitch,
+             float DisplayYaw, float MaxDegrees);
+
+// Relative rotation to put on a plane locked to a head at the display pose
+// so it faces the capture pose. Head roll is ignored; the gimbal has none.
+MYBLANKVRPROJECT_API FQuat PlaneRotation(float DisplayPitch, float DisplayYaw,
+                                         const FVideoReprojectionDelta &Delta);
+
+// Texture-space shift that lines the captured image up with the view at
+// its centre, for a camera with the given horizontal field of view and
+// width over height. Added to the sampled UV: positive U reads further
+// right in the image, positive V further down.
+MYBLANKVRPROJECT_API FVector2D UVOffset(float DisplayPitch, float DisplayYaw,
+                                        const FVideoReprojectionDelta &Delta,
+                                        float HorizontalFovDegrees,
+                                        float AspectRatio);
+} // namespace VideoReprojection
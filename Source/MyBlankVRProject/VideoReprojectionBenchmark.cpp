@@ -0,0 +1,251 @@
+#include "BenchmarkScenarios.h"
+#include "Math/RandomStream.h"
+#include "VideoFramePose.h"
+#include "VideoReprojection.h"
+
+namespace {
+struct FModeInfo {
+  const TCHAR *Name;
+  EVideoReprojectionMode Mode;
+};
+
+const FModeInfo Modes[] = {
+    {TEXT("none"), EVideoReprojectionMode::None},
+    {TEXT("plane_transform"), EVideoReprojectionMode::PlaneTransform},
+    {TEXT("uv_offset"), EVideoReprojectionMode::UVOffset},
+};
+
+bool SamePose(const FVideoFramePose &A, const FVideoFramePose &B) {
+  return A.CaptureRobotUs == B.CaptureRobotUs &&
+         A.ControlSequence == B.ControlSequence &&
+         A.bHasGimbalPose == B.bHasGimbalPose &&
+         FMemory::Memcmp(&A.GimbalPitch, &B.GimbalPitch, 4) == 0 &&
+         FMemory::Memcmp(&A.GimbalYaw, &B.GimbalYaw, 4) == 0;
+}
+
+// Random poses, including ones full of zero bytes that need emulation
+// prevention, as SEI between slice-like NAL units
+bool CheckSeiRoundTrip(FRandomStream &Random, int32 Trials) {
+  for (const EVideoCodec Codec : {EVideoCodec::H264, EVideoCodec::H265}) {
+    for (int32 Trial = 0; Trial < Trials; Trial++) {
+      FVideoFramePose Pose;
+      if (Trial % 4 != 0) {
+        Pose.CaptureRobotUs = ((uint64)Random.GetUnsignedInt() << 32) |
+                              Random.GetUnsignedInt();
+        Pose.ControlSequence = Random.GetUnsignedInt();
+        Pose.bHasGimbalPose = Random.FRand() < 0.5f;
+        Pose.GimbalPitch = Random.FRandRange(-90.0f, 90.0f);
+        Pose.GimbalYaw = Random.FRandRange(-1000.0f, 1000.0f);
+      } else {
+        Pose.CaptureRobotUs = (uint64)Random.RandRange(0, 3) << 32;
+      }
+
+      uint8 AccessUnit[256];
+      int32 Size = 0;
+      for (int32 Nal = 0; Nal < 3; Nal++) {
+        if (Nal == 1) {
+          const int32 SeiSize = VideoPoseSei::Encode(
+              Codec, Pose, AccessUnit + Size, sizeof(AccessUnit) - Size);
+          if (SeiSize == 0) {
+            UE_LOG(LogTemp, Error,
+                   TEXT("VideoReprojection: SEI encode failed"));
+            return false;
+          }
+          Size += SeiSize;
+          continue;
+        }
+        // Start code and a slice header byte (IDR in H.264, TRAIL_R in
+        // H.265) ahead of some payload
+        const uint8 Header[] = {0, 0, 0, 1,
+                                (uint8)(Codec == EVideoCodec::H265 ? 2 : 0x65)};
+        FMemory::Memcpy(AccessUnit + Size, Header, sizeof(Header));
+        Size += sizeof(Header);
+        for (int32 i = 0; i < 16; i++) {
+          AccessUnit[Size++] = (uint8)Random.RandRange(4, 255);
+        }
+      }
+
+      FVideoFramePose Found;
+      if (!VideoPoseSei::Find(Codec, AccessUnit, Size, Found) ||
+          !SamePose(Pose, Found)) {
+        UE_LOG(LogTemp, Error,
+               TEXT("VideoReprojection: SEI round trip mismatch, trial %d"),
+               Trial);
+        return false;
+      }
+    }
+  }
+
+  FVideoFramePose Pose;
+  uint8 Unused[128];
+  if (VideoPoseSei::Encode(EVideoCodec::AV1, Pose, Unused, sizeof(Unused)) !=
+      0) {
+    UE_LOG(LogTemp, Error, TEXT("VideoReprojection: AV1 SEI encoded"));
+    return false;
+  }
+  return true;
+}
+
+// A wrapped history of a known ramp must interpolate it exactly
+bool CheckPoseHistory(FRandomStream &Random) {
+  FPoseHistory History(64);
+  const int64 StepUs = 11111;
+  for (int32 i = 0; i < 200; i++) {
+    FHeadPoseSample Sample;
+    Sample.TimeUs = i * StepUs;
+    Sample.Pitch = i * 0.5f;
+    Sample.Yaw = i * -2.0f;
+    History.Add(Sample);
+  }
+  const int64 FirstUs = (200 - 64) * StepUs;
+  const int64 LastUs = 199 * StepUs;
+  float Pitch;
+  float Yaw;
+  if (History.Sample(FirstUs - 1, Pitch, Yaw) ||
+      History.Sample(LastUs + 1, Pitch, Yaw)) {
+    UE_LOG(LogTemp, Error,
+           TEXT("VideoReprojection: pose history answered out of range"));
+    return false;
+  }
+  for (int32 Trial = 0; Trial < 1000; Trial++) {
+    const int64 TimeUs =
+        FirstUs + (int64)(Random.FRand() * (double)(LastUs - FirstUs));
+    if (!History.Sample(TimeUs, Pitch, Yaw) ||
+        FMath::Abs(Pitch - TimeUs * 0.5 / StepUs) > 1e-3 ||
+        FMath::Abs(Yaw + TimeUs * 2.0 / StepUs) > 1e-3) {
+      UE_LOG(LogTemp, Error,
+             TEXT("VideoReprojection: pose history wrong at %lld us"),
+             (long long)TimeUs);
+      return false;
+    }
+  }
+  return true;
+}
+
+double AngleBetweenDegrees(const FVector &A, const FVector &B) {
+  const double Cosine = FVector::DotProduct(A.GetSafeNormal(),
+                                            B.GetSafeNormal());
+  return FMath::RadiansToDegrees(FMath::Acos(FMath::Clamp(Cosine, -1.0, 1.0)));
+}
+} // namespace
+
+bool BenchmarkScenarios::RunVideoReprojection(const FString &Params,
+                                              TSharedRef<FJsonObject> Report) {
+  int32 Trials = 20000;
+  int32 Seed = 1;
+  float MaxDegrees = 30.0f;
+  float FovDegrees = 90.0f;
+  float Aspect = 16.0f / 9.0f;
+  float MaxRateDegPerSec = 300.0f;
+  FParse::Value(*Params, TEXT("Trials="), Trials);
+  FParse::Value(*Params, TEXT("Seed="), Seed);
+  FParse::Value(*Params, TEXT("MaxDegrees="), MaxDegrees);
+  FParse::Value(*Params, TEXT("FovDegrees="), FovDegrees);
+  FParse::Value(*Params, TEXT("Aspect="), Aspect);
+  FParse::Value(*Params, TEXT("MaxRate="), MaxRateDegPerSec);
+
+  FRandomStream Random(Seed);
+  if (!CheckSeiRoundTrip(Random, 1000) || !CheckPoseHistory(Random)) {
+    return false;
+  }
+
+  // A camera image spanning the field of view is shown on a head-locked
+  // plane spanning the same angles. A feature seen at some pixel should
+  // appear in the direction it was captured from, whatever the head has
+  // done since.
+  const double HalfWidth =
+      FMath::Tan(FMath::DegreesToRadians(FovDegrees) / 2.0);
+  const double HalfHeight = HalfWidth / Aspect;
+  auto PlaneDirection = [&](double U, double V) {
+    return FVector(1.0, (2.0 * U - 1.0) * HalfWidth,
+                   (1.0 - 2.0 * V) * HalfHeight);
+  };
+
+  FBenchmarkSamples ErrorDeg[UE_ARRAY_COUNT(Modes)];
+  int32 Clamped = 0;
+  double WorstUnclampedPlaneError = 0.0;
+  for (int32 Trial = 0; Trial < Trials; Trial++) {
+    // Head moving at up to MaxRate while the frame is 20-120 ms old
+    const float DisplayPitch = Random.FRandRange(-40.0f, 40.0f);
+    const float DisplayYaw = Random.FRandRange(-720.0f, 720.0f);
+    const float Heading = Random.FRandRange(0.0f, 2.0f * UE_PI);
+    const float Rate = Random.FRandRange(0.0f, MaxRateDegPerSec);
+    const float AgeSeconds = Random.FRandRange(0.02f, 0.12f);
+    const float CapturePitch =
+        DisplayPitch - Rate * AgeSeconds * FMath::Sin(Heading);
+    const float CaptureYaw =
+        DisplayYaw - Rate * AgeSeconds * FMath::Cos(Heading);
+
+    const double U = Random.FRandRange(0.05f, 0.95f);
+    const double V = Random.FRandRange(0.05f, 0.95f);
+    const FQuat Capture = FRotator(CapturePitch, CaptureYaw, 0.0f).Quaternion();
+    const FQuat Display = FRotator(DisplayPitch, DisplayYaw, 0.0f).Quaternion();
+    const FVector World = Capture.RotateVector(PlaneDirection(U, V));
+
+    const FVideoReprojectionDelta Delta = VideoReprojection::ComputeDelta(
+        CapturePitch, CaptureYaw, DisplayPitch, DisplayYaw, MaxDegrees);
+    Clamped += Delta.bClamped ? 1 : 0;
+
+    for (int32 m = 0; m < UE_ARRAY_COUNT(Modes); m++) {
+      FVector Shown;
+      switch (Modes[m].Mode) {
+      case EVideoReprojectionMode::PlaneTransform:
+        Shown = Display.RotateVector(
+            VideoReprojection::PlaneRotation(DisplayPitch, DisplayYaw, Delta)
+                .RotateVector(PlaneDirection(U, V)));
+        break;
+      case EVideoReprojectionMode::UVOffset: {
+        // The material reads texel UV + Offset at screen UV
+        const FVector2D Offset =
+            VideoReprojection::UVOffset(DisplayPitch, DisplayYaw, Delta,
+                                        FovDegrees, Aspect);
+        Shown = Display.RotateVector(
+            PlaneDirection(U - Offset.X, V - Offset.Y));
+        break;
+      }
+      default:
+        Shown = Display.RotateVector(PlaneDirection(U, V));
+        break;
+      }
+      const double Error = AngleBetweenDegrees(World, Shown);
+      ErrorDeg[m].Add(Error);
+      if (Modes[m].Mode == EVideoReprojectionMode::PlaneTransform &&
+          !Delta.bClamped) {
+        WorstUnclampedPlaneError = FMath::Max(WorstUnclampedPlaneError, Error);
+      }
+    }
+  }
+
+  TArray<TSharedPtr<FJsonValue>> Results;
+  for (int32 m = 0; m < UE_ARRAY_COUNT(Modes); m++) {
+    UE_LOG(LogTemp, Display,
+           TEXT("VideoReprojection %-16s: error p50 %.3f p95 %.3f p99 %.3f "
+                "max %.3f deg"),
+           Modes[m].Name, ErrorDeg[m].Percentile(50.0),
+           ErrorDeg[m].Percentile(95.0), ErrorDeg[m].Percentile(99.0),
+           ErrorDeg[m].Percentile(100.0));
+    TSharedRef<FJsonObject> Json = MakeShared<FJsonObject>();
+    Json->SetStringField(TEXT("mode"), Modes[m].Name);
+    Json->SetObjectField(TEXT("error_deg"), ErrorDeg[m].ToJson());
+    Results.Add(MakeShared<FJsonValueObject>(Json));
+  }
+  UE_LOG(LogTemp, Display,
+         TEXT("VideoReprojection: %d of %d trials clamped at %.0f deg"),
+         Clamped, Trials, MaxDegrees);
+
+  Report->SetNumberField(TEXT("trials"), Trials);
+  Report->SetNumberField(TEXT("fov_degrees"), FovDegrees);
+  Report->SetNumberField(TEXT("max_degrees"), MaxDegrees);
+  Report->SetNumberField(TEXT("clamped"), Clamped);
+  Report->SetBoolField(TEXT("sei_round_trip"), true);
+  Report->SetArrayField(TEXT("results"), Results);
+
+  // The plane correction is exact whenever it is not clamped
+  if (WorstUnclampedPlaneError > 0.01) {
+    UE_LOG(LogTemp, Error,
+           TEXT("VideoReprojection: plane transform off by %.4f deg"),
+           WorstUnclampedPlaneError);
+    return false;
+  }
+  return true;
+}
@@ -0,0 +1,31 @@
+#include "VideoStreamConfig.h"
+
+const TCHAR *GetRtpEncodingName(EVideoCodec Codec) {
+  switch (Codec) {
+  case EVideoCodec::H265:
+    return TEXT("H265");
+  case EVideoCodec::AV1:
+    // RFC draft name; depacketized by libavformat 7.1 and later
+    return TEXT("AV1");
+  case EVideoCodec::H264:
+  default:
+    return TEXT("H264");
+  }
+}
+
+FString FVideoStreamConfig::BuildSdp() const {
+  FString Sdp = FString::Printf(TEXT("v=0\n"
+                                     "o=- 0 0 IN IP4 0.0.0.0\n"
+                                     "s=No Name\n"
+                                     "c=IN IP4 0.0.0.0\n"
+                                     "t=0 0\n"
+                                     "a=tool:libavformat\n"
+                                     "m=video %d RTP/AVP %d\n"
+                                     "a=rtpmap:%d %s/%d\n"),
+                                GetDecoderPort(), PayloadType, PayloadType,
+                                GetRtpEncodingName(Codec), ClockRate);
+  if (!FmtpParams.IsEmpty()) {
+    Sdp += FString::Printf(TEXT("a=fmtp:%d %s\n"), PayloadType, *FmtpParams);
+  }
+  return Sdp;
+}
@@ -0,0 +1,64 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "VideoStreamConfig.generated.h"
+
+UENUM(BlueprintType)
+enum class EVideoCodec : uint8 {
+  H264 UMETA(DisplayName = "H.264"),
+  H265 UMETA(DisplayName = "H.265 / HEVC"),
+  AV1 UMETA(DisplayName = "AV1"),
+};
+
+UENUM(BlueprintType)
+enum class EVideoFrameSource : uint8 {
+  // RTP over UDP, decoded with FFmpeg
+  Network,
+  // Raw BGRA frames from a producer on the same machine (SharedMemoryFrameRing.h)
+  SharedMemory,
+};
+
+// Describes the RTP video stream we receive. The SDP handed to libavformat is
+// generated from this instead of being hard-coded.
+USTRUCT(BlueprintType)
+struct MYBLANKVRPROJECT_API FVideoStreamConfig {
+  GENERATED_BODY()
+
+  // Local UDP port the RTP stream arrives on
+  UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Video")
+  int32 Port = 5253;
+
+  // Dynamic RTP payload type used by the sender
+  UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Video")
+  int32 PayloadType = 96;
+
+  UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Video")
+  EVideoCodec Codec = EVideoCodec::H264;
+
+  UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Video")
+  int32 ClockRate = 90000;
+
+  // Optional a=fmtp parameters, e.g. "packetization-mode=1"
+  UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Video")
+  FString FmtpParams;
+
+  // Repair lost packets from XOR parity sent on FecPort (see RtpFec.h)
+  // before the stream reaches the decoder
+  UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Video|FEC")
+  bool bEnableFec = false;
+
+  UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Video|FEC")
+  int32 FecPort = 5255;
+
+  // Loopback port the repaired stream is relayed to for libavformat
+  UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Video|FEC")
+  int32 DecoderRelayPort = 15253;
+
+  // Port libavformat should read RTP from
+  int32 GetDecoderPort() const { return bEnableFec ? DecoderRelayPort : Port; }
+
+  FString BuildSdp() const;
+};
+
+// RTP encoding name used in a=rtpmap for the given codec
+MYBLANKVRPROJECT_API const TCHAR *GetRtpEncodingName(EVideoCodec Codec);
@@ -0,0 +1,292 @@
+#include "BenchmarkScenarios.h"
+#include "ControlWireProtocol.h"
+#include "HAL/PlatformTime.h"
+#include "Math/RandomStream.h"
+
+namespace {
+ControlWire::FControlPayload RandomControl(FRandomStream &Random) {
+  ControlWire::FControlPayload Payload;
+  Payload.Pitch = Random.FRandRange(-90.0f, 90.0f);
+  Payload.Yaw = Random.FRandRange(-3600.0f, 3600.0f);
+  Payload.TriggerPosition = Random.FRand();
+  Payload.ThumbstickX = Random.FRandRange(-1.0f, 1.0f);
+  return Payload;
+}
+
+// Round trips cannot catch a mistake the encoder and decoder share, such as
+// a wrong byte order or CRC polynomial, so the robot's firmware would
+// disagree with both. Check against values computed outside this codec.
+bool CheckKnownAnswers() {
+  // The standard CRC-32C check value
+  const uint8 CheckInput[] = {'1', '2', '3', '4', '5', '6', '7', '8', '9'};
+  if (ControlWire::Crc32c(CheckInput, sizeof(CheckInput)) != 0xE3069283u) {
+    return false;
+  }
+
+  // Version 2 Control, sequence 0x01020304, timestamp 0x0102030405060708,
+  // pitch 1, yaw -2.5, trigger 0.5, thumbstick 0
+  const uint8 Golden[] = {
+      0x02, 0x01, 0x01, 0x02, 0x03, 0x04, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06,
+      0x07, 0x08, 0xA4, 0xB8, 0x81, 0x26, 0x3F, 0x80, 0x00, 0x00, 0xC0, 0x20,
+      0x00, 0x00, 0x3F, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00};
+  ControlWire::FControlPayload Control;
+  Control.Pitch = 1.0f;
+  Control.Yaw = -2.5f;
+  Control.TriggerPosition = 0.5f;
+  Control.ThumbstickX = 0.0f;
+  uint8 Packet[ControlWire::MaxPacketSize];
+  const int32 Size = ControlWire::Encode(0x01020304u, 0x0102030405060708ull,
+                                         Control, Packet, sizeof(Packet));
+  if (Size != sizeof(Golden) ||
+      FMemory::Memcmp(Packet, Golden, sizeof(Golden)) != 0) {
+    return false;
+  }
+
+  ControlWire::FHeader Header;
+  ControlWire::FControlPayload Decoded;
+  return ControlWire::DecodeHeader(Golden, sizeof(Golden), Header) &&
+         ControlWire::DecodePayload(Golden, sizeof(Golden), Decoded) &&
+         Header.Sequence == 0x01020304u &&
+         Header.TimestampUs == 0x0102030405060708ull &&
+         FMemory::Memcmp(&Decoded, &Control, sizeof(Control)) == 0;
+}
+
+// Encodes and decodes random messages of every type, failing on the first
+// field that does not survive the trip.
+bool CheckRoundTrip(FRandomStream &Random, int32 Iterations) {
+  uint8 Packet[ControlWire::MaxPacketSize];
+  ControlWire::FHeader Header;
+  for (int32 i = 0; i < Iterations; i++) {
+    const uint32 Sequence = (uint32)Random.GetUnsignedInt();
+    const uint64 Timestamp =
+        ((uint64)Random.GetUnsignedInt() << 32) | Random.GetUnsignedInt();
+
+    const ControlWire::FControlPayload Control = RandomControl(Random);
+    ControlWire::FControlPayload ControlOut;
+    int32 Size =
+        ControlWire::Encode(Sequence, Timestamp, Control, Packet, sizeof(Packet));
+    if (!ControlWire::DecodeHeader(Packet, Size, Header) ||
+        !ControlWire::DecodePayload(Packet, Size, ControlOut) ||
+        Header.Sequence != Sequence || Header.TimestampUs != Timestamp ||
+        FMemory::Memcmp(&Control, &ControlOut, sizeof(Control)) != 0) {
+      return false;
+    }
+
+    ControlWire::FTelemetryPayload Telemetry;
+    Telemetry.SpeedMph = Random.FRandRange(0.0f, 60.0f);
+    Telemetry.DistanceFeet = Random.FRandRange(0.0f, 1e6f);
+    Telemetry.ControlBatteryPercentage = (uint8)Random.RandRange(0, 100);
+    Telemetry.DriveBatteryPercentage = (uint8)Random.RandRange(0, 100);
+    ControlWire::FTelemetryPayload TelemetryOut;
+    Size = ControlWire::Encode(Sequence, Timestamp, Telemetry, Packet,
+                               sizeof(Packet));
+    if (!ControlWire::DecodeHeader(Packet, Size, Header) ||
+        !ControlWire::DecodePayload(Packet, Size, TelemetryOut) ||
+        TelemetryOut.SpeedMph != Telemetry.SpeedMph ||
+        TelemetryOut.DistanceFeet != Telemetry.DistanceFeet ||
+        TelemetryOut.ControlBatteryPercentage !=
+            Telemetry.ControlBatteryPercentage ||
+        TelemetryOut.DriveBatteryPercentage !=
+            Telemetry.DriveBatteryPercentage) {
+      return false;
+    }
+
+    ControlWire::FClockSyncPayload Sync;
+    Sync.OriginateUs = Timestamp;
+    Sync.ReceiveUs = Timestamp + Random.RandRange(0, 100000);
+    Sync.TransmitUs = Sync.ReceiveUs + Random.RandRange(0, 1000);
+    ControlWire::FClockSyncPayload SyncOut;
+    Size = ControlWire::Encode(Sequence, Timestamp, Sync, Packet, sizeof(Packet));
+    if (!ControlWire::DecodeHeader(Packet, Size, Header) ||
+        !ControlWire::DecodePayload(Packet, Size, SyncOut) ||
+        SyncOut.OriginateUs != Sync.OriginateUs ||
+        SyncOut.ReceiveUs != Sync.ReceiveUs ||
+        SyncOut.TransmitUs != Sync.TransmitUs) {
+      return false;
+    }
+
+    ControlWire::FDiscoveryPayload Discovery;
+    Discovery.ClockSyncPort = (uint16)Random.RandRange(1, 65535);
+    Discovery.ControlPort = (uint16)Random.RandRange(1, 65535);
+    Discovery.Capabilities = (uint32)Random.GetUnsignedInt();
+    Discovery.SessionId = (uint32)Random.GetUnsignedInt();
+    ControlWire::FDiscoveryPayload DiscoveryOut;
+    Size = ControlWire::Encode(Sequence, Timestamp, Discovery, Packet,
+                               sizeof(Packet));
+    if (!ControlWire::DecodeHeader(Packet, Size, Header) ||
+        !ControlWire::DecodePayload(Packet, Size, DiscoveryOut) ||
+        DiscoveryOut.ClockSyncPort != Discovery.ClockSyncPort ||
+        DiscoveryOut.ControlPort != Discovery.ControlPort ||
+        DiscoveryOut.Capabilities != Discovery.Capabilities ||
+        DiscoveryOut.SessionId != Discovery.SessionId) {
+      return false;
+    }
+
+    ControlWire::FHelloPayload Hello;
+    Hello.SessionId = (uint32)Random.GetUnsignedInt();
+    ControlWire::FHelloPayload HelloOut;
+    Size = ControlWire::Encode(Sequence, Timestamp, Hello, Packet,
+                               sizeof(Packet));
+    if (!ControlWire::DecodeHeader(Packet, Size, Header) ||
+        !ControlWire::DecodePayload(Packet, Size, HelloOut) ||
+        HelloOut.SessionId != Hello.SessionId ||
+        ControlWire::DecodePayload(Packet, Size, DiscoveryOut)) {
+      return false;
+    }
+
+    ControlWire::FControlAckPayload Ack;
+    Ack.AckedSequence = Sequence;
+    Ack.ReceivedMask = (uint32)Random.GetUnsignedInt();
+    Ack.ReceiveUs = Timestamp;
+    ControlWire::FControlAckPayload AckOut;
+    Size = ControlWire::Encode(Sequence, Timestamp, Ack, Packet, sizeof(Packet));
+    if (!ControlWire::DecodeHeader(Packet, Size, Header) ||
+        !ControlWire::DecodePayload(Packet, Size, AckOut) ||
+        AckOut.AckedSequence != Ack.AckedSequence ||
+        AckOut.ReceivedMask != Ack.ReceivedMask ||
+        AckOut.ReceiveUs != Ack.ReceiveUs) {
+      return false;
+    }
+
+    // No other message type may decode as control
+    if (ControlWire::DecodePayload(Packet, Size, ControlOut)) {
+      return false;
+    }
+
+    ControlWire::FControlPayload Bundle[ControlWire::MaxBundleSamples];
+    ControlWire::FControlPayload BundleOut[ControlWire::MaxBundleSamples];
+    const int32 Count = Random.RandRange(1, ControlWire::MaxBundleSamples);
+    for (int32 Sample = 0; Sample < Count; Sample++) {
+      Bundle[Sample] = RandomControl(Random);
+    }
+    Size = ControlWire::EncodeControlBundle(Sequence, Timestamp, Bundle, Count,
+                                            Packet, sizeof(Packet));
+    if (!ControlWire::DecodeHeader(Packet, Size, Header) ||
+        ControlWire::DecodeControlBundle(Packet, Size, BundleOut) != Count ||
+        Header.Sequence != Sequence ||
+        FMemory::Memcmp(Bundle, BundleOut, Count * sizeof(Bundle[0])) != 0 ||
+        ControlWire::DecodePayload(Packet, Size, ControlOut)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+struct FFuzzResult {
+  int64 Mutated = 0;
+  int64 Accepted = 0;
+  int64 RandomAccepted = 0;
+};
+
+// Flips bits in, truncates and extends valid packets, and feeds pure noise.
+// The decoder must stay in bounds; an accepted packet that differs from what
+// was encoded is an undetected corruption.
+FFuzzResult Fuzz(FRandomStream &Random, int32 Iterations) {
+  FFuzzResult Result;
+  uint8 Packet[ControlWire::MaxPacketSize * 2];
+  uint8 Original[ControlWire::MaxPacketSize];
+  ControlWire::FHeader Header;
+  ControlWire::FControlPayload Payload;
+  for (int32 i = 0; i < Iterations; i++) {
+    int32 Size = ControlWire::Encode((uint32)i, (uint64)i * 1000,
+                                     RandomControl(Random), Packet,
+                                     ControlWire::MaxPacketSize);
+    FMemory::Memcpy(Original, Packet, Size);
+    const int32 EncodedSize = Size;
+    const int32 Flips = Random.RandRange(1, 4);
+    for (int32 Flip = 0; Flip < Flips; Flip++) {
+      Packet[Random.RandRange(0, Size - 1)] ^=
+          (uint8)(1 << Random.RandRange(0, 7));
+    }
+    if (Random.FRand() < 0.1f) {
+      Size = Random.RandRange(0, sizeof(Packet));
+    }
+    // Repeated flips of one bit can cancel out
+    if (Size == EncodedSize && FMemory::Memcmp(Packet, Original, Size) == 0) {
+      continue;
+    }
+    Result.Mutated++;
+    if (ControlWire::DecodeHeader(Packet, Size, Header) &&
+        ControlWire::DecodePayload(Packet, Size, Payload)) {
+      Result.Accepted++;
+    }
+
+    const int32 NoiseSize = Random.RandRange(0, sizeof(Packet));
+    for (int32 Byte = 0; Byte < NoiseSize; Byte++) {
+      Packet[Byte] = (uint8)Random.RandRange(0, 255);
+    }
+    if (ControlWire::DecodeHeader(Packet, NoiseSize, Header)) {
+      Result.RandomAccepted++;
+    }
+  }
+  return Result;
+}
+} // namespace
+
+bool BenchmarkScenarios::RunWireCodec(const FString &Params,
+                                      TSharedRef<FJsonObject> Report) {
+  int32 Iterations = 1000000;
+  int32 Seed = 1;
+  FParse::Value(*Params, TEXT("Iterations="), Iterations);
+  FParse::Value(*Params, TEXT("Seed="), Seed);
+  FRandomStream Random(Seed);
+
+  const bool bKnownAnswers = CheckKnownAnswers();
+  const bool bRoundTrip = CheckRoundTrip(Random, FMath::Min(Iterations, 100000));
+  const FFuzzResult FuzzResult = Fuzz(Random, Iterations);
+
+  // Throughput over a pre-generated batch so the RNG stays out of the loop
+  TArray<ControlWire::FControlPayload> Inputs;
+  for (int32 i = 0; i < 1024; i++) {
+    Inputs.Add(RandomControl(Random));
+  }
+  uint8 Packet[ControlWire::MaxPacketSize];
+  ControlWire::FHeader Header;
+  ControlWire::FControlPayload Decoded;
+  uint64 Checksum = 0;
+
+  double Start = FPlatformTime::Seconds();
+  for (int32 i = 0; i < Iterations; i++) {
+    Checksum += ControlWire::Encode((uint32)i, (uint64)i, Inputs[i & 1023],
+                                    Packet, sizeof(Packet));
+    Checksum += Packet[ControlWire::CrcOffset];
+  }
+  const double EncodeSeconds = FPlatformTime::Seconds() - Start;
+
+  const int32 Size = ControlWire::Encode(1, 1, Inputs[0], Packet,
+                                         sizeof(Packet));
+  Start = FPlatformTime::Seconds();
+  for (int32 i = 0; i < Iterations; i++) {
+    if (ControlWire::DecodeHeader(Packet, Size, Header) &&
+        ControlWire::DecodePayload(Packet, Size, Decoded)) {
+      Checksum += Header.Sequence;
+    }
+  }
+  const double DecodeSeconds = FPlatformTime::Seconds() - Start;
+
+  const double EncodeNs = EncodeSeconds * 1e9 / FMath::Max(1, Iterations);
+  const double DecodeNs = DecodeSeconds * 1e9 / FMath::Max(1, Iterations);
+  UE_LOG(LogTemp, Display,
+         TEXT("WireCodec: known answers %s, round trip %s, fuzz accepted "
+              "%lld/%lld mutated and %lld random, encode %.1f ns, decode "
+              "%.1f ns (%llu)"),
+         bKnownAnswers ? TEXT("ok") : TEXT("FAILED"),
+         bRoundTrip ? TEXT("ok") : TEXT("FAILED"), FuzzResult.Accepted,
+         FuzzResult.Mutated, FuzzResult.RandomAccepted, EncodeNs, DecodeNs,
+         Checksum);
+
+  Report->SetNumberField(TEXT("iterations"), Iterations);
+  Report->SetBoolField(TEXT("known_answers_ok"), bKnownAnswers);
+  Report->SetBoolField(TEXT("round_trip_ok"), bRoundTrip);
+  Report->SetNumberField(TEXT("fuzz_mutated"), (double)FuzzResult.Mutated);
+  Report->SetNumberField(TEXT("fuzz_accepted"), (double)FuzzResult.Accepted);
+  Report->SetNumberField(TEXT("fuzz_random_accepted"),
+                         (double)FuzzResult.RandomAccepted);
+  Report->SetNumberField(TEXT("packet_bytes"),
+                         ControlWire::PacketSize<ControlWire::FControlPayload>);
+  Report->SetNumberField(TEXT("encode_ns_per_packet"), EncodeNs);
+  Report->SetNumberField(TEXT("decode_ns_per_packet"), DecodeNs);
+  // A CRC-32C collision on a bit flip of at most 4 bits cannot happen at this
+  // packet length, so any accepted mutation is a codec bug.
+  return bKnownAnswers && bRoundTrip && FuzzResult.Accepted == 0;
+}